@@ -0,0 +1,65 @@
+#ifndef ANIMATED_LOGO_LAYER_H
+#define ANIMATED_LOGO_LAYER_H
+
+#include "DynamicLayer.h"
+#include "WatermarkCoverage.h"
+#include "WatermarkImage.h"
+#include <memory>
+#include <vector>
+
+// 动画logo（GIF/APNG等多帧图片）：按媒体时间循环选择一帧，原尺寸叠加到(x, y)处，
+// 每帧只混合logo的包围盒，并按覆盖索引跳过透明区域。
+// 只有一帧时就是静态logo，由LayerCompositor作为水印之上的框内静态层绘制
+class AnimatedLogoLayer : public DynamicLayer
+{
+public:
+    AnimatedLogoLayer();
+
+    // frames按startMs递增，在所有副本之间共享；loopMs是一轮动画的时长；(x, y)向下取偶数对齐色度块
+    bool Initialize(std::shared_ptr<const std::vector<ImageFrame>> frames, int width, int height,
+                    int64_t loopMs, int x, int y, float alpha);
+
+    std::unique_ptr<DynamicLayer> Clone() const override;
+    bool Prepare(int64_t frameNumber, int64_t mediaTimeMs, int frameWidth, int frameHeight,
+                 FrameRect& outRect) override;
+    void Draw(const LayerTarget& target) override;
+    std::string Describe() const override;
+
+    // 只混合包围盒与regions（起止为偶数，可以互相重叠）相交的部分，重叠处只混合一次
+    void DrawRegions(const LayerTarget& target, const FrameRect* regions, size_t count);
+
+private:
+    // 一帧logo转换到目标格式后的平面：[0]=Y [1]=U [2]=V，每个平面配alpha平面和覆盖索引
+    struct PlaneSet
+    {
+        std::vector<uint8_t> planes[3];
+        std::vector<uint8_t> alpha[3];
+        WatermarkCoverage coverage[3];
+    };
+
+    // 目标的色度采样、范围或颜色矩阵与已转换的不同时，重新转换所有帧（通常只在第一帧发生一次）
+    void ConvertFrames(const LayerTarget& target);
+    // 把平面p的第row行中 [x0, x1)（logo内的坐标）混合到out（logo这一行在画面中的起点）
+    void BlendRow(const PlaneSet& set, int p, uint8_t* out, int row, int x0, int x1) const;
+
+    std::shared_ptr<const std::vector<ImageFrame>> frames_;
+    int width_;
+    int height_;
+    int64_t loopMs_;
+    int x_;
+    int y_;
+    int alpha255_;
+
+    std::vector<PlaneSet> converted_;
+    int chromaShiftW_;
+    int chromaShiftH_;
+    bool fullRange_;
+    bool bt709_;
+
+    size_t current_;
+    FrameRect rect_;
+    // DrawRegions中一行的区间，合并重叠的区域
+    std::vector<std::pair<int, int>> spans_;
+};
+
+#endif
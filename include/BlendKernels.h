@@ -0,0 +1,128 @@
+#ifndef BLEND_KERNELS_H
+#define BLEND_KERNELS_H
+
+#include <cstdint>
+#include <vector>
+
+// CPU水印混合内核，与WatermarkPS.hlsl相同：out = lerp(video, wm, wm.a * alpha)
+// 所有指令集实现使用同一个定点公式，结果逐字节一致：
+//   a   = div255(wm.a * alpha255)
+//   out = div255(video * (255 - a) + wm * a)
+// 其中 div255(x) 是四舍五入的 x/255，alpha255 = round(alpha * 255)
+// x86上有SSE4.1/AVX2/AVX-512版本，其他架构只有标量实现（NEON版本需要在aarch64上编译和测试后再加入），
+// 每个版本与标量实现的一致性由tests/BlendKernelsTest.cpp检查
+
+enum class BlendIsa
+{
+    Scalar,
+    SSE41,
+    AVX2,
+    AVX512
+};
+
+// 平面格式：dst与wm是同一平面（Y/U/V或单个颜色通道）的一行，wmA是对应的水印alpha
+typedef void (*BlendPlanarFn)(uint8_t* dst, const uint8_t* wm, const uint8_t* wmA,
+                              int alpha255, int count);
+// 平面格式，水印alpha在整段内相同（不透明区域）：a是已经乘过全局alpha的系数
+typedef void (*BlendUniformFn)(uint8_t* dst, const uint8_t* wm, int a, int count);
+// 预乘格式（见BlendPlan）：pm = wm * a，inv = 255 - a，out = div255(dst * inv + pm)
+typedef void (*BlendPremulFn)(uint8_t* dst, const uint16_t* pm, const uint8_t* inv, int count);
+// 打包格式：wmRGBA是RGBA水印；dst为RGB24，或与水印通道顺序相同的4字节像素（第4字节保持不变）
+typedef void (*BlendPackedFn)(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count);
+
+// 融合转换的一对输入行和输出行：两行BGRA在一遍中完成水印混合并写出两行Y和一行U/V（YUV420P）
+// pm/inv是BGRA元素顺序的预乘计划（见BlendPlan::BuildPackedBGRA），nullptr表示这一行没有水印；
+// 高度为奇数时最后一行与自己配对，两个指针相同
+struct BgraToYuvRows
+{
+    const uint8_t* bgra[2];
+    const uint16_t* pm[2];
+    const uint8_t* inv[2];
+    uint8_t* y[2];
+    uint8_t* u;
+    uint8_t* v;
+};
+
+// 从第x个像素（偶数）开始的行
+inline BgraToYuvRows AdvanceBgraToYuvRows(const BgraToYuvRows& rows, int x)
+{
+    BgraToYuvRows out;
+    for (int r = 0; r < 2; r++) {
+        out.bgra[r] = rows.bgra[r] + x * 4;
+        out.pm[r] = rows.pm[r] ? rows.pm[r] + x * 4 : nullptr;
+        out.inv[r] = rows.inv[r] ? rows.inv[r] + x * 4 : nullptr;
+        out.y[r] = rows.y[r] + x;
+    }
+    out.u = rows.u + x / 2;
+    out.v = rows.v + x / 2;
+    return out;
+}
+
+// BGRA -> 混合水印 -> YUV420P（BT.601有限范围，色度取2x2平均），count个像素，
+// 前wmCount个像素有水印；count为奇数时（画面宽度为奇数）最后一列与自己配对
+typedef void (*BlendBgraToYuv420Fn)(const BgraToYuvRows& rows, int count, int wmCount);
+
+struct BlendKernels
+{
+    BlendIsa isa;
+    const char* name;
+    BlendPlanarFn planar;
+    BlendUniformFn planarUniform;
+    BlendPremulFn premul;
+    BlendPackedFn packedRGB24;
+    BlendPackedFn packedRGBA;
+    BlendBgraToYuv420Fn bgraToYuv420;
+};
+
+// 四舍五入的 x/255，x 取值范围 [0, 65025]
+constexpr int BlendDiv255(int x)
+{
+    return ((x + 128) + ((x + 128) >> 8)) >> 8;
+}
+
+inline int BlendAlpha255(float alpha)
+{
+    if (alpha <= 0.0f) return 0;
+    if (alpha >= 1.0f) return 255;
+    return static_cast<int>(alpha * 255.0f + 0.5f);
+}
+
+// 标量参考实现，也用于SIMD实现处理行尾
+void BlendPlanarScalar(uint8_t* dst, const uint8_t* wm, const uint8_t* wmA, int alpha255, int count);
+void BlendPlanarUniformScalar(uint8_t* dst, const uint8_t* wm, int a, int count);
+void BlendPremulScalar(uint8_t* dst, const uint16_t* pm, const uint8_t* inv, int count);
+void BlendPackedRGB24Scalar(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count);
+void BlendPackedRGBAScalar(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count);
+void BlendBgraToYuv420Scalar(const BgraToYuvRows& rows, int count, int wmCount);
+
+// BT.601有限范围的RGB->YUV，与swscale默认的系数相同；SIMD实现使用相同的定点公式
+inline uint8_t BlendRgbToY(int r, int g, int b)
+{
+    return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline uint8_t BlendRgbToU(int r, int g, int b)
+{
+    return static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+inline uint8_t BlendRgbToV(int r, int g, int b)
+{
+    return static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// 各指令集实现，没有针对对应架构编译时返回nullptr
+const BlendKernels* GetBlendKernelsSSE41();
+const BlendKernels* GetBlendKernelsAVX2();
+const BlendKernels* GetBlendKernelsAVX512();
+
+// 首次调用时根据CPUID选择当前CPU支持的最快实现
+const BlendKernels& GetBlendKernels();
+
+// 当前CPU支持的所有实现，按从慢到快排列（第一个总是标量实现）
+std::vector<const BlendKernels*> GetSupportedBlendKernels();
+
+// 逐个指令集测量吞吐量并与标量结果比对，输出报告
+void ReportBlendKernelThroughput(int width, int height, int iterations);
+
+#endif
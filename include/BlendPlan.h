@@ -0,0 +1,61 @@
+#ifndef BLEND_PLAN_H
+#define BLEND_PLAN_H
+
+#include "BlendKernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 预先编译好的水印混合计划：水印和全局alpha在整个任务内不变，
+// 构建时就把 a = div255(wm.a * alpha255) 和预乘后的 wm * a 算好，
+// 每帧只剩 out = div255(dst * (255 - a) + pm) 的一次乘加
+//
+// 存储为SoA：8位的 (255 - a) 系数平面 + 16位的预乘水印平面，
+// 元素顺序与目标行的字节顺序一致（RGB24每个像素展开为3个元素），每行起始地址64字节对齐
+class BlendPlan
+{
+public:
+    BlendPlan();
+
+    // 行指针指向内部缓冲区，不允许复制
+    BlendPlan(const BlendPlan&) = delete;
+    BlendPlan& operator=(const BlendPlan&) = delete;
+
+    // RGBA水印 -> RGB24目标，wmStride为水印相邻两行的字节间隔
+    bool BuildPackedRGB24(const uint8_t* wmRGBA, int wmStride, int width, int height, int alpha255);
+    // RGBA水印 -> BGRA目标（每个像素4个元素，第4个元素的系数使目标保持原值），用于融合转换内核
+    bool BuildPackedBGRA(const uint8_t* wmRGBA, int wmStride, int width, int height, int alpha255);
+    // 单个平面（Y/U/V），wm与wmA使用相同的行间隔
+    bool BuildPlanar(const uint8_t* wm, const uint8_t* wmA, int wmStride, int width, int height, int alpha255);
+
+    // 混合目标行中的 [x, x + count) 元素；元素单位是目标的字节（RGB24像素x对应元素3x）
+    void BlendRow(const BlendKernels& kernels, uint8_t* dstRow, int y, int x, int count) const
+    {
+        kernels.premul(dstRow + x, PremulRow(y) + x, InvRow(y) + x, count);
+    }
+
+    const uint16_t* PremulRow(int y) const { return premul_ + static_cast<size_t>(y) * premulStride_; }
+    const uint8_t* InvRow(int y) const { return inv_ + static_cast<size_t>(y) * invStride_; }
+
+    int GetElementsPerRow() const { return elementsPerRow_; }
+    int GetHeight() const { return height_; }
+    int GetAlpha255() const { return alpha255_; }
+    bool IsEmpty() const { return elementsPerRow_ == 0 || height_ == 0; }
+    size_t GetMemoryBytes() const { return storage_.size(); }
+
+private:
+    bool Allocate(int elementsPerRow, int height, int alpha255);
+
+    std::vector<uint8_t> storage_;
+    uint8_t* inv_;
+    uint16_t* premul_;
+    int invStride_;      // 字节
+    int premulStride_;   // uint16_t个数
+    int elementsPerRow_;
+    int height_;
+    int alpha255_;
+    // coef_[wa] = div255(wa * alpha255)，构建时查表代替逐像素乘除
+    uint8_t coef_[256];
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef CAPTURE_RING_H
+#define CAPTURE_RING_H
+
+#include "DirtyRegion.h"
+#include "ScratchArena.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 环满（编码跟不上采集）时如何处理新采集的帧
+enum class DropPolicy
+{
+    DropOldest,   // 丢弃还没编码的最旧一帧，保证编码的总是最新画面（延迟最低）
+    DropNewest,   // 丢弃刚采集的这一帧，已排队的帧保持不变
+    Block         // 采集线程等待编码线程腾出槽位，不丢帧，但会拖慢采集时钟
+};
+
+const char* DropPolicyName(DropPolicy policy);
+
+// 环中的一个槽位：一帧BGRA画面及其采集信息
+// 只有dirty区域内的像素是这一帧的内容，其余像素是槽位上次使用时留下的，不应读取
+struct CaptureSlot
+{
+    ScratchArena buffer;
+    int linesize;
+    int64_t index;          // 采集时刻的序号
+    int64_t timestampUs;    // 来源给出的采集时间，编码时换算成pts，丢帧时pts保持原来的间隔
+    double captureStartMs;  // 开始采集的时间，用于计算延迟
+    // 相对编码线程处理的上一帧变化的区域；DropOldest复用被丢弃的槽位时保留其中的区域，
+    // 生产者需要在此基础上添加新的变化，保证丢帧不会丢失变化
+    DirtyRegion dirty;
+};
+
+struct CaptureRingStats
+{
+    int64_t captured;   // 从来源采集到的帧数
+    int64_t dropped;    // 因环满被丢弃的帧数
+    int64_t encoded;    // 编码线程取走并处理完的帧数
+    int64_t blocked;    // Block策略下采集线程等待的次数
+};
+
+// 采集线程 -> 编码线程之间预先分配好的帧环（单生产者/单消费者）
+// 槽位在初始化时一次分配，录制过程中只在空闲/就绪/使用中之间流转
+class CaptureRing
+{
+public:
+    CaptureRing();
+
+    CaptureRing(const CaptureRing&) = delete;
+    CaptureRing& operator=(const CaptureRing&) = delete;
+
+    // capacity至少为3：生产者和消费者各占一个槽位，至少还要有一个槽位排队
+    // 槽位缓冲区按width x height的BGRA分配
+    bool Initialize(int capacity, DropPolicy policy, int width, int height);
+
+    // 生产者：取一个槽位写入新帧，空闲槽位的dirty为空
+    // DropNewest且环满时返回nullptr（这一帧计为丢弃，生产者需要把它的变化留给下一帧），环已中止时也返回nullptr
+    // keep为true时这一帧不能丢弃（可变帧率的最后一帧）：DropNewest且环满时与Block一样等待空闲槽位
+    CaptureSlot* AcquireWrite(bool keep);
+    void CommitWrite(CaptureSlot* slot);
+    // 生产者写完最后一帧后调用
+    void Close();
+
+    // 消费者：等待下一帧，环关闭且已取空时返回nullptr
+    CaptureSlot* AcquireRead();
+    void ReleaseRead(CaptureSlot* slot);
+
+    // 任意一方出错时调用，唤醒另一方并让它退出
+    void Abort();
+    bool IsAborted() const;
+
+    // 已就绪、还没被消费者取走的帧数，用于观察编码线程是否跟得上
+    int GetReadyCount() const;
+
+    CaptureRingStats GetStats() const;
+    DropPolicy GetPolicy() const { return policy_; }
+    int GetCapacity() const { return capacity_; }
+
+private:
+    int PopReady();
+
+    std::unique_ptr<CaptureSlot[]> slots_;
+    int capacity_;
+    DropPolicy policy_;
+
+    // 空闲槽位栈和就绪槽位的循环队列，容量在初始化时确定，不会再分配
+    std::vector<int> free_;
+    std::vector<int> ready_;
+    int readyHead_;
+    int readyCount_;
+
+    bool closed_;
+    bool aborted_;
+    CaptureRingStats stats_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable readyCond_;
+    std::condition_variable freeCond_;
+};
+
+#endif
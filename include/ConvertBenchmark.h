@@ -0,0 +1,8 @@
+#ifndef CONVERT_BENCHMARK_H
+#define CONVERT_BENCHMARK_H
+
+// 录屏转换吞吐量测试：旧的多遍流程（BGRA->RGBA重排、RGBA->RGB24、混合水印、
+// 逐行复制到AVFrame、sws_scale RGB24->YUV420P）与融合转换内核对比，输出报告
+void ReportBgraToYuvThroughput(int width, int height, int iterations);
+
+#endif
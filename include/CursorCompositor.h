@@ -0,0 +1,102 @@
+#ifndef CURSOR_COMPOSITOR_H
+#define CURSOR_COMPOSITOR_H
+
+#include "BlendKernels.h"
+#include "FrameSource.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 指针形状的格式，取值与DXGI_OUTDUPL_POINTER_SHAPE_TYPE相同
+enum class CursorShapeType
+{
+    Monochrome = 1,   // 1位AND掩码在前、1位XOR掩码在后，height是两个掩码的总行数
+    Color = 2,        // BGRA，按alpha混合
+    MaskedColor = 4   // BGRA，第4字节为0时直接替换屏幕颜色，为0xFF时与屏幕颜色异或
+};
+
+// 来源提供的一个指针形状，data由调用方持有，只在SetShape期间使用
+struct CursorShape
+{
+    CursorShapeType type;
+    const uint8_t* data;
+    size_t size;
+    int width;
+    int height;
+    int pitch;
+    int hotSpotX;
+    int hotSpotY;
+};
+
+struct CursorCacheStats
+{
+    int64_t hits;     // 形状已在缓存中，直接复用
+    int64_t misses;   // 需要解码的形状
+    int cached;       // 当前缓存的形状数
+};
+
+// CPU光标合成：每个指针形状解码一次，得到与BlendPlan相同的预乘格式（BGRA元素顺序）
+//   out = div255(dst * inv + pm) ^ xor
+// 三种形状都用这一个公式表示：彩色指针 inv = 255 - a、pm = c * a；单色指针的黑/白像素 inv = 0，
+// 透明像素 inv = 255、pm = 0，反色像素再加上 xor = 0xFF；带掩码彩色指针的异或像素 inv = 255、xor = c。
+// 混合用当前CPU最快的premul内核，只有含异或像素的形状才多一遍异或。
+// 解码结果按形状内容的哈希缓存，同一个形状再次出现（例如在文本框和按钮之间来回移动）时不再解码
+class CursorCompositor
+{
+public:
+    static const int kDefaultCacheSize = 16;
+
+    // kernels为nullptr时使用当前CPU最快的实现；测试时指定某个指令集与标量实现比对
+    explicit CursorCompositor(int cacheSize = kDefaultCacheSize, const BlendKernels* kernels = nullptr);
+
+    CursorCompositor(const CursorCompositor&) = delete;
+    CursorCompositor& operator=(const CursorCompositor&) = delete;
+
+    // 切换到这个形状：命中缓存时直接复用，否则解码并替换最久没有使用的缓存项
+    // 形状的尺寸或数据大小不合法时返回false，当前形状保持不变
+    bool SetShape(const CursorShape& shape);
+    bool HasShape() const { return current_ >= 0; }
+
+    // 指针位于(x, y)时光标占据的矩形（左上角为位置减去热点），可能超出画面
+    bool GetRect(int x, int y, FrameRect& rect) const;
+    // 把当前形状画到BGRA画面上，指针位于(x, y)，超出画面的部分被裁掉；画面的第4字节保持不变
+    void Composite(uint8_t* frame, int linesize, int width, int height, int x, int y) const;
+
+    CursorCacheStats GetStats() const;
+
+    static uint64_t HashShape(const CursorShape& shape);
+
+private:
+    struct Sprite
+    {
+        uint64_t hash;
+        CursorShapeType type;
+        int width;
+        int height;   // 解码后的行数，单色指针是原始height的一半
+        int pitch;
+        int hotSpotX;
+        int hotSpotY;
+        std::vector<uint8_t> source;  // 原始形状数据，哈希相同时逐字节比对
+        std::vector<uint16_t> pm;
+        std::vector<uint8_t> inv;
+        std::vector<uint8_t> xorMask; // 没有异或像素时为空
+        // 每行不透明像素的区间[spanBegin, spanEnd)，全透明的行为空区间
+        std::vector<int> spanBegin;
+        std::vector<int> spanEnd;
+        int64_t lastUse;
+    };
+
+    static bool Validate(const CursorShape& shape);
+    static bool Matches(const Sprite& sprite, const CursorShape& shape, uint64_t hash);
+    static void Decode(const CursorShape& shape, uint64_t hash, Sprite& sprite);
+
+    const BlendKernels& kernels_;
+    std::vector<Sprite> cache_;
+    int cacheSize_;
+    int current_;
+    int64_t useClock_;
+    int64_t hits_;
+    int64_t misses_;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef D3DPROCESSOR_H
 #define D3DPROCESSOR_H
 
+#include "ScratchArena.h"
 #include <d3d11.h>
 #include <dxgi.h>
 #include <d3dcompiler.h>
@@ -30,11 +31,15 @@ public:
     bool CreateTextureFromRGBA(const unsigned char* rgbaData, int width, int height,
                                ID3D11Texture2D** texture,
                                ID3D11ShaderResourceView** srv);
-    bool UpdateTextureData(ID3D11Texture2D* texture, const unsigned char* data, int width, int height);
-    bool BlendTextures(ID3D11ShaderResourceView* videoSRV,
-                      ID3D11ShaderResourceView* watermarkSRV,
-                      float alpha,
-                      unsigned char* outputData);
+    // data为RGBA，与纹理格式相同，直接上传不经过中间缓冲区
+    bool UpdateTextureRGBA(ID3D11Texture2D* texture, const unsigned char* rgbaData, int linesize);
+    // 混合后直接返回映射的staging纹理（RGBA，行间隔为RowPitch），调用方读完后调用UnmapBlendResult
+    bool BlendTexturesMapped(ID3D11ShaderResourceView* videoSRV,
+                             ID3D11ShaderResourceView* watermarkSRV,
+                             float alpha,
+                             const unsigned char** rgbaData,
+                             int* linesize);
+    void UnmapBlendResult();
     void Cleanup();
 
 private:
@@ -42,6 +47,10 @@ private:
     bool CompileShaders();
     bool CreateBuffers();
     bool CreateSamplerState();
+    bool RenderBlend(ID3D11ShaderResourceView* videoSRV,
+                     ID3D11ShaderResourceView* watermarkSRV,
+                     float alpha);
+    bool MapBlendResult(const unsigned char** rgbaData, int* linesize);
 
     ComPtr<ID3D11Device> device_;
     ComPtr<ID3D11DeviceContext> context_;
@@ -59,6 +68,7 @@ private:
     ComPtr<ID3D11RenderTargetView> renderTargetView_;
     ComPtr<ID3D11Texture2D> renderTargetTexture_;
     ComPtr<ID3D11Texture2D> stagingTexture_;  // 缓存staging纹理，避免每帧创建
+    ScratchArena uploadArena_;                // RGB->RGBA上传缓冲区，避免每帧分配
     
     int width_;
     int height_;
@@ -4,6 +4,7 @@
 #include <d3d11.h>
 #include <dxgi1_2.h>
 #include <wrl/client.h>
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <vector>
@@ -19,9 +20,17 @@ public:
     bool CaptureFrame();
     void Cleanup();
 
-    // 获取捕获的纹理
+    // 获取捕获的纹理（不含鼠标）
     ID3D11Texture2D* GetCapturedTexture() const { return m_capturedTexture.Get(); }
+    // 把鼠标画到读回的BGRA桌面画面上，画面尺寸与桌面相同
+    void DrawMouse(uint8_t* frame, int linesize) const;
     
+    // 最近一次CaptureFrame是否取到了新帧（超时没有新帧时为false，纹理保持上一帧）
+    bool IsFrameUpdated() const { return m_frameUpdated; }
+    // 新帧相对上一帧的移动区域和脏区域（桌面坐标），鼠标的新旧位置也计入脏区域
+    const std::vector<DXGI_OUTDUPL_MOVE_RECT>& GetMoveRects() const { return m_moveRects; }
+    const std::vector<RECT>& GetDirtyRects() const { return m_dirtyRects; }
+
     // 获取桌面尺寸
     int GetWidth() const { return m_width; }
     int GetHeight() const { return m_height; }
@@ -30,6 +39,7 @@ private:
     bool InitializeD3D();
     bool InitializeDXGI();
     bool ProcessFrame(IDXGIResource* resource);
+    void ReadFrameMetadata(UINT bufferSize);
     void SaveTextureToFile(ID3D11Texture2D* texture, const std::wstring& filename);
 
     // D3D11相关
@@ -51,4 +61,12 @@ private:
     DXGI_OUTPUT_DESC m_outputDesc;
 
     bool m_initialized;
+
+    // 变化区域
+    bool m_frameUpdated;
+    std::vector<BYTE> m_metadataBuffer;
+    std::vector<DXGI_OUTDUPL_MOVE_RECT> m_moveRects;
+    std::vector<RECT> m_dirtyRects;
+    RECT m_cursorRect;
+    bool m_cursorVisible;
 };
\ No newline at end of file
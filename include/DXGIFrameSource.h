@@ -0,0 +1,39 @@
+#pragma once
+
+#include "FrameSource.h"
+#include "DXGICapture.h"
+#include <chrono>
+#include <vector>
+
+// 真实桌面：DXGI桌面复制，从GPU读回到CPU内存，鼠标在读回后由CPU画上
+// 只读回DXGI报告的变化区域，frame_始终保存完整的当前桌面（含鼠标）
+class DXGIFrameSource : public FrameSource
+{
+public:
+    DXGIFrameSource();
+
+    DXGIFrameSource(const DXGIFrameSource&) = delete;
+    DXGIFrameSource& operator=(const DXGIFrameSource&) = delete;
+
+    bool Initialize() override;
+    bool CaptureFrame(CapturedFrame& frame) override;
+
+    int GetWidth() const override { return capture_.GetWidth(); }
+    int GetHeight() const override { return capture_.GetHeight(); }
+    const char* GetName() const override { return "桌面"; }
+    bool IsRealtime() const override { return true; }
+
+private:
+    DXGICapture capture_;
+
+    // staging纹理在整个录制过程中复用，读回的数据紧密排列
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> stagingTexture_;
+    std::vector<uint8_t> frame_;
+    bool hasFrame_;
+
+    std::vector<FrameRect> dirtyRects_;
+    std::vector<FrameMove> moveRects_;
+    std::vector<FrameRect> readbackRects_;
+    std::chrono::steady_clock::time_point startTime_;
+    bool started_;
+};
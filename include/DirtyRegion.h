@@ -0,0 +1,41 @@
+#ifndef DIRTY_REGION_H
+#define DIRTY_REGION_H
+
+#include "FrameSource.h"
+#include <cstdint>
+#include <vector>
+
+// 一帧中需要重新处理的区域：若干个裁剪到画面内、起止坐标扩展到偶数的矩形
+// 矩形数量有上限，超过时合并成外接矩形；变化面积超过画面的一定比例时直接视为整帧，
+// 整帧一次处理比逐个小矩形处理更快。容量在Reset时分配，之后添加矩形不再分配内存
+class DirtyRegion
+{
+public:
+    static const int kMaxRects = 64;
+
+    DirtyRegion();
+
+    void Reset(int width, int height);
+    void Clear();
+    void SetFull();
+
+    void Add(const FrameRect& rect);
+    void Add(const DirtyRegion& other);
+    // 一帧的变化区域和移动目标；来源不提供变化信息时视为整帧
+    void AddFrame(const CapturedFrame& frame);
+
+    bool IsEmpty() const { return rects_.empty(); }
+    bool IsFull() const { return full_; }
+    const std::vector<FrameRect>& GetRects() const { return rects_; }
+    // 各矩形面积之和（重叠部分重复计算）
+    int64_t GetArea() const { return area_; }
+
+private:
+    std::vector<FrameRect> rects_;
+    int width_;
+    int height_;
+    int64_t area_;
+    bool full_;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef DYNAMIC_LAYER_H
+#define DYNAMIC_LAYER_H
+
+#include "FrameSource.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// 动态层绘制的目标：8位平面YUV（4:2:0/4:2:2/4:4:4）
+struct LayerTarget
+{
+    uint8_t* const* data;
+    const int* linesize;
+    int chromaShiftW;
+    int chromaShiftH;
+    bool fullRange;   // 全范围（YUVJ），否则为有限范围
+    bool bt709;       // 颜色矩阵，否则为BT.601
+};
+
+// 随时间变化的层（逐帧文字、动画logo）：不能预先合并到水印中，
+// 每帧在YUV平面上单独绘制，只处理自己的包围盒
+class DynamicLayer
+{
+public:
+    virtual ~DynamicLayer() {}
+
+    // 每个处理器实例（分段并行时每个分段）使用自己的副本，共享的只读数据（图集、动画帧）不复制
+    virtual std::unique_ptr<DynamicLayer> Clone() const = 0;
+
+    // 准备这一帧的内容；outRect是裁剪到画面内的包围盒（起点为偶数），这一帧不可见时返回false
+    virtual bool Prepare(int64_t frameNumber, int64_t mediaTimeMs, int frameWidth, int frameHeight,
+                         FrameRect& outRect) = 0;
+    // 把Prepare准备的内容混合到target上
+    virtual void Draw(const LayerTarget& target) = 0;
+
+    // 统计输出中使用的描述（类型、尺寸等）
+    virtual std::string Describe() const = 0;
+};
+
+#endif
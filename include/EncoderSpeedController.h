@@ -0,0 +1,69 @@
+#ifndef ENCODER_SPEED_CONTROLLER_H
+#define ENCODER_SPEED_CONTROLLER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// x264编码速度的一档：分析选项（x264-params）、前瞻帧数和相对基准的CRF增量
+// 各档只改变不写入SPS/PPS的分析选项，取值与同名x264预设相同；profile、熵编码（CABAC）、8x8变换、
+// 参考帧数、B帧等参数集中的设置由起始预设决定，各档相同。换档后新编码器的参数集与文件头中的一致，
+// MP4（avc1）等只在文件头中保存一组参数集的容器也能中途换档
+// 用码率控制的编码器（录屏）把CRF增量换算成码率：每+6码率减半
+struct EncoderSpeedLevel
+{
+    const char* name;     // 分析选项对应的x264预设，只用于日志
+    const char* params;
+    int lookahead;        // rc-lookahead
+    int crfOffset;
+};
+
+// 编码速度控制：按帧收集编码耗时和输入队列深度，在GOP边界决定是否换档
+// 跟不上目标帧率时换快一档（先降低分析强度，到最快的分析选项后再提高CRF），连续几个GOP都有富余时换回慢一档，
+// 不会比起始预设更慢。控制器只做决策，重新配置编码器由调用方完成（换档需要重新打开编码器）
+// 只在编码线程中使用
+class EncoderSpeedController
+{
+public:
+    EncoderSpeedController();
+
+    // basePreset: 起始预设（medium、fast或veryfast），编码器始终用这个预设，它的分析选项也是允许的最慢一档；targetFps: 需要保持的帧率，每帧的预算为1000/targetFps毫秒
+    // queueCapacity: 编码阶段输入队列的容量；0表示不看队列（离线处理时队列总是满的，只看编码耗时）
+    bool Initialize(const std::string& basePreset, double targetFps, int queueCapacity);
+
+    // 每处理一帧调用：encodeMs是这一帧在编码线程上的耗时，queueDepth是取这一帧时输入队列中的帧数
+    void OnFrameEncoded(double encodeMs, int queueDepth);
+    // 在GOP边界调用，根据这个GOP的统计决定是否换档；换档时返回true，调用方按GetLevel()重新配置编码器
+    bool OnGopBoundary();
+
+    const EncoderSpeedLevel& GetLevel() const;
+    // 当前档位的x264-params；lookahead为false时不设置rc-lookahead（zerolatency不使用前瞻）
+    std::string GetX264Params(bool lookahead) const;
+    int GetAdjustments() const { return adjustments_; }
+    void PrintSummary() const;
+
+private:
+    void ChangeLevel(int level, double averageMs, double averageQueue);
+
+    int baseLevel_;
+    int level_;
+    double budgetMs_;
+    int queueCapacity_;
+
+    // 当前GOP的统计
+    int64_t frames_;
+    double encodeMsSum_;
+    int64_t queueSum_;
+
+    int64_t gops_;
+    // 换回慢一档前需要连续有富余的GOP数；换慢后马上又跟不上时加倍，避免来回振荡
+    int calmGops_;
+    int holdGops_;
+    int64_t lastSlowerGop_;
+    bool warnedAtFastest_;
+
+    int adjustments_;
+    std::vector<int64_t> gopsAtLevel_;
+};
+
+#endif
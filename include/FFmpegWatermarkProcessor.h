@@ -1,6 +1,8 @@
 #ifndef FFMPEG_WATERMARK_PROCESSOR_H
 #define FFMPEG_WATERMARK_PROCESSOR_H
 
+#include "MediaDecode.h"
+#include "StreamPassthrough.h"
 #include <string>
 
 extern "C" {
@@ -26,8 +28,11 @@ public:
                      const std::string& watermarkPath,
                      float alpha = 0.3f);
 
-    // 静态方法：获取视频尺寸
-    static bool GetVideoDimensions(const std::string& path, int& width, int& height);
+    // 流水线队列深度：0为单线程顺序处理，大于0时解码/filter/编码各用一个线程
+    void SetPipelineDepth(int depth) { pipelineDepth_ = depth; }
+
+    // 只处理输入的一段（分段并行处理时使用），输出文件只包含这一段
+    void SetSegment(const SegmentRange& segment) { segment_ = segment; }
 
 private:
     bool OpenInput(const std::string& path);
@@ -55,6 +60,11 @@ private:
     int width_;
     int height_;
     AVPixelFormat pixelFormat_;
+
+    int pipelineDepth_;
+    SegmentRange segment_;
+    // 音频、字幕等非视频流的直通，同时负责写入视频包（与直通包共用一把锁）
+    StreamPassthrough passthrough_;
 };
 
 #endif
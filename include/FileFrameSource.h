@@ -0,0 +1,54 @@
+#ifndef FILE_FRAME_SOURCE_H
+#define FILE_FRAME_SOURCE_H
+
+#include "FrameSource.h"
+#include <string>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+// 把录好的视频当作桌面回放：逐帧解码并转换为BGRA
+// 读到文件末尾后从头循环，时间戳按视频的pts累加，保证单调递增
+class FileFrameSource : public FrameSource
+{
+public:
+    explicit FileFrameSource(const std::string& path);
+    ~FileFrameSource() override;
+
+    FileFrameSource(const FileFrameSource&) = delete;
+    FileFrameSource& operator=(const FileFrameSource&) = delete;
+
+    bool Initialize() override;
+    bool CaptureFrame(CapturedFrame& frame) override;
+
+    int GetWidth() const override { return width_; }
+    int GetHeight() const override { return height_; }
+    const char* GetName() const override { return "视频回放"; }
+    bool IsRealtime() const override { return false; }
+
+private:
+    bool Rewind();
+    void Cleanup();
+
+    std::string path_;
+    AVFormatContext* formatCtx_;
+    AVCodecContext* decoderCtx_;
+    SwsContext* swsCtx_;
+    AVPacket* packet_;
+    AVFrame* bgraFrame_;
+    int videoStreamIndex_;
+    int width_;
+    int height_;
+
+    // 时间戳（微秒）：loopOffsetUs_是之前各轮回放的总时长
+    int64_t firstPtsUs_;
+    int64_t lastPtsUs_;
+    int64_t frameDurationUs_;
+    int64_t loopOffsetUs_;
+    int64_t frameCount_;
+};
+
+#endif
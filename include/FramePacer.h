@@ -0,0 +1,54 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "Histogram.h"
+#include <chrono>
+#include <cstdint>
+
+// 实时采集的节拍：第i个采集时刻的截止时间是 start + i * 1s / fps（整数纳秒，不累积取整误差），
+// 总是相对录制开始的绝对时刻等待，某一帧慢了不会推迟之后的所有时刻。
+// 落后超过一帧时跳过错过的时刻（输出中表现为上一帧多显示一段时间），而不是连续补采。
+// 同时统计唤醒抖动、迟到和跳过的时刻，以及来源时间戳相对节拍的漂移
+class FramePacer
+{
+public:
+    FramePacer();
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    void Start(std::chrono::steady_clock::time_point start, int fps);
+    void Stop();
+
+    // 等到第tick个时刻；已经落后超过一帧时不等待，返回跳过错过的时刻后实际采集的序号（>= tick）
+    int64_t WaitForTick(int64_t tick);
+    // 第tick个时刻采集到的画面，timestampUs是来源给出的采集时间，用于计算漂移
+    void OnFrameCaptured(int64_t tick, int64_t timestampUs);
+
+    int64_t GetMissedTicks() const { return missedTicks_; }
+    void PrintReport() const;
+
+private:
+    std::chrono::steady_clock::time_point Deadline(int64_t tick) const;
+
+    std::chrono::steady_clock::time_point start_;
+    int fps_;
+    int64_t frameNs_;
+    bool timerRaised_;
+
+    // 醒来的时刻相对截止时间的延迟（毫秒）；超过帧间隔10%的计为迟到
+    Histogram lateness_;
+    int64_t lateTicks_;
+    int64_t missedTicks_;
+
+    // 来源时间戳相对节拍的偏移（毫秒）：timestamp - 第一帧timestamp - (tick - 第一帧tick) / fps
+    bool hasFirstFrame_;
+    int64_t firstTick_;
+    int64_t firstTimestampUs_;
+    double lastDriftMs_;
+    double maxDriftMs_;
+    Histogram drift_;
+};
+
+#endif
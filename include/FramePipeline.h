@@ -0,0 +1,103 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+// 有界的单生产者/单消费者无锁队列，只传递AVFrame指针
+// 队列满时生产者等待（背压），队列空时消费者等待
+class FrameQueue
+{
+public:
+    explicit FrameQueue(int capacity);
+
+    // 只能由生产者线程调用
+    bool TryPush(AVFrame* frame);
+    // 生产者写完最后一帧后调用，之后消费者取空队列即表示结束
+    void Close();
+
+    // 只能由消费者线程调用，队列为空时返回nullptr
+    AVFrame* TryPop();
+    bool IsClosed() const { return closed_.load(std::memory_order_acquire); }
+
+    int Size() const;
+    int Capacity() const { return static_cast<int>(capacity_); }
+
+private:
+    std::vector<AVFrame*> slots_;
+    size_t capacity_;
+    // 生产者和消费者各自写的下标放在不同的缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+    alignas(64) std::atomic<bool> closed_;
+};
+
+// 把处理好的帧交给下一阶段（转移所有权），下一阶段已经停止时返回false
+typedef std::function<bool(AVFrame* frame)> PipelineEmitFn;
+// 解码阶段：每次输出一帧到*frame（调用方拥有），没有更多帧时*frame为nullptr；出错返回false
+typedef std::function<bool(AVFrame** frame)> PipelineSourceFn;
+// 混合阶段：拥有frame，结果通过emit输出（可以是0到多帧）；frame为nullptr表示输入结束，借此刷新内部缓存
+typedef std::function<bool(AVFrame* frame, const PipelineEmitFn& emit)> PipelineTransformFn;
+// 编码阶段：拥有frame；frame为nullptr表示刷新编码器
+typedef std::function<bool(AVFrame* frame)> PipelineSinkFn;
+
+struct PipelineStageStats
+{
+    const char* name;
+    int64_t frames;
+    double busySeconds;        // 阶段本身的处理时间
+    double waitInputSeconds;   // 上游没有数据时的等待时间
+    double waitOutputSeconds;  // 下游队列满时的等待时间（背压）
+};
+
+struct PipelineQueueStats
+{
+    int64_t samples;
+    int64_t occupancySum;      // 每次取帧时队列中的帧数之和
+    int64_t fullCount;         // 生产者遇到队列满的次数
+};
+
+// 解码 -> 混合 -> 编码 三阶段流水线
+// queueDepth > 0 时每个阶段各占一个线程，阶段之间用深度为queueDepth的FrameQueue连接；
+// queueDepth == 0 时在调用线程上按顺序执行，行为与原来的单线程循环相同
+class FramePipeline
+{
+public:
+    explicit FramePipeline(int queueDepth);
+
+    bool Run(const PipelineSourceFn& decode,
+             const PipelineTransformFn& blend,
+             const PipelineSinkFn& encode);
+
+    // 输出每个阶段的忙碌/等待比例、队列平均占用，并指出瓶颈阶段
+    void PrintStats() const;
+
+private:
+    bool RunSequential(const PipelineSourceFn& decode,
+                       const PipelineTransformFn& blend,
+                       const PipelineSinkFn& encode);
+    bool RunThreaded(const PipelineSourceFn& decode,
+                     const PipelineTransformFn& blend,
+                     const PipelineSinkFn& encode);
+
+    // 阻塞的入队/出队，流水线中止时返回false/nullptr
+    bool Push(FrameQueue& queue, PipelineQueueStats& queueStats, AVFrame* frame, double& waitSeconds);
+    AVFrame* Pop(FrameQueue& queue, PipelineQueueStats& queueStats, double& waitSeconds);
+    void Abort();
+
+    int queueDepth_;
+    std::atomic<bool> aborted_;
+    PipelineStageStats stages_[3];
+    PipelineQueueStats queues_[2];
+    double wallSeconds_;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <cstddef>
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+// 固定格式/尺寸的视频帧缓冲池，基于AVBufferPool
+// Acquire返回的帧可以像普通帧一样交给编码器或用av_frame_free释放，
+// 最后一个引用释放时数据缓冲区自动回到池中；池本身可以先于帧销毁
+// 缓冲池是线程安全的，流水线中混合线程取帧、编码线程释放帧没有问题
+class FramePool
+{
+public:
+    FramePool();
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    bool Initialize(AVPixelFormat format, int width, int height);
+    bool IsInitialized() const { return pool_ != nullptr; }
+
+    // 从池中取一帧，失败返回nullptr
+    AVFrame* Acquire();
+
+private:
+    void Release();
+
+    AVBufferPool* pool_;
+    AVPixelFormat format_;
+    int width_;
+    int height_;
+    int linesize_[4];
+    size_t bufferSize_;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <cstdint>
+
+// 画面中的一个矩形区域（像素）
+struct FrameRect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// 画面中的一块内容从(sourceX, sourceY)整体移动到destination（窗口拖动、滚动）
+struct FrameMove
+{
+    int sourceX;
+    int sourceY;
+    FrameRect destination;
+};
+
+// 采集到的一帧画面，BGRA（与DXGI桌面复制的格式相同），每行linesize字节
+// data由FrameSource持有，在下一次CaptureFrame之前有效
+struct CapturedFrame
+{
+    const uint8_t* data;
+    int linesize;
+    int width;
+    int height;
+    int64_t timestampUs;  // 采集时间（微秒），第一帧为0
+    bool updated;         // 与上一帧相比画面是否有变化
+
+    // 与上一帧相比变化的区域，由来源持有，与data的有效期相同
+    // hasDirtyRects为false表示来源不提供变化信息，整帧都视为变化；
+    // 移动区域的目标位置同样是变化的，需要和dirtyRects一起处理
+    bool hasDirtyRects;
+    const FrameRect* dirtyRects;
+    int dirtyRectCount;
+    const FrameMove* moveRects;
+    int moveRectCount;
+};
+
+// 录屏的画面来源：真实桌面（DXGI），或者在没有显示器/GPU的机器上
+// 用合成画面、录好的视频代替桌面，测量录制管线本身的吞吐量和延迟
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    virtual bool Initialize() = 0;
+    virtual bool CaptureFrame(CapturedFrame& frame) = 0;
+
+    virtual int GetWidth() const = 0;
+    virtual int GetHeight() const = 0;
+    virtual const char* GetName() const = 0;
+
+    // 实时来源按墙上时钟出帧，录制循环需要按帧率等待；
+    // 非实时来源每次调用立即产生下一帧，录制循环全速运行用于测量
+    virtual bool IsRealtime() const = 0;
+};
+
+#endif
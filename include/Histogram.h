@@ -0,0 +1,35 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+// 固定分桶的直方图，用于在录制结束时输出时间分布（节拍抖动、延迟）
+// 分桶边界在构造时确定，Add不分配内存，可以在录制循环中使用；只在一个线程中使用
+class Histogram
+{
+public:
+    // bounds: 各桶的上界（不含），升序；最后还有一个不小于最大上界的桶
+    explicit Histogram(const std::vector<double>& bounds);
+
+    void Add(double value);
+    void Clear();
+
+    int64_t GetCount() const { return count_; }
+    double GetMean() const { return count_ > 0 ? sum_ / count_ : 0.0; }
+    double GetMax() const { return max_; }
+    // 不小于threshold的样本数（threshold必须是某个桶的边界）
+    int64_t CountAtLeast(double threshold) const;
+
+    // 每个非空桶一行：区间、样本数、占比和比例条
+    void Print(const char* title, const char* unit) const;
+
+private:
+    std::vector<double> bounds_;
+    std::vector<int64_t> counts_;
+    int64_t count_;
+    double sum_;
+    double max_;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef LAYER_COMPOSITOR_H
+#define LAYER_COMPOSITOR_H
+
+#include "AnimatedLogoLayer.h"
+#include "DynamicLayer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// 静态层：整个处理过程中不变（图片logo、平铺的文字水印），DirectX方法开始时合并成一个整幅水印
+struct StaticLayer
+{
+    std::string name;
+    const unsigned char* rgba;  // 非预乘RGBA
+    int width;
+    int height;
+    int x;          // 平铺层忽略位置，从(0,0)起按单元重复到整个画面
+    int y;
+    bool tiled;
+    float alpha;
+};
+
+// 按顺序（后面的层在上面）把静态层合并成一个非预乘RGBA水印，各层的透明度乘进alpha，
+// 混合时全局透明度用1.0，每帧只做一次混合。
+// 结果是frameWidth x frameHeight，只用于DirectX方法（水印纹理拉伸到整帧）；
+// YUV方法和录屏的平铺单元保持周期性，logo作为LayerCompositor的框内静态层单独混合
+void FlattenStaticLayers(const std::vector<StaticLayer>& layers, int frameWidth, int frameHeight,
+                         std::vector<unsigned char>& outRGBA, int& outWidth, int& outHeight);
+
+// 多层水印的逐帧部分：静态水印（平铺单元或图片）由处理器按原来的方式混合，这里只记录它的耗时；
+// 静态logo每帧在水印之上只混合自己的包围盒（录屏时只混合变化的区域）；
+// 动态层每帧在各自的包围盒内单独绘制。按层统计每帧的耗时和处理的面积
+class LayerCompositor
+{
+public:
+    LayerCompositor();
+    // 复制时动态层各自Clone，每个处理器实例有自己的状态
+    LayerCompositor(const LayerCompositor& other);
+    LayerCompositor& operator=(const LayerCompositor& other);
+
+    // 合并进静态水印的层的名字（只用于统计输出）；fused表示静态水印的混合与格式转换融合在一起，没有单独的耗时
+    void SetStaticLayers(const std::vector<std::string>& names, bool fused);
+    // 静态logo（只有一帧的AnimatedLogoLayer），在静态水印之上、动态层之下
+    void AddStaticLogo(std::unique_ptr<AnimatedLogoLayer> logo);
+    bool HasStaticLogos() const { return !logos_.empty(); }
+    void AddDynamicLayer(std::unique_ptr<DynamicLayer> layer);
+    bool HasDynamicLayers() const { return !layers_.empty(); }
+
+    // 在刚混合好静态水印的regions（起止为偶数）中混合静态logo，只处理与logo包围盒相交的部分
+    void DrawStaticLogos(const LayerTarget& target, const FrameRect* regions, size_t count,
+                         int frameWidth, int frameHeight);
+
+    // 准备所有动态层的这一帧，返回可见的层的包围盒（绘制之前需要保存背景时使用）
+    const std::vector<FrameRect>& Prepare(int64_t frameNumber, int64_t mediaTimeMs, int frameWidth, int frameHeight);
+    // 按添加的顺序绘制Prepare之后可见的层
+    void Draw(const LayerTarget& target);
+
+    // 记录一帧静态水印的混合耗时
+    void AddStaticTime(double seconds);
+
+    void PrintSummary() const;
+
+private:
+    struct LayerStats
+    {
+        std::unique_ptr<DynamicLayer> layer;
+        bool visible;
+        int64_t frames;
+        int64_t pixels;
+        double seconds;
+    };
+
+    struct LogoStats
+    {
+        std::unique_ptr<AnimatedLogoLayer> logo;
+        int64_t frames;
+        int64_t pixels;
+        double seconds;
+    };
+
+    std::vector<std::string> staticNames_;
+    bool staticFused_;
+    int64_t staticFrames_;
+    double staticSeconds_;
+
+    std::vector<LogoStats> logos_;
+
+    std::vector<LayerStats> layers_;
+    std::vector<FrameRect> rects_;
+};
+
+#endif
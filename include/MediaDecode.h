@@ -0,0 +1,52 @@
+#ifndef MEDIA_DECODE_H
+#define MEDIA_DECODE_H
+
+#include <cstdint>
+#include <string>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+class StreamPassthrough;
+
+// 输入视频中的一段 [startPts, endPts)，单位是视频流的time_base
+// startPts应是关键帧的时间戳；两端为AV_NOPTS_VALUE表示不限制
+struct SegmentRange
+{
+    int64_t startPts;
+    int64_t endPts;
+};
+
+inline SegmentRange WholeFileRange()
+{
+    return { AV_NOPTS_VALUE, AV_NOPTS_VALUE };
+}
+
+inline bool IsWholeFile(const SegmentRange& range)
+{
+    return range.startPts == AV_NOPTS_VALUE && range.endPts == AV_NOPTS_VALUE;
+}
+
+// 打开输入文件，找到第一个视频流并打开它的解码器
+// 失败时已经创建的上下文仍留在*formatCtx/*decoderCtx中，由调用方照常释放
+bool OpenVideoDecoder(const std::string& path, AVFormatContext** formatCtx, int& streamIndex,
+                      AVCodecContext** decoderCtx);
+
+// 只读取第一个视频流的尺寸，不打开解码器
+bool GetVideoDimensions(const std::string& path, int& width, int& height);
+
+// 定位到分段起点所在的关键帧，整个文件时不做任何操作
+bool SeekToSegment(AVFormatContext* formatCtx, int streamIndex, const SegmentRange& range);
+
+// 读取streamIndex的数据包并解码出下一帧（新分配，调用方拥有）
+// 输入读完后自动刷新解码器，解码器也刷新完毕时*frame为nullptr
+// 指定range时丢弃起点之前的帧（开放GOP的前导B帧），遇到终点及之后的帧即视为结束
+// 指定passthrough时，读到的其他流的数据包直接交给它写入输出
+bool DecodeNextFrame(AVFormatContext* formatCtx, AVCodecContext* decoderCtx,
+                     int streamIndex, AVPacket* packet, AVFrame** frame,
+                     const SegmentRange* range = nullptr,
+                     StreamPassthrough* passthrough = nullptr);
+
+#endif
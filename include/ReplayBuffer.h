@@ -0,0 +1,109 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+struct ReplayBufferStats
+{
+    int64_t packets;        // 当前缓冲的包数
+    int64_t bytes;          // 当前占用的内存（包数据、附加数据和AVPacket结构）
+    int64_t peakBytes;
+    int gops;               // 当前缓冲的GOP数
+    int64_t durationMs;     // 当前缓冲覆盖的时长
+    int64_t evictedGops;    // 超出时长窗口而淘汰的GOP数
+    int64_t memoryEvictions;// 因内存上限提前淘汰的GOP数（这时缓冲的时长可能不足窗口）
+    int64_t droppedPackets; // 第一个关键帧之前、无法独立解码而丢弃的包
+};
+
+// 缓冲区某一时刻的快照：包只增加引用计数，不复制数据，可以交给另一个线程写文件
+class ReplayClip
+{
+public:
+    ReplayClip();
+    ~ReplayClip();
+
+    ReplayClip(const ReplayClip&) = delete;
+    ReplayClip& operator=(const ReplayClip&) = delete;
+
+    // 流复制写入文件（格式由扩展名决定），不重新编码；时间戳平移到从0开始
+    bool WriteToFile(const std::string& path) const;
+
+    int64_t GetDurationMs() const { return durationMs_; }
+    size_t GetPacketCount() const { return packets_.size(); }
+    int64_t GetBytes() const { return bytes_; }
+
+private:
+    friend class ReplayBuffer;
+    void Reset();
+
+    std::vector<AVPacket*> packets_;
+    AVCodecParameters* codecpar_;
+    AVRational timeBase_;
+    int64_t durationMs_;
+    int64_t bytes_;
+};
+
+// 即时回放：编码后的包按GOP保存在内存中，只保留最近一段时间，需要时写成文件而不重新编码
+// 每个GOP从关键帧开始，淘汰时整个GOP一起淘汰，保证缓冲区的第一个包总是关键帧；
+// 保留覆盖时长窗口所需的最少GOP数，所以实际缓冲的时长在[窗口, 窗口 + 一个GOP)之间。
+// 只在编码线程中使用；快照之后写文件可以在任意线程进行
+class ReplayBuffer
+{
+public:
+    ReplayBuffer();
+    ~ReplayBuffer();
+
+    ReplayBuffer(const ReplayBuffer&) = delete;
+    ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+    // codecCtx必须已经打开（需要其中的extradata）；包的时间戳使用codecCtx的time_base
+    // maxBytes为0表示不限内存，否则超过时从最旧的GOP开始提前淘汰（至少保留正在写入的GOP）
+    bool Initialize(const AVCodecContext* codecCtx, int64_t windowMs, int64_t maxBytes);
+
+    // 加入一个编码输出的包（增加引用，不复制数据）
+    bool Append(const AVPacket* packet);
+
+    // 当前缓冲的所有包的快照，缓冲区为空时返回false
+    bool Snapshot(ReplayClip& clip) const;
+
+    void Clear();
+    ReplayBufferStats GetStats() const;
+
+private:
+    struct Gop
+    {
+        int64_t startPts;
+        int packets;
+        int64_t bytes;
+    };
+
+    static int64_t PacketBytes(const AVPacket* packet);
+    void EvictFront();
+    void Compact();
+    int64_t DurationMs() const;
+
+    AVCodecParameters* codecpar_;
+    AVRational timeBase_;
+    int64_t window_;        // 时长窗口，单位为timeBase_
+    int64_t maxBytes_;
+
+    // 按到达顺序保存，[packetHead_, size)是有效的包，[gopHead_, size)是有效的GOP；
+    // 前面淘汰掉的部分积累到一半时整体前移，vector的容量保留，稳定运行后不再分配
+    std::vector<AVPacket*> packets_;
+    std::vector<Gop> gops_;
+    size_t packetHead_;
+    size_t gopHead_;
+    // 淘汰的AVPacket结构留着给后面的包复用，稳定运行后不再分配
+    std::vector<AVPacket*> spare_;
+    int64_t lastPts_;
+
+    ReplayBufferStats stats_;
+};
+
+#endif
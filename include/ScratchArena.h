@@ -0,0 +1,102 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 热循环中的堆分配计数：count/bytes是帧级别的大块缓冲区（帧缓冲池、临时缓冲区），
+// smallCount/smallBytes是每帧的小对象（AVFrame描述结构、文字叠加的字符串和排版缓冲区等）
+// 不包括FFmpeg编解码器内部的分配
+struct AllocationStats
+{
+    int64_t count;
+    int64_t bytes;
+    int64_t smallCount;
+    int64_t smallBytes;
+};
+
+// 一个任务（一次处理或录制、分段并行时的一段）的分配计数
+// 任务的各个线程用AllocationScope绑定同一个计数器，分配计入当前线程绑定的计数器，
+// 同时运行的几个任务互不干扰；没有绑定的线程（初始化、生成水印图片等）不计数
+class AllocationCounter
+{
+public:
+    AllocationCounter();
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    void Add(size_t bytes, bool small);
+    AllocationStats Get() const;
+
+private:
+    std::atomic<int64_t> count_;
+    std::atomic<int64_t> bytes_;
+    std::atomic<int64_t> smallCount_;
+    std::atomic<int64_t> smallBytes_;
+};
+
+// 在作用域内把当前线程绑定到counter（可以为nullptr），结束时恢复原来的绑定
+class AllocationScope
+{
+public:
+    explicit AllocationScope(AllocationCounter* counter);
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    AllocationCounter* previous_;
+};
+
+// 当前线程绑定的计数器，启动子线程的代码用它把绑定传给子线程
+AllocationCounter* GetAllocationCounter();
+// 计入当前线程绑定的计数器：大块缓冲区和小对象
+void RecordAllocation(size_t bytes);
+void RecordSmallAllocation(size_t bytes);
+
+// 可重复使用的临时缓冲区，由处理器持有
+// 只在请求的大小超过当前容量时重新分配，稳态下每帧不分配内存
+class ScratchArena
+{
+public:
+    ScratchArena() {}
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    // 返回至少bytes字节的缓冲区，内容不保证保留
+    uint8_t* Get(size_t bytes);
+    const uint8_t* Data() const { return buffer_.data(); }
+    size_t GetCapacity() const { return buffer_.size(); }
+
+private:
+    std::vector<uint8_t> buffer_;
+};
+
+// 统计一个任务的分配情况：前warmupFrames帧用于填满缓冲池和流水线队列，
+// 之后的稳态阶段大块缓冲区的分配次数应为0；小对象（主要是每帧的AVFrame）按帧分配，只报告每帧的次数
+// 任务的线程需要用AllocationScope绑定GetCounter()
+class AllocationMonitor
+{
+public:
+    explicit AllocationMonitor(int warmupFrames);
+
+    AllocationCounter* GetCounter() { return &counter_; }
+    // 每完成一帧调用一次（可以在任意一个阶段的线程中调用，但只能是同一个线程）
+    void OnFrameDone(int64_t frameCount);
+    void PrintSummary() const;
+
+private:
+    AllocationCounter counter_;
+    int warmupFrames_;
+    AllocationStats warm_;
+    int64_t warmFrames_;
+    int64_t frames_;
+    bool warmed_;
+};
+
+#endif
@@ -1,20 +1,79 @@
 #pragma once
 
+#include "BlendPlan.h"
+#include "CaptureRing.h"
+#include "EncoderSpeedController.h"
+#include "FramePacer.h"
+#include "FramePool.h"
+#include "FrameSource.h"
+#include "Histogram.h"
+#include "LayerCompositor.h"
+#include "ReplayBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
-class DXGICapture;
-class D3DProcessor;
-
 class ScreenRecorder {
 public:
     ScreenRecorder();
     ~ScreenRecorder();
 
+    // 画面来源（DXGIFrameSource、SyntheticFrameSource、FileFrameSource），
+    // 由调用方创建并初始化（通常先用它获取画面尺寸来生成水印），必须在RecordScreen之前设置
+    void SetFrameSource(std::unique_ptr<FrameSource> source) { source_ = std::move(source); }
+
+    // 采集线程和编码线程之间的帧环：容量（至少3）和环满时的丢帧策略
+    void SetRingSize(int frames) { ringSize_ = frames; }
+    void SetDropPolicy(DropPolicy policy) { dropPolicy_ = policy; }
+
+    // 可变帧率：画面（包括鼠标）没有变化时不输出帧，pts取自采集时间戳（毫秒时间基）；
+    // 距上一次输出超过maxGapMs时输出一帧保活，避免播放器认为流中断
+    void SetVariableFrameRate(bool enabled, int maxGapMs)
+    {
+        vfr_ = enabled;
+        maxGapUs_ = static_cast<int64_t>(maxGapMs) * 1000;
+    }
+
+    // 即时回放：编码后的包只保存在内存中，保留最近seconds秒（按GOP对齐），不写文件；
+    // 每次RequestReplaySave时把当前缓冲写成<输出文件名>_replay_<序号>.<扩展名>，
+    // 录制结束时把最后的缓冲写到outputPath。maxMegabytes为0表示不限内存。seconds为0时关闭
+    void SetReplay(int seconds, int maxMegabytes)
+    {
+        replaySeconds_ = seconds;
+        replayMaxBytes_ = static_cast<int64_t>(maxMegabytes) * 1024 * 1024;
+    }
+    // 可以在任意线程调用（例如热键或控制台按键），编码线程在处理完当前帧后保存
+    void RequestReplaySave() { replayRequests_++; }
+
+    // 低延迟模式：不用B帧，周期帧内刷新代替关键帧，VBV把每帧限制在一帧时间的码率内，
+    // 按条带多线程编码，每个包写入后立即刷新到文件。不能与即时回放同时使用。
+    // latencySloMs大于0时统计从开始采集到写入文件超过该时间的帧
+    void SetLowLatency(bool enabled, int latencySloMs)
+    {
+        lowLatency_ = enabled;
+        latencySloMs_ = latencySloMs;
+    }
+
+    // 编码速度自适应：编码线程跟不上帧率或帧环积压时，在GOP边界把x264换快一档（预设，然后是码率），
+    // 有富余时再换回来。换预设需要重新打开编码器，新编码器的SPS/PPS放在码流中
+    void SetAdaptiveSpeed(bool enabled) { adaptive_ = enabled; }
+
+    // 水印数据是周期平铺的一个单元（WatermarkTile，宽高为偶数），按单元尺寸取模重复到整个画面
+    void SetWatermarkTiled(bool tiled) { watermarkTiled_ = tiled; }
+
+    // 多层水印：RecordScreen的水印是静态水印（平铺单元或图片，可以没有），这里是静态logo、
+    // 动态层（逐帧文字、动画logo）和各层的统计；静态logo在变化区域与其包围盒的交集内重新混合，
+    // 动态层每帧在水印之上绘制，都只处理各自的包围盒。引用的图集等由调用方保证录制期间有效
+    void SetLayers(const LayerCompositor& layers) { layers_ = layers; }
+
     // 录制桌面并叠加水印
     // duration: 录制时长（秒）
     // fps: 帧率
-    // watermarkData: 水印数据（RGBA格式）
+    // watermarkData: 水印数据（RGBA格式），从左上角叠加一次；SetWatermarkTiled时是平铺单元
     // watermarkWidth/Height: 水印尺寸
     // alpha: 水印透明度
     bool RecordScreen(const std::string& outputPath, 
@@ -26,19 +85,55 @@ public:
                      float alpha);
 
 private:
+    // 每帧各环节耗时，用于输出吞吐量和延迟报告
+    struct RecorderStats
+    {
+        int64_t frames;
+        double captureSeconds;   // 采集线程：采集并复制到帧环
+        double convertSeconds;   // 变化区域的BGRA->YUV420P融合转换（包括水印混合）
+        double encodeSeconds;
+        double wallSeconds;
+        int64_t dirtyPixels;     // 各帧变化区域的面积之和
+        int64_t fullFrames;      // 按整帧处理的帧数
+        int64_t yuvCopies;       // 编码器仍占用YUV帧时复制的次数
+        int64_t skippedFrames;   // 可变帧率下画面未变化而没有输出的采集时刻
+        int64_t unchangedFrames; // 编码的未变化帧（固定帧率的静止帧，可变帧率的保活帧和结尾帧）
+        // 每个输出包从开始采集到写入文件（即时回放时为放入缓冲）的时间（毫秒）
+        std::vector<double> latencyMs;
+    };
+
     bool InitializeCapture();
-    bool InitializeEncoder(const std::string& outputPath, int width, int height, int fps);
-    bool CaptureAndProcessFrame();
+    bool InitializeEncoder(const std::string& outputPath);
+    // 按当前的速度档位创建并打开codecCtx_
+    bool OpenEncoder();
+    // 在GOP边界换档：刷新并关闭当前编码器，按新档位重新打开
+    bool ReopenEncoder();
+    // 采集线程
+    bool CaptureLoop(int totalFrames);
+    // 调用RecordScreen的线程：从帧环取帧，转换、混合并编码
+    bool EncodeLoop(AllocationMonitor& allocMonitor);
+    bool EncodeFrame(const CaptureSlot& slot);
+    bool PrepareYuvFrame();
+    void ConvertRegion(const CaptureSlot& slot, const FrameRect& rect);
+    int64_t NextPts(const CaptureSlot& slot);
+    // 在yuvFrame_上绘制这一帧的动态层，先保存各层包围盒下面的画面
+    void DrawDynamicLayers(const CaptureSlot& slot);
+    // 动态层包围盒的画面与overlayBackground_之间复制：save为true时保存，否则还原
+    void CopyOverlayBackground(bool save);
+    bool ReceivePackets();
+    // 快照回放缓冲并写入path；background时在单独的线程中写，不阻塞编码
+    bool SaveReplayClip(const std::string& path, bool background);
+    std::string ReplayClipPath(int index) const;
+    void PrintStats() const;
     void Cleanup();
 
-    DXGICapture* capture_;
-    D3DProcessor* d3dProcessor_;
+    std::unique_ptr<FrameSource> source_;
     
     // FFmpeg编码相关
     struct AVFormatContext* formatCtx_;
     struct AVCodecContext* codecCtx_;
     struct AVStream* videoStream_;
-    struct SwsContext* swsCtx_;
+    struct AVPacket* packet_;
     
     int width_;
     int height_;
@@ -50,11 +145,71 @@ private:
     int watermarkWidth_;
     int watermarkHeight_;
     float alpha_;
-    
-    // DirectX纹理和资源
-    void* videoTexture_;
-    void* watermarkTexture_;
-    void* videoSRV_;
-    void* watermarkSRV_;
-};
+    bool watermarkTiled_;
+
+    // 水印在录制期间不变，预先构建BGRA顺序的混合计划，由融合转换内核在CPU上混合
+    BlendPlan blendPlan_;
+    int blendWidth_;
+    int blendHeight_;
+
+    // 持久的YUV帧：每帧只更新变化区域，编码器仍占用时换成池中的另一帧
+    FramePool yuvPool_;
+    struct AVFrame* yuvFrame_;
+
+    // 动态层：帧槽中只有变化区域是新内容，不能从采集的画面重新转换动态层覆盖的区域，
+    // 所以绘制前保存这些区域的YUV，下一帧转换变化区域之前还原
+    LayerCompositor layers_;
+    std::vector<FrameRect> overlayRects_;
+    std::vector<size_t> overlayOffsets_;    // 每个包围盒在overlayBackground_中的起点，每帧复用
+    std::vector<uint8_t> overlayBackground_;
+
+    CaptureRing ring_;
+    DropPolicy dropPolicy_;
+    int ringSize_;
+    // 采集线程：还没交给编码线程的变化区域
+    DirtyRegion pending_;
+
+    // 实时来源的采集节拍（绝对截止时间、抖动和漂移统计），只在采集线程中使用
+    FramePacer pacer_;
 
+    // 可变帧率：采集线程记录上一次输出的采集时间戳
+    // 编码线程把相对第一帧的采集时间戳换算成pts（固定帧率为帧时刻，可变帧率为毫秒）
+    bool vfr_;
+    int64_t maxGapUs_;
+    int64_t lastEmitUs_;
+    int64_t firstTimestampUs_;
+    int64_t lastPts_;
+    int64_t lastKeyPts_;
+
+    // 按pts记录每帧开始采集的时间（相对于startTime_），收到对应的包时计算延迟
+    // 以pts对表长取模存放并保存pts用于核对：固定帧率时表长等于总帧数，
+    // 可变帧率时pts以毫秒计，表长覆盖约65秒内仍在编码器中的帧
+    struct PendingLatency
+    {
+        int64_t pts;
+        double captureStartMs;
+    };
+    std::chrono::steady_clock::time_point startTime_;
+    std::vector<PendingLatency> captureStart_;
+
+    // 即时回放
+    int replaySeconds_;
+    int64_t replayMaxBytes_;
+    ReplayBuffer replay_;
+    std::atomic<int> replayRequests_;
+    std::thread replaySaver_;
+    std::string outputPath_;
+    int replayClips_;
+
+    // 低延迟模式和延迟分布（只在编码线程中更新）
+    bool lowLatency_;
+    int latencySloMs_;
+    Histogram latency_;
+
+    // 编码速度自适应
+    bool adaptive_;
+    bool globalHeader_;
+    EncoderSpeedController speed_;
+    int64_t lastDts_;
+    RecorderStats stats_;
+};
@@ -0,0 +1,88 @@
+#ifndef SEGMENT_PARALLEL_PROCESSOR_H
+#define SEGMENT_PARALLEL_PROCESSOR_H
+
+#include "MediaDecode.h"
+#include "StreamPassthrough.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+// 一个按GOP对齐的分段
+struct VideoSegment
+{
+    int index;
+    SegmentRange range;
+    int64_t frames;      // 扫描关键帧时统计的帧数，用于分配负载和计算fps
+    std::string path;    // 分段的临时输出文件
+    bool copy;           // 区间模式下与所有区间都不重叠的GOP，拼接时直接从输入复制，不经过工作线程
+};
+
+// 需要加水印的时间区间（秒，从视频开头算起），--range start-end
+struct TimeRange
+{
+    double start;
+    double end;
+};
+
+// 长视频分段并行处理：
+// 1. 扫描输入的关键帧，按GOP边界切成若干段
+// 2. 多个工作线程各自用独立的解码器/编码器上下文处理分段，写入临时文件
+// 3. 按顺序以流复制的方式把分段拼接成一个输出文件，时间戳保持连续；
+//    音频等其他流在拼接时从原始输入直通
+class SegmentParallelProcessor
+{
+public:
+    // 处理一个分段：把输入中segment.range范围内的帧加水印后编码写入segment.path
+    typedef std::function<bool(const VideoSegment& segment)> SegmentWorkFn;
+
+    SegmentParallelProcessor();
+    ~SegmentParallelProcessor();
+
+    // 只给这些区间加水印：与区间重叠的GOP重新编码，其余GOP按原样复制
+    // 区间边界向外扩展到关键帧（开放GOP时扩展到IDR），输入必须是H.264才能与重新编码的GOP拼接
+    void SetRanges(const std::vector<TimeRange>& ranges) { ranges_ = ranges; }
+
+    // workerCount为0时使用CPU核心数
+    bool ProcessVideo(const std::string& inputPath,
+                      const std::string& outputPath,
+                      int workerCount,
+                      const SegmentWorkFn& work);
+
+private:
+    struct WorkerStats
+    {
+        int segments;
+        int64_t frames;
+        double seconds;
+    };
+
+    bool ScanKeyframes(const std::string& inputPath);
+    void BuildSegments(const std::string& outputPath, int workerCount);
+    void BuildRangeSegments(const std::string& outputPath, int workerCount);
+    void AddSegment(int firstGop, int endGop, bool copy, const std::string& outputPath);
+    bool RunWorkers(int workerCount, const SegmentWorkFn& work);
+    bool StitchSegments(const std::string& inputPath, const std::string& outputPath);
+    void RemoveSegmentFiles();
+    void PrintWorkerStats(double wallSeconds) const;
+
+    // 关键帧扫描结果：每个GOP的起始pts和帧数，以及关键帧是否是IDR（闭合GOP，非H.264时总是true）
+    std::vector<int64_t> gopStartPts_;
+    std::vector<int64_t> gopFrames_;
+    std::vector<bool> gopClosed_;
+
+    // 原始输入视频流的time_base、start_time和编码
+    AVRational sourceTimeBase_;
+    int64_t sourceStartTime_;
+    AVCodecID sourceCodecId_;
+
+    std::vector<TimeRange> ranges_;
+    std::vector<VideoSegment> segments_;
+    std::vector<WorkerStats> workerStats_;
+};
+
+#endif
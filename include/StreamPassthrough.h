@@ -0,0 +1,62 @@
+#ifndef STREAM_PASSTHROUGH_H
+#define STREAM_PASSTHROUGH_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+// 把输入中除处理的视频流以外的流（音频、字幕、数据）以流复制的方式写入输出
+// 时间戳从输入流的time_base换算到输出流的time_base，交错由av_interleaved_write_frame完成
+class StreamPassthrough
+{
+public:
+    StreamPassthrough();
+    ~StreamPassthrough();
+
+    StreamPassthrough(const StreamPassthrough&) = delete;
+    StreamPassthrough& operator=(const StreamPassthrough&) = delete;
+
+    // 在avformat_write_header之前调用，为每个可以直通的流创建输出流
+    // 其余的流（其他视频流、封面图片、输出容器不支持的编码）设置为AVDISCARD_ALL，解复用时直接跳过
+    // copyStreams为false时（分段模式，由拼接阶段从原始输入直通）只保留视频流
+    bool Setup(AVFormatContext* inputCtx, AVFormatContext* outputCtx, int videoStreamIndex, bool copyStreams);
+
+    bool IsEmpty() const { return streamCount_ == 0; }
+
+    // packet属于直通流时写入输出并返回true（packet已被unref），否则不做任何操作返回false
+    bool HandlePacket(AVPacket* packet);
+
+    // 写入编码后的视频包。流水线模式下直通包在解码线程写入、视频包在编码线程写入，
+    // 两者必须经过同一把锁
+    int WriteVideoPacket(AVPacket* packet);
+
+    // 继续从输入读取直通流，写入dts不晚于limit（单位为timeBase）的包；
+    // limit为AV_NOPTS_VALUE时一直读到文件末尾
+    bool CopyUntil(int64_t limit, AVRational timeBase);
+
+    void PrintSummary() const;
+
+private:
+    bool WritePassthroughPacket(AVPacket* packet);
+
+    AVFormatContext* inputCtx_;
+    AVFormatContext* outputCtx_;
+    // 输入流下标 -> 输出流下标，-1表示不直通
+    std::vector<int> streamMap_;
+    std::vector<int64_t> packetCounts_;
+    int streamCount_;
+
+    // CopyUntil读到但还没到时间的包
+    AVPacket* pending_;
+    bool hasPending_;
+    bool inputEnded_;
+
+    std::mutex writeMutex_;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SYNTHETIC_FRAME_SOURCE_H
+#define SYNTHETIC_FRAME_SOURCE_H
+
+#include "FrameSource.h"
+#include <cstdint>
+#include <vector>
+
+// 确定性的合成桌面画面，按10秒一个周期循环：
+//   0-4秒  几个窗口在桌面上移动（整屏大面积变化）
+//   4-7秒  终端窗口中的文字向上滚动（局部变化）
+//   7-10秒 画面静止（updated为false）
+// 只用整数运算绘制，同样的参数在任何机器上得到逐字节相同的画面；
+// 时间戳按帧率推算，不依赖墙上时钟。每帧报告精确的变化区域：
+// 窗口移动报告新旧位置的外接矩形，终端滚动报告一个移动区域加底部新露出的一条
+class SyntheticFrameSource : public FrameSource
+{
+public:
+    SyntheticFrameSource(int width, int height, int fps);
+
+    bool Initialize() override;
+    bool CaptureFrame(CapturedFrame& frame) override;
+
+    int GetWidth() const override { return width_; }
+    int GetHeight() const override { return height_; }
+    const char* GetName() const override { return "合成画面"; }
+    bool IsRealtime() const override { return false; }
+
+private:
+    typedef FrameRect Rect;
+
+    static const int kWindowCount = 4;
+
+    Rect TerminalRect() const;
+    Rect TerminalBody() const;
+    void DrawWallpaper();
+    void DrawMovingWindows(int64_t t);
+    void DrawTerminal(int64_t t);
+    void DrawWindow(const Rect& rect, uint32_t titleColor, uint32_t bodyColor);
+    void DrawTextLine(int x, int y, uint64_t seed, uint32_t color, const Rect& clip);
+    void FillRect(const Rect& rect, uint32_t color, const Rect& clip);
+
+    int width_;
+    int height_;
+    int fps_;
+    int64_t frameIndex_;
+    int linesize_;
+    std::vector<uint8_t> wallpaper_;
+    std::vector<uint8_t> frame_;
+
+    // 变化区域：上一帧所处的阶段、各窗口的位置
+    int lastPhase_;
+    Rect windowRects_[kWindowCount];
+    std::vector<FrameRect> dirtyRects_;
+    FrameMove move_;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include "DynamicLayer.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 字形在图集中的单元：单元四周各留kPadding像素，字形画在(x + kPadding, y + kPadding)处，
+// 超出字宽的笔画（斜体、字距）和描边都落在留白内
+struct GlyphInfo
+{
+    int x;
+    int y;
+    int width;      // 单元宽度（含两侧留白）
+    int height;     // 单元高度（含上下留白），所有字形相同
+    float advance;  // 排版时笔位置前进的距离
+};
+
+// 字形图集：需要的字符只光栅化一次，每个字符一个单元，保存覆盖度（文字的alpha）和外扩1像素的描边
+class GlyphAtlas
+{
+public:
+    static const int kPadding = 2;
+
+    GlyphAtlas();
+
+    // 分配width x height的空白图集，lineHeight是一行文字的高度（不含留白）
+    void Reset(int width, int height, int lineHeight);
+    void AddGlyph(wchar_t ch, const GlyphInfo& info);
+    // 覆盖度写完后调用：每个单元内做3x3最大值膨胀，得到描边平面
+    void BuildOutline();
+
+    const GlyphInfo* Find(wchar_t ch) const;
+    uint8_t* GetCoverage() { return coverage_.data(); }
+    const uint8_t* GetCoverage() const { return coverage_.data(); }
+    const uint8_t* GetOutline() const { return outline_.data(); }
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+    int GetLineHeight() const { return lineHeight_; }
+    size_t GetGlyphCount() const { return glyphs_.size(); }
+
+private:
+    std::vector<uint8_t> coverage_;
+    std::vector<uint8_t> outline_;
+    std::unordered_map<wchar_t, GlyphInfo> glyphs_;
+    int width_;
+    int height_;
+    int lineHeight_;
+};
+
+// 每帧变化的文字（时间戳、帧号、观看者ID等）：用图集中的字形拼出文字的遮罩，
+// 直接混合到YUV平面上，每帧的开销只与文字区域的面积有关。
+// 模板中的 {time} 替换为本地时间（YYYY-MM-DD HH:MM:SS），{frame} 替换为帧号，
+// {pts} 替换为媒体时间（HH:MM:SS.mmm），其余字符原样显示
+class TextOverlay : public DynamicLayer
+{
+public:
+    TextOverlay();
+
+    // 模板需要的所有字符（字面字符，以及变量可能出现的数字和分隔符），用于生成图集
+    static std::wstring GetCharset(const std::wstring& textTemplate);
+
+    // 文字区域的左上角放在(x, y)，向下取偶数对齐色度块；调用方保证atlas在使用期间有效
+    bool Initialize(const std::wstring& textTemplate, const GlyphAtlas* atlas, int x, int y);
+
+    std::unique_ptr<DynamicLayer> Clone() const override;
+    // 生成这一帧的文字，文字与上一帧不同时才重新排版；完全在画面外时返回false
+    bool Prepare(int64_t frameNumber, int64_t mediaTimeMs, int frameWidth, int frameHeight,
+                 FrameRect& outRect) override;
+    // 描边压暗亮度，文字提亮亮度，覆盖处的色度拉向中性灰；黑白按target的范围取值，与颜色矩阵无关
+    void Draw(const LayerTarget& target) override;
+    std::string Describe() const override;
+
+private:
+    struct Segment
+    {
+        enum Kind { Literal, Time, Frame, Pts } kind;
+        std::wstring text;
+    };
+
+    // 排版时一个字形单元的位置
+    struct PlacedGlyph
+    {
+        const GlyphInfo* glyph;
+        int x;
+    };
+
+    static void ParseTemplate(const std::wstring& textTemplate, std::vector<Segment>& outSegments);
+    // 生成这一帧的文字，写到formatted_中
+    void Format(int64_t frameNumber, int64_t mediaTimeMs);
+    // 按formatted_中的文字排版，重新拼出文字和描边的遮罩
+    void Layout();
+    // 按色度平面的下采样构建色度遮罩
+    void BuildChromaMask(int chromaShiftW, int chromaShiftH);
+    // 每帧复用的缓冲区的总容量，增长时计入分配统计
+    size_t GetBufferCapacity() const;
+
+    const GlyphAtlas* atlas_;
+    std::vector<Segment> segments_;
+    int x_;
+    int y_;
+
+    // 文字和排版的缓冲区每帧复用，只在文字变长时重新分配
+    std::wstring formatted_;
+    std::wstring text_;
+    std::vector<PlacedGlyph> placed_;
+    // 文字区域的遮罩：maskWidth_为偶数，fill_是文字，outline_是描边
+    std::vector<uint8_t> fill_;
+    std::vector<uint8_t> outline_;
+    int maskWidth_;
+    int maskHeight_;
+    FrameRect rect_;
+
+    // 色度遮罩：每个色度样本取所覆盖亮度像素的max(文字, 描边)的平均
+    std::vector<uint8_t> chromaMask_;
+    int chromaShiftW_;
+    int chromaShiftH_;
+    bool chromaDirty_;
+
+    // 混合目标的常量行
+    std::vector<uint8_t> dark_;
+    std::vector<uint8_t> light_;
+    std::vector<uint8_t> neutral_;
+    int rangeLevels_;   // 常量行对应的范围：-1未填充，0有限范围，1全范围
+
+    int64_t relayouts_;
+};
+
+#endif
@@ -2,6 +2,12 @@
 #define VIDEO_PROCESSOR_H
 
 #include "D3DProcessor.h"
+#include "WatermarkCoverage.h"
+#include "BlendPlan.h"
+#include "MediaDecode.h"
+#include "StreamPassthrough.h"
+#include "FramePool.h"
+#include "ScratchArena.h"
 #include <string>
 #include <d3d11.h>
 
@@ -25,8 +31,15 @@ public:
                      int watermarkHeight,
                      float alpha = 0.3f);
 
-    // 静态方法：获取视频尺寸
-    static bool GetVideoDimensions(const std::string& path, int& width, int& height);
+    // 流水线队列深度：0为单线程顺序处理，大于0时解码/混合/编码各用一个线程
+    void SetPipelineDepth(int depth) { pipelineDepth_ = depth; }
+
+    // 只处理输入的一段（分段并行处理时使用），输出文件只包含这一段
+    void SetSegment(const SegmentRange& segment) { segment_ = segment; }
+
+    // 已经构建好的水印覆盖索引（水印资源缓存中保存的，按整个水印的alpha构建），尺寸一致时CPU混合直接使用，
+    // 不再重新扫描alpha；调用方保证处理期间有效
+    void SetWatermarkCoverage(const WatermarkCoverage* coverage) { prebuiltCoverage_ = coverage; }
 
 private:
     bool OpenInput(const std::string& path);
@@ -51,6 +64,18 @@ private:
 
     // DirectX处理器
     D3DProcessor* d3dProcessor_;
+    // 没有可用的D3D设备（如无GPU的服务器）时改用CPU混合内核
+    bool useCpuBlend_;
+    // CPU混合时使用的水印覆盖索引
+    WatermarkCoverage wmCoverage_;
+    const WatermarkCoverage* prebuiltCoverage_;
+    // CPU混合的预乘计划，整个任务只构建一次
+    BlendPlan blendPlan_;
+
+    // 每帧使用的RGB/YUV帧缓冲池，稳态下不再分配内存
+    // GPU路径按linesize直接上传/读回，不需要紧密排列的中间缓冲区
+    FramePool rgbPool_;
+    FramePool yuvPool_;
 
     // 视频参数
     int width_;
@@ -62,6 +87,13 @@ private:
     ID3D11ShaderResourceView* watermarkSRV_;
     ID3D11Texture2D* videoTexture_;
     ID3D11ShaderResourceView* videoSRV_;
+
+    int pipelineDepth_;
+    SegmentRange segment_;
+    // 只打印第一帧的颜色属性；分段并行时每个实例各自一份
+    bool firstFrame_;
+    // 音频、字幕等非视频流的直通，同时负责写入视频包（与直通包共用一把锁）
+    StreamPassthrough passthrough_;
 };
 
 #endif
\ No newline at end of file
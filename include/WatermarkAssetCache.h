@@ -0,0 +1,87 @@
+#ifndef WATERMARK_ASSET_CACHE_H
+#define WATERMARK_ASSET_CACHE_H
+
+#include "WatermarkCoverage.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 水印资源缓存的键：同一个来源、同样的目标尺寸和生成参数得到的水印完全相同
+struct WatermarkAssetKey
+{
+    std::string kind;      // "png" 或 "text"
+    uint64_t sourceHash;   // PNG文件内容或文字（UTF-16）的哈希
+    int width;             // 目标尺寸；平铺单元的尺寸由文字决定，填0
+    int height;
+    bool tiled;            // 平铺单元还是整帧
+    std::string params;    // 生成参数：缩放方式，字体/字号/颜色/间距等，改变后旧的缓存不再命中
+};
+
+// 准备好的水印（RGBA，已缩放和转换）：从缓存文件只读映射，或者是刚生成的内存副本
+// 映射的页面在同一个缓存文件的所有进程之间共享
+class WatermarkAsset
+{
+public:
+    WatermarkAsset();
+    ~WatermarkAsset();
+
+    WatermarkAsset(const WatermarkAsset&) = delete;
+    WatermarkAsset& operator=(const WatermarkAsset&) = delete;
+
+    const unsigned char* GetRGBA() const { return rgba_; }
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+    bool IsTiled() const { return tiled_; }
+    bool IsMapped() const { return view_ != nullptr; }
+
+    // 缓存文件中保存的覆盖索引（按RGBA的alpha、整个水印尺寸构建）；内存副本没有，返回false
+    bool GetCoverage(WatermarkCoverage& outCoverage) const;
+
+private:
+    friend class WatermarkAssetCache;
+
+    bool Map(const std::string& path, uint64_t keyHash);
+    void Adopt(std::vector<unsigned char>&& rgba, int width, int height, bool tiled);
+    void Release();
+
+    const unsigned char* rgba_;
+    int width_;
+    int height_;
+    bool tiled_;
+
+    // 映射的视图（只读）
+    const uint8_t* view_;
+    size_t viewBytes_;
+    // 没有缓存目录或写入失败时持有生成的数据
+    std::vector<unsigned char> owned_;
+};
+
+// 水印资源缓存：目录中每个键一个文件，内容是缩放/转换后的RGBA和覆盖索引。
+// 未命中时生成、写入临时文件后改名，多个进程同时生成同一个键时内容相同，谁的改名生效都可以
+class WatermarkAssetCache
+{
+public:
+    // 生成水印：输出RGBA和尺寸
+    typedef std::function<bool(std::vector<unsigned char>& rgba, int& width, int& height)> GenerateFn;
+
+    // directory为空时不使用缓存，每次直接生成
+    explicit WatermarkAssetCache(const std::string& directory);
+
+    // 命中时映射已有的文件；否则调用generate，写入缓存后映射（写入失败时使用内存中的数据）
+    bool Acquire(const WatermarkAssetKey& key, const GenerateFn& generate, WatermarkAsset& asset) const;
+
+    static uint64_t HashBytes(const void* data, size_t size);
+    static bool HashFile(const std::string& path, uint64_t& outHash);
+
+private:
+    static uint64_t HashKey(const WatermarkAssetKey& key);
+    std::string GetPath(uint64_t keyHash) const;
+    bool Write(const std::string& path, uint64_t keyHash, const std::vector<unsigned char>& rgba,
+               int width, int height, bool tiled) const;
+
+    std::string directory_;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef WATERMARK_COVERAGE_H
+#define WATERMARK_COVERAGE_H
+
+#include <cstdint>
+#include <vector>
+
+// 水印每一行中需要混合的区间
+// 完全透明的像素不在任何区间内；opaque表示区间内水印alpha全部为255
+struct CoverageSpan
+{
+    int x;
+    int length;
+    bool opaque;
+};
+
+// 水印覆盖索引：每个水印只构建一次，混合时只遍历区间，跳过透明区域
+class WatermarkCoverage
+{
+public:
+    WatermarkCoverage();
+
+    // alpha: 第一个像素的alpha地址
+    // pixelStride: 相邻像素alpha的间隔（RGBA为4，单独的alpha平面为1）
+    // rowStride: 相邻两行的字节间隔
+    void Build(const uint8_t* alpha, int width, int height, int pixelStride, int rowStride);
+    // 使用已经构建好的区间表（如水印资源缓存中保存的），rowStart有height+1项
+    void Assign(std::vector<CoverageSpan>&& spans, std::vector<int>&& rowStart, int width, int height);
+
+    const CoverageSpan* RowBegin(int y) const { return spans_.data() + rowStart_[y]; }
+    const CoverageSpan* RowEnd(int y) const { return spans_.data() + rowStart_[y + 1]; }
+
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+    bool IsEmpty() const { return spans_.empty(); }
+
+    // 区间覆盖的像素数（包括为了减少区间数而并入的少量透明像素）
+    int64_t GetBlendedPixels() const { return blendedPixels_; }
+    int64_t GetOpaquePixels() const { return opaquePixels_; }
+    // 混合时跳过的像素占整个水印的比例
+    double GetSkippedFraction() const;
+
+    void PrintSummary(const char* label) const;
+
+private:
+    std::vector<CoverageSpan> spans_;
+    std::vector<int> rowStart_;
+    int width_;
+    int height_;
+    int64_t blendedPixels_;
+    int64_t opaquePixels_;
+};
+
+#endif
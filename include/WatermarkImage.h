@@ -0,0 +1,49 @@
+#ifndef WATERMARK_IMAGE_H
+#define WATERMARK_IMAGE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 缩放图片水印时使用的滤波器
+enum class ResampleFilter
+{
+    Box,        // 区域平均（放大时等同于最近邻）
+    Bilinear,
+    Cubic,      // Catmull-Rom，默认，接近原来WIC的HighQualityCubic
+    Lanczos,    // Lanczos3，缩小时最锐利
+};
+
+bool ParseResampleFilter(const std::string& name, ResampleFilter& outFilter);
+const char* GetResampleFilterName(ResampleFilter filter);
+
+// 用libavformat/libavcodec解码图片（PNG、JPEG等，只取第一帧），输出非预乘的RGBA，不依赖WIC
+bool DecodeImageRGBA(const std::string& path, std::vector<unsigned char>& outData, int& outWidth, int& outHeight);
+
+// 多帧图片的一帧：非预乘RGBA，从startMs开始显示到下一帧开始
+struct ImageFrame
+{
+    std::vector<unsigned char> rgba;
+    int64_t startMs;
+};
+
+// 解码多帧图片（GIF、APNG等）的前maxFrames帧，每帧是合成好的整幅非预乘RGBA，带相对第一帧的开始时间；
+// outLoopMs是一轮动画的时长。静态图片输出一帧
+bool DecodeImageFrames(const std::string& path, int maxFrames, std::vector<ImageFrame>& outFrames,
+                       int& outWidth, int& outHeight, int64_t& outLoopMs);
+
+// 可分离的两遍缩放：水平滤波后的行放在每个线程的环形缓冲中，再做垂直滤波，
+// 中间结果只占滤波器抽头数那么多行。滤波在预乘alpha的空间中进行，透明像素的颜色不会渗到边缘，
+// 输出还原为非预乘RGBA。按输出行分给多个线程，threads为0时使用CPU核心数
+void ResampleRGBA(const unsigned char* src, int srcWidth, int srcHeight,
+                  unsigned char* dst, int dstWidth, int dstHeight,
+                  ResampleFilter filter, int threads);
+
+// 解码图片并拉伸到targetWidth x targetHeight（填满整个画面），输出非预乘RGBA
+bool LoadWatermarkImage(const std::string& path, int targetWidth, int targetHeight,
+                        ResampleFilter filter, std::vector<unsigned char>& outData);
+
+// 解码和缩放的参数，作为水印资源缓存键的一部分；修改解码或滤波的实现时同时修改这里
+std::string GetWatermarkImageKey(ResampleFilter filter);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef WATERMARK_RENDERER_H
 #define WATERMARK_RENDERER_H
 
+#include "TextOverlay.h"
+#include "WatermarkTile.h"
 #include <d2d1.h>
 #include <d2d1helper.h>
 #include <dwrite.h>
@@ -18,14 +20,17 @@ public:
     ~WatermarkRenderer();
 
     bool Initialize();
+    // 旋转45度的重复文字，展开成width x height的整幅RGBA（需要整幅纹理的GPU路径使用）
     bool CreateTiledWatermark(int width, int height, 
                              const std::wstring& text,
                              std::vector<unsigned char>& outData);
-    
-    // 从PNG文件加载水印并缩放到指定尺寸
-    bool LoadWatermarkFromPNG(const std::string& pngPath, 
-                             int targetWidth, int targetHeight,
-                             std::vector<unsigned char>& outData);
+    // 同样的图案只渲染一个周期单元，大小只取决于文字，与画面分辨率无关
+    bool CreateWatermarkTile(const std::wstring& text, WatermarkTile& outTile);
+    // 把charset中的每个字符渲染一次到字形图集（白色，只保留覆盖度），逐帧变化的文字从图集中拼出
+    bool CreateGlyphAtlas(const std::wstring& charset, float fontSize, GlyphAtlas& outAtlas);
+
+    // 文字水印的生成参数，作为水印资源缓存键的一部分
+    static const char* GetTextStyleKey();
 
 private:
     ComPtr<ID2D1Factory> d2dFactory_;
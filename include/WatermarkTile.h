@@ -0,0 +1,19 @@
+#ifndef WATERMARK_TILE_H
+#define WATERMARK_TILE_H
+
+#include <vector>
+
+// 周期平铺的水印：只保存一个周期单元（RGBA），画面(x, y)处的水印像素是单元中的(x mod width, y mod height)
+// 内存与输出分辨率无关，混合时单元一直留在缓存中。
+// 宽高都是偶数（平铺步长为奇数时单元包含两个周期），YUV420的色度块和融合转换内核的2x2块不会跨过单元边界
+struct WatermarkTile
+{
+    std::vector<unsigned char> rgba;
+    int width;
+    int height;
+};
+
+// 展开成width x height的整幅RGBA水印，给需要整幅纹理的GPU路径使用
+void ExpandWatermarkTile(const WatermarkTile& tile, int width, int height, std::vector<unsigned char>& outData);
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef YUV_BLEND_PROCESSOR_H
+#define YUV_BLEND_PROCESSOR_H
+
+#include "EncoderSpeedController.h"
+#include "LayerCompositor.h"
+#include "WatermarkCoverage.h"
+#include "MediaDecode.h"
+#include "StreamPassthrough.h"
+#include "FramePool.h"
+#include "ScratchArena.h"
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+struct BlendKernels;
+
+// 直接在解码器输出的YUV平面上混合水印
+// 与VideoProcessor不同，这里没有 YUV->RGB->GPU->RGB->YUV 的往返，
+// 也不依赖DirectX，可以在没有GPU的机器上运行
+class YuvBlendProcessor
+{
+public:
+    YuvBlendProcessor();
+    ~YuvBlendProcessor();
+
+    // watermarkData: RGBA格式的水印，从左上角(0,0)开始叠加
+    bool ProcessVideo(const std::string& inputPath,
+                     const std::string& outputPath,
+                     const unsigned char* watermarkData,
+                     int watermarkWidth,
+                     int watermarkHeight,
+                     float alpha = 0.3f);
+
+    // 流水线队列深度：0为单线程顺序处理，大于0时解码/混合/编码各用一个线程
+    void SetPipelineDepth(int depth) { pipelineDepth_ = depth; }
+
+    // 只处理输入的一段（分段并行处理时使用），输出文件只包含这一段
+    void SetSegment(const SegmentRange& segment) { segment_ = segment; }
+
+    // 目标帧率：编码跟不上时在GOP边界把x264换快一档（预设，然后是CRF），有富余时换回来；
+    // 0表示不调整。分段处理时各段要能直接拼接，不调整
+    void SetTargetFps(double fps) { targetFps_ = fps; }
+
+    // 水印数据是周期平铺的一个单元（WatermarkTile，宽高为偶数），混合时按单元尺寸取模重复到整个画面，
+    // 而不是从左上角叠加一次
+    void SetWatermarkTiled(bool tiled) { watermarkTiled_ = tiled; }
+
+    // 已经构建好的水印覆盖索引（按整个水印的alpha构建），与Y平面尺寸一致时直接作为Y平面的索引；
+    // 调用方保证处理期间有效
+    void SetWatermarkCoverage(const WatermarkCoverage* coverage) { prebuiltCoverage_ = coverage; }
+
+    // 多层水印：ProcessVideo的水印是静态水印（平铺单元或图片，watermarkData为nullptr时没有），
+    // 这里是静态logo、动态层（逐帧文字、动画logo）和各层的统计；静态logo和动态层每帧按顺序在水印之上绘制，
+    // 帧号和媒体时间按帧的时间戳计算。每个实例复制一份，
+    // 引用的图集、logo帧在各个分段之间共用，调用方保证处理期间有效
+    void SetLayers(const LayerCompositor& layers) { layers_ = layers; }
+
+private:
+    bool OpenInput(const std::string& path);
+    bool OpenOutput(const std::string& path);
+    // 按当前的速度档位创建并打开encoderCtx_
+    bool OpenEncoder();
+    // 在GOP边界换档：刷新并关闭当前编码器，按新档位重新打开
+    bool ReopenEncoder();
+    bool PrepareWatermark(const unsigned char* watermarkData,
+                          int watermarkWidth, int watermarkHeight);
+    // 在frame的平面上原地混合水印，返回可以直接送入编码器的帧
+    // 需要格式转换或frame不可写时返回缓冲池中的新帧，frame仍由调用方释放
+    AVFrame* BlendFrame(AVFrame* frame);
+    // 在target的平面上混合静态水印（单元平铺时按单元取模）
+    void BlendWatermark(AVFrame* target);
+    // 把水印平面p的第wmY行混合到dst的 [xOffset, xOffset + 单元宽度) 中，超出limit的部分不混合
+    void BlendPlaneRow(const BlendKernels& kernels, uint8_t* dst, int p, int wmY, int xOffset, int limit) const;
+    // 在混合好水印的帧上绘制这一帧的动态层
+    void DrawDynamicLayers(AVFrame* frame);
+    // 静态logo和动态层绘制的目标：frame的平面，范围和颜色矩阵与水印相同
+    LayerTarget GetLayerTarget(AVFrame* frame) const;
+    bool EncodeFrame(AVFrame* frame);
+    void Cleanup();
+
+    // FFmpeg相关
+    AVFormatContext* inputFormatCtx_;
+    AVFormatContext* outputFormatCtx_;
+    const AVCodec* decoder_;
+    const AVCodec* encoder_;
+    AVCodecContext* decoderCtx_;
+    AVCodecContext* encoderCtx_;
+    AVStream* videoStream_;
+    AVStream* outVideoStream_;
+    int videoStreamIndex_;
+    AVPacket* outPacket_;
+
+    // 解码格式不是8位平面YUV420时，先转换到缓冲池中的帧再混合；
+    // 解码帧仍被解码器引用时也复制到池中的帧，避免每帧重新分配
+    SwsContext* swsToBlendCtx_;
+    FramePool blendPool_;
+
+    // 视频参数
+    int width_;
+    int height_;
+    AVPixelFormat pixelFormat_;
+    AVPixelFormat blendFormat_;
+    int chromaShiftW_;
+    int chromaShiftH_;
+
+    // 预先转换好的水印: [0]=Y [1]=U [2]=V，每个平面配一个同尺寸的alpha平面
+    std::vector<unsigned char> wmPlanes_[3];
+    std::vector<unsigned char> wmAlpha_[3];
+    int wmPlaneWidth_[3];
+    int wmPlaneHeight_[3];
+    // 每个平面的覆盖索引，混合时跳过透明区域
+    WatermarkCoverage wmCoverage_[3];
+    int alpha255_;
+    bool watermarkTiled_;
+    const WatermarkCoverage* prebuiltCoverage_;
+    // 各层的统计和动态层，只在混合阶段的线程中使用
+    LayerCompositor layers_;
+    int pipelineDepth_;
+    SegmentRange segment_;
+    // 音频、字幕等非视频流的直通，同时负责写入视频包（与直通包共用一把锁）
+    StreamPassthrough passthrough_;
+
+    // 编码速度自适应（只在编码阶段的线程中使用）
+    double targetFps_;
+    bool adaptive_;
+    bool globalHeader_;
+    EncoderSpeedController speed_;
+    int64_t lastDts_;
+};
+
+#endif
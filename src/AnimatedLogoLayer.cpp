@@ -0,0 +1,242 @@
+#include "AnimatedLogoLayer.h"
+#include "BlendKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// RGB->YUV：BT.601有限范围与录屏的融合转换内核使用同一个定点公式，其余组合按系数计算
+static void RgbToYuv(int r, int g, int b, bool fullRange, bool bt709, uint8_t& y, uint8_t& u, uint8_t& v)
+{
+    if (!fullRange && !bt709) {
+        y = BlendRgbToY(r, g, b);
+        u = BlendRgbToU(r, g, b);
+        v = BlendRgbToV(r, g, b);
+        return;
+    }
+    double kr = bt709 ? 0.2126 : 0.299;
+    double kb = bt709 ? 0.0722 : 0.114;
+    double luma = (kr * r + (1.0 - kr - kb) * g + kb * b) / 255.0;
+    double cb = (b / 255.0 - luma) / (2.0 * (1.0 - kb));
+    double cr = (r / 255.0 - luma) / (2.0 * (1.0 - kr));
+    double yScale = fullRange ? 255.0 : 219.0;
+    double cScale = fullRange ? 255.0 : 224.0;
+    double yOffset = fullRange ? 0.0 : 16.0;
+    auto clamp = [](double value) {
+        return static_cast<uint8_t>(std::min(std::max(std::lround(value), 0L), 255L));
+    };
+    y = clamp(yOffset + yScale * luma);
+    u = clamp(128.0 + cScale * cb);
+    v = clamp(128.0 + cScale * cr);
+}
+
+AnimatedLogoLayer::AnimatedLogoLayer()
+    : width_(0)
+    , height_(0)
+    , loopMs_(0)
+    , x_(0)
+    , y_(0)
+    , alpha255_(255)
+    , chromaShiftW_(-1)
+    , chromaShiftH_(-1)
+    , fullRange_(false)
+    , bt709_(false)
+    , current_(0)
+    , rect_{ 0, 0, 0, 0 }
+{
+}
+
+bool AnimatedLogoLayer::Initialize(std::shared_ptr<const std::vector<ImageFrame>> frames, int width, int height,
+                                   int64_t loopMs, int x, int y, float alpha)
+{
+    if (!frames || frames->empty() || width <= 0 || height <= 0) {
+        std::cerr << "动画logo没有可用的帧" << std::endl;
+        return false;
+    }
+    frames_ = frames;
+    width_ = width;
+    height_ = height;
+    loopMs_ = std::max<int64_t>(loopMs, 1);
+    x_ = std::max(x, 0) & ~1;
+    y_ = std::max(y, 0) & ~1;
+    alpha255_ = BlendAlpha255(alpha);
+    converted_.clear();
+    chromaShiftW_ = -1;
+    chromaShiftH_ = -1;
+    current_ = 0;
+    return true;
+}
+
+std::unique_ptr<DynamicLayer> AnimatedLogoLayer::Clone() const
+{
+    return std::unique_ptr<DynamicLayer>(new AnimatedLogoLayer(*this));
+}
+
+bool AnimatedLogoLayer::Prepare(int64_t frameNumber, int64_t mediaTimeMs, int frameWidth, int frameHeight,
+                                FrameRect& outRect)
+{
+    (void)frameNumber;
+
+    // 按媒体时间在一轮动画中的位置选择最后一个已经开始的帧
+    int64_t t = std::max<int64_t>(mediaTimeMs, 0) % loopMs_;
+    auto it = std::upper_bound(frames_->begin(), frames_->end(), t,
+                               [](int64_t value, const ImageFrame& frame) { return value < frame.startMs; });
+    current_ = it == frames_->begin() ? 0 : static_cast<size_t>(it - frames_->begin() - 1);
+
+    rect_.x = x_;
+    rect_.y = y_;
+    rect_.width = std::max(std::min(width_, frameWidth - x_), 0);
+    rect_.height = std::max(std::min(height_, frameHeight - y_), 0);
+    outRect = rect_;
+    return rect_.width > 0 && rect_.height > 0;
+}
+
+void AnimatedLogoLayer::ConvertFrames(const LayerTarget& target)
+{
+    chromaShiftW_ = target.chromaShiftW;
+    chromaShiftH_ = target.chromaShiftH;
+    fullRange_ = target.fullRange;
+    bt709_ = target.bt709;
+
+    int blockW = 1 << chromaShiftW_;
+    int blockH = 1 << chromaShiftH_;
+    int chromaW = (width_ + blockW - 1) >> chromaShiftW_;
+    int chromaH = (height_ + blockH - 1) >> chromaShiftH_;
+    size_t pixels = static_cast<size_t>(width_) * height_;
+    std::vector<uint8_t> u444(pixels);
+    std::vector<uint8_t> v444(pixels);
+
+    converted_.assign(frames_->size(), PlaneSet());
+    for (size_t i = 0; i < frames_->size(); i++) {
+        const unsigned char* rgba = (*frames_)[i].rgba.data();
+        PlaneSet& set = converted_[i];
+        set.planes[0].resize(pixels);
+        set.alpha[0].resize(pixels);
+        for (size_t j = 0; j < pixels; j++) {
+            RgbToYuv(rgba[j * 4], rgba[j * 4 + 1], rgba[j * 4 + 2], fullRange_, bt709_,
+                     set.planes[0][j], u444[j], v444[j]);
+            set.alpha[0][j] = rgba[j * 4 + 3];
+        }
+
+        // 色度按采样块下采样，颜色按alpha加权（与YUV域混合的水印相同），透明像素的颜色不会渗入边缘
+        for (int p = 1; p < 3; p++) {
+            set.planes[p].resize(static_cast<size_t>(chromaW) * chromaH);
+            set.alpha[p].resize(static_cast<size_t>(chromaW) * chromaH);
+        }
+        for (int cy = 0; cy < chromaH; cy++) {
+            for (int cx = 0; cx < chromaW; cx++) {
+                // logo宽高为奇数时右边和下边的块不完整，alpha按块内实际的像素数平均
+                int sumA = 0, sumU = 0, sumV = 0, count = 0;
+                for (int y = cy * blockH; y < std::min((cy + 1) * blockH, height_); y++) {
+                    for (int x = cx * blockW; x < std::min((cx + 1) * blockW, width_); x++) {
+                        size_t j = static_cast<size_t>(y) * width_ + x;
+                        int a = rgba[j * 4 + 3];
+                        sumA += a;
+                        sumU += a * u444[j];
+                        sumV += a * v444[j];
+                        count++;
+                    }
+                }
+                size_t idx = static_cast<size_t>(cy) * chromaW + cx;
+                set.alpha[1][idx] = set.alpha[2][idx] = static_cast<uint8_t>((sumA + count / 2) / count);
+                set.planes[1][idx] = static_cast<uint8_t>(sumA ? (sumU + sumA / 2) / sumA : 128);
+                set.planes[2][idx] = static_cast<uint8_t>(sumA ? (sumV + sumA / 2) / sumA : 128);
+            }
+        }
+
+        set.coverage[0].Build(set.alpha[0].data(), width_, height_, 1, width_);
+        set.coverage[1].Build(set.alpha[1].data(), chromaW, chromaH, 1, chromaW);
+        set.coverage[2] = set.coverage[1];
+    }
+}
+
+void AnimatedLogoLayer::BlendRow(const PlaneSet& set, int p, uint8_t* out, int row, int x0, int x1) const
+{
+    // 与YuvBlendProcessor::BlendPlaneRow相同：只处理覆盖索引中的区间，不透明区间走均匀alpha内核
+    const BlendKernels& kernels = GetBlendKernels();
+    const WatermarkCoverage& coverage = set.coverage[p];
+    int planeW = coverage.GetWidth();
+    const uint8_t* wm = set.planes[p].data() + static_cast<size_t>(row) * planeW;
+    const uint8_t* wmA = set.alpha[p].data() + static_cast<size_t>(row) * planeW;
+    for (const CoverageSpan* s = coverage.RowBegin(row); s != coverage.RowEnd(row); ++s) {
+        int start = std::max(s->x, x0);
+        int length = std::min(s->x + s->length, x1) - start;
+        if (s->x >= x1) {
+            break;
+        }
+        if (length <= 0) {
+            continue;
+        }
+        if (!s->opaque) {
+            kernels.planar(out + start, wm + start, wmA + start, alpha255_, length);
+        } else if (alpha255_ == 255) {
+            std::memcpy(out + start, wm + start, length);
+        } else {
+            kernels.planarUniform(out + start, wm + start, alpha255_, length);
+        }
+    }
+}
+
+void AnimatedLogoLayer::Draw(const LayerTarget& target)
+{
+    DrawRegions(target, &rect_, 1);
+}
+
+void AnimatedLogoLayer::DrawRegions(const LayerTarget& target, const FrameRect* regions, size_t count)
+{
+    if (rect_.width <= 0 || rect_.height <= 0) {
+        return;
+    }
+    if (converted_.empty() || target.chromaShiftW != chromaShiftW_ || target.chromaShiftH != chromaShiftH_ ||
+        target.fullRange != fullRange_ || target.bt709 != bt709_) {
+        ConvertFrames(target);
+    }
+
+    // 包围盒和区域的起点都是偶数，logo的色度块与画面的色度块对齐，一个色度块的亮度行总在同一个区域里；
+    // 裁剪后的宽高按色度向上取整
+    const PlaneSet& set = converted_[current_];
+    for (int p = 0; p < 3; p++) {
+        int shiftW = p == 0 ? 0 : chromaShiftW_;
+        int shiftH = p == 0 ? 0 : chromaShiftH_;
+        int originX = rect_.x >> shiftW;
+        int originY = rect_.y >> shiftH;
+        int rows = ((rect_.y + rect_.height + (1 << shiftH) - 1) >> shiftH) - originY;
+        for (int row = 0; row < rows; row++) {
+            int lumaY = (originY + row) << shiftH;
+            spans_.clear();
+            for (size_t i = 0; i < count; i++) {
+                const FrameRect& region = regions[i];
+                int x0 = std::max(region.x, rect_.x);
+                int x1 = std::min(region.x + region.width, rect_.x + rect_.width);
+                if (lumaY >= region.y && lumaY < region.y + region.height && x0 < x1) {
+                    spans_.emplace_back((x0 >> shiftW) - originX, ((x1 + (1 << shiftW) - 1) >> shiftW) - originX);
+                }
+            }
+            if (spans_.empty()) {
+                continue;
+            }
+
+            std::sort(spans_.begin(), spans_.end());
+            uint8_t* out = target.data[p] + static_cast<size_t>(originY + row) * target.linesize[p] + originX;
+            int x0 = spans_[0].first;
+            int x1 = spans_[0].second;
+            for (size_t i = 1; i < spans_.size(); i++) {
+                if (spans_[i].first > x1) {
+                    BlendRow(set, p, out, row, x0, x1);
+                    x0 = spans_[i].first;
+                }
+                x1 = std::max(x1, spans_[i].second);
+            }
+            BlendRow(set, p, out, row, x0, x1);
+        }
+    }
+}
+
+std::string AnimatedLogoLayer::Describe() const
+{
+    if (frames_ && frames_->size() == 1) {
+        return "静态logo " + std::to_string(width_) + "x" + std::to_string(height_);
+    }
+    return "动画logo " + std::to_string(width_) + "x" + std::to_string(height_) + " (" +
+           std::to_string(frames_ ? frames_->size() : 0) + " 帧, 一轮 " + std::to_string(loopMs_) + " ms)";
+}
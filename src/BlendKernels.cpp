@@ -0,0 +1,378 @@
+#include "BlendKernels.h"
+#include "BlendPlan.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+void BlendPlanarScalar(uint8_t* dst, const uint8_t* wm, const uint8_t* wmA, int alpha255, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int a = BlendDiv255(wmA[i] * alpha255);
+        dst[i] = static_cast<uint8_t>(BlendDiv255(dst[i] * (255 - a) + wm[i] * a));
+    }
+}
+
+void BlendPlanarUniformScalar(uint8_t* dst, const uint8_t* wm, int a, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = static_cast<uint8_t>(BlendDiv255(dst[i] * (255 - a) + wm[i] * a));
+    }
+}
+
+void BlendPremulScalar(uint8_t* dst, const uint16_t* pm, const uint8_t* inv, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = static_cast<uint8_t>(BlendDiv255(dst[i] * inv[i] + pm[i]));
+    }
+}
+
+void BlendPackedRGB24Scalar(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const uint8_t* w = wmRGBA + i * 4;
+        uint8_t* d = dst + i * 3;
+        int a = BlendDiv255(w[3] * alpha255);
+        d[0] = static_cast<uint8_t>(BlendDiv255(d[0] * (255 - a) + w[0] * a));
+        d[1] = static_cast<uint8_t>(BlendDiv255(d[1] * (255 - a) + w[1] * a));
+        d[2] = static_cast<uint8_t>(BlendDiv255(d[2] * (255 - a) + w[2] * a));
+    }
+}
+
+void BlendPackedRGBAScalar(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count)
+{
+    for (int i = 0; i < count; i++) {
+        const uint8_t* w = wmRGBA + i * 4;
+        uint8_t* d = dst + i * 4;
+        int a = BlendDiv255(w[3] * alpha255);
+        d[0] = static_cast<uint8_t>(BlendDiv255(d[0] * (255 - a) + w[0] * a));
+        d[1] = static_cast<uint8_t>(BlendDiv255(d[1] * (255 - a) + w[1] * a));
+        d[2] = static_cast<uint8_t>(BlendDiv255(d[2] * (255 - a) + w[2] * a));
+    }
+}
+
+void BlendBgraToYuv420Scalar(const BgraToYuvRows& rows, int count, int wmCount)
+{
+    for (int x = 0; x < count; x += 2) {
+        // 宽度为奇数时最后一列与自己配对
+        int px[2] = { x, x + 1 < count ? x + 1 : x };
+        int sum[3] = { 0, 0, 0 };
+        for (int r = 0; r < 2; r++) {
+            for (int k = 0; k < 2; k++) {
+                const uint8_t* p = rows.bgra[r] + px[k] * 4;
+                int bgr[3] = { p[0], p[1], p[2] };
+                if (rows.pm[r] && px[k] < wmCount) {
+                    const uint16_t* pm = rows.pm[r] + px[k] * 4;
+                    const uint8_t* inv = rows.inv[r] + px[k] * 4;
+                    for (int c = 0; c < 3; c++) {
+                        bgr[c] = BlendDiv255(bgr[c] * inv[c] + pm[c]);
+                    }
+                }
+                rows.y[r][px[k]] = BlendRgbToY(bgr[2], bgr[1], bgr[0]);
+                for (int c = 0; c < 3; c++) {
+                    sum[c] += bgr[c];
+                }
+            }
+        }
+        int b = (sum[0] + 2) >> 2;
+        int g = (sum[1] + 2) >> 2;
+        int r = (sum[2] + 2) >> 2;
+        rows.u[x / 2] = BlendRgbToU(r, g, b);
+        rows.v[x / 2] = BlendRgbToV(r, g, b);
+    }
+}
+
+static const BlendKernels g_scalarKernels = {
+    BlendIsa::Scalar,
+    "Scalar",
+    BlendPlanarScalar,
+    BlendPlanarUniformScalar,
+    BlendPremulScalar,
+    BlendPackedRGB24Scalar,
+    BlendPackedRGBAScalar,
+    BlendBgraToYuv420Scalar
+};
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+// MSVC没有__builtin_cpu_supports，手动查询CPUID和XCR0
+static bool CpuSupports(BlendIsa isa)
+{
+    int info[4] = { 0 };
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    if (maxLeaf < 1) return false;
+
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (isa == BlendIsa::SSE41) return sse41;
+    if (!osxsave || !avx) return false;
+
+    // 操作系统需要保存YMM（以及AVX-512的opmask/ZMM）寄存器状态
+    unsigned long long xcr0 = _xgetbv(0);
+    bool ymmState = (xcr0 & 0x6) == 0x6;
+    bool zmmState = (xcr0 & 0xE6) == 0xE6;
+    if (maxLeaf < 7 || !ymmState) return false;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+    bool avx512bw = (info[1] & (1 << 30)) != 0;
+    if (isa == BlendIsa::AVX2) return avx2;
+    if (isa == BlendIsa::AVX512) return zmmState && avx512f && avx512bw;
+    return false;
+}
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+static bool CpuSupports(BlendIsa isa)
+{
+    __builtin_cpu_init();
+    switch (isa) {
+    case BlendIsa::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case BlendIsa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case BlendIsa::AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    default:
+        return false;
+    }
+}
+#else
+static bool CpuSupports(BlendIsa isa)
+{
+    // 其他架构只使用标量实现（没有在aarch64上编译和测试过的NEON实现不参与选择）
+    (void)isa;
+    return false;
+}
+#endif
+
+std::vector<const BlendKernels*> GetSupportedBlendKernels()
+{
+    std::vector<const BlendKernels*> kernels;
+    kernels.push_back(&g_scalarKernels);
+
+    const BlendKernels* candidates[] = {
+        GetBlendKernelsSSE41(),
+        GetBlendKernelsAVX2(),
+        GetBlendKernelsAVX512(),
+    };
+    for (const BlendKernels* k : candidates) {
+        if (k && CpuSupports(k->isa)) {
+            kernels.push_back(k);
+        }
+    }
+    return kernels;
+}
+
+const BlendKernels& GetBlendKernels()
+{
+    static const BlendKernels* selected = []() {
+        const BlendKernels* best = GetSupportedBlendKernels().back();
+        std::cout << "CPU混合内核: " << best->name << std::endl;
+        return best;
+    }();
+    return *selected;
+}
+
+// 固定种子的伪随机数据，保证每次报告的输入相同
+static void FillPattern(std::vector<uint8_t>& buffer, uint32_t seed)
+{
+    for (size_t i = 0; i < buffer.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buffer[i] = static_cast<uint8_t>(seed >> 24);
+    }
+}
+
+// 帧数据通路：同一个带行尾填充的RGB24帧，比较
+//   紧密副本：按行复制到紧密缓冲区 -> 混合 -> 复制回帧（旧的GPU路径的做法）
+//   原地混合：按linesize直接在帧上混合
+// 内存流量计数器按每一步实际读写的字节数累加，两种通路的结果必须相同
+static void ReportFrameDataPath(const BlendKernels& kernels, const BlendPlan& plan,
+                                const std::vector<uint8_t>& rgbSrc,
+                                int width, int height, int iterations)
+{
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    // 与FFmpeg分配的帧一样，每行末尾有填充并按64字节对齐
+    const size_t linesize = (rowBytes + 64 + 63) / 64 * 64;
+    // 混合一行：读写目标各一次，读预乘计划的inv（1字节）和pm（2字节）
+    const uint64_t blendRowBytes = rowBytes * (2 + 1 + 2);
+
+    std::vector<uint8_t> base(linesize * height);
+    for (int y = 0; y < height; y++) {
+        memcpy(base.data() + y * linesize, rgbSrc.data() + y * rowBytes, rowBytes);
+    }
+    std::vector<uint8_t> copyFrame = base, inPlaceFrame = base;
+    std::vector<uint8_t> tight(rowBytes * height);
+
+    auto run = [&](auto&& oneFrame, uint64_t& traffic) {
+        auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; it++) {
+            oneFrame(traffic);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    };
+
+    uint64_t copyTraffic = 0;
+    double copySeconds = run([&](uint64_t& traffic) {
+        for (int y = 0; y < height; y++) {
+            memcpy(tight.data() + y * rowBytes, copyFrame.data() + y * linesize, rowBytes);
+            traffic += rowBytes * 2;
+        }
+        for (int y = 0; y < height; y++) {
+            plan.BlendRow(kernels, tight.data() + y * rowBytes, y, 0, static_cast<int>(rowBytes));
+            traffic += blendRowBytes;
+        }
+        for (int y = 0; y < height; y++) {
+            memcpy(copyFrame.data() + y * linesize, tight.data() + y * rowBytes, rowBytes);
+            traffic += rowBytes * 2;
+        }
+    }, copyTraffic);
+
+    uint64_t inPlaceTraffic = 0;
+    double inPlaceSeconds = run([&](uint64_t& traffic) {
+        for (int y = 0; y < height; y++) {
+            plan.BlendRow(kernels, inPlaceFrame.data() + y * linesize, y, 0, static_cast<int>(rowBytes));
+            traffic += blendRowBytes;
+        }
+    }, inPlaceTraffic);
+
+    bool exact = copyFrame == inPlaceFrame;
+
+    std::cout << "=== 帧数据通路 (RGB24, linesize=" << linesize << ", " << kernels.name << ") ===" << std::endl;
+    std::cout << std::left << std::setw(14) << "通路"
+              << std::right << std::setw(12) << "ms/帧"
+              << std::setw(16) << "内存流量 MB/帧"
+              << std::setw(12) << "GB/s" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    auto printRow = [&](const char* name, double seconds, uint64_t traffic) {
+        std::cout << std::left << std::setw(14) << name
+                  << std::right << std::setw(12) << seconds * 1000.0 / iterations
+                  << std::setw(16) << static_cast<double>(traffic) / iterations / (1024.0 * 1024.0)
+                  << std::setw(12) << static_cast<double>(traffic) / seconds / 1e9 << std::endl;
+    };
+    printRow("紧密副本", copySeconds, copyTraffic);
+    printRow("原地混合", inPlaceSeconds, inPlaceTraffic);
+    std::cout << std::defaultfloat;
+    std::cout << "结果一致: " << (exact ? "是" : "否")
+              << "，每帧节省 " << (copyTraffic - inPlaceTraffic) / iterations / 1024 << " KB 内存流量" << std::endl;
+}
+
+void ReportBlendKernelThroughput(int width, int height, int iterations)
+{
+    if (width <= 0 || height <= 0 || iterations <= 0) {
+        std::cerr << "无效的测试参数" << std::endl;
+        return;
+    }
+
+    size_t pixels = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> planeSrc(pixels), planeWm(pixels), planeA(pixels);
+    std::vector<uint8_t> rgbSrc(pixels * 3), rgbaSrc(pixels * 4), wmRGBA(pixels * 4);
+    FillPattern(planeSrc, 1);
+    FillPattern(planeWm, 2);
+    FillPattern(planeA, 3);
+    FillPattern(rgbSrc, 4);
+    FillPattern(rgbaSrc, 5);
+    FillPattern(wmRGBA, 6);
+    const int alpha255 = BlendAlpha255(0.3f);
+
+    // 标量实现的结果作为比对基准
+    std::vector<uint8_t> planeRef = planeSrc, uniformRef = planeSrc, rgbRef = rgbSrc, rgbaRef = rgbaSrc;
+    for (int y = 0; y < height; y++) {
+        size_t row = static_cast<size_t>(y) * width;
+        BlendPlanarScalar(planeRef.data() + row, planeWm.data() + row, planeA.data() + row, alpha255, width);
+        BlendPlanarUniformScalar(uniformRef.data() + row, planeWm.data() + row, alpha255, width);
+        BlendPackedRGB24Scalar(rgbRef.data() + row * 3, wmRGBA.data() + row * 4, alpha255, width);
+        BlendPackedRGBAScalar(rgbaRef.data() + row * 4, wmRGBA.data() + row * 4, alpha255, width);
+    }
+
+    // 预乘计划与平面/RGB24参考结果比对
+    BlendPlan planarPlan, rgbPlan;
+    planarPlan.BuildPlanar(planeWm.data(), planeA.data(), width, width, height, alpha255);
+    rgbPlan.BuildPackedRGB24(wmRGBA.data(), width * 4, width, height, alpha255);
+
+    const BlendKernels& selected = GetBlendKernels();
+
+    std::cout << "=== CPU混合内核吞吐量 (" << width << "x" << height
+              << ", " << iterations << " 次) ===" << std::endl;
+    std::cout << std::left << std::setw(10) << "内核"
+              << std::right << std::setw(14) << "平面 Mpix/s"
+              << std::setw(14) << "不透明 Mpix/s"
+              << std::setw(14) << "RGB24 Mpix/s"
+              << std::setw(14) << "RGB24预乘 Mpix/s"
+              << std::setw(14) << "RGBA Mpix/s"
+              << std::setw(10) << "加速比"
+              << std::setw(8) << "一致" << std::endl;
+
+    double scalarPlanar = 0.0;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const BlendKernels* k : GetSupportedBlendKernels()) {
+        std::vector<uint8_t> plane = planeSrc, uniform = planeSrc, rgb = rgbSrc, rgba = rgbaSrc;
+        std::vector<uint8_t> premul = planeSrc, premulRgb = rgbSrc;
+
+        // 单次混合的结果必须与标量实现逐字节一致
+        for (int y = 0; y < height; y++) {
+            size_t row = static_cast<size_t>(y) * width;
+            k->planar(plane.data() + row, planeWm.data() + row, planeA.data() + row, alpha255, width);
+            k->planarUniform(uniform.data() + row, planeWm.data() + row, alpha255, width);
+            k->packedRGB24(rgb.data() + row * 3, wmRGBA.data() + row * 4, alpha255, width);
+            k->packedRGBA(rgba.data() + row * 4, wmRGBA.data() + row * 4, alpha255, width);
+            planarPlan.BlendRow(*k, premul.data() + row, y, 0, width);
+            rgbPlan.BlendRow(*k, premulRgb.data() + row * 3, y, 0, width * 3);
+        }
+        bool exact = plane == planeRef && uniform == uniformRef && rgb == rgbRef && rgba == rgbaRef &&
+                     premul == planeRef && premulRgb == rgbRef;
+
+        auto measure = [&](auto&& blendRow) {
+            auto start = std::chrono::steady_clock::now();
+            for (int it = 0; it < iterations; it++) {
+                for (int y = 0; y < height; y++) {
+                    blendRow(static_cast<size_t>(y) * width);
+                }
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            return static_cast<double>(pixels) * iterations / elapsed.count() / 1e6;
+        };
+
+        double planarRate = measure([&](size_t row) {
+            k->planar(plane.data() + row, planeWm.data() + row, planeA.data() + row, alpha255, width);
+        });
+        double uniformRate = measure([&](size_t row) {
+            k->planarUniform(uniform.data() + row, planeWm.data() + row, alpha255, width);
+        });
+        double premulRate = measure([&](size_t row) {
+            rgbPlan.BlendRow(*k, premulRgb.data() + row * 3, static_cast<int>(row / width), 0, width * 3);
+        });
+        double rgb24Rate = measure([&](size_t row) {
+            k->packedRGB24(rgb.data() + row * 3, wmRGBA.data() + row * 4, alpha255, width);
+        });
+        double rgbaRate = measure([&](size_t row) {
+            k->packedRGBA(rgba.data() + row * 4, wmRGBA.data() + row * 4, alpha255, width);
+        });
+
+        if (k->isa == BlendIsa::Scalar) {
+            scalarPlanar = planarRate;
+        }
+
+        std::cout << std::left << std::setw(10) << k->name
+                  << std::right << std::setw(14) << planarRate
+                  << std::setw(14) << uniformRate
+                  << std::setw(14) << rgb24Rate
+                  << std::setw(14) << premulRate
+                  << std::setw(14) << rgbaRate
+                  << std::setw(9) << (scalarPlanar > 0.0 ? planarRate / scalarPlanar : 0.0) << "x"
+                  << std::setw(8) << (exact ? "是" : "否") << std::endl;
+    }
+
+    std::cout << std::defaultfloat;
+    std::cout << "运行时选择: " << selected.name << std::endl;
+
+    ReportFrameDataPath(selected, rgbPlan, rgbSrc, width, height, iterations);
+}
@@ -0,0 +1,251 @@
+#include "BlendKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// 16位通道上的四舍五入 x/255
+static inline __m256i Div255Epu16(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+// 32个字节逐字节混合；unpack/packus都在128位通道内进行，字节顺序保持不变
+static inline __m256i Blend32(__m256i v, __m256i w, __m256i wmA, __m256i alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c255 = _mm256_set1_epi16(255);
+
+    __m256i aLo = Div255Epu16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(wmA, zero), alpha));
+    __m256i aHi = Div255Epu16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(wmA, zero), alpha));
+
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), _mm256_sub_epi16(c255, aLo)),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(w, zero), aLo));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), _mm256_sub_epi16(c255, aHi)),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(w, zero), aHi));
+
+    return _mm256_packus_epi16(Div255Epu16(lo), Div255Epu16(hi));
+}
+
+static void BlendPlanarAVX2(uint8_t* dst, const uint8_t* wm, const uint8_t* wmA, int alpha255, int count)
+{
+    const __m256i alpha = _mm256_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(wm + i));
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(wmA + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), Blend32(v, w, a, alpha));
+    }
+    BlendPlanarScalar(dst + i, wm + i, wmA + i, alpha255, count - i);
+}
+
+static void BlendPlanarUniformAVX2(uint8_t* dst, const uint8_t* wm, int a, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i va = _mm256_set1_epi16(static_cast<short>(a));
+    const __m256i vinv = _mm256_set1_epi16(static_cast<short>(255 - a));
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(wm + i));
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), vinv),
+                                      _mm256_mullo_epi16(_mm256_unpacklo_epi8(w, zero), va));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), vinv),
+                                      _mm256_mullo_epi16(_mm256_unpackhi_epi8(w, zero), va));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_packus_epi16(Div255Epu16(lo), Div255Epu16(hi)));
+    }
+    BlendPlanarUniformScalar(dst + i, wm + i, a, count - i);
+}
+
+static void BlendPremulAVX2(uint8_t* dst, const uint16_t* pm, const uint8_t* inv, int count)
+{
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        // 按顺序零扩展，使16位元素与pm一一对应；packus按128位通道交错，最后用permute还原顺序
+        __m256i vLo = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i)));
+        __m256i vHi = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i + 16)));
+        __m256i nLo = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inv + i)));
+        __m256i nHi = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inv + i + 16)));
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(vLo, nLo),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pm + i)));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(vHi, nHi),
+                                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pm + i + 16)));
+        __m256i packed = _mm256_packus_epi16(Div255Epu16(lo), Div255Epu16(hi));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    BlendPremulScalar(dst + i, pm + i, inv + i, count - i);
+}
+
+// 把16个RGBA水印像素重排成与RGB24目标对齐的48字节颜色和48字节alpha
+static inline void PackRGBA16(const uint8_t* wm, __m128i color[3], __m128i alpha[3])
+{
+    const __m128i rgbMask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i aMask = _mm_setr_epi8(3, 3, 3, 7, 7, 7, 11, 11, 11, 15, 15, 15, -1, -1, -1, -1);
+
+    __m128i p[4], c[4], a[4];
+    for (int k = 0; k < 4; k++) {
+        p[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wm + k * 16));
+        c[k] = _mm_shuffle_epi8(p[k], rgbMask);
+        a[k] = _mm_shuffle_epi8(p[k], aMask);
+    }
+
+    color[0] = _mm_or_si128(c[0], _mm_slli_si128(c[1], 12));
+    color[1] = _mm_or_si128(_mm_srli_si128(c[1], 4), _mm_slli_si128(c[2], 8));
+    color[2] = _mm_or_si128(_mm_srli_si128(c[2], 8), _mm_slli_si128(c[3], 4));
+    alpha[0] = _mm_or_si128(a[0], _mm_slli_si128(a[1], 12));
+    alpha[1] = _mm_or_si128(_mm_srli_si128(a[1], 4), _mm_slli_si128(a[2], 8));
+    alpha[2] = _mm_or_si128(_mm_srli_si128(a[2], 8), _mm_slli_si128(a[3], 4));
+}
+
+static void BlendPackedRGB24AVX2(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count)
+{
+    const __m256i alpha = _mm256_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        // 32个像素 = 96字节目标 = 6个128位块
+        __m128i color[6], wmA[6];
+        PackRGBA16(wmRGBA + i * 4, color, wmA);
+        PackRGBA16(wmRGBA + i * 4 + 64, color + 3, wmA + 3);
+        for (int k = 0; k < 3; k++) {
+            __m256i* d = reinterpret_cast<__m256i*>(dst + i * 3 + k * 32);
+            __m256i w = _mm256_set_m128i(color[2 * k + 1], color[2 * k]);
+            __m256i a = _mm256_set_m128i(wmA[2 * k + 1], wmA[2 * k]);
+            _mm256_storeu_si256(d, Blend32(_mm256_loadu_si256(d), w, a, alpha));
+        }
+    }
+    BlendPackedRGB24Scalar(dst + i * 3, wmRGBA + i * 4, alpha255, count - i);
+}
+
+static void BlendPackedRGBAAVX2(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count)
+{
+    // alpha复制到RGB三个字节，第4字节的系数为0，保持目标原值
+    const __m256i aMask = _mm256_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1,
+                                           3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1);
+    const __m256i alpha = _mm256_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i* d = reinterpret_cast<__m256i*>(dst + i * 4);
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(wmRGBA + i * 4));
+        _mm256_storeu_si256(d, Blend32(_mm256_loadu_si256(d), w, _mm256_shuffle_epi8(w, aMask), alpha));
+    }
+    BlendPackedRGBAScalar(dst + i * 4, wmRGBA + i * 4, alpha255, count - i);
+}
+
+// 融合转换用的常量，见BlendKernels_SSE41.cpp
+static const int kYuvBiasY = 128 + (16 << 8);
+static const int kYuvBiasUV = 128 + (128 << 8);
+
+// 8个BGRA像素按128位通道展开：lo为像素0,1|4,5，hi为像素2,3|6,7；pm非空时混合水印
+static inline void LoadBgra8(const uint8_t* bgra, const uint16_t* pm, const uint8_t* inv, __m256i out[2])
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgra));
+    out[0] = _mm256_unpacklo_epi8(p, zero);
+    out[1] = _mm256_unpackhi_epi8(p, zero);
+    if (pm) {
+        // pm按像素顺序存放，调整成与unpack相同的通道排列
+        __m256i pmA = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pm));
+        __m256i pmB = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pm + 16));
+        __m256i n = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inv));
+        out[0] = Div255Epu16(_mm256_add_epi16(_mm256_mullo_epi16(out[0], _mm256_unpacklo_epi8(n, zero)),
+                                              _mm256_permute2x128_si256(pmA, pmB, 0x20)));
+        out[1] = Div255Epu16(_mm256_add_epi16(_mm256_mullo_epi16(out[1], _mm256_unpackhi_epi8(n, zero)),
+                                              _mm256_permute2x128_si256(pmA, pmB, 0x31)));
+    }
+}
+
+// 32个像素：两行各写32个Y，写16个U和16个V
+static inline void ConvertBgra32(const BgraToYuvRows& rows, int x, bool blend)
+{
+    const __m256i cy = _mm256_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0);
+    const __m256i cuv = _mm256_setr_epi16(112, -74, -38, 0, -18, -94, 112, 0, 112, -74, -38, 0, -18, -94, 112, 0);
+    const __m256i biasY = _mm256_set1_epi32(kYuvBiasY);
+    const __m256i biasUV = _mm256_set1_epi32(kYuvBiasUV);
+    const __m256i two = _mm256_set1_epi16(2);
+    // packus之后每个128位通道中的4字节组是 0-3,8-11,16-19,24-27 | 4-7,12-15,20-23,28-31
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256i split = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+                                           0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+    __m256i yv[2][4], uv[4];
+    for (int g = 0; g < 4; g++) {
+        int px = x + g * 8;
+        __m256i p[2][2];
+        for (int r = 0; r < 2; r++) {
+            const uint16_t* pm = blend && rows.pm[r] ? rows.pm[r] + px * 4 : nullptr;
+            LoadBgra8(rows.bgra[r] + px * 4, pm, pm ? rows.inv[r] + px * 4 : nullptr, p[r]);
+            __m256i s = _mm256_hadd_epi32(_mm256_madd_epi16(p[r][0], cy), _mm256_madd_epi16(p[r][1], cy));
+            yv[r][g] = _mm256_srli_epi32(_mm256_add_epi32(s, biasY), 8);
+        }
+
+        __m256i c[2];
+        for (int k = 0; k < 2; k++) {
+            __m256i s = _mm256_add_epi16(p[0][k], p[1][k]);
+            s = _mm256_add_epi16(_mm256_unpacklo_epi64(s, s), _mm256_unpackhi_epi64(s, s));
+            c[k] = _mm256_madd_epi16(_mm256_srli_epi16(_mm256_add_epi16(s, two), 2), cuv);
+        }
+        uv[g] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_hadd_epi32(c[0], c[1]), biasUV), 8);
+    }
+
+    for (int r = 0; r < 2; r++) {
+        __m256i y = _mm256_packus_epi16(_mm256_packs_epi32(yv[r][0], yv[r][1]),
+                                        _mm256_packs_epi32(yv[r][2], yv[r][3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rows.y[r] + x), _mm256_permutevar8x32_epi32(y, order));
+    }
+    __m256i c = _mm256_packus_epi16(_mm256_packs_epi32(uv[0], uv[1]), _mm256_packs_epi32(uv[2], uv[3]));
+    c = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(c, order), split);
+    c = _mm256_permute4x64_epi64(c, 0xD8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rows.u + x / 2), _mm256_castsi256_si128(c));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rows.v + x / 2), _mm256_extracti128_si256(c, 1));
+}
+
+static void BlendBgraToYuv420AVX2(const BgraToYuvRows& rows, int count, int wmCount)
+{
+    int i = 0;
+    if (wmCount > 0) {
+        for (; i + 32 <= wmCount; i += 32) {
+            ConvertBgra32(rows, i, true);
+        }
+        // 水印右边界所在的一段交给标量实现
+        int edge = (wmCount + 1) & ~1;
+        if (edge > count) {
+            edge = count;
+        }
+        if (i < edge) {
+            BlendBgraToYuv420Scalar(AdvanceBgraToYuvRows(rows, i), edge - i, wmCount - i);
+            i = edge;
+        }
+    }
+    for (; i + 32 <= count; i += 32) {
+        ConvertBgra32(rows, i, false);
+    }
+    BlendBgraToYuv420Scalar(AdvanceBgraToYuvRows(rows, i), count - i, 0);
+}
+
+static const BlendKernels g_avx2Kernels = {
+    BlendIsa::AVX2,
+    "AVX2",
+    BlendPlanarAVX2,
+    BlendPlanarUniformAVX2,
+    BlendPremulAVX2,
+    BlendPackedRGB24AVX2,
+    BlendPackedRGBAAVX2,
+    BlendBgraToYuv420AVX2
+};
+
+const BlendKernels* GetBlendKernelsAVX2()
+{
+    return &g_avx2Kernels;
+}
+
+#else
+
+const BlendKernels* GetBlendKernelsAVX2()
+{
+    return nullptr;
+}
+
+#endif
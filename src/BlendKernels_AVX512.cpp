@@ -0,0 +1,245 @@
+#include "BlendKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+
+#include <immintrin.h>
+
+// 16位通道上的四舍五入 x/255（需要AVX-512BW）
+static inline __m512i Div255Epu16(__m512i x)
+{
+    x = _mm512_add_epi16(x, _mm512_set1_epi16(128));
+    return _mm512_srli_epi16(_mm512_add_epi16(x, _mm512_srli_epi16(x, 8)), 8);
+}
+
+// 64个字节逐字节混合；unpack/packus都在128位通道内进行，字节顺序保持不变
+static inline __m512i Blend64(__m512i v, __m512i w, __m512i wmA, __m512i alpha)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i c255 = _mm512_set1_epi16(255);
+
+    __m512i aLo = Div255Epu16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(wmA, zero), alpha));
+    __m512i aHi = Div255Epu16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(wmA, zero), alpha));
+
+    __m512i lo = _mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(v, zero), _mm512_sub_epi16(c255, aLo)),
+                                  _mm512_mullo_epi16(_mm512_unpacklo_epi8(w, zero), aLo));
+    __m512i hi = _mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(v, zero), _mm512_sub_epi16(c255, aHi)),
+                                  _mm512_mullo_epi16(_mm512_unpackhi_epi8(w, zero), aHi));
+
+    return _mm512_packus_epi16(Div255Epu16(lo), Div255Epu16(hi));
+}
+
+static void BlendPlanarAVX512(uint8_t* dst, const uint8_t* wm, const uint8_t* wmA, int alpha255, int count)
+{
+    const __m512i alpha = _mm512_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i v = _mm512_loadu_si512(dst + i);
+        __m512i w = _mm512_loadu_si512(wm + i);
+        __m512i a = _mm512_loadu_si512(wmA + i);
+        _mm512_storeu_si512(dst + i, Blend64(v, w, a, alpha));
+    }
+    BlendPlanarScalar(dst + i, wm + i, wmA + i, alpha255, count - i);
+}
+
+static void BlendPlanarUniformAVX512(uint8_t* dst, const uint8_t* wm, int a, int count)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i va = _mm512_set1_epi16(static_cast<short>(a));
+    const __m512i vinv = _mm512_set1_epi16(static_cast<short>(255 - a));
+    int i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i v = _mm512_loadu_si512(dst + i);
+        __m512i w = _mm512_loadu_si512(wm + i);
+        __m512i lo = _mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(v, zero), vinv),
+                                      _mm512_mullo_epi16(_mm512_unpacklo_epi8(w, zero), va));
+        __m512i hi = _mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(v, zero), vinv),
+                                      _mm512_mullo_epi16(_mm512_unpackhi_epi8(w, zero), va));
+        _mm512_storeu_si512(dst + i, _mm512_packus_epi16(Div255Epu16(lo), Div255Epu16(hi)));
+    }
+    BlendPlanarUniformScalar(dst + i, wm + i, a, count - i);
+}
+
+static void BlendPremulAVX512(uint8_t* dst, const uint16_t* pm, const uint8_t* inv, int count)
+{
+    // packus按128位通道交错两个输入，用64位置换还原顺序
+    const __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+    int i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i vLo = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i)));
+        __m512i vHi = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i + 32)));
+        __m512i nLo = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(inv + i)));
+        __m512i nHi = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(inv + i + 32)));
+        __m512i lo = _mm512_add_epi16(_mm512_mullo_epi16(vLo, nLo), _mm512_loadu_si512(pm + i));
+        __m512i hi = _mm512_add_epi16(_mm512_mullo_epi16(vHi, nHi), _mm512_loadu_si512(pm + i + 32));
+        __m512i packed = _mm512_packus_epi16(Div255Epu16(lo), Div255Epu16(hi));
+        _mm512_storeu_si512(dst + i, _mm512_permutexvar_epi64(order, packed));
+    }
+    BlendPremulScalar(dst + i, pm + i, inv + i, count - i);
+}
+
+// 把16个RGBA水印像素重排成与RGB24目标对齐的48字节颜色和48字节alpha
+static inline void PackRGBA16(const uint8_t* wm, __m128i color[3], __m128i alpha[3])
+{
+    const __m128i rgbMask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i aMask = _mm_setr_epi8(3, 3, 3, 7, 7, 7, 11, 11, 11, 15, 15, 15, -1, -1, -1, -1);
+
+    __m128i p[4], c[4], a[4];
+    for (int k = 0; k < 4; k++) {
+        p[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wm + k * 16));
+        c[k] = _mm_shuffle_epi8(p[k], rgbMask);
+        a[k] = _mm_shuffle_epi8(p[k], aMask);
+    }
+
+    color[0] = _mm_or_si128(c[0], _mm_slli_si128(c[1], 12));
+    color[1] = _mm_or_si128(_mm_srli_si128(c[1], 4), _mm_slli_si128(c[2], 8));
+    color[2] = _mm_or_si128(_mm_srli_si128(c[2], 8), _mm_slli_si128(c[3], 4));
+    alpha[0] = _mm_or_si128(a[0], _mm_slli_si128(a[1], 12));
+    alpha[1] = _mm_or_si128(_mm_srli_si128(a[1], 4), _mm_slli_si128(a[2], 8));
+    alpha[2] = _mm_or_si128(_mm_srli_si128(a[2], 8), _mm_slli_si128(a[3], 4));
+}
+
+static inline __m512i Combine4(const __m128i* chunks)
+{
+    __m512i r = _mm512_castsi128_si512(chunks[0]);
+    r = _mm512_inserti32x4(r, chunks[1], 1);
+    r = _mm512_inserti32x4(r, chunks[2], 2);
+    return _mm512_inserti32x4(r, chunks[3], 3);
+}
+
+static void BlendPackedRGB24AVX512(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count)
+{
+    const __m512i alpha = _mm512_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 64 <= count; i += 64) {
+        // 64个像素 = 192字节目标 = 12个128位块
+        __m128i color[12], wmA[12];
+        for (int g = 0; g < 4; g++) {
+            PackRGBA16(wmRGBA + (i + g * 16) * 4, color + g * 3, wmA + g * 3);
+        }
+        for (int k = 0; k < 3; k++) {
+            uint8_t* d = dst + i * 3 + k * 64;
+            _mm512_storeu_si512(d, Blend64(_mm512_loadu_si512(d), Combine4(color + k * 4),
+                                           Combine4(wmA + k * 4), alpha));
+        }
+    }
+    BlendPackedRGB24Scalar(dst + i * 3, wmRGBA + i * 4, alpha255, count - i);
+}
+
+static void BlendPackedRGBAAVX512(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count)
+{
+    // alpha复制到RGB三个字节，第4字节的系数为0，保持目标原值
+    const __m512i aMask = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1));
+    const __m512i alpha = _mm512_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8_t* d = dst + i * 4;
+        __m512i w = _mm512_loadu_si512(wmRGBA + i * 4);
+        _mm512_storeu_si512(d, Blend64(_mm512_loadu_si512(d), w, _mm512_shuffle_epi8(w, aMask), alpha));
+    }
+    BlendPackedRGBAScalar(dst + i * 4, wmRGBA + i * 4, alpha255, count - i);
+}
+
+// 融合转换用的常量，见BlendKernels_SSE41.cpp
+static const int kYuvBiasY = 128 + (16 << 8);
+static const int kYuvBiasUV = 128 + (128 << 8);
+
+// 8个BGRA像素零扩展，每个像素占一个64位元素，顺序不变；pm非空时混合水印
+static inline __m512i LoadBgra8(const uint8_t* bgra, const uint16_t* pm, const uint8_t* inv)
+{
+    __m512i p = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgra)));
+    if (pm) {
+        __m512i n = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(inv)));
+        p = Div255Epu16(_mm512_add_epi16(_mm512_mullo_epi16(p, n), _mm512_loadu_si512(pm)));
+    }
+    return p;
+}
+
+// 每个64位元素中的两个32位部分和相加，加偏移右移8位后取低字节
+static inline __m128i SumPairsToBytes(__m512i m, __m512i bias)
+{
+    __m512i s = _mm512_add_epi32(m, _mm512_srli_epi64(m, 32));
+    return _mm512_cvtepi64_epi8(_mm512_srli_epi32(_mm512_add_epi32(s, bias), 8));
+}
+
+// 16个像素：两行各写16个Y，写8个U和8个V
+static inline void ConvertBgra16(const BgraToYuvRows& rows, int x, bool blend)
+{
+    const __m512i cy = _mm512_set1_epi64(0x0000004200810019LL);           // 25, 129, 66, 0
+    const __m512i cuv = _mm512_broadcast_i32x4(_mm_setr_epi16(112, -74, -38, 0, -18, -94, 112, 0));
+    const __m512i biasY = _mm512_set1_epi32(kYuvBiasY);
+    const __m512i biasUV = _mm512_set1_epi32(kYuvBiasUV);
+    const __m512i two = _mm512_set1_epi16(2);
+    const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+    __m512i p[2][2];
+    for (int r = 0; r < 2; r++) {
+        const uint16_t* pm = blend && rows.pm[r] ? rows.pm[r] + x * 4 : nullptr;
+        for (int h = 0; h < 2; h++) {
+            p[r][h] = LoadBgra8(rows.bgra[r] + (x + h * 8) * 4, pm ? pm + h * 32 : nullptr,
+                                pm ? rows.inv[r] + (x + h * 8) * 4 : nullptr);
+        }
+        __m128i y = _mm_unpacklo_epi64(SumPairsToBytes(_mm512_madd_epi16(p[r][0], cy), biasY),
+                                       SumPairsToBytes(_mm512_madd_epi16(p[r][1], cy), biasY));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rows.y[r] + x), y);
+    }
+
+    // 2x2块：两行相加，同一128位中的两个像素相加后低64位算U、高64位算V
+    __m128i c[2];
+    for (int h = 0; h < 2; h++) {
+        __m512i s = _mm512_add_epi16(p[0][h], p[1][h]);
+        s = _mm512_add_epi16(_mm512_unpacklo_epi64(s, s), _mm512_unpackhi_epi64(s, s));
+        c[h] = SumPairsToBytes(_mm512_madd_epi16(_mm512_srli_epi16(_mm512_add_epi16(s, two), 2), cuv), biasUV);
+    }
+    __m128i uv = _mm_shuffle_epi8(_mm_unpacklo_epi64(c[0], c[1]), split);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(rows.u + x / 2), uv);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(rows.v + x / 2), _mm_srli_si128(uv, 8));
+}
+
+static void BlendBgraToYuv420AVX512(const BgraToYuvRows& rows, int count, int wmCount)
+{
+    int i = 0;
+    if (wmCount > 0) {
+        for (; i + 16 <= wmCount; i += 16) {
+            ConvertBgra16(rows, i, true);
+        }
+        // 水印右边界所在的一段交给标量实现
+        int edge = (wmCount + 1) & ~1;
+        if (edge > count) {
+            edge = count;
+        }
+        if (i < edge) {
+            BlendBgraToYuv420Scalar(AdvanceBgraToYuvRows(rows, i), edge - i, wmCount - i);
+            i = edge;
+        }
+    }
+    for (; i + 16 <= count; i += 16) {
+        ConvertBgra16(rows, i, false);
+    }
+    BlendBgraToYuv420Scalar(AdvanceBgraToYuvRows(rows, i), count - i, 0);
+}
+
+static const BlendKernels g_avx512Kernels = {
+    BlendIsa::AVX512,
+    "AVX-512",
+    BlendPlanarAVX512,
+    BlendPlanarUniformAVX512,
+    BlendPremulAVX512,
+    BlendPackedRGB24AVX512,
+    BlendPackedRGBAAVX512,
+    BlendBgraToYuv420AVX512
+};
+
+const BlendKernels* GetBlendKernelsAVX512()
+{
+    return &g_avx512Kernels;
+}
+
+#else
+
+const BlendKernels* GetBlendKernelsAVX512()
+{
+    return nullptr;
+}
+
+#endif
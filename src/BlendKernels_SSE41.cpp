@@ -0,0 +1,238 @@
+#include "BlendKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+
+#include <smmintrin.h>
+
+// 16位通道上的四舍五入 x/255
+static inline __m128i Div255Epu16(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// 16个字节逐字节混合，w/wmA与v按字节一一对应
+static inline __m128i Blend16(__m128i v, __m128i w, __m128i wmA, __m128i alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi16(255);
+
+    __m128i aLo = Div255Epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(wmA, zero), alpha));
+    __m128i aHi = Div255Epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(wmA, zero), alpha));
+
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), _mm_sub_epi16(c255, aLo)),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(w, zero), aLo));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), _mm_sub_epi16(c255, aHi)),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(w, zero), aHi));
+
+    return _mm_packus_epi16(Div255Epu16(lo), Div255Epu16(hi));
+}
+
+static void BlendPlanarSSE41(uint8_t* dst, const uint8_t* wm, const uint8_t* wmA, int alpha255, int count)
+{
+    const __m128i alpha = _mm_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wm + i));
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wmA + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), Blend16(v, w, a, alpha));
+    }
+    BlendPlanarScalar(dst + i, wm + i, wmA + i, alpha255, count - i);
+}
+
+static void BlendPlanarUniformSSE41(uint8_t* dst, const uint8_t* wm, int a, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i va = _mm_set1_epi16(static_cast<short>(a));
+    const __m128i vinv = _mm_set1_epi16(static_cast<short>(255 - a));
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wm + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), vinv),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(w, zero), va));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), vinv),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(w, zero), va));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(Div255Epu16(lo), Div255Epu16(hi)));
+    }
+    BlendPlanarUniformScalar(dst + i, wm + i, a, count - i);
+}
+
+static void BlendPremulSSE41(uint8_t* dst, const uint16_t* pm, const uint8_t* inv, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i n = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inv + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(n, zero)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(pm + i)));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(n, zero)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(pm + i + 8)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(Div255Epu16(lo), Div255Epu16(hi)));
+    }
+    BlendPremulScalar(dst + i, pm + i, inv + i, count - i);
+}
+
+// 把16个RGBA水印像素重排成与RGB24目标对齐的48字节颜色和48字节alpha
+static inline void PackRGBA16(const uint8_t* wm, __m128i color[3], __m128i alpha[3])
+{
+    const __m128i rgbMask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i aMask = _mm_setr_epi8(3, 3, 3, 7, 7, 7, 11, 11, 11, 15, 15, 15, -1, -1, -1, -1);
+
+    __m128i p[4], c[4], a[4];
+    for (int k = 0; k < 4; k++) {
+        p[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wm + k * 16));
+        c[k] = _mm_shuffle_epi8(p[k], rgbMask);
+        a[k] = _mm_shuffle_epi8(p[k], aMask);
+    }
+
+    color[0] = _mm_or_si128(c[0], _mm_slli_si128(c[1], 12));
+    color[1] = _mm_or_si128(_mm_srli_si128(c[1], 4), _mm_slli_si128(c[2], 8));
+    color[2] = _mm_or_si128(_mm_srli_si128(c[2], 8), _mm_slli_si128(c[3], 4));
+    alpha[0] = _mm_or_si128(a[0], _mm_slli_si128(a[1], 12));
+    alpha[1] = _mm_or_si128(_mm_srli_si128(a[1], 4), _mm_slli_si128(a[2], 8));
+    alpha[2] = _mm_or_si128(_mm_srli_si128(a[2], 8), _mm_slli_si128(a[3], 4));
+}
+
+static void BlendPackedRGB24SSE41(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count)
+{
+    const __m128i alpha = _mm_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i color[3], wmA[3];
+        PackRGBA16(wmRGBA + i * 4, color, wmA);
+        for (int k = 0; k < 3; k++) {
+            __m128i* d = reinterpret_cast<__m128i*>(dst + i * 3 + k * 16);
+            _mm_storeu_si128(d, Blend16(_mm_loadu_si128(d), color[k], wmA[k], alpha));
+        }
+    }
+    BlendPackedRGB24Scalar(dst + i * 3, wmRGBA + i * 4, alpha255, count - i);
+}
+
+static void BlendPackedRGBASSE41(uint8_t* dst, const uint8_t* wmRGBA, int alpha255, int count)
+{
+    // alpha复制到RGB三个字节，第4字节的系数为0，保持目标原值
+    const __m128i aMask = _mm_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1);
+    const __m128i alpha = _mm_set1_epi16(static_cast<short>(alpha255));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i* d = reinterpret_cast<__m128i*>(dst + i * 4);
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wmRGBA + i * 4));
+        _mm_storeu_si128(d, Blend16(_mm_loadu_si128(d), w, _mm_shuffle_epi8(w, aMask), alpha));
+    }
+    BlendPackedRGBAScalar(dst + i * 4, wmRGBA + i * 4, alpha255, count - i);
+}
+
+// 融合转换用的常量：BT.601系数按BGRA像素排列，madd得到每个像素的两个部分和，再用hadd合并
+// Y = (s + 128 + 16 * 256) >> 8；U/V = (s + 128 + 128 * 256) >> 8，加偏移后都是正数
+static const int kYuvBiasY = 128 + (16 << 8);
+static const int kYuvBiasUV = 128 + (128 << 8);
+
+// 4个BGRA像素展开成两个16位向量（各2个像素），pm非空时混合水印
+static inline void LoadBgra4(const uint8_t* bgra, const uint16_t* pm, const uint8_t* inv, __m128i out[2])
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra));
+    out[0] = _mm_unpacklo_epi8(p, zero);
+    out[1] = _mm_unpackhi_epi8(p, zero);
+    if (pm) {
+        __m128i n = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inv));
+        out[0] = Div255Epu16(_mm_add_epi16(_mm_mullo_epi16(out[0], _mm_unpacklo_epi8(n, zero)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(pm))));
+        out[1] = Div255Epu16(_mm_add_epi16(_mm_mullo_epi16(out[1], _mm_unpackhi_epi8(n, zero)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(pm + 8))));
+    }
+}
+
+// 16个像素：两行各写16个Y，写8个U和8个V
+static inline void ConvertBgra16(const BgraToYuvRows& rows, int x, bool blend)
+{
+    const __m128i cy = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+    const __m128i cuv = _mm_setr_epi16(112, -74, -38, 0, -18, -94, 112, 0);
+    const __m128i biasY = _mm_set1_epi32(kYuvBiasY);
+    const __m128i biasUV = _mm_set1_epi32(kYuvBiasUV);
+    const __m128i two = _mm_set1_epi16(2);
+    // U0 V0 U1 V1 ... -> U0..U7 V0..V7
+    const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+    __m128i yv[2][4], uv[4];
+    for (int g = 0; g < 4; g++) {
+        int px = x + g * 4;
+        __m128i p[2][2];
+        for (int r = 0; r < 2; r++) {
+            const uint16_t* pm = blend && rows.pm[r] ? rows.pm[r] + px * 4 : nullptr;
+            LoadBgra4(rows.bgra[r] + px * 4, pm, pm ? rows.inv[r] + px * 4 : nullptr, p[r]);
+            __m128i s = _mm_hadd_epi32(_mm_madd_epi16(p[r][0], cy), _mm_madd_epi16(p[r][1], cy));
+            yv[r][g] = _mm_srli_epi32(_mm_add_epi32(s, biasY), 8);
+        }
+
+        // 2x2块：两行相加，再把同一128位中的两个像素相加，四舍五入取平均
+        __m128i c[2];
+        for (int k = 0; k < 2; k++) {
+            __m128i s = _mm_add_epi16(p[0][k], p[1][k]);
+            s = _mm_add_epi16(_mm_unpacklo_epi64(s, s), _mm_unpackhi_epi64(s, s));
+            c[k] = _mm_madd_epi16(_mm_srli_epi16(_mm_add_epi16(s, two), 2), cuv);
+        }
+        uv[g] = _mm_srli_epi32(_mm_add_epi32(_mm_hadd_epi32(c[0], c[1]), biasUV), 8);
+    }
+
+    for (int r = 0; r < 2; r++) {
+        __m128i y = _mm_packus_epi16(_mm_packs_epi32(yv[r][0], yv[r][1]), _mm_packs_epi32(yv[r][2], yv[r][3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rows.y[r] + x), y);
+    }
+    __m128i c = _mm_shuffle_epi8(_mm_packus_epi16(_mm_packs_epi32(uv[0], uv[1]), _mm_packs_epi32(uv[2], uv[3])), split);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(rows.u + x / 2), c);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(rows.v + x / 2), _mm_srli_si128(c, 8));
+}
+
+static void BlendBgraToYuv420SSE41(const BgraToYuvRows& rows, int count, int wmCount)
+{
+    int i = 0;
+    if (wmCount > 0) {
+        for (; i + 16 <= wmCount; i += 16) {
+            ConvertBgra16(rows, i, true);
+        }
+        // 水印右边界所在的一段交给标量实现
+        int edge = (wmCount + 1) & ~1;
+        if (edge > count) {
+            edge = count;
+        }
+        if (i < edge) {
+            BlendBgraToYuv420Scalar(AdvanceBgraToYuvRows(rows, i), edge - i, wmCount - i);
+            i = edge;
+        }
+    }
+    for (; i + 16 <= count; i += 16) {
+        ConvertBgra16(rows, i, false);
+    }
+    BlendBgraToYuv420Scalar(AdvanceBgraToYuvRows(rows, i), count - i, 0);
+}
+
+static const BlendKernels g_sse41Kernels = {
+    BlendIsa::SSE41,
+    "SSE4.1",
+    BlendPlanarSSE41,
+    BlendPlanarUniformSSE41,
+    BlendPremulSSE41,
+    BlendPackedRGB24SSE41,
+    BlendPackedRGBASSE41,
+    BlendBgraToYuv420SSE41
+};
+
+const BlendKernels* GetBlendKernelsSSE41()
+{
+    return &g_sse41Kernels;
+}
+
+#else
+
+const BlendKernels* GetBlendKernelsSSE41()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include "BlendPlan.h"
+#include <iostream>
+
+// 16位通道内的最大中间值 255*255 + 128 不能溢出
+static_assert(255 * 255 + 128 < 65536, "预乘中间结果必须放得进16位");
+// div255 在整个取值范围内都是四舍五入的 x/255
+static_assert(BlendDiv255(0) == 0 && BlendDiv255(127) == 0 && BlendDiv255(128) == 1, "div255舍入错误");
+static_assert(BlendDiv255(255 * 255) == 255 && BlendDiv255(255 * 128) == 128, "div255舍入错误");
+
+static const int kPlanAlignment = 64;
+
+static int AlignUp(int value, int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+BlendPlan::BlendPlan()
+    : inv_(nullptr)
+    , premul_(nullptr)
+    , invStride_(0)
+    , premulStride_(0)
+    , elementsPerRow_(0)
+    , height_(0)
+    , alpha255_(0)
+    , coef_()
+{
+}
+
+bool BlendPlan::Allocate(int elementsPerRow, int height, int alpha255)
+{
+    if (elementsPerRow <= 0 || height <= 0 || alpha255 < 0 || alpha255 > 255) {
+        std::cerr << "无效的混合计划参数: " << elementsPerRow << "x" << height
+                  << ", alpha=" << alpha255 << std::endl;
+        return false;
+    }
+
+    elementsPerRow_ = elementsPerRow;
+    height_ = height;
+    alpha255_ = alpha255;
+    invStride_ = AlignUp(elementsPerRow, kPlanAlignment);
+    premulStride_ = AlignUp(elementsPerRow * 2, kPlanAlignment) / 2;
+
+    // 两个平面放在同一块内存里，多分配一个对齐单位用于调整起始地址
+    size_t invBytes = static_cast<size_t>(invStride_) * height;
+    size_t premulBytes = static_cast<size_t>(premulStride_) * 2 * height;
+    storage_.assign(invBytes + premulBytes + kPlanAlignment, 0);
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(storage_.data());
+    size_t pad = (kPlanAlignment - base % kPlanAlignment) % kPlanAlignment;
+    inv_ = storage_.data() + pad;
+    premul_ = reinterpret_cast<uint16_t*>(inv_ + invBytes);
+
+    for (int wa = 0; wa < 256; wa++) {
+        coef_[wa] = static_cast<uint8_t>(BlendDiv255(wa * alpha255));
+    }
+    return true;
+}
+
+bool BlendPlan::BuildPackedRGB24(const uint8_t* wmRGBA, int wmStride, int width, int height, int alpha255)
+{
+    if (!wmRGBA || !Allocate(width * 3, height, alpha255)) {
+        return false;
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = wmRGBA + static_cast<size_t>(y) * wmStride;
+        uint8_t* inv = inv_ + static_cast<size_t>(y) * invStride_;
+        uint16_t* pm = premul_ + static_cast<size_t>(y) * premulStride_;
+        for (int x = 0; x < width; x++) {
+            int a = coef_[src[x * 4 + 3]];
+            for (int c = 0; c < 3; c++) {
+                inv[x * 3 + c] = static_cast<uint8_t>(255 - a);
+                pm[x * 3 + c] = static_cast<uint16_t>(src[x * 4 + c] * a);
+            }
+        }
+    }
+    return true;
+}
+
+bool BlendPlan::BuildPackedBGRA(const uint8_t* wmRGBA, int wmStride, int width, int height, int alpha255)
+{
+    if (!wmRGBA || !Allocate(width * 4, height, alpha255)) {
+        return false;
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = wmRGBA + static_cast<size_t>(y) * wmStride;
+        uint8_t* inv = inv_ + static_cast<size_t>(y) * invStride_;
+        uint16_t* pm = premul_ + static_cast<size_t>(y) * premulStride_;
+        for (int x = 0; x < width; x++) {
+            int a = coef_[src[x * 4 + 3]];
+            for (int c = 0; c < 3; c++) {
+                inv[x * 4 + c] = static_cast<uint8_t>(255 - a);
+                pm[x * 4 + c] = static_cast<uint16_t>(src[x * 4 + 2 - c] * a);
+            }
+            // div255(dst * 255 + 0) == dst
+            inv[x * 4 + 3] = 255;
+            pm[x * 4 + 3] = 0;
+        }
+    }
+    return true;
+}
+
+bool BlendPlan::BuildPlanar(const uint8_t* wm, const uint8_t* wmA, int wmStride, int width, int height, int alpha255)
+{
+    if (!wm || !wmA || !Allocate(width, height, alpha255)) {
+        return false;
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* srcW = wm + static_cast<size_t>(y) * wmStride;
+        const uint8_t* srcA = wmA + static_cast<size_t>(y) * wmStride;
+        uint8_t* inv = inv_ + static_cast<size_t>(y) * invStride_;
+        uint16_t* pm = premul_ + static_cast<size_t>(y) * premulStride_;
+        for (int x = 0; x < width; x++) {
+            int a = coef_[srcA[x]];
+            inv[x] = static_cast<uint8_t>(255 - a);
+            pm[x] = static_cast<uint16_t>(srcW[x] * a);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,166 @@
+#include "CaptureRing.h"
+#include <iostream>
+
+const char* DropPolicyName(DropPolicy policy)
+{
+    switch (policy) {
+    case DropPolicy::DropOldest: return "丢弃最旧帧";
+    case DropPolicy::DropNewest: return "丢弃最新帧";
+    case DropPolicy::Block: return "阻塞采集";
+    }
+    return "未知";
+}
+
+CaptureRing::CaptureRing()
+    : capacity_(0)
+    , policy_(DropPolicy::DropOldest)
+    , readyHead_(0)
+    , readyCount_(0)
+    , closed_(false)
+    , aborted_(false)
+    , stats_()
+{
+}
+
+bool CaptureRing::Initialize(int capacity, DropPolicy policy, int width, int height)
+{
+    if (capacity < 3) {
+        std::cerr << "帧环容量至少为3: " << capacity << std::endl;
+        return false;
+    }
+
+    capacity_ = capacity;
+    policy_ = policy;
+    slots_.reset(new CaptureSlot[capacity]);
+    free_.clear();
+    free_.reserve(capacity);
+    ready_.assign(capacity, -1);
+    for (int i = capacity - 1; i >= 0; i--) {
+        // 所有槽位的缓冲区在录制开始前分配好
+        slots_[i].buffer.Get(static_cast<size_t>(width) * 4 * height);
+        slots_[i].linesize = width * 4;
+        slots_[i].index = 0;
+        slots_[i].timestampUs = 0;
+        slots_[i].captureStartMs = 0.0;
+        slots_[i].dirty.Reset(width, height);
+        free_.push_back(i);
+    }
+    readyHead_ = 0;
+    readyCount_ = 0;
+    closed_ = false;
+    aborted_ = false;
+    stats_ = CaptureRingStats();
+    return true;
+}
+
+int CaptureRing::PopReady()
+{
+    int slot = ready_[readyHead_];
+    readyHead_ = (readyHead_ + 1) % capacity_;
+    readyCount_--;
+    return slot;
+}
+
+CaptureSlot* CaptureRing::AcquireWrite(bool keep)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (aborted_) {
+        return nullptr;
+    }
+    stats_.captured++;
+
+    if (free_.empty()) {
+        switch (policy_) {
+        case DropPolicy::DropOldest:
+            // 消费者最多占用一个槽位，容量>=3时环满说明至少有一帧在排队
+            stats_.dropped++;
+            return &slots_[PopReady()];
+        case DropPolicy::DropNewest:
+            if (!keep) {
+                stats_.dropped++;
+                return nullptr;
+            }
+            // 不能丢弃时按Block处理
+            [[fallthrough]];
+        case DropPolicy::Block:
+            stats_.blocked++;
+            freeCond_.wait(lock, [this] { return !free_.empty() || aborted_; });
+            if (aborted_) {
+                return nullptr;
+            }
+            break;
+        }
+    }
+
+    int slot = free_.back();
+    free_.pop_back();
+    return &slots_[slot];
+}
+
+void CaptureRing::CommitWrite(CaptureSlot* slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_[(readyHead_ + readyCount_) % capacity_] = static_cast<int>(slot - slots_.get());
+        readyCount_++;
+    }
+    readyCond_.notify_one();
+}
+
+void CaptureRing::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    readyCond_.notify_all();
+}
+
+CaptureSlot* CaptureRing::AcquireRead()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    readyCond_.wait(lock, [this] { return readyCount_ > 0 || closed_ || aborted_; });
+    if (aborted_ || readyCount_ == 0) {
+        return nullptr;
+    }
+    return &slots_[PopReady()];
+}
+
+void CaptureRing::ReleaseRead(CaptureSlot* slot)
+{
+    slot->dirty.Clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(static_cast<int>(slot - slots_.get()));
+        stats_.encoded++;
+    }
+    freeCond_.notify_one();
+}
+
+void CaptureRing::Abort()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = true;
+    }
+    readyCond_.notify_all();
+    freeCond_.notify_all();
+}
+
+bool CaptureRing::IsAborted() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return aborted_;
+}
+
+int CaptureRing::GetReadyCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return readyCount_;
+}
+
+CaptureRingStats CaptureRing::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,216 @@
+#include "ConvertBenchmark.h"
+#include "BlendKernels.h"
+#include "BlendPlan.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+// 固定种子的伪随机数据，保证每次报告的输入相同
+static void FillPattern(std::vector<uint8_t>& buffer, uint32_t seed)
+{
+    for (size_t i = 0; i < buffer.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buffer[i] = static_cast<uint8_t>(seed >> 24);
+    }
+}
+
+static AVFrame* AllocFrame(AVPixelFormat format, int width, int height)
+{
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
+    }
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    return frame;
+}
+
+// 两个YUV420P帧的同一平面逐像素比较，返回最大差值，mean为平均差值
+static int ComparePlanes(const AVFrame* a, const AVFrame* b, int plane, int width, int height, double& mean)
+{
+    int maxDiff = 0;
+    int64_t sum = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* pa = a->data[plane] + static_cast<size_t>(y) * a->linesize[plane];
+        const uint8_t* pb = b->data[plane] + static_cast<size_t>(y) * b->linesize[plane];
+        for (int x = 0; x < width; x++) {
+            int d = std::abs(pa[x] - pb[x]);
+            maxDiff = std::max(maxDiff, d);
+            sum += d;
+        }
+    }
+    mean = static_cast<double>(sum) / (static_cast<double>(width) * height);
+    return maxDiff;
+}
+
+static bool EqualFrames(const AVFrame* a, const AVFrame* b, int width, int height)
+{
+    for (int plane = 0; plane < 3; plane++) {
+        int w = plane == 0 ? width : (width + 1) / 2;
+        int h = plane == 0 ? height : (height + 1) / 2;
+        for (int y = 0; y < h; y++) {
+            if (memcmp(a->data[plane] + static_cast<size_t>(y) * a->linesize[plane],
+                       b->data[plane] + static_cast<size_t>(y) * b->linesize[plane], w) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void ConvertFused(const BlendKernels& kernels, const BlendPlan& plan,
+                         const uint8_t* bgra, int width, int height, AVFrame* yuv)
+{
+    for (int y = 0; y < height; y += 2) {
+        int rowY[2] = { y, std::min(y + 1, height - 1) };
+        BgraToYuvRows rows;
+        for (int r = 0; r < 2; r++) {
+            rows.bgra[r] = bgra + static_cast<size_t>(rowY[r]) * width * 4;
+            rows.pm[r] = plan.PremulRow(rowY[r]);
+            rows.inv[r] = plan.InvRow(rowY[r]);
+            rows.y[r] = yuv->data[0] + static_cast<size_t>(rowY[r]) * yuv->linesize[0];
+        }
+        rows.u = yuv->data[1] + static_cast<size_t>(y / 2) * yuv->linesize[1];
+        rows.v = yuv->data[2] + static_cast<size_t>(y / 2) * yuv->linesize[2];
+        kernels.bgraToYuv420(rows, width, width);
+    }
+}
+
+void ReportBgraToYuvThroughput(int width, int height, int iterations)
+{
+    if (width <= 1 || height <= 1 || iterations <= 0) {
+        std::cerr << "无效的测试参数" << std::endl;
+        return;
+    }
+
+    size_t pixels = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> bgra(pixels * 4), wmRGBA(pixels * 4);
+    FillPattern(bgra, 7);
+    FillPattern(wmRGBA, 8);
+    const int alpha255 = BlendAlpha255(0.3f);
+
+    BlendPlan rgbPlan, bgraPlan;
+    if (!rgbPlan.BuildPackedRGB24(wmRGBA.data(), width * 4, width, height, alpha255) ||
+        !bgraPlan.BuildPackedBGRA(wmRGBA.data(), width * 4, width, height, alpha255)) {
+        return;
+    }
+
+    AVFrame* rgbFrame = AllocFrame(AV_PIX_FMT_RGB24, width, height);
+    AVFrame* swsFrame = AllocFrame(AV_PIX_FMT_YUV420P, width, height);
+    AVFrame* refFrame = AllocFrame(AV_PIX_FMT_YUV420P, width, height);
+    AVFrame* fusedFrame = AllocFrame(AV_PIX_FMT_YUV420P, width, height);
+    SwsContext* sws = sws_getContext(width, height, AV_PIX_FMT_RGB24, width, height, AV_PIX_FMT_YUV420P,
+                                     SWS_BICUBIC, nullptr, nullptr, nullptr);
+    if (!rgbFrame || !swsFrame || !refFrame || !fusedFrame || !sws) {
+        std::cerr << "分配测试帧失败" << std::endl;
+        av_frame_free(&rgbFrame);
+        av_frame_free(&swsFrame);
+        av_frame_free(&refFrame);
+        av_frame_free(&fusedFrame);
+        sws_freeContext(sws);
+        return;
+    }
+
+    const BlendKernels& selected = GetBlendKernels();
+    std::vector<uint8_t> rgba(pixels * 4), rgb(pixels * 3);
+
+    // 旧流程：每一步都完整地遍历一次整帧（GPU混合用CPU预乘混合代替，上传/读回不计入）
+    auto oldChain = [&]() {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                size_t i = static_cast<size_t>(y) * width + x;
+                rgba[i * 4 + 0] = bgra[i * 4 + 2];
+                rgba[i * 4 + 1] = bgra[i * 4 + 1];
+                rgba[i * 4 + 2] = bgra[i * 4 + 0];
+                rgba[i * 4 + 3] = bgra[i * 4 + 3];
+            }
+        }
+        for (size_t i = 0; i < pixels; i++) {
+            rgb[i * 3 + 0] = rgba[i * 4 + 0];
+            rgb[i * 3 + 1] = rgba[i * 4 + 1];
+            rgb[i * 3 + 2] = rgba[i * 4 + 2];
+        }
+        for (int y = 0; y < height; y++) {
+            rgbPlan.BlendRow(selected, rgb.data() + static_cast<size_t>(y) * width * 3, y, 0, width * 3);
+        }
+        for (int y = 0; y < height; y++) {
+            memcpy(rgbFrame->data[0] + static_cast<size_t>(y) * rgbFrame->linesize[0],
+                   rgb.data() + static_cast<size_t>(y) * width * 3, static_cast<size_t>(width) * 3);
+        }
+        sws_scale(sws, rgbFrame->data, rgbFrame->linesize, 0, height, swsFrame->data, swsFrame->linesize);
+    };
+
+    auto measure = [&](auto&& oneFrame) {
+        oneFrame();
+        auto start = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; it++) {
+            oneFrame();
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    };
+
+    std::cout << "=== 录屏转换吞吐量 (" << width << "x" << height << " BGRA -> 混合水印 -> YUV420P, "
+              << iterations << " 次) ===" << std::endl;
+    std::cout << std::left << std::setw(22) << "流程"
+              << std::right << std::setw(10) << "ms/帧"
+              << std::setw(10) << "fps"
+              << std::setw(10) << "加速比"
+              << std::setw(8) << "一致" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    double oldMs = measure(oldChain);
+    std::cout << std::left << std::setw(22) << "旧流程 (5遍, sws)"
+              << std::right << std::setw(10) << oldMs
+              << std::setw(10) << 1000.0 / oldMs
+              << std::setw(10) << "1.00x"
+              << std::setw(8) << "-" << std::endl;
+
+    // 标量实现的结果作为融合内核的比对基准
+    ConvertFused(*GetSupportedBlendKernels().front(), bgraPlan, bgra.data(), width, height, refFrame);
+    for (const BlendKernels* k : GetSupportedBlendKernels()) {
+        double ms = measure([&]() {
+            ConvertFused(*k, bgraPlan, bgra.data(), width, height, fusedFrame);
+        });
+        bool exact = EqualFrames(fusedFrame, refFrame, width, height);
+        std::string name = std::string("融合 ") + k->name;
+        std::cout << std::left << std::setw(22) << name
+                  << std::right << std::setw(10) << ms
+                  << std::setw(10) << 1000.0 / ms
+                  << std::setw(9) << oldMs / ms << "x"
+                  << std::setw(8) << (exact ? "是" : "否") << std::endl;
+    }
+
+    // 融合内核用2x2平均做色度下采样，swscale用双三次滤波，两者的输出不要求逐字节相同；
+    // 测试输入是逐像素的随机噪声，色度差异远大于真实桌面画面
+    double meanY = 0.0, meanU = 0.0, meanV = 0.0;
+    int maxY = ComparePlanes(refFrame, swsFrame, 0, width, height, meanY);
+    int maxU = ComparePlanes(refFrame, swsFrame, 1, (width + 1) / 2, (height + 1) / 2, meanU);
+    int maxV = ComparePlanes(refFrame, swsFrame, 2, (width + 1) / 2, (height + 1) / 2, meanV);
+    std::cout << "与swscale输出的差异: Y 最大 " << maxY << " 平均 " << meanY
+              << ", U 最大 " << maxU << " 平均 " << meanU
+              << ", V 最大 " << maxV << " 平均 " << meanV << std::endl;
+    std::cout << std::defaultfloat;
+    std::cout << "运行时选择: " << selected.name << std::endl;
+
+    sws_freeContext(sws);
+    av_frame_free(&rgbFrame);
+    av_frame_free(&swsFrame);
+    av_frame_free(&refFrame);
+    av_frame_free(&fusedFrame);
+}
@@ -0,0 +1,253 @@
+#include "CursorCompositor.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// 指针形状的最大边长，DXGI的指针不会超过这个尺寸，超过时按数据损坏处理
+static const int kMaxCursorSize = 1024;
+
+CursorCompositor::CursorCompositor(int cacheSize, const BlendKernels* kernels)
+    : kernels_(kernels ? *kernels : GetBlendKernels())
+    , cacheSize_(std::max(cacheSize, 1))
+    , current_(-1)
+    , useClock_(0)
+    , hits_(0)
+    , misses_(0)
+{
+    cache_.reserve(cacheSize_);
+}
+
+uint64_t CursorCompositor::HashShape(const CursorShape& shape)
+{
+    // FNV-1a：形状一般只有几KB，而且只在形状变化时计算一次
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const uint8_t* bytes, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    int header[6] = { static_cast<int>(shape.type), shape.width, shape.height,
+                      shape.pitch, shape.hotSpotX, shape.hotSpotY };
+    mix(reinterpret_cast<const uint8_t*>(header), sizeof(header));
+    mix(shape.data, static_cast<size_t>(shape.pitch) * shape.height);
+    return hash;
+}
+
+bool CursorCompositor::Validate(const CursorShape& shape)
+{
+    if (!shape.data || shape.width <= 0 || shape.height <= 0 ||
+        shape.width > kMaxCursorSize || shape.height > kMaxCursorSize * 2) {
+        return false;
+    }
+    int minPitch = 0;
+    switch (shape.type) {
+    case CursorShapeType::Monochrome:
+        if (shape.height % 2 != 0) {
+            return false;
+        }
+        minPitch = (shape.width + 7) / 8;
+        break;
+    case CursorShapeType::Color:
+    case CursorShapeType::MaskedColor:
+        minPitch = shape.width * 4;
+        break;
+    default:
+        return false;
+    }
+    return shape.pitch >= minPitch &&
+           shape.size >= static_cast<size_t>(shape.pitch) * shape.height;
+}
+
+bool CursorCompositor::Matches(const Sprite& sprite, const CursorShape& shape, uint64_t hash)
+{
+    return sprite.hash == hash && sprite.type == shape.type &&
+           sprite.width == shape.width && sprite.pitch == shape.pitch &&
+           sprite.hotSpotX == shape.hotSpotX && sprite.hotSpotY == shape.hotSpotY &&
+           sprite.source.size() == static_cast<size_t>(shape.pitch) * shape.height &&
+           std::memcmp(sprite.source.data(), shape.data, sprite.source.size()) == 0;
+}
+
+void CursorCompositor::Decode(const CursorShape& shape, uint64_t hash, Sprite& sprite)
+{
+    int width = shape.width;
+    int height = shape.type == CursorShapeType::Monochrome ? shape.height / 2 : shape.height;
+    size_t elements = static_cast<size_t>(width) * 4 * height;
+
+    sprite.hash = hash;
+    sprite.type = shape.type;
+    sprite.width = width;
+    sprite.height = height;
+    sprite.pitch = shape.pitch;
+    sprite.hotSpotX = shape.hotSpotX;
+    sprite.hotSpotY = shape.hotSpotY;
+    sprite.source.assign(shape.data, shape.data + static_cast<size_t>(shape.pitch) * shape.height);
+    // 默认全部透明：inv = 255、pm = 0，第4个元素始终保持画面原值
+    sprite.pm.assign(elements, 0);
+    sprite.inv.assign(elements, 255);
+    sprite.xorMask.clear();
+    sprite.spanBegin.assign(height, 0);
+    sprite.spanEnd.assign(height, 0);
+
+    for (int row = 0; row < height; row++) {
+        uint16_t* pm = sprite.pm.data() + static_cast<size_t>(row) * width * 4;
+        uint8_t* inv = sprite.inv.data() + static_cast<size_t>(row) * width * 4;
+        int first = width;
+        int last = -1;
+
+        for (int col = 0; col < width; col++) {
+            uint16_t* p = pm + col * 4;
+            uint8_t* n = inv + col * 4;
+            const uint8_t* xorColor = nullptr;
+            static const uint8_t kInvert[3] = { 0xFF, 0xFF, 0xFF };
+
+            if (shape.type == CursorShapeType::Monochrome) {
+                // (屏幕 & AND) ^ XOR：AND=0时是黑/白，AND=1时是透明/反色
+                const uint8_t* andRow = shape.data + static_cast<size_t>(row) * shape.pitch;
+                const uint8_t* xorRow = andRow + static_cast<size_t>(height) * shape.pitch;
+                int bit = 0x80 >> (col & 7);
+                bool andBit = (andRow[col >> 3] & bit) != 0;
+                bool xorBit = (xorRow[col >> 3] & bit) != 0;
+                if (!andBit) {
+                    for (int c = 0; c < 3; c++) {
+                        n[c] = 0;
+                        p[c] = xorBit ? 255 * 255 : 0;
+                    }
+                } else if (xorBit) {
+                    xorColor = kInvert;
+                } else {
+                    continue;
+                }
+            } else {
+                const uint8_t* px = shape.data + static_cast<size_t>(row) * shape.pitch + col * 4;
+                if (shape.type == CursorShapeType::Color) {
+                    int a = px[3];
+                    if (a == 0) {
+                        continue;
+                    }
+                    for (int c = 0; c < 3; c++) {
+                        n[c] = static_cast<uint8_t>(255 - a);
+                        p[c] = static_cast<uint16_t>(px[c] * a);
+                    }
+                } else if (px[3] == 0) {
+                    for (int c = 0; c < 3; c++) {
+                        n[c] = 0;
+                        p[c] = static_cast<uint16_t>(px[c] * 255);
+                    }
+                } else if (px[0] | px[1] | px[2]) {
+                    xorColor = px;
+                } else {
+                    // 与0异或，屏幕不变
+                    continue;
+                }
+            }
+
+            if (xorColor) {
+                if (sprite.xorMask.empty()) {
+                    sprite.xorMask.assign(elements, 0);
+                }
+                uint8_t* x = sprite.xorMask.data() + (static_cast<size_t>(row) * width + col) * 4;
+                x[0] = xorColor[0];
+                x[1] = xorColor[1];
+                x[2] = xorColor[2];
+            }
+            first = std::min(first, col);
+            last = col;
+        }
+
+        if (last >= first) {
+            sprite.spanBegin[row] = first;
+            sprite.spanEnd[row] = last + 1;
+        }
+    }
+}
+
+bool CursorCompositor::SetShape(const CursorShape& shape)
+{
+    if (!Validate(shape)) {
+        std::cerr << "无效的指针形状: 类型 " << static_cast<int>(shape.type) << ", "
+                  << shape.width << "x" << shape.height << ", pitch " << shape.pitch
+                  << ", " << shape.size << " 字节" << std::endl;
+        return false;
+    }
+
+    uint64_t hash = HashShape(shape);
+    useClock_++;
+    for (size_t i = 0; i < cache_.size(); i++) {
+        if (Matches(cache_[i], shape, hash)) {
+            cache_[i].lastUse = useClock_;
+            current_ = static_cast<int>(i);
+            hits_++;
+            return true;
+        }
+    }
+
+    // 缓存未满时追加，满了替换最久没有使用的一项（槽位内的vector容量继续复用）
+    size_t slot = cache_.size();
+    if (static_cast<int>(slot) < cacheSize_) {
+        cache_.emplace_back();
+    } else {
+        slot = 0;
+        for (size_t i = 1; i < cache_.size(); i++) {
+            if (cache_[i].lastUse < cache_[slot].lastUse) {
+                slot = i;
+            }
+        }
+    }
+    Decode(shape, hash, cache_[slot]);
+    cache_[slot].lastUse = useClock_;
+    current_ = static_cast<int>(slot);
+    misses_++;
+    return true;
+}
+
+bool CursorCompositor::GetRect(int x, int y, FrameRect& rect) const
+{
+    if (current_ < 0) {
+        rect = FrameRect{ 0, 0, 0, 0 };
+        return false;
+    }
+    const Sprite& sprite = cache_[current_];
+    rect = FrameRect{ x - sprite.hotSpotX, y - sprite.hotSpotY, sprite.width, sprite.height };
+    return true;
+}
+
+void CursorCompositor::Composite(uint8_t* frame, int linesize, int width, int height, int x, int y) const
+{
+    if (current_ < 0) {
+        return;
+    }
+    const Sprite& sprite = cache_[current_];
+    int left = x - sprite.hotSpotX;
+    int top = y - sprite.hotSpotY;
+    int y0 = std::max(top, 0);
+    int y1 = std::min(top + sprite.height, height);
+
+    for (int fy = y0; fy < y1; fy++) {
+        int row = fy - top;
+        int begin = std::max(sprite.spanBegin[row], -left);
+        int end = std::min(sprite.spanEnd[row], width - left);
+        if (begin >= end) {
+            continue;
+        }
+
+        size_t offset = (static_cast<size_t>(row) * sprite.width + begin) * 4;
+        int count = (end - begin) * 4;
+        uint8_t* dst = frame + static_cast<size_t>(fy) * linesize + static_cast<size_t>(left + begin) * 4;
+        kernels_.premul(dst, sprite.pm.data() + offset, sprite.inv.data() + offset, count);
+        if (!sprite.xorMask.empty()) {
+            const uint8_t* xorMask = sprite.xorMask.data() + offset;
+            for (int i = 0; i < count; i++) {
+                dst[i] ^= xorMask[i];
+            }
+        }
+    }
+}
+
+CursorCacheStats CursorCompositor::GetStats() const
+{
+    CursorCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.cached = static_cast<int>(cache_.size());
+    return stats;
+}
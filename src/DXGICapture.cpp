@@ -7,7 +7,8 @@
 using namespace Microsoft::WRL;
 
 DXGICapture::DXGICapture() 
-    : m_width(0), m_height(0), m_initialized(false) {
+    : m_width(0), m_height(0), m_initialized(false)
+    , m_frameUpdated(false), m_cursorRect(), m_cursorVisible(false) {
     m_mouseHandler = std::make_unique<MouseHandler>();
 }
 
@@ -31,7 +32,7 @@ bool DXGICapture::Initialize() {
     }
 
     // 初始化鼠标处理器
-    if (!m_mouseHandler->Initialize(m_device.Get(), m_context.Get(), m_width, m_height)) {
+    if (!m_mouseHandler->Initialize(m_width, m_height)) {
         std::wcerr << L"Failed to initialize mouse handler" << std::endl;
         return false;
     }
@@ -120,6 +121,10 @@ bool DXGICapture::CaptureFrame() {
         return false;
     }
 
+    m_frameUpdated = false;
+    m_moveRects.clear();
+    m_dirtyRects.clear();
+
     HRESULT hr;
     ComPtr<IDXGIResource> resource;
     DXGI_OUTDUPL_FRAME_INFO frameInfo;
@@ -138,15 +143,60 @@ bool DXGICapture::CaptureFrame() {
         m_mouseHandler->UpdateMouse(frameInfo, m_duplication.Get());
     }
 
+    // 变化区域：必须在ReleaseFrame之前读取，先读移动区域再读脏区域
+    if (frameInfo.TotalMetadataBufferSize > 0) {
+        ReadFrameMetadata(frameInfo.TotalMetadataBufferSize);
+    }
+
     // 处理桌面图像
     bool result = ProcessFrame(resource.Get());
 
     // 释放帧
     m_duplication->ReleaseFrame();
 
+    if (result) {
+        m_frameUpdated = true;
+        // 鼠标在读回后画进画面，旧位置和新位置都需要重新读回和处理
+        RECT cursorRect;
+        bool cursorVisible = m_mouseHandler->GetCursorRect(cursorRect);
+        if (m_cursorVisible) {
+            m_dirtyRects.push_back(m_cursorRect);
+        }
+        if (cursorVisible) {
+            m_dirtyRects.push_back(cursorRect);
+        }
+        m_cursorRect = cursorRect;
+        m_cursorVisible = cursorVisible;
+    }
     return result;
 }
 
+void DXGICapture::ReadFrameMetadata(UINT bufferSize) {
+    if (m_metadataBuffer.size() < bufferSize) {
+        m_metadataBuffer.resize(bufferSize);
+    }
+
+    UINT moveBytes = 0;
+    HRESULT hr = m_duplication->GetFrameMoveRects(bufferSize,
+        reinterpret_cast<DXGI_OUTDUPL_MOVE_RECT*>(m_metadataBuffer.data()), &moveBytes);
+    if (FAILED(hr)) {
+        moveBytes = 0;
+    }
+    const DXGI_OUTDUPL_MOVE_RECT* moves = reinterpret_cast<const DXGI_OUTDUPL_MOVE_RECT*>(m_metadataBuffer.data());
+    m_moveRects.assign(moves, moves + moveBytes / sizeof(DXGI_OUTDUPL_MOVE_RECT));
+
+    UINT dirtyBytes = 0;
+    hr = m_duplication->GetFrameDirtyRects(bufferSize,
+        reinterpret_cast<RECT*>(m_metadataBuffer.data()), &dirtyBytes);
+    if (FAILED(hr)) {
+        // 取不到脏区域时按整个桌面处理
+        m_dirtyRects.push_back(RECT{ 0, 0, m_width, m_height });
+        return;
+    }
+    const RECT* dirty = reinterpret_cast<const RECT*>(m_metadataBuffer.data());
+    m_dirtyRects.insert(m_dirtyRects.end(), dirty, dirty + dirtyBytes / sizeof(RECT));
+}
+
 bool DXGICapture::ProcessFrame(IDXGIResource* resource) {
     HRESULT hr;
 
@@ -163,10 +213,10 @@ bool DXGICapture::ProcessFrame(IDXGIResource* resource) {
         D3D11_TEXTURE2D_DESC desc;
         desktopTexture->GetDesc(&desc);
         
-        // 修改为可以作为渲染目标的格式
+        // 只作为复制源，鼠标在读回后由CPU画上
         desc.Usage = D3D11_USAGE_DEFAULT;
         desc.CPUAccessFlags = 0;
-        desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 
         hr = m_device->CreateTexture2D(&desc, nullptr, &m_capturedTexture);
         if (FAILED(hr)) {
@@ -177,12 +227,13 @@ bool DXGICapture::ProcessFrame(IDXGIResource* resource) {
     // 复制桌面内容
     m_context->CopyResource(m_capturedTexture.Get(), desktopTexture.Get());
 
-    // 渲染鼠标到纹理上
-    m_mouseHandler->RenderMouse(m_capturedTexture.Get());
-
     return true;
 }
 
+void DXGICapture::DrawMouse(uint8_t* frame, int linesize) const {
+    m_mouseHandler->DrawMouse(frame, linesize);
+}
+
 void DXGICapture::SaveTextureToFile(ID3D11Texture2D* texture, const std::wstring& filename) {
     // 复制到暂存纹理
     m_context->CopyResource(m_stagingTexture.Get(), texture);
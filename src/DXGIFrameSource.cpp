@@ -0,0 +1,141 @@
+#include "DXGIFrameSource.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+DXGIFrameSource::DXGIFrameSource()
+    : hasFrame_(false)
+    , started_(false)
+{
+}
+
+bool DXGIFrameSource::Initialize()
+{
+    if (!capture_.Initialize()) {
+        return false;
+    }
+    frame_.resize(static_cast<size_t>(capture_.GetWidth()) * 4 * capture_.GetHeight());
+    hasFrame_ = false;
+    return true;
+}
+
+bool DXGIFrameSource::CaptureFrame(CapturedFrame& frame)
+{
+    if (!capture_.CaptureFrame()) {
+        return false;
+    }
+
+    ID3D11Texture2D* capturedTexture = capture_.GetCapturedTexture();
+    if (!capturedTexture) {
+        return false;
+    }
+
+    Microsoft::WRL::ComPtr<ID3D11Device> device;
+    capturedTexture->GetDevice(device.GetAddressOf());
+
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+    device->GetImmediateContext(context.GetAddressOf());
+
+    if (!stagingTexture_) {
+        D3D11_TEXTURE2D_DESC stagingDesc;
+        capturedTexture->GetDesc(&stagingDesc);
+        stagingDesc.Usage = D3D11_USAGE_STAGING;
+        stagingDesc.BindFlags = 0;
+        stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        stagingDesc.MiscFlags = 0;
+
+        HRESULT hr = device->CreateTexture2D(&stagingDesc, nullptr, stagingTexture_.GetAddressOf());
+        if (FAILED(hr)) {
+            std::cerr << "创建staging纹理失败" << std::endl;
+            return false;
+        }
+    }
+
+    // 变化区域：移动区域的目标和脏区域都要重新读回；第一帧读回整个桌面
+    int width = capture_.GetWidth();
+    int height = capture_.GetHeight();
+    bool fullFrame = !hasFrame_;
+    bool updated = capture_.IsFrameUpdated() || fullFrame;
+
+    dirtyRects_.clear();
+    moveRects_.clear();
+    if (fullFrame) {
+        dirtyRects_.push_back(FrameRect{ 0, 0, width, height });
+    } else if (updated) {
+        for (const DXGI_OUTDUPL_MOVE_RECT& move : capture_.GetMoveRects()) {
+            const RECT& d = move.DestinationRect;
+            moveRects_.push_back(FrameMove{ move.SourcePoint.x, move.SourcePoint.y,
+                                            FrameRect{ d.left, d.top, d.right - d.left, d.bottom - d.top } });
+        }
+        for (const RECT& d : capture_.GetDirtyRects()) {
+            dirtyRects_.push_back(FrameRect{ d.left, d.top, d.right - d.left, d.bottom - d.top });
+        }
+    }
+
+    if (updated) {
+        // 只把变化的区域从GPU复制到staging纹理并读回，读回量与变化面积成正比
+        readbackRects_.clear();
+        for (const FrameMove& move : moveRects_) {
+            readbackRects_.push_back(move.destination);
+        }
+        readbackRects_.insert(readbackRects_.end(), dirtyRects_.begin(), dirtyRects_.end());
+
+        if (fullFrame) {
+            context->CopyResource(stagingTexture_.Get(), capturedTexture);
+        }
+        for (FrameRect& rect : readbackRects_) {
+            // 鼠标矩形可能超出桌面，裁剪后再复制
+            int x0 = std::max(rect.x, 0);
+            int y0 = std::max(rect.y, 0);
+            int x1 = std::min(rect.x + rect.width, width);
+            int y1 = std::min(rect.y + rect.height, height);
+            rect = FrameRect{ x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0) };
+            if (!fullFrame && rect.width > 0 && rect.height > 0) {
+                D3D11_BOX box = { static_cast<UINT>(x0), static_cast<UINT>(y0), 0,
+                                  static_cast<UINT>(x1), static_cast<UINT>(y1), 1 };
+                context->CopySubresourceRegion(stagingTexture_.Get(), 0, x0, y0, 0, capturedTexture, 0, &box);
+            }
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        HRESULT hr = context->Map(stagingTexture_.Get(), 0, D3D11_MAP_READ, 0, &mapped);
+        if (FAILED(hr)) {
+            std::cerr << "映射纹理失败" << std::endl;
+            return false;
+        }
+
+        // RowPitch通常大于宽度*4，逐行复制
+        const uint8_t* src = static_cast<const uint8_t*>(mapped.pData);
+        for (const FrameRect& rect : readbackRects_) {
+            for (int y = rect.y; y < rect.y + rect.height; y++) {
+                std::memcpy(frame_.data() + static_cast<size_t>(y) * width * 4 + rect.x * 4,
+                            src + static_cast<size_t>(y) * mapped.RowPitch + rect.x * 4,
+                            static_cast<size_t>(rect.width) * 4);
+            }
+        }
+        context->Unmap(stagingTexture_.Get(), 0);
+
+        // 纹理里没有鼠标：鼠标的新旧矩形都在读回区域中，旧位置刚被桌面内容覆盖，在新位置画上鼠标
+        capture_.DrawMouse(frame_.data(), width * 4);
+        hasFrame_ = true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!started_) {
+        startTime_ = now;
+        started_ = true;
+    }
+
+    frame.data = frame_.data();
+    frame.linesize = width * 4;
+    frame.width = width;
+    frame.height = height;
+    frame.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(now - startTime_).count();
+    frame.updated = updated;
+    frame.hasDirtyRects = true;
+    frame.dirtyRects = dirtyRects_.data();
+    frame.dirtyRectCount = static_cast<int>(dirtyRects_.size());
+    frame.moveRects = moveRects_.data();
+    frame.moveRectCount = static_cast<int>(moveRects_.size());
+    return true;
+}
@@ -0,0 +1,98 @@
+#include "DirtyRegion.h"
+#include <algorithm>
+
+// 变化面积超过画面的这个比例（百分比）时按整帧处理
+static const int kFullFramePercent = 60;
+
+DirtyRegion::DirtyRegion()
+    : width_(0)
+    , height_(0)
+    , area_(0)
+    , full_(false)
+{
+}
+
+void DirtyRegion::Reset(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+    rects_.clear();
+    rects_.reserve(kMaxRects);
+    area_ = 0;
+    full_ = false;
+}
+
+void DirtyRegion::Clear()
+{
+    rects_.clear();
+    area_ = 0;
+    full_ = false;
+}
+
+void DirtyRegion::SetFull()
+{
+    rects_.clear();
+    rects_.push_back(FrameRect{ 0, 0, width_, height_ });
+    area_ = static_cast<int64_t>(width_) * height_;
+    full_ = true;
+}
+
+void DirtyRegion::Add(const FrameRect& rect)
+{
+    if (full_) {
+        return;
+    }
+
+    // 扩展到偶数边界：YUV420P的一个色度样本对应2x2像素，转换时按2x2块处理
+    int x0 = std::max(rect.x, 0) & ~1;
+    int y0 = std::max(rect.y, 0) & ~1;
+    int x1 = std::min((rect.x + rect.width + 1) & ~1, width_);
+    int y1 = std::min((rect.y + rect.height + 1) & ~1, height_);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    if (static_cast<int>(rects_.size()) == kMaxRects) {
+        // 矩形太多，合并成外接矩形
+        for (const FrameRect& r : rects_) {
+            x0 = std::min(x0, r.x);
+            y0 = std::min(y0, r.y);
+            x1 = std::max(x1, r.x + r.width);
+            y1 = std::max(y1, r.y + r.height);
+        }
+        rects_.clear();
+        area_ = 0;
+    }
+
+    rects_.push_back(FrameRect{ x0, y0, x1 - x0, y1 - y0 });
+    area_ += static_cast<int64_t>(x1 - x0) * (y1 - y0);
+
+    if (area_ * 100 >= static_cast<int64_t>(width_) * height_ * kFullFramePercent) {
+        SetFull();
+    }
+}
+
+void DirtyRegion::Add(const DirtyRegion& other)
+{
+    if (other.full_) {
+        SetFull();
+        return;
+    }
+    for (const FrameRect& rect : other.rects_) {
+        Add(rect);
+    }
+}
+
+void DirtyRegion::AddFrame(const CapturedFrame& frame)
+{
+    if (!frame.hasDirtyRects) {
+        SetFull();
+        return;
+    }
+    for (int i = 0; i < frame.moveRectCount; i++) {
+        Add(frame.moveRects[i].destination);
+    }
+    for (int i = 0; i < frame.dirtyRectCount; i++) {
+        Add(frame.dirtyRects[i]);
+    }
+}
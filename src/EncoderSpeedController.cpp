@@ -0,0 +1,191 @@
+#include "EncoderSpeedController.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+// 从慢到快的档位，分析选项取自同名预设中不进入参数集的部分（superfast/ultrafast关闭CABAC和8x8变换，
+// 这里不跟随）；最快的分析选项之后继续提高CRF，减少熵编码和残差的工作量
+static const char* const kFastestParams = "me=dia:subme=0:trellis=0:mixed-refs=0:partitions=none:mbtree=0:aq-mode=0";
+static const EncoderSpeedLevel kLevels[] = {
+    { "medium", "me=hex:subme=7:trellis=1:mixed-refs=1:partitions=p8x8,b8x8,i8x8,i4x4", 40, 0 },
+    { "fast", "me=hex:subme=6:trellis=1:mixed-refs=1:partitions=p8x8,b8x8,i8x8,i4x4", 30, 0 },
+    { "faster", "me=hex:subme=4:trellis=1:mixed-refs=0:partitions=p8x8,b8x8,i8x8,i4x4", 20, 0 },
+    { "veryfast", "me=dia:subme=2:trellis=0:mixed-refs=0:partitions=i8x8,i4x4", 10, 0 },
+    { "superfast", "me=dia:subme=1:trellis=0:mixed-refs=0:partitions=i8x8,i4x4:mbtree=0", 0, 0 },
+    { "ultrafast", kFastestParams, 0, 0 },
+    { "ultrafast", kFastestParams, 0, 3 },
+    { "ultrafast", kFastestParams, 0, 6 },
+};
+static const int kLevelCount = static_cast<int>(sizeof(kLevels) / sizeof(kLevels[0]));
+
+// 平均耗时超过预算的这个比例，或输入队列平均占用超过这个比例时换快一档
+static const double kBehindBudget = 0.95;
+static const double kBehindQueue = 0.75;
+// 平均耗时低于预算的这个比例且队列基本为空时，这个GOP算作有富余
+static const double kCalmBudget = 0.6;
+static const double kCalmQueue = 0.25;
+// 换回慢一档前需要连续有富余的GOP数（初始值和上限）
+static const int kInitialHoldGops = 4;
+static const int kMaxHoldGops = 64;
+
+EncoderSpeedController::EncoderSpeedController()
+    : baseLevel_(0)
+    , level_(0)
+    , budgetMs_(0.0)
+    , queueCapacity_(0)
+    , frames_(0)
+    , encodeMsSum_(0.0)
+    , queueSum_(0)
+    , gops_(0)
+    , calmGops_(0)
+    , holdGops_(kInitialHoldGops)
+    , lastSlowerGop_(-1)
+    , warnedAtFastest_(false)
+    , adjustments_(0)
+{
+}
+
+bool EncoderSpeedController::Initialize(const std::string& basePreset, double targetFps, int queueCapacity)
+{
+    if (targetFps <= 0.0) {
+        std::cerr << "编码速度控制: 目标帧率必须大于0" << std::endl;
+        return false;
+    }
+
+    baseLevel_ = -1;
+    for (int i = 0; i < kLevelCount; i++) {
+        if (basePreset == kLevels[i].name && kLevels[i].crfOffset == 0) {
+            baseLevel_ = i;
+            break;
+        }
+    }
+    if (baseLevel_ < 0) {
+        std::cerr << "编码速度控制: 不支持的预设 " << basePreset << std::endl;
+        return false;
+    }
+
+    level_ = baseLevel_;
+    budgetMs_ = 1000.0 / targetFps;
+    queueCapacity_ = std::max(queueCapacity, 0);
+    frames_ = 0;
+    encodeMsSum_ = 0.0;
+    queueSum_ = 0;
+    gops_ = 0;
+    calmGops_ = 0;
+    holdGops_ = kInitialHoldGops;
+    lastSlowerGop_ = -1;
+    warnedAtFastest_ = false;
+    adjustments_ = 0;
+    gopsAtLevel_.assign(kLevelCount, 0);
+    return true;
+}
+
+void EncoderSpeedController::OnFrameEncoded(double encodeMs, int queueDepth)
+{
+    frames_++;
+    encodeMsSum_ += encodeMs;
+    queueSum_ += queueDepth;
+}
+
+bool EncoderSpeedController::OnGopBoundary()
+{
+    if (frames_ == 0) {
+        return false;
+    }
+
+    double averageMs = encodeMsSum_ / frames_;
+    double averageQueue = static_cast<double>(queueSum_) / frames_;
+    double queueFill = queueCapacity_ > 0 ? averageQueue / queueCapacity_ : 0.0;
+    frames_ = 0;
+    encodeMsSum_ = 0.0;
+    queueSum_ = 0;
+    gopsAtLevel_[level_]++;
+    gops_++;
+
+    bool behind = averageMs > budgetMs_ * kBehindBudget || queueFill > kBehindQueue;
+    bool calm = averageMs < budgetMs_ * kCalmBudget && queueFill < kCalmQueue;
+
+    if (behind) {
+        calmGops_ = 0;
+        // 刚换慢就又跟不上，说明慢一档本来就不够，下次多等一段时间再尝试
+        if (lastSlowerGop_ >= 0 && gops_ - lastSlowerGop_ <= 2) {
+            holdGops_ = std::min(holdGops_ * 2, kMaxHoldGops);
+        }
+        if (level_ + 1 < kLevelCount) {
+            ChangeLevel(level_ + 1, averageMs, averageQueue);
+            return true;
+        }
+        // 分辨率在一个流中途不能改变（MP4等容器的轨道尺寸固定），只给出提示
+        if (!warnedAtFastest_) {
+            warnedAtFastest_ = true;
+            std::cout << std::fixed << std::setprecision(2)
+                      << "编码速度控制: 已是最快的设置, 平均每帧 " << averageMs << " ms / 预算 " << budgetMs_
+                      << " ms, 仍然跟不上, 建议降低输出分辨率或帧率" << std::defaultfloat << std::endl;
+        }
+        return false;
+    }
+
+    warnedAtFastest_ = false;
+    if (!calm || level_ == baseLevel_) {
+        calmGops_ = 0;
+        return false;
+    }
+    if (++calmGops_ < holdGops_) {
+        return false;
+    }
+    calmGops_ = 0;
+    lastSlowerGop_ = gops_;
+    ChangeLevel(level_ - 1, averageMs, averageQueue);
+    return true;
+}
+
+void EncoderSpeedController::ChangeLevel(int level, double averageMs, double averageQueue)
+{
+    const EncoderSpeedLevel& from = kLevels[level_];
+    const EncoderSpeedLevel& to = kLevels[level];
+    adjustments_++;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "编码速度调整 #" << adjustments_ << " (第 " << gops_ << " 个GOP, "
+              << (level > level_ ? "跟不上" : "有富余") << "): "
+              << from.name << " CRF+" << from.crfOffset << " -> " << to.name << " CRF+" << to.crfOffset
+              << ", 平均每帧 " << averageMs << " ms / 预算 " << budgetMs_ << " ms";
+    if (queueCapacity_ > 0) {
+        std::cout << ", 队列 " << averageQueue << "/" << queueCapacity_;
+    }
+    std::cout << std::defaultfloat << std::endl;
+
+    level_ = level;
+}
+
+const EncoderSpeedLevel& EncoderSpeedController::GetLevel() const
+{
+    return kLevels[level_];
+}
+
+std::string EncoderSpeedController::GetX264Params(bool lookahead) const
+{
+    // stitchable：参数集不按内容优化（CRF时PPS的初始QP固定为26），各档的CRF不同时参数集也相同
+    std::string params = std::string(kLevels[level_].params) + ":stitchable=1";
+    if (lookahead) {
+        params += ":rc-lookahead=" + std::to_string(kLevels[level_].lookahead);
+    }
+    return params;
+}
+
+void EncoderSpeedController::PrintSummary() const
+{
+    if (gops_ == 0) {
+        return;
+    }
+
+    const EncoderSpeedLevel& level = kLevels[level_];
+    std::cout << "编码速度控制: 调整 " << adjustments_ << " 次, 最终 " << level.name << " CRF+" << level.crfOffset
+              << ", 各档位的GOP数:";
+    for (int i = 0; i < kLevelCount; i++) {
+        if (gopsAtLevel_[i] > 0) {
+            std::cout << " " << kLevels[i].name << "/CRF+" << kLevels[i].crfOffset << " " << gopsAtLevel_[i];
+        }
+    }
+    std::cout << std::endl;
+}
@@ -1,6 +1,8 @@
 #include "FFmpegWatermarkProcessor.h"
+#include "FramePipeline.h"
 #include <iostream>
 #include <sstream>
+#include <atomic>
 
 FFmpegWatermarkProcessor::FFmpegWatermarkProcessor()
     : inputFormatCtx_(nullptr)
@@ -18,6 +20,8 @@ FFmpegWatermarkProcessor::FFmpegWatermarkProcessor()
     , width_(0)
     , height_(0)
     , pixelFormat_(AV_PIX_FMT_NONE)
+    , pipelineDepth_(0)
+    , segment_(WholeFileRange())
 {
 }
 
@@ -26,104 +30,13 @@ FFmpegWatermarkProcessor::~FFmpegWatermarkProcessor()
     Cleanup();
 }
 
-bool FFmpegWatermarkProcessor::GetVideoDimensions(const std::string& path, int& width, int& height)
-{
-    AVFormatContext* formatCtx = nullptr;
-    
-    // 打开输入文件
-    if (avformat_open_input(&formatCtx, path.c_str(), nullptr, nullptr) < 0) {
-        std::cerr << "无法打开输入文件: " << path << std::endl;
-        return false;
-    }
-
-    // 获取流信息
-    if (avformat_find_stream_info(formatCtx, nullptr) < 0) {
-        std::cerr << "无法获取流信息" << std::endl;
-        avformat_close_input(&formatCtx);
-        return false;
-    }
-
-    // 查找视频流
-    int videoStreamIndex = -1;
-    for (unsigned int i = 0; i < formatCtx->nb_streams; i++) {
-        if (formatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            videoStreamIndex = i;
-            break;
-        }
-    }
-
-    if (videoStreamIndex == -1) {
-        std::cerr << "未找到视频流" << std::endl;
-        avformat_close_input(&formatCtx);
-        return false;
-    }
-
-    // 获取视频尺寸
-    AVCodecParameters* codecpar = formatCtx->streams[videoStreamIndex]->codecpar;
-    width = codecpar->width;
-    height = codecpar->height;
-
-    // 清理
-    avformat_close_input(&formatCtx);
-    
-    return true;
-}
-
 bool FFmpegWatermarkProcessor::OpenInput(const std::string& path)
 {
-    // 打开输入文件
-    if (avformat_open_input(&inputFormatCtx_, path.c_str(), nullptr, nullptr) < 0) {
-        std::cerr << "无法打开输入文件: " << path << std::endl;
-        return false;
-    }
-
-    // 获取流信息
-    if (avformat_find_stream_info(inputFormatCtx_, nullptr) < 0) {
-        std::cerr << "无法获取流信息" << std::endl;
+    if (!OpenVideoDecoder(path, &inputFormatCtx_, videoStreamIndex_, &decoderCtx_)) {
         return false;
     }
-
-    // 查找视频流
-    videoStreamIndex_ = -1;
-    for (unsigned int i = 0; i < inputFormatCtx_->nb_streams; i++) {
-        if (inputFormatCtx_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            videoStreamIndex_ = i;
-            break;
-        }
-    }
-
-    if (videoStreamIndex_ == -1) {
-        std::cerr << "未找到视频流" << std::endl;
-        return false;
-    }
-
     videoStream_ = inputFormatCtx_->streams[videoStreamIndex_];
-    AVCodecParameters* codecpar = videoStream_->codecpar;
-
-    // 查找解码器
-    decoder_ = avcodec_find_decoder(codecpar->codec_id);
-    if (!decoder_) {
-        std::cerr << "未找到解码器" << std::endl;
-        return false;
-    }
-
-    // 创建解码器上下文
-    decoderCtx_ = avcodec_alloc_context3(decoder_);
-    if (!decoderCtx_) {
-        std::cerr << "无法分配解码器上下文" << std::endl;
-        return false;
-    }
-
-    if (avcodec_parameters_to_context(decoderCtx_, codecpar) < 0) {
-        std::cerr << "无法复制解码器参数" << std::endl;
-        return false;
-    }
-
-    // 打开解码器
-    if (avcodec_open2(decoderCtx_, decoder_, nullptr) < 0) {
-        std::cerr << "无法打开解码器" << std::endl;
-        return false;
-    }
+    decoder_ = decoderCtx_->codec;
 
     width_ = decoderCtx_->width;
     height_ = decoderCtx_->height;
@@ -174,6 +87,12 @@ bool FFmpegWatermarkProcessor::OpenOutput(const std::string& path)
     encoderCtx_->bit_rate = 4000000; // 4 Mbps
     encoderCtx_->gop_size = 12;
     encoderCtx_->max_b_frames = 2;
+    // 分段输出要首尾相接地拼接，不使用B帧，保证各段的dts与pts一致且连续；
+    // 并行度来自分段之间，每个编码器只用一个线程，避免线程数远超核心数
+    if (!IsWholeFile(segment_)) {
+        encoderCtx_->max_b_frames = 0;
+        encoderCtx_->thread_count = 1;
+    }
 
     if (outputFormatCtx_->oformat->flags & AVFMT_GLOBALHEADER) {
         encoderCtx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
@@ -200,6 +119,11 @@ bool FFmpegWatermarkProcessor::OpenOutput(const std::string& path)
 
     outVideoStream_->time_base = encoderCtx_->time_base;
 
+    // 音频、字幕等其他流以流复制方式直通；分段模式下由拼接阶段从原始输入直通
+    if (!passthrough_.Setup(inputFormatCtx_, outputFormatCtx_, videoStreamIndex_, IsWholeFile(segment_))) {
+        return false;
+    }
+
     // 打开输出文件
     if (!(outputFormatCtx_->oformat->flags & AVFMT_NOFILE)) {
         if (avio_open(&outputFormatCtx_->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
@@ -339,6 +263,9 @@ bool FFmpegWatermarkProcessor::ProcessVideo(const std::string& inputPath,
     if (!OpenInput(inputPath)) {
         return false;
     }
+    if (!SeekToSegment(inputFormatCtx_, videoStreamIndex_, segment_)) {
+        return false;
+    }
 
     // 打开输出
     if (!OpenOutput(outputPath)) {
@@ -352,154 +279,109 @@ bool FFmpegWatermarkProcessor::ProcessVideo(const std::string& inputPath,
 
     // 处理视频帧
     AVPacket* packet = av_packet_alloc();
-    AVFrame* frame = av_frame_alloc();
-    AVFrame* filtFrame = av_frame_alloc();
+    AVPacket* outPacket = av_packet_alloc();
 
-    if (!packet || !frame || !filtFrame) {
-        std::cerr << "无法分配帧/数据包内存" << std::endl;
+    if (!packet || !outPacket) {
+        std::cerr << "无法分配数据包内存" << std::endl;
+        av_packet_free(&outPacket);
+        av_packet_free(&packet);
         return false;
     }
 
-    int64_t frameCount = 0;
+    // frameCount由解码阶段更新、编码阶段读取，流水线模式下在不同线程
+    std::atomic<int64_t> frameCount(0);
     int64_t encodedFrames = 0;
 
     std::cout << "开始处理视频帧..." << std::endl;
 
-    while (av_read_frame(inputFormatCtx_, packet) >= 0) {
-        if (packet->stream_index == videoStreamIndex_) {
-            // 发送数据包到解码器
-            ret = avcodec_send_packet(decoderCtx_, packet);
-            if (ret < 0) {
-                av_strerror(ret, errbuf, sizeof(errbuf));
-                std::cerr << "发送数据包到解码器失败: " << errbuf << std::endl;
-                av_packet_unref(packet);
-                continue;
-            }
-            
-            // 接收解码后的帧
-            while ((ret = avcodec_receive_frame(decoderCtx_, frame)) >= 0) {
-                frameCount++;
-                
-                // 将帧推送到filter
-                ret = av_buffersrc_add_frame_flags(bufferSrcCtx_, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
-                if (ret < 0) {
-                    av_strerror(ret, errbuf, sizeof(errbuf));
-                    std::cerr << "推送帧到filter失败: " << errbuf << std::endl;
-                    break;
-                }
+    auto decodeStage = [&](AVFrame** frame) {
+        bool decoded = DecodeNextFrame(inputFormatCtx_, decoderCtx_, videoStreamIndex_, packet, frame, &segment_,
+                                       &passthrough_);
+        if (decoded && *frame) {
+            frameCount++;
+        }
+        return decoded;
+    };
+
+    // filter graph只在这个阶段中使用；frame为nullptr时刷新filter
+    auto filterStage = [&](AVFrame* frame, const PipelineEmitFn& emit) {
+        // 每个阶段用自己的错误缓冲区，流水线模式下阶段在不同线程运行
+        char errbuf[AV_ERROR_MAX_STRING_SIZE];
+        // 不带KEEP_REF时filter直接接管帧的数据引用
+        int ret = av_buffersrc_add_frame_flags(bufferSrcCtx_, frame, 0);
+        av_frame_free(&frame);
+        if (ret < 0) {
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            std::cerr << "推送帧到filter失败: " << errbuf << std::endl;
+            return true;
+        }
 
-                // 从filter获取处理后的帧
-                while ((ret = av_buffersink_get_frame(bufferSinkCtx_, filtFrame)) >= 0) {
-                    // 编码处理后的帧
-                    filtFrame->pict_type = AV_PICTURE_TYPE_NONE;
-                    
-                    ret = avcodec_send_frame(encoderCtx_, filtFrame);
-                    if (ret < 0) {
-                        av_strerror(ret, errbuf, sizeof(errbuf));
-                        std::cerr << "发送帧到编码器失败: " << errbuf << std::endl;
-                        av_frame_unref(filtFrame);
-                        continue;
-                    }
-                    
-                    AVPacket* outPacket = av_packet_alloc();
-                    while (avcodec_receive_packet(encoderCtx_, outPacket) >= 0) {
-                        av_packet_rescale_ts(outPacket, encoderCtx_->time_base, 
-                                            outVideoStream_->time_base);
-                        outPacket->stream_index = outVideoStream_->index;
-                        
-                        ret = av_interleaved_write_frame(outputFormatCtx_, outPacket);
-                        if (ret < 0) {
-                            av_strerror(ret, errbuf, sizeof(errbuf));
-                            std::cerr << "写入数据包失败: " << errbuf << std::endl;
-                        } else {
-                            encodedFrames++;
-                        }
-                        av_packet_unref(outPacket);
-                    }
-                    av_packet_free(&outPacket);
-
-                    av_frame_unref(filtFrame);
-                    
-                    if (encodedFrames % 30 == 0 && encodedFrames > 0) {
-                        std::cout << "已解码 " << frameCount << " 帧, 已编码 " << encodedFrames << " 帧" << std::endl;
-                    }
-                }
-                
-                if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF && ret < 0) {
-                    av_strerror(ret, errbuf, sizeof(errbuf));
-                    std::cerr << "从filter获取帧失败: " << errbuf << std::endl;
-                }
+        // 从filter获取处理后的帧
+        while (true) {
+            AVFrame* filtFrame = av_frame_alloc();
+            if (!filtFrame) {
+                std::cerr << "无法分配帧内存" << std::endl;
+                return false;
             }
-            
-            if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF && ret < 0) {
-                av_strerror(ret, errbuf, sizeof(errbuf));
-                std::cerr << "接收解码帧失败: " << errbuf << std::endl;
+            ret = av_buffersink_get_frame(bufferSinkCtx_, filtFrame);
+            if (ret < 0) {
+                av_frame_free(&filtFrame);
+                break;
             }
-        }
-        av_packet_unref(packet);
-    }
-    
-    std::cout << "读取完成，开始刷新解码器..." << std::endl;
-
-    // 刷新解码器
-    std::cout << "刷新解码器..." << std::endl;
-    avcodec_send_packet(decoderCtx_, nullptr);
-    while ((ret = avcodec_receive_frame(decoderCtx_, frame)) >= 0) {
-        frameCount++;
-        av_buffersrc_add_frame_flags(bufferSrcCtx_, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
-        
-        while ((ret = av_buffersink_get_frame(bufferSinkCtx_, filtFrame)) >= 0) {
             filtFrame->pict_type = AV_PICTURE_TYPE_NONE;
-            avcodec_send_frame(encoderCtx_, filtFrame);
-            
-            AVPacket* outPacket = av_packet_alloc();
-            while (avcodec_receive_packet(encoderCtx_, outPacket) >= 0) {
-                av_packet_rescale_ts(outPacket, encoderCtx_->time_base, outVideoStream_->time_base);
-                outPacket->stream_index = outVideoStream_->index;
-                av_interleaved_write_frame(outputFormatCtx_, outPacket);
-                encodedFrames++;
-                av_packet_unref(outPacket);
+            if (!emit(filtFrame)) {
+                return false;
             }
-            av_packet_free(&outPacket);
-            
-            av_frame_unref(filtFrame);
         }
-    }
 
-    // 刷新filter
-    std::cout << "刷新filter..." << std::endl;
-    av_buffersrc_add_frame_flags(bufferSrcCtx_, nullptr, 0);
-    while ((ret = av_buffersink_get_frame(bufferSinkCtx_, filtFrame)) >= 0) {
-        filtFrame->pict_type = AV_PICTURE_TYPE_NONE;
-        avcodec_send_frame(encoderCtx_, filtFrame);
-        
-        AVPacket* outPacket = av_packet_alloc();
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            std::cerr << "从filter获取帧失败: " << errbuf << std::endl;
+        }
+        return true;
+    };
+
+    // frame为nullptr时刷新编码器
+    auto encodeStage = [&](AVFrame* frame) {
+        char errbuf[AV_ERROR_MAX_STRING_SIZE];
+        int sendRet = avcodec_send_frame(encoderCtx_, frame);
+        av_frame_free(&frame);
+        if (sendRet < 0 && sendRet != AVERROR_EOF) {
+            av_strerror(sendRet, errbuf, sizeof(errbuf));
+            std::cerr << "发送帧到编码器失败: " << errbuf << std::endl;
+            return true;
+        }
+
         while (avcodec_receive_packet(encoderCtx_, outPacket) >= 0) {
-            av_packet_rescale_ts(outPacket, encoderCtx_->time_base, outVideoStream_->time_base);
+            av_packet_rescale_ts(outPacket, encoderCtx_->time_base,
+                                outVideoStream_->time_base);
             outPacket->stream_index = outVideoStream_->index;
-            av_interleaved_write_frame(outputFormatCtx_, outPacket);
-            encodedFrames++;
+
+            int writeRet = passthrough_.WriteVideoPacket(outPacket);
+            if (writeRet < 0) {
+                av_strerror(writeRet, errbuf, sizeof(errbuf));
+                std::cerr << "写入数据包失败: " << errbuf << std::endl;
+            } else {
+                encodedFrames++;
+                if (encodedFrames % 30 == 0) {
+                    std::cout << "已解码 " << frameCount.load() << " 帧, 已编码 " << encodedFrames << " 帧" << std::endl;
+                }
+            }
             av_packet_unref(outPacket);
         }
-        av_packet_free(&outPacket);
-        
-        av_frame_unref(filtFrame);
-    }
+        return true;
+    };
 
-    // 刷新编码器
-    std::cout << "刷新编码器..." << std::endl;
-    avcodec_send_frame(encoderCtx_, nullptr);
-    AVPacket* outPacket = av_packet_alloc();
-    while (avcodec_receive_packet(encoderCtx_, outPacket) >= 0) {
-        av_packet_rescale_ts(outPacket, encoderCtx_->time_base, outVideoStream_->time_base);
-        outPacket->stream_index = outVideoStream_->index;
-        ret = av_interleaved_write_frame(outputFormatCtx_, outPacket);
-        if (ret >= 0) {
-            encodedFrames++;
-        }
-        av_packet_unref(outPacket);
-    }
+    FramePipeline pipeline(pipelineDepth_);
+    bool ok = pipeline.Run(decodeStage, filterStage, encodeStage);
     av_packet_free(&outPacket);
+    av_packet_free(&packet);
+    pipeline.PrintStats();
+    passthrough_.PrintSummary();
+    if (!ok) {
+        std::cerr << "处理视频帧失败" << std::endl;
+        return false;
+    }
 
     // 写入文件尾
     std::cout << "写入文件尾..." << std::endl;
@@ -507,17 +389,10 @@ bool FFmpegWatermarkProcessor::ProcessVideo(const std::string& inputPath,
     if (ret < 0) {
         av_strerror(ret, errbuf, sizeof(errbuf));
         std::cerr << "写入文件尾失败: " << errbuf << std::endl;
-        av_frame_free(&filtFrame);
-        av_frame_free(&frame);
-        av_packet_free(&packet);
         return false;
     }
 
-    std::cout << "处理完成！解码 " << frameCount << " 帧, 编码 " << encodedFrames << " 帧" << std::endl;
-
-    av_frame_free(&filtFrame);
-    av_frame_free(&frame);
-    av_packet_free(&packet);
+    std::cout << "处理完成！解码 " << frameCount.load() << " 帧, 编码 " << encodedFrames << " 帧" << std::endl;
 
     return true;
 }
@@ -0,0 +1,164 @@
+#include "FileFrameSource.h"
+#include "MediaDecode.h"
+#include <iostream>
+
+static const AVRational kMicroseconds = { 1, 1000000 };
+
+FileFrameSource::FileFrameSource(const std::string& path)
+    : path_(path)
+    , formatCtx_(nullptr)
+    , decoderCtx_(nullptr)
+    , swsCtx_(nullptr)
+    , packet_(nullptr)
+    , bgraFrame_(nullptr)
+    , videoStreamIndex_(-1)
+    , width_(0)
+    , height_(0)
+    , firstPtsUs_(AV_NOPTS_VALUE)
+    , lastPtsUs_(0)
+    , frameDurationUs_(0)
+    , loopOffsetUs_(0)
+    , frameCount_(0)
+{
+}
+
+FileFrameSource::~FileFrameSource()
+{
+    Cleanup();
+}
+
+bool FileFrameSource::Initialize()
+{
+    if (!OpenVideoDecoder(path_, &formatCtx_, videoStreamIndex_, &decoderCtx_)) {
+        std::cerr << "无法打开回放视频: " << path_ << std::endl;
+        return false;
+    }
+    // 只需要视频，其他流在解复用时直接丢弃
+    for (unsigned int i = 0; i < formatCtx_->nb_streams; i++) {
+        if (static_cast<int>(i) != videoStreamIndex_) {
+            formatCtx_->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    AVStream* stream = formatCtx_->streams[videoStreamIndex_];
+
+    width_ = decoderCtx_->width;
+    height_ = decoderCtx_->height;
+
+    // 没有pts时按平均帧率推算
+    AVRational rate = stream->avg_frame_rate;
+    if (rate.num <= 0 || rate.den <= 0) {
+        rate = AVRational{ 30, 1 };
+    }
+    frameDurationUs_ = av_rescale_q(1, av_inv_q(rate), kMicroseconds);
+
+    packet_ = av_packet_alloc();
+    bgraFrame_ = av_frame_alloc();
+    if (!packet_ || !bgraFrame_) {
+        std::cerr << "无法分配帧内存" << std::endl;
+        return false;
+    }
+    bgraFrame_->format = AV_PIX_FMT_BGRA;
+    bgraFrame_->width = width_;
+    bgraFrame_->height = height_;
+    if (av_frame_get_buffer(bgraFrame_, 0) < 0) {
+        std::cerr << "无法分配BGRA帧缓冲区" << std::endl;
+        return false;
+    }
+
+    std::cout << "回放视频: " << path_ << " (" << width_ << "x" << height_ << ", "
+              << av_q2d(rate) << " fps)" << std::endl;
+    return true;
+}
+
+bool FileFrameSource::CaptureFrame(CapturedFrame& frame)
+{
+    AVFrame* decoded = nullptr;
+    if (!DecodeNextFrame(formatCtx_, decoderCtx_, videoStreamIndex_, packet_, &decoded)) {
+        return false;
+    }
+    if (!decoded) {
+        // 读完一遍，从头循环
+        if (frameCount_ == 0 || !Rewind()) {
+            std::cerr << "回放视频没有可解码的帧" << std::endl;
+            return false;
+        }
+        if (!DecodeNextFrame(formatCtx_, decoderCtx_, videoStreamIndex_, packet_, &decoded) || !decoded) {
+            return false;
+        }
+    }
+
+    // 视频中途改变尺寸或格式时，getCachedContext会重建转换器，输出始终是初始尺寸
+    swsCtx_ = sws_getCachedContext(swsCtx_,
+                                   decoded->width, decoded->height, static_cast<AVPixelFormat>(decoded->format),
+                                   width_, height_, AV_PIX_FMT_BGRA,
+                                   SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!swsCtx_) {
+        std::cerr << "无法创建颜色空间转换器" << std::endl;
+        av_frame_free(&decoded);
+        return false;
+    }
+    sws_scale(swsCtx_, decoded->data, decoded->linesize, 0, decoded->height,
+              bgraFrame_->data, bgraFrame_->linesize);
+
+    int64_t pts = decoded->best_effort_timestamp;
+    int64_t ptsUs = lastPtsUs_ + frameDurationUs_;
+    if (pts != AV_NOPTS_VALUE) {
+        ptsUs = av_rescale_q(pts, formatCtx_->streams[videoStreamIndex_]->time_base, kMicroseconds);
+    }
+    av_frame_free(&decoded);
+
+    if (firstPtsUs_ == AV_NOPTS_VALUE) {
+        firstPtsUs_ = ptsUs;
+    }
+    lastPtsUs_ = ptsUs;
+    frameCount_++;
+
+    frame.data = bgraFrame_->data[0];
+    frame.linesize = bgraFrame_->linesize[0];
+    frame.width = width_;
+    frame.height = height_;
+    frame.timestampUs = loopOffsetUs_ + ptsUs - firstPtsUs_;
+    frame.updated = true;
+    // 解码出的每一帧都当作整帧变化
+    frame.hasDirtyRects = false;
+    frame.dirtyRects = nullptr;
+    frame.dirtyRectCount = 0;
+    frame.moveRects = nullptr;
+    frame.moveRectCount = 0;
+    return true;
+}
+
+bool FileFrameSource::Rewind()
+{
+    // 下一轮的时间戳接在这一轮最后一帧之后
+    loopOffsetUs_ += lastPtsUs_ - firstPtsUs_ + frameDurationUs_;
+    firstPtsUs_ = AV_NOPTS_VALUE;
+
+    if (av_seek_frame(formatCtx_, videoStreamIndex_, 0, AVSEEK_FLAG_BACKWARD) < 0) {
+        std::cerr << "回放视频定位到开头失败" << std::endl;
+        return false;
+    }
+    avcodec_flush_buffers(decoderCtx_);
+    return true;
+}
+
+void FileFrameSource::Cleanup()
+{
+    if (swsCtx_) {
+        sws_freeContext(swsCtx_);
+        swsCtx_ = nullptr;
+    }
+    if (bgraFrame_) {
+        av_frame_free(&bgraFrame_);
+    }
+    if (packet_) {
+        av_packet_free(&packet_);
+    }
+    if (decoderCtx_) {
+        avcodec_free_context(&decoderCtx_);
+    }
+    if (formatCtx_) {
+        avformat_close_input(&formatCtx_);
+    }
+}
@@ -0,0 +1,135 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+
+// 先睡到截止时间前这么久，剩下的时间让出CPU等待，避免睡眠粒度带来的抖动
+static const std::chrono::microseconds kSpinMargin(1000);
+
+FramePacer::FramePacer()
+    : fps_(30)
+    , frameNs_(1000000000LL / 30)
+    , timerRaised_(false)
+    , lateness_({ 0.1, 0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 33.3 })
+    , lateTicks_(0)
+    , missedTicks_(0)
+    , hasFirstFrame_(false)
+    , firstTick_(0)
+    , firstTimestampUs_(0)
+    , lastDriftMs_(0.0)
+    , maxDriftMs_(0.0)
+    , drift_({ 0.1, 0.5, 1.0, 2.0, 5.0, 10.0, 20.0, 50.0 })
+{
+}
+
+FramePacer::~FramePacer()
+{
+    Stop();
+}
+
+void FramePacer::Start(std::chrono::steady_clock::time_point start, int fps)
+{
+    start_ = start;
+    fps_ = fps;
+    frameNs_ = 1000000000LL / fps;
+    lateness_.Clear();
+    drift_.Clear();
+    lateTicks_ = 0;
+    missedTicks_ = 0;
+    hasFirstFrame_ = false;
+    lastDriftMs_ = 0.0;
+    maxDriftMs_ = 0.0;
+
+#ifdef _WIN32
+    // Windows默认的定时器精度约15.6ms，比60fps的帧间隔还长；录制期间提高到1ms
+    if (!timerRaised_) {
+        timerRaised_ = timeBeginPeriod(1) == TIMERR_NOERROR;
+    }
+#endif
+}
+
+void FramePacer::Stop()
+{
+#ifdef _WIN32
+    if (timerRaised_) {
+        timeEndPeriod(1);
+    }
+#endif
+    timerRaised_ = false;
+}
+
+std::chrono::steady_clock::time_point FramePacer::Deadline(int64_t tick) const
+{
+    // 每个时刻都从开始时间直接算出，1s / fps 不能整除时也不会累积误差
+    return start_ + std::chrono::nanoseconds(tick * 1000000000LL / fps_);
+}
+
+int64_t FramePacer::WaitForTick(int64_t tick)
+{
+    auto deadline = Deadline(tick);
+    auto now = std::chrono::steady_clock::now();
+
+    if (now < deadline) {
+        if (deadline - now > kSpinMargin) {
+            std::this_thread::sleep_until(deadline - kSpinMargin);
+        }
+        while ((now = std::chrono::steady_clock::now()) < deadline) {
+            std::this_thread::yield();
+        }
+    } else {
+        // 落后超过一帧：跳到已经开始的最后一个时刻
+        int64_t behindNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count();
+        int64_t current = behindNs * fps_ / 1000000000LL;
+        if (current > tick) {
+            missedTicks_ += current - tick;
+            tick = current;
+            deadline = Deadline(tick);
+        }
+    }
+
+    double lateMs = std::chrono::duration<double, std::milli>(now - deadline).count();
+    lateness_.Add(lateMs);
+    if (lateMs * 1000000.0 > frameNs_ * 0.1) {
+        lateTicks_++;
+    }
+    return tick;
+}
+
+void FramePacer::OnFrameCaptured(int64_t tick, int64_t timestampUs)
+{
+    if (!hasFirstFrame_) {
+        hasFirstFrame_ = true;
+        firstTick_ = tick;
+        firstTimestampUs_ = timestampUs;
+    }
+    double expectedUs = static_cast<double>(tick - firstTick_) * 1000000.0 / fps_;
+    lastDriftMs_ = (timestampUs - firstTimestampUs_ - expectedUs) / 1000.0;
+    maxDriftMs_ = std::max(maxDriftMs_, std::fabs(lastDriftMs_));
+    drift_.Add(std::fabs(lastDriftMs_));
+}
+
+void FramePacer::PrintReport() const
+{
+    if (lateness_.GetCount() == 0) {
+        return;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "=== 采集节拍 (" << fps_ << " fps, 间隔 " << frameNs_ / 1000000.0 << " ms) ===" << std::endl;
+    std::cout << std::defaultfloat;
+    lateness_.Print("唤醒延迟", "ms");
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "迟到(超过帧间隔10%) " << lateTicks_ << " 次, 跳过错过的时刻 " << missedTicks_ << " 个" << std::endl;
+    std::cout << std::defaultfloat;
+    drift_.Print("来源时间戳相对节拍的漂移(绝对值)", "ms");
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "结束时漂移 " << lastDriftMs_ << " ms, 最大 " << maxDriftMs_ << " ms" << std::endl;
+    std::cout << std::defaultfloat;
+}
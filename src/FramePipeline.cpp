@@ -0,0 +1,355 @@
+#include "FramePipeline.h"
+#include "ScratchArena.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// 先让出时间片，等待时间较长时改为短暂休眠，避免空转占满一个核心
+static void Backoff(int& spins)
+{
+    if (++spins < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+FrameQueue::FrameQueue(int capacity)
+    : slots_(capacity > 0 ? capacity : 1, nullptr)
+    , capacity_(capacity > 0 ? capacity : 1)
+    , head_(0)
+    , tail_(0)
+    , closed_(false)
+{
+}
+
+bool FrameQueue::TryPush(AVFrame* frame)
+{
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+        return false;
+    }
+    slots_[tail % capacity_] = frame;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+void FrameQueue::Close()
+{
+    closed_.store(true, std::memory_order_release);
+}
+
+AVFrame* FrameQueue::TryPop()
+{
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    AVFrame* frame = slots_[head % capacity_];
+    head_.store(head + 1, std::memory_order_release);
+    return frame;
+}
+
+int FrameQueue::Size() const
+{
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t head = head_.load(std::memory_order_acquire);
+    return static_cast<int>(tail - head);
+}
+
+FramePipeline::FramePipeline(int queueDepth)
+    : queueDepth_(queueDepth > 0 ? queueDepth : 0)
+    , aborted_(false)
+    , stages_{ { "解码", 0, 0.0, 0.0, 0.0 },
+               { "混合", 0, 0.0, 0.0, 0.0 },
+               { "编码", 0, 0.0, 0.0, 0.0 } }
+    , queues_{ { 0, 0, 0 }, { 0, 0, 0 } }
+    , wallSeconds_(0.0)
+{
+}
+
+bool FramePipeline::Run(const PipelineSourceFn& decode,
+                        const PipelineTransformFn& blend,
+                        const PipelineSinkFn& encode)
+{
+    auto start = std::chrono::steady_clock::now();
+    bool ok = queueDepth_ > 0 ? RunThreaded(decode, blend, encode)
+                              : RunSequential(decode, blend, encode);
+    wallSeconds_ = SecondsSince(start);
+    return ok;
+}
+
+bool FramePipeline::RunSequential(const PipelineSourceFn& decode,
+                                  const PipelineTransformFn& blend,
+                                  const PipelineSinkFn& encode)
+{
+    PipelineStageStats& decodeStats = stages_[0];
+    PipelineStageStats& blendStats = stages_[1];
+    PipelineStageStats& encodeStats = stages_[2];
+
+    // 编码在emit内部同步执行，统计时从混合阶段的耗时中扣除
+    double sinkSeconds = 0.0;
+    PipelineEmitFn emit = [&](AVFrame* frame) {
+        auto t = std::chrono::steady_clock::now();
+        bool ok = encode(frame);
+        double elapsed = SecondsSince(t);
+        sinkSeconds += elapsed;
+        encodeStats.busySeconds += elapsed;
+        encodeStats.frames++;
+        return ok;
+    };
+
+    auto runBlend = [&](AVFrame* frame) {
+        sinkSeconds = 0.0;
+        auto t = std::chrono::steady_clock::now();
+        bool ok = blend(frame, emit);
+        blendStats.busySeconds += SecondsSince(t) - sinkSeconds;
+        return ok;
+    };
+
+    while (true) {
+        AVFrame* frame = nullptr;
+        auto t = std::chrono::steady_clock::now();
+        bool ok = decode(&frame);
+        decodeStats.busySeconds += SecondsSince(t);
+        if (!ok) {
+            return false;
+        }
+        if (!frame) {
+            break;
+        }
+        decodeStats.frames++;
+        blendStats.frames++;
+        if (!runBlend(frame)) {
+            return false;
+        }
+    }
+
+    if (!runBlend(nullptr)) {
+        return false;
+    }
+
+    auto t = std::chrono::steady_clock::now();
+    bool ok = encode(nullptr);
+    encodeStats.busySeconds += SecondsSince(t);
+    return ok;
+}
+
+void FramePipeline::Abort()
+{
+    aborted_.store(true, std::memory_order_release);
+}
+
+bool FramePipeline::Push(FrameQueue& queue, PipelineQueueStats& queueStats, AVFrame* frame, double& waitSeconds)
+{
+    if (queue.TryPush(frame)) {
+        return true;
+    }
+
+    queueStats.fullCount++;
+    auto t = std::chrono::steady_clock::now();
+    int spins = 0;
+    while (!queue.TryPush(frame)) {
+        if (aborted_.load(std::memory_order_acquire)) {
+            waitSeconds += SecondsSince(t);
+            return false;
+        }
+        Backoff(spins);
+    }
+    waitSeconds += SecondsSince(t);
+    return true;
+}
+
+AVFrame* FramePipeline::Pop(FrameQueue& queue, PipelineQueueStats& queueStats, double& waitSeconds)
+{
+    queueStats.samples++;
+    queueStats.occupancySum += queue.Size();
+
+    AVFrame* frame = queue.TryPop();
+    if (frame) {
+        return frame;
+    }
+
+    auto t = std::chrono::steady_clock::now();
+    int spins = 0;
+    while (!(frame = queue.TryPop())) {
+        // Close()在最后一次入队之后，看到关闭标记后还要再取一次
+        if (queue.IsClosed()) {
+            frame = queue.TryPop();
+            break;
+        }
+        if (aborted_.load(std::memory_order_acquire)) {
+            break;
+        }
+        Backoff(spins);
+    }
+    waitSeconds += SecondsSince(t);
+    return frame;
+}
+
+bool FramePipeline::RunThreaded(const PipelineSourceFn& decode,
+                                const PipelineTransformFn& blend,
+                                const PipelineSinkFn& encode)
+{
+    FrameQueue decoded(queueDepth_);
+    FrameQueue blended(queueDepth_);
+
+    std::cout << "流水线模式: 解码/混合/编码各一个线程，队列深度 " << queueDepth_ << std::endl;
+
+    // 解码和混合线程的分配计入调用线程所属的任务
+    AllocationCounter* allocCounter = GetAllocationCounter();
+
+    std::thread decodeThread([&]() {
+        AllocationScope allocScope(allocCounter);
+        PipelineStageStats& stats = stages_[0];
+        while (!aborted_.load(std::memory_order_acquire)) {
+            AVFrame* frame = nullptr;
+            auto t = std::chrono::steady_clock::now();
+            bool ok = decode(&frame);
+            stats.busySeconds += SecondsSince(t);
+            if (!ok) {
+                Abort();
+                break;
+            }
+            if (!frame) {
+                break;
+            }
+            stats.frames++;
+            if (!Push(decoded, queues_[0], frame, stats.waitOutputSeconds)) {
+                av_frame_free(&frame);
+                break;
+            }
+        }
+        decoded.Close();
+    });
+
+    std::thread blendThread([&]() {
+        AllocationScope allocScope(allocCounter);
+        PipelineStageStats& stats = stages_[1];
+        double emitSeconds = 0.0;
+        PipelineEmitFn emit = [&](AVFrame* frame) {
+            auto t = std::chrono::steady_clock::now();
+            bool ok = Push(blended, queues_[1], frame, stats.waitOutputSeconds);
+            emitSeconds += SecondsSince(t);
+            if (!ok) {
+                av_frame_free(&frame);
+            }
+            return ok;
+        };
+
+        while (true) {
+            AVFrame* frame = Pop(decoded, queues_[0], stats.waitInputSeconds);
+            if (!frame && aborted_.load(std::memory_order_acquire)) {
+                break;
+            }
+
+            // frame为nullptr时是输入结束，最后调用一次用于刷新
+            emitSeconds = 0.0;
+            auto t = std::chrono::steady_clock::now();
+            bool ok = blend(frame, emit);
+            stats.busySeconds += SecondsSince(t) - emitSeconds;
+            if (!ok) {
+                Abort();
+                break;
+            }
+            if (!frame) {
+                break;
+            }
+            stats.frames++;
+        }
+        blended.Close();
+    });
+
+    // 编码和写文件留在调用线程
+    PipelineStageStats& stats = stages_[2];
+    while (true) {
+        AVFrame* frame = Pop(blended, queues_[1], stats.waitInputSeconds);
+        if (!frame && aborted_.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        auto t = std::chrono::steady_clock::now();
+        bool ok = encode(frame);
+        stats.busySeconds += SecondsSince(t);
+        if (!ok) {
+            Abort();
+            break;
+        }
+        if (!frame) {
+            break;
+        }
+        stats.frames++;
+    }
+
+    decodeThread.join();
+    blendThread.join();
+
+    // 中止时队列里可能还有没处理的帧
+    AVFrame* leftover = nullptr;
+    while ((leftover = decoded.TryPop()) != nullptr) {
+        av_frame_free(&leftover);
+    }
+    while ((leftover = blended.TryPop()) != nullptr) {
+        av_frame_free(&leftover);
+    }
+
+    return !aborted_.load(std::memory_order_acquire);
+}
+
+void FramePipeline::PrintStats() const
+{
+    if (wallSeconds_ <= 0.0) {
+        return;
+    }
+
+    int64_t frames = stages_[2].frames;
+    std::cout << "=== 流水线统计 (" << (queueDepth_ > 0 ? "多线程" : "串行");
+    if (queueDepth_ > 0) {
+        std::cout << ", 队列深度 " << queueDepth_;
+    }
+    std::cout << ") ===" << std::endl;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "总计 " << frames << " 帧, 用时 " << wallSeconds_ << " 秒, "
+              << frames / wallSeconds_ << " fps" << std::endl;
+
+    std::cout << std::left << std::setw(8) << "阶段"
+              << std::right << std::setw(8) << "帧数"
+              << std::setw(10) << "忙碌%"
+              << std::setw(12) << "等待输入%"
+              << std::setw(12) << "等待输出%" << std::endl;
+
+    int bottleneck = 0;
+    for (int i = 0; i < 3; i++) {
+        const PipelineStageStats& s = stages_[i];
+        std::cout << std::left << std::setw(8) << s.name
+                  << std::right << std::setw(8) << s.frames
+                  << std::setw(10) << s.busySeconds / wallSeconds_ * 100.0
+                  << std::setw(12) << s.waitInputSeconds / wallSeconds_ * 100.0
+                  << std::setw(12) << s.waitOutputSeconds / wallSeconds_ * 100.0 << std::endl;
+        if (s.busySeconds > stages_[bottleneck].busySeconds) {
+            bottleneck = i;
+        }
+    }
+
+    if (queueDepth_ > 0) {
+        const char* names[2] = { "解码->混合", "混合->编码" };
+        for (int i = 0; i < 2; i++) {
+            const PipelineQueueStats& q = queues_[i];
+            double average = q.samples > 0 ? static_cast<double>(q.occupancySum) / q.samples : 0.0;
+            std::cout << "队列 " << names[i] << ": 平均占用 " << average << "/" << queueDepth_
+                      << ", 队列满 " << q.fullCount << " 次" << std::endl;
+        }
+    }
+
+    std::cout << "瓶颈阶段: " << stages_[bottleneck].name << " (忙碌 "
+              << stages_[bottleneck].busySeconds / wallSeconds_ * 100.0 << "%)" << std::endl;
+    std::cout << std::defaultfloat;
+}
@@ -0,0 +1,117 @@
+#include "FramePool.h"
+#include "ScratchArena.h"
+#include <iostream>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+#include <libavutil/version.h>
+}
+
+// 行首按64字节对齐，满足所有SIMD混合内核和swscale的要求
+static const int kFrameAlignment = 64;
+
+// FFmpeg 5.0 起缓冲池的分配回调参数改为size_t
+#if LIBAVUTIL_VERSION_MAJOR >= 57
+typedef size_t PoolBufferSize;
+#else
+typedef int PoolBufferSize;
+#endif
+
+// 缓冲池没有空闲缓冲区时才会调用，计入分配统计
+static AVBufferRef* AllocatePoolBuffer(PoolBufferSize size)
+{
+    AVBufferRef* buffer = av_buffer_alloc(size);
+    if (buffer) {
+        RecordAllocation(static_cast<size_t>(size));
+    }
+    return buffer;
+}
+
+FramePool::FramePool()
+    : pool_(nullptr)
+    , format_(AV_PIX_FMT_NONE)
+    , width_(0)
+    , height_(0)
+    , linesize_()
+    , bufferSize_(0)
+{
+}
+
+FramePool::~FramePool()
+{
+    Release();
+}
+
+void FramePool::Release()
+{
+    // 还有帧在使用时，缓冲区在最后一帧释放后才真正回收
+    if (pool_) {
+        av_buffer_pool_uninit(&pool_);
+    }
+}
+
+bool FramePool::Initialize(AVPixelFormat format, int width, int height)
+{
+    Release();
+
+    if (av_image_fill_linesizes(linesize_, format, width) < 0) {
+        std::cerr << "帧缓冲池: 不支持的像素格式 " << format << std::endl;
+        return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        linesize_[i] = FFALIGN(linesize_[i], kFrameAlignment);
+    }
+
+    // 所有平面放在一个缓冲区里，与av_frame_get_buffer的布局相同
+    uint8_t* data[4] = {};
+    int size = av_image_fill_pointers(data, format, height, nullptr, linesize_);
+    if (size < 0) {
+        std::cerr << "帧缓冲池: 计算帧大小失败" << std::endl;
+        return false;
+    }
+
+    format_ = format;
+    width_ = width;
+    height_ = height;
+    bufferSize_ = static_cast<size_t>(size) + kFrameAlignment;
+    pool_ = av_buffer_pool_init(static_cast<PoolBufferSize>(bufferSize_), AllocatePoolBuffer);
+    if (!pool_) {
+        std::cerr << "帧缓冲池: 创建AVBufferPool失败" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+AVFrame* FramePool::Acquire()
+{
+    if (!pool_) {
+        return nullptr;
+    }
+
+    // 描述结构每帧分配一次，数据缓冲区来自池
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
+    }
+    RecordSmallAllocation(sizeof(AVFrame));
+
+    frame->buf[0] = av_buffer_pool_get(pool_);
+    if (!frame->buf[0]) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+
+    frame->format = format_;
+    frame->width = width_;
+    frame->height = height_;
+    for (int i = 0; i < 4; i++) {
+        frame->linesize[i] = linesize_[i];
+    }
+
+    // av_buffer_alloc只保证平台默认对齐，这里把起始地址再对齐到64字节
+    uint8_t* base = frame->buf[0]->data;
+    uint8_t* aligned = base + (kFrameAlignment - reinterpret_cast<uintptr_t>(base) % kFrameAlignment) % kFrameAlignment;
+    av_image_fill_pointers(frame->data, format_, height_, aligned, frame->linesize);
+    return frame;
+}
@@ -0,0 +1,83 @@
+#include "Histogram.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// 比例条的最大长度（字符）
+static const int kBarWidth = 40;
+
+Histogram::Histogram(const std::vector<double>& bounds)
+    : bounds_(bounds)
+    , counts_(bounds.size() + 1, 0)
+    , count_(0)
+    , sum_(0.0)
+    , max_(0.0)
+{
+    std::sort(bounds_.begin(), bounds_.end());
+}
+
+void Histogram::Add(double value)
+{
+    size_t bucket = std::upper_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+    counts_[bucket]++;
+    if (count_ == 0 || value > max_) {
+        max_ = value;
+    }
+    count_++;
+    sum_ += value;
+}
+
+void Histogram::Clear()
+{
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    sum_ = 0.0;
+    max_ = 0.0;
+}
+
+int64_t Histogram::CountAtLeast(double threshold) const
+{
+    size_t first = std::lower_bound(bounds_.begin(), bounds_.end(), threshold) - bounds_.begin() + 1;
+    int64_t total = 0;
+    for (size_t i = first; i < counts_.size(); i++) {
+        total += counts_[i];
+    }
+    return total;
+}
+
+void Histogram::Print(const char* title, const char* unit) const
+{
+    std::cout << title << " (" << count_ << " 个样本";
+    if (count_ > 0) {
+        std::cout << std::fixed << std::setprecision(2) << ", 平均 " << GetMean() << " " << unit
+                  << ", 最大 " << max_ << " " << unit << std::defaultfloat;
+    }
+    std::cout << "):" << std::endl;
+    if (count_ == 0) {
+        return;
+    }
+
+    int64_t peak = *std::max_element(counts_.begin(), counts_.end());
+    for (size_t i = 0; i < counts_.size(); i++) {
+        if (counts_[i] == 0) {
+            continue;
+        }
+        std::ostringstream range;
+        if (i == 0) {
+            range << "< " << bounds_[0];
+        } else if (i == bounds_.size()) {
+            range << ">= " << bounds_.back();
+        } else {
+            range << bounds_[i - 1] << " - " << bounds_[i];
+        }
+        range << " " << unit;
+
+        int bar = static_cast<int>((counts_[i] * kBarWidth + peak - 1) / peak);
+        std::cout << "  " << std::left << std::setw(20) << range.str() << std::right
+                  << std::setw(10) << counts_[i]
+                  << std::fixed << std::setprecision(2) << std::setw(9) << counts_[i] * 100.0 / count_ << "%  "
+                  << std::string(bar, '#') << std::defaultfloat << std::endl;
+    }
+}
@@ -0,0 +1,196 @@
+#include "LayerCompositor.h"
+#include "BlendKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+void FlattenStaticLayers(const std::vector<StaticLayer>& layers, int frameWidth, int frameHeight,
+                         std::vector<unsigned char>& outRGBA, int& outWidth, int& outHeight)
+{
+    // 结果是整幅画面大小：DirectX方法的纹理拉伸到整帧
+    outWidth = frameWidth;
+    outHeight = frameHeight;
+    outRGBA.assign(static_cast<size_t>(outWidth) * outHeight * 4, 0);
+
+    for (const StaticLayer& layer : layers) {
+        int alpha255 = BlendAlpha255(layer.alpha);
+        int x0 = layer.tiled ? 0 : std::max(layer.x, 0);
+        int y0 = layer.tiled ? 0 : std::max(layer.y, 0);
+        int x1 = layer.tiled ? outWidth : std::min(layer.x + layer.width, outWidth);
+        int y1 = layer.tiled ? outHeight : std::min(layer.y + layer.height, outHeight);
+        for (int y = y0; y < y1; y++) {
+            int srcY = layer.tiled ? y % layer.height : y - layer.y;
+            const unsigned char* srcRow = layer.rgba + static_cast<size_t>(srcY) * layer.width * 4;
+            unsigned char* dst = outRGBA.data() + (static_cast<size_t>(y) * outWidth + x0) * 4;
+            for (int x = x0; x < x1; x++, dst += 4) {
+                int srcX = layer.tiled ? x % layer.width : x - layer.x;
+                const unsigned char* src = srcRow + srcX * 4;
+
+                // 非预乘的source-over：上层的系数与处理器混合时相同，div255(wm.a * alpha255)，
+                // 合并后用全局透明度1.0混合一次，与逐层混合的结果只差舍入
+                int as = BlendDiv255(src[3] * alpha255);
+                if (as == 0) {
+                    continue;
+                }
+                int ad = dst[3];
+                int weightS = as * 255;
+                int weightD = ad * (255 - as);
+                int total = weightS + weightD;
+                for (int c = 0; c < 3; c++) {
+                    dst[c] = static_cast<unsigned char>((src[c] * weightS + dst[c] * weightD + total / 2) / total);
+                }
+                dst[3] = static_cast<unsigned char>(as + BlendDiv255(weightD));
+            }
+        }
+    }
+}
+
+LayerCompositor::LayerCompositor()
+    : staticFused_(false)
+    , staticFrames_(0)
+    , staticSeconds_(0.0)
+{
+}
+
+LayerCompositor::LayerCompositor(const LayerCompositor& other)
+    : LayerCompositor()
+{
+    *this = other;
+}
+
+LayerCompositor& LayerCompositor::operator=(const LayerCompositor& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    staticNames_ = other.staticNames_;
+    staticFused_ = other.staticFused_;
+    staticFrames_ = other.staticFrames_;
+    staticSeconds_ = other.staticSeconds_;
+    logos_.clear();
+    for (const LogoStats& entry : other.logos_) {
+        logos_.push_back({ std::unique_ptr<AnimatedLogoLayer>(new AnimatedLogoLayer(*entry.logo)),
+                           entry.frames, entry.pixels, entry.seconds });
+    }
+    layers_.clear();
+    for (const LayerStats& entry : other.layers_) {
+        layers_.push_back({ entry.layer->Clone(), false, entry.frames, entry.pixels, entry.seconds });
+    }
+    rects_.clear();
+    return *this;
+}
+
+void LayerCompositor::SetStaticLayers(const std::vector<std::string>& names, bool fused)
+{
+    staticNames_ = names;
+    staticFused_ = fused;
+}
+
+void LayerCompositor::AddStaticLogo(std::unique_ptr<AnimatedLogoLayer> logo)
+{
+    logos_.push_back({ std::move(logo), 0, 0, 0.0 });
+}
+
+void LayerCompositor::AddDynamicLayer(std::unique_ptr<DynamicLayer> layer)
+{
+    layers_.push_back({ std::move(layer), false, 0, 0, 0.0 });
+}
+
+void LayerCompositor::DrawStaticLogos(const LayerTarget& target, const FrameRect* regions, size_t count,
+                                      int frameWidth, int frameHeight)
+{
+    for (LogoStats& entry : logos_) {
+        auto t0 = std::chrono::steady_clock::now();
+        FrameRect rect;
+        if (entry.logo->Prepare(0, 0, frameWidth, frameHeight, rect)) {
+            entry.logo->DrawRegions(target, regions, count);
+            for (size_t i = 0; i < count; i++) {
+                int w = std::min(rect.x + rect.width, regions[i].x + regions[i].width) - std::max(rect.x, regions[i].x);
+                int h = std::min(rect.y + rect.height, regions[i].y + regions[i].height) - std::max(rect.y, regions[i].y);
+                entry.pixels += w > 0 && h > 0 ? static_cast<int64_t>(w) * h : 0;
+            }
+        }
+        entry.frames++;
+        entry.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+}
+
+const std::vector<FrameRect>& LayerCompositor::Prepare(int64_t frameNumber, int64_t mediaTimeMs,
+                                                       int frameWidth, int frameHeight)
+{
+    rects_.clear();
+    for (LayerStats& entry : layers_) {
+        auto t0 = std::chrono::steady_clock::now();
+        FrameRect rect;
+        entry.visible = entry.layer->Prepare(frameNumber, mediaTimeMs, frameWidth, frameHeight, rect);
+        if (entry.visible) {
+            rects_.push_back(rect);
+            entry.pixels += static_cast<int64_t>(rect.width) * rect.height;
+        }
+        entry.frames++;
+        entry.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+    return rects_;
+}
+
+void LayerCompositor::Draw(const LayerTarget& target)
+{
+    for (LayerStats& entry : layers_) {
+        if (!entry.visible) {
+            continue;
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        entry.layer->Draw(target);
+        entry.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+}
+
+void LayerCompositor::AddStaticTime(double seconds)
+{
+    staticFrames_++;
+    staticSeconds_ += seconds;
+}
+
+void LayerCompositor::PrintSummary() const
+{
+    if (staticNames_.empty() && logos_.empty() && layers_.empty()) {
+        return;
+    }
+
+    std::cout << "=== 图层耗时（每帧平均） ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    if (!staticNames_.empty()) {
+        std::cout << "静态水印 (";
+        for (size_t i = 0; i < staticNames_.size(); i++) {
+            std::cout << (i > 0 ? " + " : "") << staticNames_[i];
+        }
+        std::cout << "): ";
+        if (staticFused_) {
+            std::cout << "与BGRA->YUV转换融合，计入转换耗时" << std::endl;
+        } else if (staticFrames_ > 0) {
+            std::cout << staticSeconds_ * 1000.0 / staticFrames_ << " ms" << std::endl;
+        } else {
+            std::cout << "没有处理的帧" << std::endl;
+        }
+    }
+    for (const LogoStats& entry : logos_) {
+        std::cout << entry.logo->Describe() << ": ";
+        if (entry.frames == 0) {
+            std::cout << "没有处理的帧" << std::endl;
+            continue;
+        }
+        std::cout << entry.seconds * 1000.0 / entry.frames << " ms, "
+                  << entry.pixels / entry.frames << " 像素" << std::endl;
+    }
+    for (const LayerStats& entry : layers_) {
+        std::cout << entry.layer->Describe() << ": ";
+        if (entry.frames == 0) {
+            std::cout << "没有处理的帧" << std::endl;
+            continue;
+        }
+        std::cout << entry.seconds * 1000.0 / entry.frames << " ms, "
+                  << entry.pixels / entry.frames << " 像素" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
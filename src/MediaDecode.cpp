@@ -0,0 +1,147 @@
+#include "MediaDecode.h"
+#include "ScratchArena.h"
+#include "StreamPassthrough.h"
+#include <iostream>
+
+// 打开输入文件并读取流信息，返回第一个视频流的下标，没有视频流时返回-1
+static int OpenFormat(const std::string& path, AVFormatContext** formatCtx)
+{
+    if (avformat_open_input(formatCtx, path.c_str(), nullptr, nullptr) < 0) {
+        std::cerr << "无法打开输入文件: " << path << std::endl;
+        return -1;
+    }
+
+    if (avformat_find_stream_info(*formatCtx, nullptr) < 0) {
+        std::cerr << "无法获取流信息" << std::endl;
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < (*formatCtx)->nb_streams; i++) {
+        if ((*formatCtx)->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            return static_cast<int>(i);
+        }
+    }
+    std::cerr << "未找到视频流" << std::endl;
+    return -1;
+}
+
+bool OpenVideoDecoder(const std::string& path, AVFormatContext** formatCtx, int& streamIndex,
+                      AVCodecContext** decoderCtx)
+{
+    streamIndex = OpenFormat(path, formatCtx);
+    if (streamIndex < 0) {
+        return false;
+    }
+
+    AVCodecParameters* codecpar = (*formatCtx)->streams[streamIndex]->codecpar;
+    const AVCodec* decoder = avcodec_find_decoder(codecpar->codec_id);
+    if (!decoder) {
+        std::cerr << "未找到解码器" << std::endl;
+        return false;
+    }
+
+    *decoderCtx = avcodec_alloc_context3(decoder);
+    if (!*decoderCtx) {
+        std::cerr << "无法分配解码器上下文" << std::endl;
+        return false;
+    }
+
+    if (avcodec_parameters_to_context(*decoderCtx, codecpar) < 0) {
+        std::cerr << "无法复制解码器参数" << std::endl;
+        return false;
+    }
+
+    if (avcodec_open2(*decoderCtx, decoder, nullptr) < 0) {
+        std::cerr << "无法打开解码器" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool GetVideoDimensions(const std::string& path, int& width, int& height)
+{
+    AVFormatContext* formatCtx = nullptr;
+    int streamIndex = OpenFormat(path, &formatCtx);
+    if (streamIndex >= 0) {
+        width = formatCtx->streams[streamIndex]->codecpar->width;
+        height = formatCtx->streams[streamIndex]->codecpar->height;
+    }
+    avformat_close_input(&formatCtx);
+    return streamIndex >= 0;
+}
+
+bool SeekToSegment(AVFormatContext* formatCtx, int streamIndex, const SegmentRange& range)
+{
+    if (range.startPts == AV_NOPTS_VALUE) {
+        return true;
+    }
+
+    int ret = av_seek_frame(formatCtx, streamIndex, range.startPts, AVSEEK_FLAG_BACKWARD);
+    if (ret < 0) {
+        std::cerr << "定位到分段起点失败: pts=" << range.startPts << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool DecodeNextFrame(AVFormatContext* formatCtx, AVCodecContext* decoderCtx,
+                     int streamIndex, AVPacket* packet, AVFrame** frame,
+                     const SegmentRange* range,
+                     StreamPassthrough* passthrough)
+{
+    *frame = av_frame_alloc();
+    if (!*frame) {
+        std::cerr << "无法分配帧内存" << std::endl;
+        return false;
+    }
+    RecordSmallAllocation(sizeof(AVFrame));
+
+    while (true) {
+        int ret = avcodec_receive_frame(decoderCtx, *frame);
+        if (ret >= 0) {
+            if (!range) {
+                return true;
+            }
+            // 解码器按显示顺序输出，第一帧到达终点后后面的帧都不属于这一段
+            int64_t pts = (*frame)->best_effort_timestamp;
+            if (range->endPts != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE && pts >= range->endPts) {
+                av_frame_free(frame);
+                return true;
+            }
+            if (range->startPts != AV_NOPTS_VALUE && pts != AV_NOPTS_VALUE && pts < range->startPts) {
+                av_frame_unref(*frame);
+                continue;
+            }
+            return true;
+        }
+        if (ret == AVERROR_EOF) {
+            av_frame_free(frame);
+            return true;
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            std::cerr << "接收解码帧失败" << std::endl;
+            av_frame_free(frame);
+            return false;
+        }
+
+        // 解码器需要更多数据：读到下一个视频包为止，读完后发送空包刷新解码器
+        bool sent = false;
+        while (av_read_frame(formatCtx, packet) >= 0) {
+            if (packet->stream_index == streamIndex) {
+                if (avcodec_send_packet(decoderCtx, packet) < 0) {
+                    std::cerr << "发送数据包到解码器失败，跳过该包" << std::endl;
+                }
+                av_packet_unref(packet);
+                sent = true;
+                break;
+            }
+            if (passthrough && passthrough->HandlePacket(packet)) {
+                continue;
+            }
+            av_packet_unref(packet);
+        }
+        if (!sent) {
+            avcodec_send_packet(decoderCtx, nullptr);
+        }
+    }
+}
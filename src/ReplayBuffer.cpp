@@ -0,0 +1,285 @@
+#include "ReplayBuffer.h"
+#include <algorithm>
+#include <iostream>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+static const AVRational kMilliseconds = { 1, 1000 };
+
+ReplayClip::ReplayClip()
+    : codecpar_(nullptr)
+    , timeBase_{ 1, 1000 }
+    , durationMs_(0)
+    , bytes_(0)
+{
+}
+
+ReplayClip::~ReplayClip()
+{
+    Reset();
+}
+
+void ReplayClip::Reset()
+{
+    for (AVPacket*& packet : packets_) {
+        av_packet_free(&packet);
+    }
+    packets_.clear();
+    if (codecpar_) {
+        avcodec_parameters_free(&codecpar_);
+    }
+    durationMs_ = 0;
+    bytes_ = 0;
+}
+
+bool ReplayClip::WriteToFile(const std::string& path) const
+{
+    if (packets_.empty() || !codecpar_) {
+        return false;
+    }
+
+    AVFormatContext* outputCtx = nullptr;
+    avformat_alloc_output_context2(&outputCtx, nullptr, nullptr, path.c_str());
+    if (!outputCtx) {
+        std::cerr << "无法创建输出上下文: " << path << std::endl;
+        return false;
+    }
+
+    AVStream* stream = avformat_new_stream(outputCtx, nullptr);
+    AVPacket* packet = av_packet_alloc();
+    bool ok = stream && packet && avcodec_parameters_copy(stream->codecpar, codecpar_) >= 0;
+    if (ok) {
+        stream->codecpar->codec_tag = 0;
+        stream->time_base = timeBase_;
+        if (!(outputCtx->oformat->flags & AVFMT_NOFILE) &&
+            avio_open(&outputCtx->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+            std::cerr << "无法打开输出文件: " << path << std::endl;
+            ok = false;
+        }
+    }
+    if (ok && avformat_write_header(outputCtx, nullptr) < 0) {
+        std::cerr << "写入文件头失败: " << path << std::endl;
+        ok = false;
+    }
+
+    if (ok) {
+        // 第一个包是关键帧，以它的dts为0点；有B帧时pts不早于dts，平移后不会为负
+        const AVPacket* first = packets_.front();
+        int64_t offset = first->dts != AV_NOPTS_VALUE ? first->dts : first->pts;
+        for (const AVPacket* source : packets_) {
+            if (av_packet_ref(packet, source) < 0) {
+                ok = false;
+                break;
+            }
+            if (packet->pts != AV_NOPTS_VALUE) packet->pts -= offset;
+            if (packet->dts != AV_NOPTS_VALUE) packet->dts -= offset;
+            av_packet_rescale_ts(packet, timeBase_, stream->time_base);
+            packet->stream_index = stream->index;
+            packet->pos = -1;
+            if (av_interleaved_write_frame(outputCtx, packet) < 0) {
+                std::cerr << "写入数据包失败: " << path << std::endl;
+                ok = false;
+                break;
+            }
+        }
+        av_packet_unref(packet);
+        if (av_write_trailer(outputCtx) < 0) {
+            ok = false;
+        }
+    }
+
+    av_packet_free(&packet);
+    if (!(outputCtx->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&outputCtx->pb);
+    }
+    avformat_free_context(outputCtx);
+    return ok;
+}
+
+ReplayBuffer::ReplayBuffer()
+    : codecpar_(nullptr)
+    , timeBase_{ 1, 1000 }
+    , window_(0)
+    , maxBytes_(0)
+    , packetHead_(0)
+    , gopHead_(0)
+    , lastPts_(AV_NOPTS_VALUE)
+    , stats_()
+{
+}
+
+ReplayBuffer::~ReplayBuffer()
+{
+    Clear();
+    for (AVPacket*& packet : spare_) {
+        av_packet_free(&packet);
+    }
+    if (codecpar_) {
+        avcodec_parameters_free(&codecpar_);
+    }
+}
+
+bool ReplayBuffer::Initialize(const AVCodecContext* codecCtx, int64_t windowMs, int64_t maxBytes)
+{
+    if (windowMs <= 0 || maxBytes < 0) {
+        std::cerr << "无效的即时回放参数: " << windowMs << " ms, " << maxBytes << " 字节" << std::endl;
+        return false;
+    }
+
+    Clear();
+    if (!codecpar_) {
+        codecpar_ = avcodec_parameters_alloc();
+    }
+    if (!codecpar_ || avcodec_parameters_from_context(codecpar_, codecCtx) < 0) {
+        std::cerr << "无法保存编码参数" << std::endl;
+        return false;
+    }
+    timeBase_ = codecCtx->time_base;
+    window_ = av_rescale_q(windowMs, kMilliseconds, timeBase_);
+    maxBytes_ = maxBytes;
+    stats_ = ReplayBufferStats();
+    return true;
+}
+
+int64_t ReplayBuffer::PacketBytes(const AVPacket* packet)
+{
+    int64_t bytes = static_cast<int64_t>(sizeof(AVPacket)) + packet->size;
+    for (int i = 0; i < packet->side_data_elems; i++) {
+        bytes += packet->side_data[i].size;
+    }
+    return bytes;
+}
+
+bool ReplayBuffer::Append(const AVPacket* packet)
+{
+    bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    if (gopHead_ == gops_.size() && !key) {
+        stats_.droppedPackets++;
+        return true;
+    }
+
+    AVPacket* stored = nullptr;
+    if (!spare_.empty()) {
+        stored = spare_.back();
+        spare_.pop_back();
+    } else {
+        stored = av_packet_alloc();
+        if (!stored) {
+            std::cerr << "无法分配数据包" << std::endl;
+            return false;
+        }
+    }
+    if (av_packet_ref(stored, packet) < 0) {
+        spare_.push_back(stored);
+        std::cerr << "无法引用编码数据包" << std::endl;
+        return false;
+    }
+
+    int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (key) {
+        gops_.push_back(Gop{ pts, 0, 0 });
+    }
+    int64_t bytes = PacketBytes(stored);
+    packets_.push_back(stored);
+    gops_.back().packets++;
+    gops_.back().bytes += bytes;
+    stats_.packets++;
+    stats_.bytes += bytes;
+    if (pts != AV_NOPTS_VALUE && (lastPts_ == AV_NOPTS_VALUE || pts > lastPts_)) {
+        lastPts_ = pts;
+    }
+
+    // 去掉最旧的GOP后仍覆盖整个窗口时才淘汰它
+    while (gops_.size() - gopHead_ > 1 && lastPts_ - gops_[gopHead_ + 1].startPts >= window_) {
+        EvictFront();
+        stats_.evictedGops++;
+    }
+    // 内存超限时提前淘汰，正在写入的GOP总是保留
+    while (maxBytes_ > 0 && stats_.bytes > maxBytes_ && gops_.size() - gopHead_ > 1) {
+        EvictFront();
+        stats_.memoryEvictions++;
+    }
+    Compact();
+
+    stats_.peakBytes = std::max(stats_.peakBytes, stats_.bytes);
+    return true;
+}
+
+void ReplayBuffer::EvictFront()
+{
+    const Gop& gop = gops_[gopHead_];
+    for (int i = 0; i < gop.packets; i++) {
+        AVPacket* packet = packets_[packetHead_++];
+        av_packet_unref(packet);
+        spare_.push_back(packet);
+    }
+    stats_.packets -= gop.packets;
+    stats_.bytes -= gop.bytes;
+    gopHead_++;
+}
+
+void ReplayBuffer::Compact()
+{
+    if (packetHead_ > 0 && packetHead_ >= packets_.size() / 2) {
+        packets_.erase(packets_.begin(), packets_.begin() + packetHead_);
+        packetHead_ = 0;
+    }
+    if (gopHead_ > 0 && gopHead_ >= gops_.size() / 2) {
+        gops_.erase(gops_.begin(), gops_.begin() + gopHead_);
+        gopHead_ = 0;
+    }
+}
+
+int64_t ReplayBuffer::DurationMs() const
+{
+    if (gopHead_ == gops_.size()) {
+        return 0;
+    }
+    return av_rescale_q(lastPts_ - gops_[gopHead_].startPts, timeBase_, kMilliseconds);
+}
+
+bool ReplayBuffer::Snapshot(ReplayClip& clip) const
+{
+    clip.Reset();
+    if (packetHead_ == packets_.size() || !codecpar_) {
+        return false;
+    }
+
+    clip.codecpar_ = avcodec_parameters_alloc();
+    if (!clip.codecpar_ || avcodec_parameters_copy(clip.codecpar_, codecpar_) < 0) {
+        clip.Reset();
+        return false;
+    }
+    clip.packets_.reserve(packets_.size() - packetHead_);
+    for (size_t i = packetHead_; i < packets_.size(); i++) {
+        AVPacket* copy = av_packet_clone(packets_[i]);
+        if (!copy) {
+            clip.Reset();
+            return false;
+        }
+        clip.packets_.push_back(copy);
+    }
+    clip.timeBase_ = timeBase_;
+    clip.durationMs_ = DurationMs();
+    clip.bytes_ = stats_.bytes;
+    return true;
+}
+
+void ReplayBuffer::Clear()
+{
+    while (gopHead_ < gops_.size()) {
+        EvictFront();
+    }
+    Compact();
+    lastPts_ = AV_NOPTS_VALUE;
+}
+
+ReplayBufferStats ReplayBuffer::GetStats() const
+{
+    ReplayBufferStats stats = stats_;
+    stats.gops = static_cast<int>(gops_.size() - gopHead_);
+    stats.durationMs = DurationMs();
+    return stats;
+}
@@ -0,0 +1,114 @@
+#include "ScratchArena.h"
+#include <iomanip>
+#include <iostream>
+
+static thread_local AllocationCounter* t_allocationCounter = nullptr;
+
+AllocationCounter::AllocationCounter()
+    : count_(0)
+    , bytes_(0)
+    , smallCount_(0)
+    , smallBytes_(0)
+{
+}
+
+void AllocationCounter::Add(size_t bytes, bool small)
+{
+    std::atomic<int64_t>& count = small ? smallCount_ : count_;
+    std::atomic<int64_t>& total = small ? smallBytes_ : bytes_;
+    count.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+}
+
+AllocationStats AllocationCounter::Get() const
+{
+    AllocationStats stats;
+    stats.count = count_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.smallCount = smallCount_.load(std::memory_order_relaxed);
+    stats.smallBytes = smallBytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+AllocationScope::AllocationScope(AllocationCounter* counter)
+    : previous_(t_allocationCounter)
+{
+    t_allocationCounter = counter;
+}
+
+AllocationScope::~AllocationScope()
+{
+    t_allocationCounter = previous_;
+}
+
+AllocationCounter* GetAllocationCounter()
+{
+    return t_allocationCounter;
+}
+
+void RecordAllocation(size_t bytes)
+{
+    if (t_allocationCounter) {
+        t_allocationCounter->Add(bytes, false);
+    }
+}
+
+void RecordSmallAllocation(size_t bytes)
+{
+    if (t_allocationCounter) {
+        t_allocationCounter->Add(bytes, true);
+    }
+}
+
+uint8_t* ScratchArena::Get(size_t bytes)
+{
+    if (bytes > buffer_.size()) {
+        buffer_.resize(bytes);
+        RecordAllocation(bytes);
+    }
+    return buffer_.data();
+}
+
+AllocationMonitor::AllocationMonitor(int warmupFrames)
+    : warmupFrames_(warmupFrames)
+    , warm_()
+    , warmFrames_(0)
+    , frames_(0)
+    , warmed_(false)
+{
+}
+
+void AllocationMonitor::OnFrameDone(int64_t frameCount)
+{
+    frames_ = frameCount;
+    if (!warmed_ && frameCount >= warmupFrames_) {
+        warm_ = counter_.Get();
+        warmFrames_ = frameCount;
+        warmed_ = true;
+    }
+}
+
+void AllocationMonitor::PrintSummary() const
+{
+    AllocationStats end = counter_.Get();
+    AllocationStats warm = warmed_ ? warm_ : end;
+
+    std::cout << "帧缓冲分配: 预热阶段 " << warm.count << " 次 (" << warm.bytes / 1024 << " KB)";
+    if (warmed_) {
+        std::cout << "，稳态阶段 " << (end.count - warm.count) << " 次 ("
+                  << (end.bytes - warm.bytes) / 1024 << " KB)";
+    } else {
+        std::cout << "，帧数少于 " << warmupFrames_ << "，未进入稳态";
+    }
+    std::cout << std::endl;
+
+    // 小对象按帧分配，稳态阶段不为0，报告每帧的次数
+    if (warmed_ && frames_ > warmFrames_) {
+        int64_t count = end.smallCount - warm.smallCount;
+        std::cout << "小对象分配: 稳态阶段 " << count << " 次 (" << (end.smallBytes - warm.smallBytes) / 1024
+                  << " KB)，每帧 " << std::fixed << std::setprecision(2)
+                  << static_cast<double>(count) / (frames_ - warmFrames_) << " 次" << std::endl;
+    } else {
+        std::cout << "小对象分配: " << end.smallCount << " 次 (" << end.smallBytes / 1024 << " KB)" << std::endl;
+    }
+}
@@ -1,25 +1,36 @@
 #include "ScreenRecorder.h"
-#include "DXGICapture.h"
-#include "D3DProcessor.h"
+#include "ScratchArena.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <thread>
-#include <chrono>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
-#include <libswscale/swscale.h>
 #include <libavutil/opt.h>
 #include <libavutil/imgutils.h>
 }
 
+// 录制码率；低延迟模式同时作为VBV的最大码率
+static const int64_t kBitRate = 4000000;
+
+// 延迟分布的分桶（毫秒），延迟目标也会作为一个边界加入
+static const std::vector<double> kLatencyBounds = { 2, 4, 8, 16, 24, 33, 50, 67, 100, 150, 250, 500 };
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
 ScreenRecorder::ScreenRecorder()
-    : capture_(nullptr)
-    , d3dProcessor_(nullptr)
-    , formatCtx_(nullptr)
+    : formatCtx_(nullptr)
     , codecCtx_(nullptr)
     , videoStream_(nullptr)
-    , swsCtx_(nullptr)
+    , packet_(nullptr)
     , width_(0)
     , height_(0)
     , fps_(30)
@@ -28,10 +39,29 @@ ScreenRecorder::ScreenRecorder()
     , watermarkWidth_(0)
     , watermarkHeight_(0)
     , alpha_(0.3f)
-    , videoTexture_(nullptr)
-    , watermarkTexture_(nullptr)
-    , videoSRV_(nullptr)
-    , watermarkSRV_(nullptr)
+    , watermarkTiled_(false)
+    , blendWidth_(0)
+    , blendHeight_(0)
+    , yuvFrame_(nullptr)
+    , dropPolicy_(DropPolicy::DropOldest)
+    , ringSize_(4)
+    , vfr_(false)
+    , maxGapUs_(1000000)
+    , lastEmitUs_(0)
+    , firstTimestampUs_(0)
+    , lastPts_(-1)
+    , lastKeyPts_(0)
+    , replaySeconds_(0)
+    , replayMaxBytes_(0)
+    , replayRequests_(0)
+    , replayClips_(0)
+    , lowLatency_(false)
+    , latencySloMs_(0)
+    , latency_(kLatencyBounds)
+    , adaptive_(false)
+    , globalHeader_(false)
+    , lastDts_(AV_NOPTS_VALUE)
+    , stats_()
 {
 }
 
@@ -49,65 +79,135 @@ bool ScreenRecorder::RecordScreen(const std::string& outputPath,
                                   float alpha)
 {
     fps_ = fps;
+    outputPath_ = outputPath;
     watermarkData_ = watermarkData;
     watermarkWidth_ = watermarkWidth;
     watermarkHeight_ = watermarkHeight;
     alpha_ = alpha;
 
-    std::cout << "初始化桌面捕获..." << std::endl;
+    if (lowLatency_ && replaySeconds_ > 0) {
+        // 周期帧内刷新没有IDR帧，回放缓冲无法按GOP淘汰；回放也不需要即时写盘
+        std::cerr << "低延迟模式不能与即时回放同时使用" << std::endl;
+        return false;
+    }
+    // 帧环中生产者和消费者各占一个槽位，排队的帧最多为容量-1
+    if (adaptive_ && !speed_.Initialize(lowLatency_ ? "veryfast" : "fast", fps, ringSize_ - 1)) {
+        return false;
+    }
+
+    std::cout << "初始化画面来源..." << std::endl;
     if (!InitializeCapture()) {
-        std::cerr << "初始化桌面捕获失败" << std::endl;
+        std::cerr << "初始化画面来源失败" << std::endl;
         return false;
     }
 
-    std::cout << "桌面尺寸: " << width_ << "x" << height_ << std::endl;
+    std::cout << "画面来源: " << source_->GetName() << ", 尺寸: " << width_ << "x" << height_ << std::endl;
 
     std::cout << "初始化视频编码器..." << std::endl;
-    if (!InitializeEncoder(outputPath, width_, height_, fps)) {
+    if (!InitializeEncoder(outputPath)) {
         std::cerr << "初始化编码器失败" << std::endl;
         return false;
     }
 
     int totalFrames = duration * fps;
-    std::cout << "开始录制 " << duration << " 秒 (" << totalFrames << " 帧)..." << std::endl;
-
-    auto startTime = std::chrono::steady_clock::now();
-    auto frameDuration = std::chrono::milliseconds(1000 / fps);
-
-    for (int i = 0; i < totalFrames; i++) {
-        auto frameStart = std::chrono::steady_clock::now();
+    std::cout << "开始录制 " << duration << " 秒 (" << totalFrames << " 帧)";
+    if (!source_->IsRealtime()) {
+        std::cout << "，非实时来源，全速运行";
+    }
+    std::cout << "..." << std::endl;
 
-        if (!CaptureAndProcessFrame()) {
-            std::cerr << "捕获帧失败: " << i << std::endl;
-            continue;
+    // 帧环和统计用的数组预先分配好，录制循环中不再分配
+    if (!ring_.Initialize(ringSize_, dropPolicy_, width_, height_)) {
+        return false;
+    }
+    // 第一帧需要完整处理，之后只处理来源报告的变化区域
+    pending_.Reset(width_, height_);
+    pending_.SetFull();
+    std::cout << "帧环: " << ringSize_ << " 帧, 环满时" << DropPolicyName(dropPolicy_) << std::endl;
+    if (vfr_) {
+        std::cout << "可变帧率: 画面未变化时不输出帧, 最大间隔 " << maxGapUs_ / 1000 << " ms" << std::endl;
+    }
+    if (replaySeconds_ > 0) {
+        std::cout << "即时回放: 内存中保留最近 " << replaySeconds_ << " 秒";
+        if (replayMaxBytes_ > 0) {
+            std::cout << ", 内存上限 " << replayMaxBytes_ / (1024 * 1024) << " MB";
         }
-
-        if ((i + 1) % fps == 0) {
-            std::cout << "已录制 " << (i + 1) / fps << " 秒..." << std::endl;
+        std::cout << ", 按需保存为 " << ReplayClipPath(1) << " 等" << std::endl;
+    }
+    if (adaptive_) {
+        std::cout << "编码速度自适应: 从 " << speed_.GetLevel().name << " 开始, 每帧预算 "
+                  << 1000.0 / fps << " ms" << std::endl;
+    }
+    if (lowLatency_) {
+        std::cout << "低延迟模式: 无B帧, 周期帧内刷新, VBV " << kBitRate / 1000 << " kbps / 1帧, 每包立即写入";
+        if (latencySloMs_ > 0) {
+            std::cout << ", 延迟目标 " << latencySloMs_ << " ms";
         }
+        std::cout << std::endl;
+    }
+    replayRequests_ = 0;
+    replayClips_ = 0;
+
+    PendingLatency unused = { -1, 0.0 };
+    captureStart_.assign(vfr_ ? 65536 : std::max(totalFrames, 1), unused);
+    lastEmitUs_ = 0;
+    lastPts_ = -1;
+    lastKeyPts_ = 0;
+    stats_ = RecorderStats();
+    stats_.latencyMs.reserve(totalFrames);
+    std::vector<double> latencyBounds = kLatencyBounds;
+    if (latencySloMs_ > 0 &&
+        std::find(latencyBounds.begin(), latencyBounds.end(), latencySloMs_) == latencyBounds.end()) {
+        latencyBounds.push_back(latencySloMs_);
+    }
+    latency_ = Histogram(latencyBounds);
+
+    AllocationMonitor allocMonitor(8);
+    AllocationScope allocScope(allocMonitor.GetCounter());
+    startTime_ = std::chrono::steady_clock::now();
+    pacer_.Start(startTime_, fps);
+
+    // 采集线程按帧率时钟采集并放入帧环，当前线程负责转换、混合和编码，
+    // 编码偶尔变慢只会让帧环排队或丢帧，不会推迟下一次采集
+    bool captureOk = true;
+    AllocationCounter* allocCounter = allocMonitor.GetCounter();
+    std::thread captureThread([this, totalFrames, &captureOk, allocCounter] {
+        AllocationScope captureScope(allocCounter);
+        captureOk = CaptureLoop(totalFrames);
+    });
+
+    bool encodeOk = EncodeLoop(allocMonitor);
+    if (!encodeOk) {
+        ring_.Abort();
+    }
+    captureThread.join();
+    pacer_.Stop();
 
-        // 控制帧率
-        auto frameEnd = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(frameEnd - frameStart);
-        if (elapsed < frameDuration) {
-            std::this_thread::sleep_for(frameDuration - elapsed);
-        }
+    if (!captureOk || !encodeOk) {
+        return false;
     }
 
     std::cout << "录制完成，正在写入文件..." << std::endl;
 
     // 刷新编码器
     avcodec_send_frame(codecCtx_, nullptr);
-    AVPacket* pkt = av_packet_alloc();
-    while (avcodec_receive_packet(codecCtx_, pkt) == 0) {
-        av_packet_rescale_ts(pkt, codecCtx_->time_base, videoStream_->time_base);
-        pkt->stream_index = videoStream_->index;
-        av_interleaved_write_frame(formatCtx_, pkt);
-        av_packet_unref(pkt);
+    ReceivePackets();
+    stats_.wallSeconds = MillisecondsSince(startTime_) / 1000.0;
+
+    if (replaySeconds_ > 0) {
+        // 即时回放不写完整录像，结束时把最后的缓冲写到输出文件
+        if (!SaveReplayClip(outputPath, false)) {
+            return false;
+        }
+    } else {
+        av_write_trailer(formatCtx_);
     }
-    av_packet_free(&pkt);
 
-    av_write_trailer(formatCtx_);
+    PrintStats();
+    if (source_->IsRealtime()) {
+        pacer_.PrintReport();
+    }
+    allocMonitor.PrintSummary();
 
     std::cout << "录制成功！" << std::endl;
     return true;
@@ -115,93 +215,95 @@ bool ScreenRecorder::RecordScreen(const std::string& outputPath,
 
 bool ScreenRecorder::InitializeCapture()
 {
-    capture_ = new DXGICapture();
-    if (!capture_->Initialize()) {
+    if (!source_) {
+        std::cerr << "未指定画面来源" << std::endl;
         return false;
     }
 
-    width_ = capture_->GetWidth();
-    height_ = capture_->GetHeight();
+    width_ = source_->GetWidth();
+    height_ = source_->GetHeight();
+    if (width_ <= 0 || height_ <= 0) {
+        std::cerr << "画面来源尺寸无效" << std::endl;
+        return false;
+    }
 
-    // 初始化D3D处理器用于水印混合
-    d3dProcessor_ = new D3DProcessor();
-    if (!d3dProcessor_->Initialize(width_, height_)) {
-        std::cerr << "初始化D3D处理器失败" << std::endl;
+    if (!yuvPool_.Initialize(AV_PIX_FMT_YUV420P, width_, height_)) {
         return false;
     }
 
-    // 创建水印纹理（假设水印尺寸与桌面相同）
+    // 水印与画面左上角对齐，超出画面的部分忽略
+    // 混合在CPU上进行，结果与WatermarkPS.hlsl逐字节一致，不需要GPU
+    // 平铺时计划只覆盖一个单元，转换时按单元尺寸取模
     if (watermarkData_) {
-        ID3D11Texture2D* watermarkTex = nullptr;
-        ID3D11ShaderResourceView* watermarkSrv = nullptr;
-        
-        if (!d3dProcessor_->CreateTextureFromRGBA(watermarkData_, watermarkWidth_, watermarkHeight_, 
-                                                  &watermarkTex, &watermarkSrv)) {
-            std::cerr << "创建水印纹理失败" << std::endl;
+        if (watermarkTiled_ && (watermarkWidth_ % 2 != 0 || watermarkWidth_ <= 0 || watermarkHeight_ <= 0)) {
+            std::cerr << "水印平铺单元的宽度必须是正偶数: " << watermarkWidth_ << "x" << watermarkHeight_ << std::endl;
+            return false;
+        }
+        blendWidth_ = watermarkTiled_ ? watermarkWidth_ : std::min(width_, watermarkWidth_);
+        blendHeight_ = watermarkTiled_ ? watermarkHeight_ : std::min(height_, watermarkHeight_);
+        if (!blendPlan_.BuildPackedBGRA(watermarkData_, watermarkWidth_ * 4,
+                                        blendWidth_, blendHeight_, BlendAlpha255(alpha_))) {
+            std::cerr << "构建水印混合计划失败" << std::endl;
             return false;
         }
-        
-        watermarkTexture_ = watermarkTex;
-        watermarkSRV_ = watermarkSrv;
+        std::cout << "水印混合: CPU " << GetBlendKernels().name;
+        if (watermarkTiled_) {
+            std::cout << ", 平铺单元 " << blendWidth_ << "x" << blendHeight_ << " ("
+                      << blendPlan_.GetMemoryBytes() / 1024 << " KB)";
+        }
+        std::cout << std::endl;
     }
 
     return true;
 }
 
-bool ScreenRecorder::InitializeEncoder(const std::string& outputPath, int width, int height, int fps)
+bool ScreenRecorder::InitializeEncoder(const std::string& outputPath)
 {
-    // 分配输出上下文
-    avformat_alloc_output_context2(&formatCtx_, nullptr, nullptr, outputPath.c_str());
-    if (!formatCtx_) {
-        std::cerr << "无法创建输出上下文" << std::endl;
-        return false;
-    }
-
-    // 查找编码器
-    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_H264);
-    if (!codec) {
-        std::cerr << "找不到H264编码器" << std::endl;
-        return false;
+    // 即时回放时录制过程中不写文件，只用输出格式决定编码参数（是否需要全局头）
+    bool replay = replaySeconds_ > 0;
+    const AVOutputFormat* oformat = nullptr;
+    if (replay) {
+        oformat = av_guess_format(nullptr, outputPath.c_str(), nullptr);
+        if (!oformat) {
+            std::cerr << "无法根据扩展名确定输出格式: " << outputPath << std::endl;
+            return false;
+        }
+    } else {
+        // 分配输出上下文
+        avformat_alloc_output_context2(&formatCtx_, nullptr, nullptr, outputPath.c_str());
+        if (!formatCtx_) {
+            std::cerr << "无法创建输出上下文" << std::endl;
+            return false;
+        }
+        oformat = formatCtx_->oformat;
     }
 
     // 创建视频流
-    videoStream_ = avformat_new_stream(formatCtx_, nullptr);
-    if (!videoStream_) {
-        std::cerr << "无法创建视频流" << std::endl;
-        return false;
+    if (!replay) {
+        videoStream_ = avformat_new_stream(formatCtx_, nullptr);
+        if (!videoStream_) {
+            std::cerr << "无法创建视频流" << std::endl;
+            return false;
+        }
     }
 
-    // 创建编码器上下文
-    codecCtx_ = avcodec_alloc_context3(codec);
-    if (!codecCtx_) {
-        std::cerr << "无法创建编码器上下文" << std::endl;
+    // 换档不改变SPS/PPS（见EncoderSpeedLevel），自适应时参数集同样只写在文件头里
+    globalHeader_ = (oformat->flags & AVFMT_GLOBALHEADER) != 0;
+    frameCount_ = 0;
+    lastDts_ = AV_NOPTS_VALUE;
+    if (!OpenEncoder()) {
         return false;
     }
 
-    // 设置编码参数
-    codecCtx_->codec_id = AV_CODEC_ID_H264;
-    codecCtx_->codec_type = AVMEDIA_TYPE_VIDEO;
-    codecCtx_->pix_fmt = AV_PIX_FMT_YUV420P;
-    codecCtx_->width = width;
-    codecCtx_->height = height;
-    codecCtx_->time_base = AVRational{1, fps};
-    codecCtx_->framerate = AVRational{fps, 1};
-    codecCtx_->gop_size = fps;
-    codecCtx_->max_b_frames = 2;
-    codecCtx_->bit_rate = 4000000;
-
-    // H264编码选项
-    av_opt_set(codecCtx_->priv_data, "preset", "fast", 0);
-    av_opt_set(codecCtx_->priv_data, "tune", "zerolatency", 0);
-
-    if (formatCtx_->oformat->flags & AVFMT_GLOBALHEADER) {
-        codecCtx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    packet_ = av_packet_alloc();
+    if (!packet_) {
+        std::cerr << "无法分配数据包" << std::endl;
+        return false;
     }
 
-    // 打开编码器
-    if (avcodec_open2(codecCtx_, codec, nullptr) < 0) {
-        std::cerr << "无法打开编码器" << std::endl;
-        return false;
+    if (replay) {
+        // 编码参数（包括全局头）由回放缓冲保存，写片段时复制到输出流
+        return replay_.Initialize(codecCtx_, static_cast<int64_t>(replaySeconds_) * 1000, replayMaxBytes_);
     }
 
     // 复制编码器参数到流
@@ -216,200 +318,634 @@ bool ScreenRecorder::InitializeEncoder(const std::string& outputPath, int width,
         }
     }
 
+    if (lowLatency_) {
+        // 每个包写入后立即刷新IO缓冲，不在封装器和AVIOContext中攒数据
+        formatCtx_->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+    }
+
     // 写入文件头
     if (avformat_write_header(formatCtx_, nullptr) < 0) {
         std::cerr << "写入文件头失败" << std::endl;
         return false;
     }
-
-    // 初始化颜色空间转换
-    swsCtx_ = sws_getContext(
-        width, height, AV_PIX_FMT_RGB24,
-        width, height, AV_PIX_FMT_YUV420P,
-        SWS_BICUBIC, nullptr, nullptr, nullptr
-    );
-
-    if (!swsCtx_) {
-        std::cerr << "无法创建颜色空间转换器" << std::endl;
-        return false;
-    }
-
-    frameCount_ = 0;
     return true;
 }
 
-bool ScreenRecorder::CaptureAndProcessFrame()
+bool ScreenRecorder::OpenEncoder()
 {
-    // 捕获桌面帧（包含鼠标）
-    if (!capture_->CaptureFrame()) {
+    // 查找编码器
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    if (!codec) {
+        std::cerr << "找不到H264编码器" << std::endl;
         return false;
     }
 
-    ID3D11Texture2D* capturedTexture = capture_->GetCapturedTexture();
-    if (!capturedTexture) {
+    // 创建编码器上下文
+    codecCtx_ = avcodec_alloc_context3(codec);
+    if (!codecCtx_) {
+        std::cerr << "无法创建编码器上下文" << std::endl;
         return false;
     }
 
-    // 从D3D11纹理读取数据到CPU内存
-    D3D11_TEXTURE2D_DESC desc;
-    capturedTexture->GetDesc(&desc);
+    // 速度档位：预设固定，换档只改变分析选项，以及按CRF增量换算的码率（每+6码率减半）
+    const char* preset = lowLatency_ ? "veryfast" : "fast";
+    int64_t bitRate = kBitRate;
+    if (adaptive_) {
+        bitRate = static_cast<int64_t>(kBitRate * std::pow(2.0, -speed_.GetLevel().crfOffset / 6.0));
+    }
 
-    // 创建临时staging纹理用于读取
-    Microsoft::WRL::ComPtr<ID3D11Device> device;
-    capturedTexture->GetDevice(device.GetAddressOf());
+    // 设置编码参数
+    codecCtx_->codec_id = AV_CODEC_ID_H264;
+    codecCtx_->codec_type = AVMEDIA_TYPE_VIDEO;
+    codecCtx_->pix_fmt = AV_PIX_FMT_YUV420P;
+    codecCtx_->width = width_;
+    codecCtx_->height = height_;
+    // 可变帧率时pts是采集时间戳（毫秒），framerate只作为名义帧率
+    codecCtx_->time_base = vfr_ ? AVRational{1, 1000} : AVRational{1, fps_};
+    codecCtx_->framerate = AVRational{fps_, 1};
+    codecCtx_->gop_size = fps_;
+    codecCtx_->bit_rate = bitRate;
+
+    // B帧数在各档位保持不变（不跟随预设），换编码器前后的dts延迟相同，dts保持递增
+    if (lowLatency_) {
+        // B帧要等后面的帧到了才能编码，每个B帧至少增加一帧的延迟
+        codecCtx_->max_b_frames = 0;
+        // VBV缓冲只有一帧时间的码率，任何一帧都不会比平均大很多，传输和写盘的时间可预期；
+        // VBV按基准码率设置，不随档位变化（level_idc由VBV决定，在SPS中）
+        codecCtx_->rc_max_rate = kBitRate;
+        codecCtx_->rc_buffer_size = static_cast<int>(kBitRate / fps_);
+        // 条带多线程：一帧由多个线程分条带同时编码，而不是多帧并行（帧多线程每个线程增加一帧延迟）
+        codecCtx_->thread_type = FF_THREAD_SLICE;
+        codecCtx_->thread_count = 0;
+
+        av_opt_set(codecCtx_->priv_data, "preset", preset, 0);
+        av_opt_set(codecCtx_->priv_data, "tune", "zerolatency", 0);
+        // 一列帧内块在gop_size帧内扫过整个画面，代替周期性的关键帧，避免关键帧的码率尖峰
+        av_opt_set(codecCtx_->priv_data, "intra-refresh", "1", 0);
+    } else {
+        codecCtx_->max_b_frames = 2;
 
-    Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
-    device->GetImmediateContext(context.GetAddressOf());
+        // H264编码选项
+        av_opt_set(codecCtx_->priv_data, "preset", preset, 0);
+        av_opt_set(codecCtx_->priv_data, "tune", "zerolatency", 0);
+    }
 
-    D3D11_TEXTURE2D_DESC stagingDesc = desc;
-    stagingDesc.Usage = D3D11_USAGE_STAGING;
-    stagingDesc.BindFlags = 0;
-    stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-    stagingDesc.MiscFlags = 0;
+    if (adaptive_) {
+        // zerolatency不使用前瞻，档位的rc-lookahead不设置
+        av_opt_set(codecCtx_->priv_data, "x264-params", speed_.GetX264Params(false).c_str(), 0);
+    }
+    if (globalHeader_) {
+        codecCtx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
 
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> stagingTexture;
-    HRESULT hr = device->CreateTexture2D(&stagingDesc, nullptr, stagingTexture.GetAddressOf());
-    if (FAILED(hr)) {
-        std::cerr << "创建staging纹理失败" << std::endl;
+    // 打开编码器
+    if (avcodec_open2(codecCtx_, codec, nullptr) < 0) {
+        std::cerr << "无法打开编码器" << std::endl;
         return false;
     }
+    return true;
+}
 
-    context->CopyResource(stagingTexture.Get(), capturedTexture);
+bool ScreenRecorder::ReopenEncoder()
+{
+    // 先取出旧编码器中剩余的包，新编码器从IDR帧开始，pts接着原来的时间线
+    avcodec_send_frame(codecCtx_, nullptr);
+    if (!ReceivePackets()) {
+        return false;
+    }
+    std::vector<uint8_t> extradata(codecCtx_->extradata, codecCtx_->extradata + codecCtx_->extradata_size);
+    avcodec_free_context(&codecCtx_);
+    if (!OpenEncoder()) {
+        return false;
+    }
 
-    // 读取像素数据
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    hr = context->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mapped);
-    if (FAILED(hr)) {
-        std::cerr << "映射纹理失败" << std::endl;
+    // 文件头（或回放片段的文件头）中只有第一个编码器的SPS/PPS，换档后必须完全相同
+    if (globalHeader_ && (codecCtx_->extradata_size != static_cast<int>(extradata.size()) ||
+                          !std::equal(extradata.begin(), extradata.end(), codecCtx_->extradata))) {
+        std::cerr << "换档后编码器的SPS/PPS与文件头中的不同，停止录制" << std::endl;
         return false;
     }
+    return true;
+}
+
+bool ScreenRecorder::CaptureLoop(int totalFrames)
+{
+    bool realtime = source_->IsRealtime();
+
+    // i是采集时刻的序号
+    for (int64_t i = 0; i < totalFrames; i++) {
+        // 实时来源按绝对时刻采集；落后超过一帧时跳过错过的时刻，而不是连续补采。
+        // 跳过的时刻包括最后一个时刻时，它已经过去，马上采集作为最后一帧（不计入时钟漂移）
+        bool overran = false;
+        if (realtime) {
+            int64_t tick = pacer_.WaitForTick(i);
+            overran = tick >= totalFrames;
+            i = std::min<int64_t>(tick, totalFrames - 1);
+        }
+        bool last = i == totalFrames - 1;
+
+        auto t0 = std::chrono::steady_clock::now();
+        double captureStartMs = MillisecondsSince(startTime_);
 
-    // 转换BGRA到RGBA（紧密排列）
-    std::vector<unsigned char> rgbaData(width_ * height_ * 4);
-    const unsigned char* src = static_cast<const unsigned char*>(mapped.pData);
-    
-    for (int y = 0; y < height_; y++) {
-        for (int x = 0; x < width_; x++) {
-            int srcIdx = y * mapped.RowPitch + x * 4;
-            int dstIdx = (y * width_ + x) * 4;
-            
-            rgbaData[dstIdx + 0] = src[srcIdx + 2]; // R
-            rgbaData[dstIdx + 1] = src[srcIdx + 1]; // G
-            rgbaData[dstIdx + 2] = src[srcIdx + 0]; // B
-            rgbaData[dstIdx + 3] = src[srcIdx + 3]; // A
-        }
-    }
-
-    context->Unmap(stagingTexture.Get(), 0);
-
-    // 如果有水印，进行混合
-    std::vector<unsigned char> finalRgbData;
-    if (watermarkData_ && watermarkSRV_) {
-        ID3D11Texture2D* videoTex = static_cast<ID3D11Texture2D*>(videoTexture_);
-        ID3D11ShaderResourceView* videoSrv = static_cast<ID3D11ShaderResourceView*>(videoSRV_);
-        ID3D11ShaderResourceView* watermarkSrv = static_cast<ID3D11ShaderResourceView*>(watermarkSRV_);
-        
-        // 创建或更新视频纹理
-        if (!videoTexture_) {
-            if (!d3dProcessor_->CreateTextureFromRGBA(rgbaData.data(), width_, height_, 
-                                                     &videoTex, &videoSrv)) {
-                std::cerr << "创建视频纹理失败" << std::endl;
+        CapturedFrame captured;
+        if (!source_->CaptureFrame(captured)) {
+            std::cerr << "捕获帧失败: " << i << std::endl;
+            // 合成画面和视频回放出错不会自行恢复
+            if (!realtime) {
+                ring_.Abort();
                 return false;
             }
-            videoTexture_ = videoTex;
-            videoSRV_ = videoSrv;
-        } else {
-            // UpdateTextureData期望RGB格式，但我们有RGBA，所以直接使用UpdateSubresource
-            Microsoft::WRL::ComPtr<ID3D11Device> device;
-            videoTex->GetDevice(device.GetAddressOf());
-            
-            Microsoft::WRL::ComPtr<ID3D11DeviceContext> ctx;
-            device->GetImmediateContext(ctx.GetAddressOf());
-            
-            ctx->UpdateSubresource(videoTex, 0, nullptr, rgbaData.data(), width_ * 4, 0);
-        }
-
-        // GPU混合（输出RGB格式）
-        finalRgbData.resize(width_ * height_ * 3);
-        if (!d3dProcessor_->BlendTextures(videoSrv, watermarkSrv, alpha_, 
-                                         finalRgbData.data())) {
-            std::cerr << "GPU混合失败" << std::endl;
+            continue;
+        }
+        if (captured.width != width_ || captured.height != height_) {
+            std::cerr << "画面尺寸发生变化: " << captured.width << "x" << captured.height << std::endl;
+            ring_.Abort();
             return false;
         }
-    } else {
-        // 转换RGBA到RGB
-        finalRgbData.resize(width_ * height_ * 3);
-        for (int i = 0; i < width_ * height_; i++) {
-            finalRgbData[i * 3 + 0] = rgbaData[i * 4 + 0]; // R
-            finalRgbData[i * 3 + 1] = rgbaData[i * 4 + 1]; // G
-            finalRgbData[i * 3 + 2] = rgbaData[i * 4 + 2]; // B
+
+        if (realtime && !overran) {
+            pacer_.OnFrameCaptured(i, captured.timestampUs);
+        }
+
+        // 这一帧的变化先记下来，槽位被丢弃（DropNewest）时留给下一帧
+        pending_.AddFrame(captured);
+
+        // 可变帧率：画面没有变化且距上一次输出不到最大间隔时不输出这一帧；
+        // 最后一个采集时刻采集成功时总是输出（环满时也不丢弃），保证视频时长完整
+        if (vfr_ && pending_.IsEmpty() && !last &&
+            captured.timestampUs - lastEmitUs_ < maxGapUs_) {
+            stats_.skippedFrames++;
+            stats_.captureSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            continue;
+        }
+
+        CaptureSlot* slot = ring_.AcquireWrite(vfr_ && last);
+        if (slot) {
+            // 复用被丢弃的槽位时，它原有的变化区域也要用当前画面重新填充
+            slot->dirty.Add(pending_);
+            pending_.Clear();
+
+            // 来源的缓冲区在下一次采集时会被覆盖，只把变化区域复制到槽位中
+            uint8_t* dst = slot->buffer.Get(static_cast<size_t>(slot->linesize) * height_);
+            for (const FrameRect& rect : slot->dirty.GetRects()) {
+                for (int y = rect.y; y < rect.y + rect.height; y++) {
+                    std::memcpy(dst + static_cast<size_t>(y) * slot->linesize + rect.x * 4,
+                                captured.data + static_cast<size_t>(y) * captured.linesize + rect.x * 4,
+                                static_cast<size_t>(rect.width) * 4);
+                }
+            }
+            slot->index = i;
+            slot->timestampUs = captured.timestampUs;
+            slot->captureStartMs = captureStartMs;
+            ring_.CommitWrite(slot);
+            lastEmitUs_ = captured.timestampUs;
+        } else if (ring_.IsAborted()) {
+            return false;
+        }
+
+        stats_.captureSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        if ((i + 1) % fps_ == 0) {
+            std::cout << "已录制 " << (i + 1) / fps_ << " 秒..." << std::endl;
         }
     }
 
-    // 编码帧
-    AVFrame* rgbFrame = av_frame_alloc();
-    rgbFrame->format = AV_PIX_FMT_RGB24;
-    rgbFrame->width = width_;
-    rgbFrame->height = height_;
-    av_frame_get_buffer(rgbFrame, 0);
+    ring_.Close();
+    return true;
+}
+
+bool ScreenRecorder::EncodeLoop(AllocationMonitor& allocMonitor)
+{
+    while (CaptureSlot* slot = ring_.AcquireRead()) {
+        int queued = adaptive_ ? ring_.GetReadyCount() : 0;
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok = EncodeFrame(*slot);
+        ring_.ReleaseRead(slot);
+        if (!ok) {
+            return false;
+        }
+        if (adaptive_) {
+            // 转换、混合和编码都在这个线程上，一起计入每帧的耗时
+            speed_.OnFrameEncoded(MillisecondsSince(t0), queued);
+        }
+        allocMonitor.OnFrameDone(frameCount_);
 
-    // 逐行复制（考虑linesize）
-    for (int y = 0; y < height_; y++) {
-        memcpy(rgbFrame->data[0] + y * rgbFrame->linesize[0],
-               finalRgbData.data() + y * width_ * 3,
-               width_ * 3);
+        // 保存请求在帧之间处理：快照只增加包的引用，写文件在单独的线程中进行
+        if (replaySeconds_ > 0 && replayRequests_.exchange(0) > 0) {
+            replayClips_++;
+            SaveReplayClip(ReplayClipPath(replayClips_), true);
+        }
     }
+    return !ring_.IsAborted();
+}
 
-    // 转换为YUV420P
-    AVFrame* yuvFrame = av_frame_alloc();
-    yuvFrame->format = AV_PIX_FMT_YUV420P;
-    yuvFrame->width = width_;
-    yuvFrame->height = height_;
-    yuvFrame->pts = frameCount_++;
-    av_frame_get_buffer(yuvFrame, 0);
+bool ScreenRecorder::EncodeFrame(const CaptureSlot& slot)
+{
+    auto t1 = std::chrono::steady_clock::now();
 
-    sws_scale(swsCtx_, rgbFrame->data, rgbFrame->linesize, 0, height_,
-              yuvFrame->data, yuvFrame->linesize);
+    if (!PrepareYuvFrame()) {
+        return false;
+    }
 
-    av_frame_free(&rgbFrame);
+    // 持久的YUV帧保存着上一帧的结果，只重新转换、混合变化的区域；
+    // 上一帧绘制的动态层先还原成原来的画面，变化区域在此基础上转换
+    CopyOverlayBackground(false);
+    const std::vector<FrameRect>& rects = slot.dirty.GetRects();
+    for (const FrameRect& rect : rects) {
+        ConvertRegion(slot, rect);
+    }
+    // 静态logo只在重新转换的区域内重新混合（重叠的变化区域每个像素只混合一次），其余区域保留上一帧的结果
+    if (layers_.HasStaticLogos()) {
+        LayerTarget target = { yuvFrame_->data, yuvFrame_->linesize, 1, 1, false, false };
+        layers_.DrawStaticLogos(target, rects.data(), rects.size(), width_, height_);
+    }
+    stats_.dirtyPixels += slot.dirty.GetArea();
+    if (slot.dirty.IsFull()) {
+        stats_.fullFrames++;
+    } else if (slot.dirty.IsEmpty()) {
+        stats_.unchangedFrames++;
+    }
+
+    int64_t pts = NextPts(slot);
+    yuvFrame_->pts = pts;
+    if (layers_.HasDynamicLayers()) {
+        DrawDynamicLayers(slot);
+    }
+
+    // GOP边界：固定帧率每gop_size帧，可变帧率在按时间强制的关键帧处
+    bool gopStart = vfr_ ? yuvFrame_->pict_type == AV_PICTURE_TYPE_I : frameCount_ % codecCtx_->gop_size == 0;
+    if (adaptive_ && gopStart && frameCount_ > 0 && speed_.OnGopBoundary() && !ReopenEncoder()) {
+        return false;
+    }
 
-    // 编码
-    int ret = avcodec_send_frame(codecCtx_, yuvFrame);
-    av_frame_free(&yuvFrame);
+    PendingLatency& pending = captureStart_[pts % captureStart_.size()];
+    pending.pts = pts;
+    pending.captureStartMs = slot.captureStartMs;
+    frameCount_++;
 
+    auto t2 = std::chrono::steady_clock::now();
+
+    // 编码：编码器只增加引用，yuvFrame_继续由这里持有
+    int ret = avcodec_send_frame(codecCtx_, yuvFrame_);
     if (ret < 0) {
         std::cerr << "发送帧到编码器失败" << std::endl;
         return false;
     }
 
-    // 接收编码后的包
-    AVPacket* pkt = av_packet_alloc();
-    while (ret >= 0) {
-        ret = avcodec_receive_packet(codecCtx_, pkt);
+    bool ok = ReceivePackets();
+
+    auto t3 = std::chrono::steady_clock::now();
+    stats_.frames++;
+    stats_.convertSeconds += std::chrono::duration<double>(t2 - t1).count();
+    stats_.encodeSeconds += std::chrono::duration<double>(t3 - t2).count();
+    return ok;
+}
+
+int64_t ScreenRecorder::NextPts(const CaptureSlot& slot)
+{
+    if (lastPts_ < 0) {
+        firstTimestampUs_ = slot.timestampUs;
+    }
+
+    if (!vfr_) {
+        // pts取自采集时间戳，四舍五入到最近的帧时刻，而不是计划的采集序号：
+        // 醒来晚了或采集耗时长的帧记在它实际采集的时刻上；错过和丢掉的时刻在输出中
+        // 表现为上一帧多显示一段时间。两帧落在同一时刻时顺延一帧保证递增
+        int64_t pts = ((slot.timestampUs - firstTimestampUs_) * fps_ + 500000) / 1000000;
+        lastPts_ = std::max(pts, lastPts_ + 1);
+        return lastPts_;
+    }
+
+    // 可变帧率：pts是相对第一帧的采集时间（毫秒），同一毫秒内的两帧顺延1毫秒保证递增
+    int64_t pts = std::max((slot.timestampUs - firstTimestampUs_) / 1000, lastPts_ + 1);
+    lastPts_ = pts;
+
+    // gop_size按帧数计，画面静止时两个关键帧之间可能相隔几十秒；
+    // 改为按时间计，距上一个关键帧满1秒时强制关键帧，便于拖动定位
+    if (pts == 0 || pts - lastKeyPts_ >= 1000) {
+        yuvFrame_->pict_type = AV_PICTURE_TYPE_I;
+        lastKeyPts_ = pts;
+    } else {
+        yuvFrame_->pict_type = AV_PICTURE_TYPE_NONE;
+    }
+    return pts;
+}
+
+void ScreenRecorder::DrawDynamicLayers(const CaptureSlot& slot)
+{
+    // 帧号是输出的第几帧，媒体时间是相对第一帧的采集时间；先保存所有包围盒的背景再绘制，
+    // 重叠的层保存的都是没有动态层的画面
+    int64_t mediaTimeMs = (slot.timestampUs - firstTimestampUs_) / 1000;
+    overlayRects_ = layers_.Prepare(frameCount_, mediaTimeMs, width_, height_);
+    CopyOverlayBackground(true);
+
+    LayerTarget target = { yuvFrame_->data, yuvFrame_->linesize, 1, 1, false, false };
+    layers_.Draw(target);
+}
+
+void ScreenRecorder::CopyOverlayBackground(bool save)
+{
+    // 每个包围盒的Y矩形和对应的U/V矩形依次存放；矩形起点为偶数，宽高为奇数时（画面边缘）色度向上取整。
+    // 还原时按相反的顺序，重叠区域最后写回的是最先保存的背景
+    std::vector<size_t>& offsets = overlayOffsets_;
+    offsets.assign(overlayRects_.size() + 1, 0);
+    for (size_t i = 0; i < overlayRects_.size(); i++) {
+        const FrameRect& rect = overlayRects_[i];
+        size_t lumaSize = static_cast<size_t>(rect.width) * rect.height;
+        size_t chromaSize = static_cast<size_t>((rect.width + 1) >> 1) * ((rect.height + 1) >> 1);
+        offsets[i + 1] = offsets[i] + lumaSize + 2 * chromaSize;
+    }
+    if (save && overlayBackground_.size() < offsets.back()) {
+        overlayBackground_.resize(offsets.back());
+        RecordAllocation(offsets.back());
+    }
+
+    for (size_t n = 0; n < overlayRects_.size(); n++) {
+        size_t i = save ? n : overlayRects_.size() - 1 - n;
+        const FrameRect& rect = overlayRects_[i];
+        size_t offset = offsets[i];
+        for (int p = 0; p < 3; p++) {
+            int shift = p == 0 ? 0 : 1;
+            int x = rect.x >> shift;
+            int y = rect.y >> shift;
+            int w = (rect.width + shift) >> shift;
+            int h = (rect.height + shift) >> shift;
+            for (int row = 0; row < h; row++) {
+                uint8_t* frameRow = yuvFrame_->data[p] + static_cast<size_t>(y + row) * yuvFrame_->linesize[p] + x;
+                uint8_t* saved = overlayBackground_.data() + offset;
+                if (save) {
+                    std::memcpy(saved, frameRow, w);
+                } else {
+                    std::memcpy(frameRow, saved, w);
+                }
+                offset += w;
+            }
+        }
+    }
+}
+
+bool ScreenRecorder::PrepareYuvFrame()
+{
+    if (!yuvFrame_) {
+        yuvFrame_ = yuvPool_.Acquire();
+        return yuvFrame_ != nullptr;
+    }
+    if (av_frame_is_writable(yuvFrame_)) {
+        return true;
+    }
+
+    // 编码器还持有上一帧的引用（例如带lookahead的编码器），不能原地修改：
+    // 换一个池中的帧并复制上一帧的内容。x264在send_frame时就复制了输入，通常不会走到这里
+    AVFrame* next = yuvPool_.Acquire();
+    if (!next) {
+        return false;
+    }
+    av_frame_copy(next, yuvFrame_);
+    av_frame_free(&yuvFrame_);
+    yuvFrame_ = next;
+    stats_.yuvCopies++;
+    return true;
+}
+
+void ScreenRecorder::ConvertRegion(const CaptureSlot& slot, const FrameRect& rect)
+{
+    // DirtyRegion中的矩形已经扩展到偶数边界，每两行调用一次融合内核：
+    // 读BGRA、混合水印、写Y/U/V都在同一遍里完成，没有中间缓冲区
+    const BlendKernels& kernels = GetBlendKernels();
+    bool tiled = watermarkTiled_ && blendWidth_ > 0;
+    int end = rect.x + rect.width;
+
+    for (int y = rect.y; y < rect.y + rect.height; y += 2) {
+        // 高度为奇数时最后一行与自己配对
+        int rowY[2] = { y, std::min(y + 1, height_ - 1) };
+
+        // 平铺时在单元边界处分段，每段的水印从单元中按取模的位置取；
+        // 单元宽度和矩形起点都是偶数，每段都从偶数列开始，2x2色度块不会被切开
+        for (int x = rect.x; x < end; ) {
+            int count = end - x;
+            int wmX = x;
+            int wmCount = std::max(0, std::min(count, blendWidth_ - x));
+            if (tiled) {
+                wmX = x % blendWidth_;
+                count = std::min(count, blendWidth_ - wmX);
+                wmCount = count;
+            }
+
+            BgraToYuvRows rows;
+            for (int r = 0; r < 2; r++) {
+                int wmY = tiled ? rowY[r] % blendHeight_ : rowY[r];
+                bool watermarked = wmCount > 0 && wmY < blendHeight_;
+                rows.bgra[r] = slot.buffer.Data() + static_cast<size_t>(rowY[r]) * slot.linesize + x * 4;
+                rows.pm[r] = watermarked ? blendPlan_.PremulRow(wmY) + wmX * 4 : nullptr;
+                rows.inv[r] = watermarked ? blendPlan_.InvRow(wmY) + wmX * 4 : nullptr;
+                rows.y[r] = yuvFrame_->data[0] + static_cast<size_t>(rowY[r]) * yuvFrame_->linesize[0] + x;
+            }
+            rows.u = yuvFrame_->data[1] + static_cast<size_t>(y / 2) * yuvFrame_->linesize[1] + x / 2;
+            rows.v = yuvFrame_->data[2] + static_cast<size_t>(y / 2) * yuvFrame_->linesize[2] + x / 2;
+            kernels.bgraToYuv420(rows, count, rows.pm[0] ? wmCount : 0);
+            x += count;
+        }
+    }
+}
+
+bool ScreenRecorder::ReceivePackets()
+{
+    while (true) {
+        int ret = avcodec_receive_packet(codecCtx_, packet_);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
+            return true;
         } else if (ret < 0) {
             std::cerr << "接收编码包失败" << std::endl;
-            av_packet_free(&pkt);
             return false;
         }
 
-        av_packet_rescale_ts(pkt, codecCtx_->time_base, videoStream_->time_base);
-        pkt->stream_index = videoStream_->index;
-        
-        ret = av_interleaved_write_frame(formatCtx_, pkt);
-        av_packet_unref(pkt);
+        // 延迟算到包写入文件为止，先按编码器的time_base取出对应的采集时间
+        const PendingLatency* pending = nullptr;
+        if (packet_->pts >= 0) {
+            pending = &captureStart_[packet_->pts % captureStart_.size()];
+            if (pending->pts != packet_->pts) {
+                pending = nullptr;
+            }
+        }
+
+        // 换编码器后新编码器的dts从它自己的起点算起，可变帧率时个别情况下不大于上一个包；
+        // 这时调整到上一个dts之后；pts不大于上一个dts时无法调整（dts不能大于pts），报错停止，不把无效的包交给封装器
+        if (adaptive_ && packet_->dts != AV_NOPTS_VALUE) {
+            if (lastDts_ != AV_NOPTS_VALUE && packet_->dts <= lastDts_) {
+                if (packet_->pts != AV_NOPTS_VALUE && packet_->pts <= lastDts_) {
+                    std::cerr << "换档后dts无法保持递增: pts " << packet_->pts << ", 上一个dts " << lastDts_ << std::endl;
+                    av_packet_unref(packet_);
+                    return false;
+                }
+                packet_->dts = lastDts_ + 1;
+            }
+            lastDts_ = packet_->dts;
+        }
+
+        bool ok = true;
+        if (replaySeconds_ > 0) {
+            // 即时回放：包保存在内存中，时间戳保持编码器的time_base
+            ok = replay_.Append(packet_);
+        } else {
+            av_packet_rescale_ts(packet_, codecCtx_->time_base, videoStream_->time_base);
+            packet_->stream_index = videoStream_->index;
+
+            // 只有一个流，不需要交错；低延迟模式下av_write_frame返回时包已经刷新到文件
+            if (av_write_frame(formatCtx_, packet_) < 0) {
+                std::cerr << "写入数据包失败" << std::endl;
+                ok = false;
+            }
+        }
+        av_packet_unref(packet_);
+        if (!ok) {
+            return false;
+        }
+
+        if (pending) {
+            double latencyMs = MillisecondsSince(startTime_) - pending->captureStartMs;
+            stats_.latencyMs.push_back(latencyMs);
+            latency_.Add(latencyMs);
+        }
+    }
+}
+
+bool ScreenRecorder::SaveReplayClip(const std::string& path, bool background)
+{
+    std::unique_ptr<ReplayClip> clip(new ReplayClip());
+    if (!replay_.Snapshot(*clip)) {
+        std::cerr << "即时回放缓冲为空，没有可保存的内容" << std::endl;
+        return false;
+    }
+
+    // 同一时刻只有一个写入线程，上一个片段还没写完时先等它
+    if (replaySaver_.joinable()) {
+        replaySaver_.join();
+    }
+
+    std::cout << "保存最近 " << clip->GetDurationMs() / 1000.0 << " 秒 (" << clip->GetPacketCount() << " 个包, "
+              << clip->GetBytes() / 1024 << " KB) 到 " << path << std::endl;
+    if (!background) {
+        if (!clip->WriteToFile(path)) {
+            std::cerr << "保存即时回放失败: " << path << std::endl;
+            return false;
+        }
+        return true;
     }
-    av_packet_free(&pkt);
 
+    replaySaver_ = std::thread([clip = std::move(clip), path] {
+        if (!clip->WriteToFile(path)) {
+            std::cerr << "保存即时回放失败: " << path << std::endl;
+        }
+    });
     return true;
 }
 
+std::string ScreenRecorder::ReplayClipPath(int index) const
+{
+    // output.mp4 -> output_replay_1.mp4
+    size_t dot = outputPath_.find_last_of('.');
+    size_t slash = outputPath_.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = outputPath_.size();
+    }
+    return outputPath_.substr(0, dot) + "_replay_" + std::to_string(index) + outputPath_.substr(dot);
+}
+
+void ScreenRecorder::PrintStats() const
+{
+    if (stats_.frames == 0 || stats_.wallSeconds <= 0.0) {
+        return;
+    }
+
+    double frames = static_cast<double>(stats_.frames);
+    std::cout << "=== 录制统计 (来源: " << source_->GetName() << ") ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "总计 " << stats_.frames << " 帧, 用时 " << stats_.wallSeconds << " 秒, "
+              << frames / stats_.wallSeconds << " fps" << std::endl;
+    CaptureRingStats ring = ring_.GetStats();
+    std::cout << "采集 " << ring.captured << " 帧, 丢弃 " << ring.dropped << " 帧, 编码 " << ring.encoded << " 帧";
+    if (pacer_.GetMissedTicks() > 0) {
+        std::cout << ", 错过采集时刻 " << pacer_.GetMissedTicks() << " 次";
+    }
+    if (ring.blocked > 0) {
+        std::cout << ", 采集线程等待 " << ring.blocked << " 次";
+    }
+    std::cout << " (" << DropPolicyName(ring_.GetPolicy()) << ")" << std::endl;
+    if (vfr_) {
+        std::cout << "可变帧率: 输出 " << stats_.frames << " 帧, 跳过未变化的采集时刻 " << stats_.skippedFrames
+                  << " 次, 保活/结尾帧 " << stats_.unchangedFrames << " 帧, 输出平均帧率 "
+                  << frames * 1000.0 / std::max<int64_t>(lastPts_, 1) << " fps" << std::endl;
+    }
+    std::cout << "变化区域: 平均每帧 " << stats_.dirtyPixels * 100.0 / (frames * width_ * height_)
+              << "% 的画面, 整帧处理 " << stats_.fullFrames << " 帧";
+    if (!vfr_ && stats_.unchangedFrames > 0) {
+        std::cout << ", 未变化 " << stats_.unchangedFrames << " 帧";
+    }
+    if (stats_.yuvCopies > 0) {
+        std::cout << ", 编码器占用时复制YUV帧 " << stats_.yuvCopies << " 次";
+    }
+    std::cout << std::endl;
+    if (replaySeconds_ > 0) {
+        ReplayBufferStats replay = replay_.GetStats();
+        std::cout << "即时回放: 缓冲 " << replay.gops << " 个GOP, " << replay.durationMs / 1000.0 << " 秒, "
+                  << replay.packets << " 个包, 占用 " << replay.bytes / (1024.0 * 1024.0)
+                  << " MB (峰值 " << replay.peakBytes / (1024.0 * 1024.0) << " MB), 淘汰 "
+                  << replay.evictedGops << " 个GOP";
+        if (replay.memoryEvictions > 0) {
+            std::cout << ", 内存超限提前淘汰 " << replay.memoryEvictions << " 个GOP";
+        }
+        std::cout << ", 保存片段 " << replayClips_ << " 个" << std::endl;
+    }
+    std::cout << "每帧平均: 采集 " << stats_.captureSeconds * 1000.0 / std::max<int64_t>(ring.captured + stats_.skippedFrames, 1)
+              << " ms, 转换+混合 " << stats_.convertSeconds * 1000.0 / frames
+              << " ms, 编码 " << stats_.encodeSeconds * 1000.0 / frames << " ms" << std::endl;
+
+    if (!stats_.latencyMs.empty()) {
+        std::vector<double> sorted = stats_.latencyMs;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](double p) {
+            size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+            return sorted[index];
+        };
+        double sum = 0.0;
+        for (double v : sorted) {
+            sum += v;
+        }
+        std::cout << "延迟(开始采集->写入文件): 平均 " << sum / sorted.size()
+                  << " ms, P50 " << percentile(0.50)
+                  << " ms, P95 " << percentile(0.95)
+                  << " ms, P99 " << percentile(0.99)
+                  << " ms, 最大 " << sorted.back() << " ms" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+
+    if (adaptive_) {
+        speed_.PrintSummary();
+    }
+    layers_.PrintSummary();
+    latency_.Print("延迟分布", "ms");
+    if (latencySloMs_ > 0 && latency_.GetCount() > 0) {
+        int64_t over = latency_.CountAtLeast(latencySloMs_);
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "延迟目标 " << latencySloMs_ << " ms: 超过 " << over << " 帧 ("
+                  << over * 100.0 / latency_.GetCount() << "%)" << (over == 0 ? ", 达标" : ", 未达标") << std::endl;
+        std::cout << std::defaultfloat;
+    }
+}
+
 void ScreenRecorder::Cleanup()
 {
-    if (swsCtx_) {
-        sws_freeContext(swsCtx_);
-        swsCtx_ = nullptr;
+    if (replaySaver_.joinable()) {
+        replaySaver_.join();
+    }
+    replay_.Clear();
+
+    if (yuvFrame_) {
+        av_frame_free(&yuvFrame_);
+    }
+
+    if (packet_) {
+        av_packet_free(&packet_);
     }
 
     if (codecCtx_) {
@@ -424,14 +960,5 @@ void ScreenRecorder::Cleanup()
         formatCtx_ = nullptr;
     }
 
-    if (d3dProcessor_) {
-        delete d3dProcessor_;
-        d3dProcessor_ = nullptr;
-    }
-
-    if (capture_) {
-        delete capture_;
-        capture_ = nullptr;
-    }
+    source_.reset();
 }
-
@@ -0,0 +1,678 @@
+#include "SegmentParallelProcessor.h"
+#include <iostream>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+// 每个工作线程平均分到的分段数，分段更细时各线程的结束时间更接近
+static const int kSegmentsPerWorker = 4;
+
+SegmentParallelProcessor::SegmentParallelProcessor()
+    : sourceTimeBase_{ 1, 1 }
+    , sourceStartTime_(0)
+    , sourceCodecId_(AV_CODEC_ID_NONE)
+{
+}
+
+SegmentParallelProcessor::~SegmentParallelProcessor()
+{
+    RemoveSegmentFiles();
+}
+
+// H.264关键帧数据包中是否有IDR片（NAL类型5）
+// 开放GOP的关键帧是带恢复点的普通I片，解码顺序在它之后的前导帧仍然参考上一个GOP
+static bool IsH264IdrPacket(const AVPacket* packet, const AVCodecParameters* par)
+{
+    const uint8_t* data = packet->data;
+    int size = packet->size;
+    if (par->extradata_size >= 5 && par->extradata[0] == 1) {
+        // avcC：每个NAL前面是lengthSizeMinusOne+1字节的长度
+        int lengthSize = (par->extradata[4] & 3) + 1;
+        for (int pos = 0; pos + lengthSize < size;) {
+            int64_t length = 0;
+            for (int i = 0; i < lengthSize; i++) {
+                length = (length << 8) | data[pos + i];
+            }
+            pos += lengthSize;
+            if (length <= 0 || length > size - pos) {
+                break;
+            }
+            if ((data[pos] & 0x1f) == 5) {
+                return true;
+            }
+            pos += static_cast<int>(length);
+        }
+        return false;
+    }
+
+    // Annex B：NAL头在00 00 01起始码之后
+    for (int pos = 0; pos + 3 < size; pos++) {
+        if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1) {
+            if ((data[pos + 3] & 0x1f) == 5) {
+                return true;
+            }
+            pos += 2;
+        }
+    }
+    return false;
+}
+
+bool SegmentParallelProcessor::ScanKeyframes(const std::string& inputPath)
+{
+    AVFormatContext* formatCtx = nullptr;
+    if (avformat_open_input(&formatCtx, inputPath.c_str(), nullptr, nullptr) < 0) {
+        std::cerr << "无法打开输入文件: " << inputPath << std::endl;
+        return false;
+    }
+    if (avformat_find_stream_info(formatCtx, nullptr) < 0) {
+        std::cerr << "无法获取流信息" << std::endl;
+        avformat_close_input(&formatCtx);
+        return false;
+    }
+
+    int streamIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (streamIndex < 0) {
+        std::cerr << "未找到视频流" << std::endl;
+        avformat_close_input(&formatCtx);
+        return false;
+    }
+
+    AVStream* stream = formatCtx->streams[streamIndex];
+    sourceTimeBase_ = stream->time_base;
+    sourceStartTime_ = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    sourceCodecId_ = stream->codecpar->codec_id;
+
+    // 只需要视频包的标志和时间戳，其它流直接丢弃
+    for (unsigned int i = 0; i < formatCtx->nb_streams; i++) {
+        if (static_cast<int>(i) != streamIndex) {
+            formatCtx->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    gopStartPts_.clear();
+    gopFrames_.clear();
+    gopClosed_.clear();
+
+    AVPacket* packet = av_packet_alloc();
+    while (av_read_frame(formatCtx, packet) >= 0) {
+        if (packet->stream_index == streamIndex) {
+            int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+            // 时间戳必须递增才能作为分段边界
+            bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0 && pts != AV_NOPTS_VALUE &&
+                       (gopStartPts_.empty() || pts > gopStartPts_.back());
+            if (key) {
+                gopStartPts_.push_back(pts);
+                gopFrames_.push_back(0);
+                gopClosed_.push_back(sourceCodecId_ != AV_CODEC_ID_H264 || IsH264IdrPacket(packet, stream->codecpar));
+            }
+            if (!gopFrames_.empty()) {
+                gopFrames_.back()++;
+            }
+        }
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    avformat_close_input(&formatCtx);
+
+    if (gopStartPts_.empty()) {
+        std::cerr << "输入中没有找到关键帧" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void SegmentParallelProcessor::AddSegment(int firstGop, int endGop, bool copy, const std::string& outputPath)
+{
+    int gopCount = static_cast<int>(gopStartPts_.size());
+
+    VideoSegment segment;
+    segment.index = static_cast<int>(segments_.size());
+    segment.frames = 0;
+    for (int gop = firstGop; gop < endGop; gop++) {
+        segment.frames += gopFrames_[gop];
+    }
+
+    // 第一段从文件开头开始，最后一段到文件末尾
+    segment.range.startPts = firstGop == 0 ? AV_NOPTS_VALUE : gopStartPts_[firstGop];
+    segment.range.endPts = endGop < gopCount ? gopStartPts_[endGop] : AV_NOPTS_VALUE;
+    segment.copy = copy;
+
+    // 直接复制的段不经过临时文件
+    if (!copy) {
+        std::filesystem::path output(outputPath);
+        std::ostringstream suffix;
+        suffix << ".seg" << std::setw(3) << std::setfill('0') << segment.index << output.extension().string();
+        std::filesystem::path segmentPath = output;
+        segmentPath.replace_extension(suffix.str());
+        segment.path = segmentPath.string();
+    }
+
+    segments_.push_back(segment);
+}
+
+void SegmentParallelProcessor::BuildSegments(const std::string& outputPath, int workerCount)
+{
+    int64_t totalFrames = 0;
+    for (int64_t frames : gopFrames_) {
+        totalFrames += frames;
+    }
+
+    int gopCount = static_cast<int>(gopStartPts_.size());
+    int targetCount = std::max(1, std::min(workerCount * kSegmentsPerWorker, gopCount));
+    int64_t framesPerSegment = (totalFrames + targetCount - 1) / targetCount;
+
+    segments_.clear();
+    int gop = 0;
+    while (gop < gopCount) {
+        int first = gop;
+        int64_t frames = 0;
+        while (gop < gopCount && (gop == first || frames < framesPerSegment)) {
+            frames += gopFrames_[gop++];
+        }
+        AddSegment(first, gop, false, outputPath);
+    }
+
+    std::cout << "关键帧扫描: " << gopCount << " 个GOP, " << totalFrames << " 帧, 切分为 "
+              << segments_.size() << " 段" << std::endl;
+}
+
+void SegmentParallelProcessor::BuildRangeSegments(const std::string& outputPath, int workerCount)
+{
+    int gopCount = static_cast<int>(gopStartPts_.size());
+
+    // 标记与任一区间重叠的GOP，GOP i 覆盖 [gopStartPts_[i], gopStartPts_[i+1])
+    // 区间从视频开头算起，时间戳先减去视频流的start_time
+    std::vector<bool> overlaps(gopCount, false);
+    for (int gop = 0; gop < gopCount; gop++) {
+        double gopStart = (gopStartPts_[gop] - sourceStartTime_) * av_q2d(sourceTimeBase_);
+        double gopEnd = gop + 1 < gopCount ? (gopStartPts_[gop + 1] - sourceStartTime_) * av_q2d(sourceTimeBase_)
+                                           : std::numeric_limits<double>::infinity();
+        for (const TimeRange& range : ranges_) {
+            if (gopStart < range.end && gopEnd > range.start) {
+                overlaps[gop] = true;
+                break;
+            }
+        }
+    }
+
+    // 开放GOP的前导帧参考上一个GOP：重新编码段之后的复制段从开放GOP开始时，前导帧参考的是重新编码过的画面；
+    // 复制段之后的重新编码段从开放GOP开始时，前导帧既不在复制段里，也无法单独解码。
+    // 所以复制段和重新编码段的边界只能落在IDR上，否则把边界外的GOP并入重新编码，直到遇到IDR
+    int extendedGops = 0;
+    for (int gop = 1; gop < gopCount; gop++) {
+        if (overlaps[gop - 1] && !overlaps[gop] && !gopClosed_[gop]) {
+            overlaps[gop] = true;
+            extendedGops++;
+        }
+    }
+    for (int gop = gopCount - 1; gop > 0; gop--) {
+        if (overlaps[gop] && !overlaps[gop - 1] && !gopClosed_[gop]) {
+            overlaps[gop - 1] = true;
+            extendedGops++;
+        }
+    }
+
+    int64_t processFrames = 0;
+    int64_t totalFrames = 0;
+    for (int gop = 0; gop < gopCount; gop++) {
+        totalFrames += gopFrames_[gop];
+        if (overlaps[gop]) {
+            processFrames += gopFrames_[gop];
+        }
+    }
+
+    // 需要重新编码的帧仍按工作线程数切细，直接复制的连续GOP合成一段
+    int targetCount = std::max(1, workerCount * kSegmentsPerWorker);
+    int64_t framesPerSegment = std::max<int64_t>(1, (processFrames + targetCount - 1) / targetCount);
+
+    segments_.clear();
+    int gop = 0;
+    while (gop < gopCount) {
+        int first = gop;
+        bool copy = !overlaps[gop];
+        int64_t frames = 0;
+        while (gop < gopCount && overlaps[gop] == !copy &&
+               (copy || gop == first || frames < framesPerSegment)) {
+            frames += gopFrames_[gop++];
+        }
+        AddSegment(first, gop, copy, outputPath);
+    }
+
+    std::cout << "关键帧扫描: " << gopCount << " 个GOP, " << totalFrames << " 帧；与 "
+              << ranges_.size() << " 个区间重叠的 " << processFrames << " 帧重新编码，其余直接复制" << std::endl;
+    if (extendedGops > 0) {
+        std::cout << "开放GOP: 区间边界不在IDR上，另外重新编码 " << extendedGops << " 个相邻GOP" << std::endl;
+    }
+}
+
+bool SegmentParallelProcessor::RunWorkers(int workerCount, const SegmentWorkFn& work)
+{
+    std::atomic<int> nextSegment(0);
+    std::atomic<bool> failed(false);
+    workerStats_.assign(workerCount, WorkerStats{ 0, 0, 0.0 });
+
+    auto worker = [&](int workerIndex) {
+        WorkerStats& stats = workerStats_[workerIndex];
+        while (!failed.load()) {
+            int index = nextSegment.fetch_add(1);
+            if (index >= static_cast<int>(segments_.size())) {
+                break;
+            }
+
+            const VideoSegment& segment = segments_[index];
+            if (segment.copy) {
+                continue;
+            }
+            auto start = std::chrono::steady_clock::now();
+            if (!work(segment)) {
+                std::cerr << "分段 " << segment.index << " 处理失败" << std::endl;
+                failed.store(true);
+                break;
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            stats.segments++;
+            stats.frames += segment.frames;
+            stats.seconds += elapsed.count();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workerCount; i++) {
+        threads.emplace_back(worker, i);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    return !failed.load();
+}
+
+// 把编码参数中的SPS/PPS转换成与数据包相同格式的NAL序列
+// extradata是avcC（MP4/MKV）时转换为4字节长度前缀；是Annex B（TS等）时原样使用
+static bool BuildParameterSets(const AVCodecParameters* par, std::vector<uint8_t>& out)
+{
+    out.clear();
+    const uint8_t* data = par->extradata;
+    int size = par->extradata_size;
+    if (!data || size <= 0) {
+        // 没有全局头时参数集已经在关键帧数据包里
+        return true;
+    }
+    if (data[0] != 1) {
+        out.assign(data, data + size);
+        return true;
+    }
+
+    // avcC: version, profile, compat, level, 0xFC|lengthSizeMinusOne, 0xE0|numSPS, {len16, sps}..., numPPS, {len16, pps}...
+    if (size < 7 || (data[4] & 3) != 3) {
+        std::cerr << "不支持的avcC（NAL长度字段不是4字节）" << std::endl;
+        return false;
+    }
+    int pos = 5;
+    for (int set = 0; set < 2; set++) {
+        if (pos >= size) {
+            return false;
+        }
+        int count = set == 0 ? (data[pos] & 0x1f) : data[pos];
+        pos++;
+        for (int i = 0; i < count; i++) {
+            if (pos + 2 > size) {
+                return false;
+            }
+            int length = (data[pos] << 8) | data[pos + 1];
+            pos += 2;
+            if (pos + length > size) {
+                return false;
+            }
+            out.push_back(static_cast<uint8_t>(length >> 24));
+            out.push_back(static_cast<uint8_t>(length >> 16));
+            out.push_back(static_cast<uint8_t>(length >> 8));
+            out.push_back(static_cast<uint8_t>(length));
+            out.insert(out.end(), data + pos, data + pos + length);
+            pos += length;
+        }
+    }
+    return true;
+}
+
+// 在数据包前面插入参数集
+static bool PrependToPacket(AVPacket* packet, const std::vector<uint8_t>& prefix)
+{
+    if (prefix.empty()) {
+        return true;
+    }
+    AVPacket* merged = av_packet_alloc();
+    if (!merged || av_new_packet(merged, static_cast<int>(prefix.size()) + packet->size) < 0) {
+        av_packet_free(&merged);
+        return false;
+    }
+    memcpy(merged->data, prefix.data(), prefix.size());
+    memcpy(merged->data + prefix.size(), packet->data, packet->size);
+    av_packet_copy_props(merged, packet);
+    av_packet_unref(packet);
+    av_packet_move_ref(packet, merged);
+    av_packet_free(&merged);
+    return true;
+}
+
+bool SegmentParallelProcessor::StitchSegments(const std::string& inputPath, const std::string& outputPath)
+{
+    // 分段文件只有视频；音频等其他流从原始输入直通，按时间戳与视频包交错写入
+    AVFormatContext* sourceCtx = nullptr;
+    if (avformat_open_input(&sourceCtx, inputPath.c_str(), nullptr, nullptr) < 0 ||
+        avformat_find_stream_info(sourceCtx, nullptr) < 0) {
+        std::cerr << "无法打开输入文件: " << inputPath << std::endl;
+        avformat_close_input(&sourceCtx);
+        return false;
+    }
+    int sourceVideoIndex = av_find_best_stream(sourceCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (sourceVideoIndex < 0) {
+        std::cerr << "未找到视频流" << std::endl;
+        avformat_close_input(&sourceCtx);
+        return false;
+    }
+
+    AVFormatContext* outputCtx = nullptr;
+    avformat_alloc_output_context2(&outputCtx, nullptr, nullptr, outputPath.c_str());
+    if (!outputCtx) {
+        std::cerr << "无法创建输出上下文" << std::endl;
+        avformat_close_input(&sourceCtx);
+        return false;
+    }
+
+    StreamPassthrough passthrough;
+    // 区间模式下直接复制的GOP从原始输入读取，与直通用的sourceCtx分开，各自顺序读取
+    AVFormatContext* copyCtx = nullptr;
+    bool rangeMode = !ranges_.empty();
+
+    AVStream* outStream = nullptr;
+    AVPacket* packet = av_packet_alloc();
+    int64_t lastDts = AV_NOPTS_VALUE;
+    bool ok = true;
+
+    for (const VideoSegment& segment : segments_) {
+        AVFormatContext* inputCtx = nullptr;
+        int streamIndex = -1;
+        if (segment.copy) {
+            if (!copyCtx) {
+                if (avformat_open_input(&copyCtx, inputPath.c_str(), nullptr, nullptr) < 0 ||
+                    avformat_find_stream_info(copyCtx, nullptr) < 0) {
+                    std::cerr << "无法打开输入文件: " << inputPath << std::endl;
+                    ok = false;
+                    break;
+                }
+                for (unsigned int i = 0; i < copyCtx->nb_streams; i++) {
+                    if (static_cast<int>(i) != sourceVideoIndex) {
+                        copyCtx->streams[i]->discard = AVDISCARD_ALL;
+                    }
+                }
+            }
+            if (!SeekToSegment(copyCtx, sourceVideoIndex, segment.range)) {
+                ok = false;
+                break;
+            }
+            inputCtx = copyCtx;
+            streamIndex = sourceVideoIndex;
+        } else {
+            if (avformat_open_input(&inputCtx, segment.path.c_str(), nullptr, nullptr) < 0 ||
+                avformat_find_stream_info(inputCtx, nullptr) < 0) {
+                std::cerr << "无法打开分段文件: " << segment.path << std::endl;
+                avformat_close_input(&inputCtx);
+                ok = false;
+                break;
+            }
+            streamIndex = av_find_best_stream(inputCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+            if (streamIndex < 0) {
+                std::cerr << "分段文件中没有视频流: " << segment.path << std::endl;
+                avformat_close_input(&inputCtx);
+                ok = false;
+                break;
+            }
+        }
+        AVStream* inStream = inputCtx->streams[streamIndex];
+        auto closeInput = [&]() {
+            if (inputCtx != copyCtx) {
+                avformat_close_input(&inputCtx);
+            }
+        };
+
+        if (!outStream) {
+            // 各分段的编码参数相同，由第一段决定输出流参数；
+            // 区间模式下以原始输入为准，重新编码的段在关键帧前带上自己的参数集
+            const AVCodecParameters* par = rangeMode ? sourceCtx->streams[sourceVideoIndex]->codecpar
+                                                     : inStream->codecpar;
+            outStream = avformat_new_stream(outputCtx, nullptr);
+            if (!outStream || avcodec_parameters_copy(outStream->codecpar, par) < 0) {
+                std::cerr << "无法创建输出流" << std::endl;
+                closeInput();
+                ok = false;
+                break;
+            }
+            outStream->codecpar->codec_tag = 0;
+            outStream->time_base = inStream->time_base;
+
+            if (!passthrough.Setup(sourceCtx, outputCtx, sourceVideoIndex, true)) {
+                closeInput();
+                ok = false;
+                break;
+            }
+            // 视频包来自分段文件或copyCtx，直通用的sourceCtx解复用时跳过视频流
+            sourceCtx->streams[sourceVideoIndex]->discard = AVDISCARD_ALL;
+
+            if (!(outputCtx->oformat->flags & AVFMT_NOFILE)) {
+                if (avio_open(&outputCtx->pb, outputPath.c_str(), AVIO_FLAG_WRITE) < 0) {
+                    std::cerr << "无法打开输出文件: " << outputPath << std::endl;
+                    closeInput();
+                    ok = false;
+                    break;
+                }
+            }
+            if (avformat_write_header(outputCtx, nullptr) < 0) {
+                std::cerr << "写入文件头失败" << std::endl;
+                closeInput();
+                ok = false;
+                break;
+            }
+        }
+
+        // 区间模式下直接复制的段和重新编码的段的SPS/PPS不同，每段第一个包前插入本段的参数集
+        std::vector<uint8_t> parameterSets;
+        if (rangeMode && !BuildParameterSets(inStream->codecpar, parameterSets)) {
+            std::cerr << "无法解析分段的编码参数: " << segment.index << std::endl;
+            closeInput();
+            ok = false;
+            break;
+        }
+
+        // 保持原始输入的时间线：直接复制的段时间戳不变；
+        // 重新编码的段的时间戳可能被容器平移过，以第一个包为基准对齐到分段在原始输入中的起点
+        bool firstPacket = true;
+        bool started = !segment.copy || segment.range.startPts == AV_NOPTS_VALUE;
+        int64_t offset = 0;
+        while (av_read_frame(inputCtx, packet) >= 0) {
+            if (packet->stream_index != streamIndex) {
+                av_packet_unref(packet);
+                continue;
+            }
+
+            if (segment.copy) {
+                // 从分段起点的关键帧开始，到下一段起点的关键帧为止；
+                // 关键帧之后解码顺序上的包（开放GOP的前导B帧）都属于这一段
+                bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+                int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+                if (!started) {
+                    if (!key || pts < segment.range.startPts) {
+                        av_packet_unref(packet);
+                        continue;
+                    }
+                    started = true;
+                }
+                if (key && segment.range.endPts != AV_NOPTS_VALUE && pts >= segment.range.endPts) {
+                    break;
+                }
+            }
+
+            av_packet_rescale_ts(packet, inStream->time_base, outStream->time_base);
+            if (firstPacket) {
+                if (!segment.copy && segment.range.startPts != AV_NOPTS_VALUE && packet->pts != AV_NOPTS_VALUE) {
+                    offset = av_rescale_q(segment.range.startPts, sourceTimeBase_, outStream->time_base) - packet->pts;
+                }
+                if (!PrependToPacket(packet, parameterSets)) {
+                    std::cerr << "无法插入参数集" << std::endl;
+                    ok = false;
+                    break;
+                }
+                firstPacket = false;
+            }
+            if (packet->pts != AV_NOPTS_VALUE) packet->pts += offset;
+            if (packet->dts != AV_NOPTS_VALUE) packet->dts += offset;
+
+            // 取整误差和段之间B帧延迟的差异不能让dts回退
+            if (lastDts != AV_NOPTS_VALUE && packet->dts != AV_NOPTS_VALUE && packet->dts <= lastDts) {
+                packet->dts = lastDts + 1;
+                if (packet->pts != AV_NOPTS_VALUE && packet->pts < packet->dts) {
+                    packet->pts = packet->dts;
+                }
+            }
+            if (packet->dts != AV_NOPTS_VALUE) {
+                lastDts = packet->dts;
+            }
+
+            // 先写入时间上在这个视频包之前的直通包
+            if (!passthrough.CopyUntil(packet->dts, outStream->time_base)) {
+                ok = false;
+                break;
+            }
+
+            packet->stream_index = outStream->index;
+            packet->pos = -1;
+            if (av_interleaved_write_frame(outputCtx, packet) < 0) {
+                std::cerr << "写入数据包失败" << std::endl;
+                ok = false;
+                break;
+            }
+        }
+        av_packet_unref(packet);
+        closeInput();
+        if (!ok) {
+            break;
+        }
+    }
+
+    if (ok && outStream) {
+        ok = passthrough.CopyUntil(AV_NOPTS_VALUE, outStream->time_base);
+        passthrough.PrintSummary();
+        av_write_trailer(outputCtx);
+    }
+
+    av_packet_free(&packet);
+    if (!(outputCtx->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&outputCtx->pb);
+    }
+    avformat_free_context(outputCtx);
+    avformat_close_input(&copyCtx);
+    avformat_close_input(&sourceCtx);
+    return ok && outStream;
+}
+
+void SegmentParallelProcessor::RemoveSegmentFiles()
+{
+    for (const VideoSegment& segment : segments_) {
+        if (segment.path.empty()) {
+            continue;
+        }
+        std::error_code ec;
+        std::filesystem::remove(segment.path, ec);
+    }
+    segments_.clear();
+}
+
+void SegmentParallelProcessor::PrintWorkerStats(double wallSeconds) const
+{
+    int64_t totalFrames = 0;
+    std::cout << "=== 分段并行统计 ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < workerStats_.size(); i++) {
+        const WorkerStats& s = workerStats_[i];
+        std::cout << "工作线程 " << i << ": " << s.segments << " 段, " << s.frames << " 帧, "
+                  << s.seconds << " 秒, " << (s.seconds > 0.0 ? s.frames / s.seconds : 0.0) << " fps" << std::endl;
+        totalFrames += s.frames;
+    }
+    std::cout << "合计: " << totalFrames << " 帧, " << wallSeconds << " 秒, "
+              << (wallSeconds > 0.0 ? totalFrames / wallSeconds : 0.0) << " fps" << std::endl;
+
+    int copySegments = 0;
+    int64_t copyFrames = 0;
+    for (const VideoSegment& segment : segments_) {
+        if (segment.copy) {
+            copySegments++;
+            copyFrames += segment.frames;
+        }
+    }
+    if (copySegments > 0) {
+        std::cout << "直接复制: " << copySegments << " 段, " << copyFrames << " 帧" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+bool SegmentParallelProcessor::ProcessVideo(const std::string& inputPath,
+                                            const std::string& outputPath,
+                                            int workerCount,
+                                            const SegmentWorkFn& work)
+{
+    if (workerCount <= 0) {
+        workerCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::cout << "扫描关键帧..." << std::endl;
+    if (!ScanKeyframes(inputPath)) {
+        return false;
+    }
+    if (ranges_.empty()) {
+        BuildSegments(outputPath, workerCount);
+    } else {
+        // 直接复制的GOP和重新编码的GOP在同一条流里，编码必须相同
+        if (sourceCodecId_ != AV_CODEC_ID_H264) {
+            std::cerr << "区间模式只支持H.264输入，当前输入为 " << avcodec_get_name(sourceCodecId_) << std::endl;
+            return false;
+        }
+        BuildRangeSegments(outputPath, workerCount);
+    }
+
+    // 只有一段且需要重新编码时直接写到最终输出，不需要拼接
+    bool direct = segments_.size() == 1 && !segments_[0].copy;
+    if (direct) {
+        segments_[0].path = outputPath;
+    }
+
+    int processCount = 0;
+    for (const VideoSegment& segment : segments_) {
+        processCount += segment.copy ? 0 : 1;
+    }
+    workerCount = std::min(workerCount, processCount);
+    std::cout << "分段并行处理: " << workerCount << " 个工作线程" << std::endl;
+
+    bool ok = RunWorkers(workerCount, work);
+    if (ok && !direct) {
+        std::cout << "拼接 " << segments_.size() << " 个分段..." << std::endl;
+        ok = StitchSegments(inputPath, outputPath);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    PrintWorkerStats(elapsed.count());
+
+    if (direct) {
+        segments_.clear();
+    }
+    RemoveSegmentFiles();
+    return ok;
+}
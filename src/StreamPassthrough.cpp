@@ -0,0 +1,150 @@
+#include "StreamPassthrough.h"
+#include <iostream>
+
+StreamPassthrough::StreamPassthrough()
+    : inputCtx_(nullptr)
+    , outputCtx_(nullptr)
+    , streamCount_(0)
+    , pending_(nullptr)
+    , hasPending_(false)
+    , inputEnded_(false)
+{
+}
+
+StreamPassthrough::~StreamPassthrough()
+{
+    av_packet_free(&pending_);
+}
+
+bool StreamPassthrough::Setup(AVFormatContext* inputCtx, AVFormatContext* outputCtx, int videoStreamIndex,
+                              bool copyStreams)
+{
+    inputCtx_ = inputCtx;
+    outputCtx_ = outputCtx;
+    streamMap_.assign(inputCtx->nb_streams, -1);
+    packetCounts_.assign(inputCtx->nb_streams, 0);
+    streamCount_ = 0;
+
+    for (unsigned int i = 0; i < inputCtx->nb_streams; i++) {
+        if (static_cast<int>(i) == videoStreamIndex) {
+            continue;
+        }
+
+        AVStream* inStream = inputCtx->streams[i];
+        AVCodecParameters* par = inStream->codecpar;
+        bool copy = copyStreams && (par->codec_type == AVMEDIA_TYPE_AUDIO ||
+                    par->codec_type == AVMEDIA_TYPE_SUBTITLE ||
+                    par->codec_type == AVMEDIA_TYPE_DATA);
+        // 返回0表示容器明确不支持该编码（例如MP4中的SRT字幕），负数表示未知，交给写文件头时判断
+        if (copy && avformat_query_codec(outputCtx->oformat, par->codec_id, FF_COMPLIANCE_NORMAL) == 0) {
+            std::cout << "流 #" << i << " (" << avcodec_get_name(par->codec_id)
+                      << ") 不能放入输出容器，已跳过" << std::endl;
+            copy = false;
+        }
+        if (!copy) {
+            inStream->discard = AVDISCARD_ALL;
+            continue;
+        }
+
+        AVStream* outStream = avformat_new_stream(outputCtx, nullptr);
+        if (!outStream || avcodec_parameters_copy(outStream->codecpar, par) < 0) {
+            std::cerr << "无法创建直通输出流" << std::endl;
+            return false;
+        }
+        outStream->codecpar->codec_tag = 0;
+        outStream->time_base = inStream->time_base;
+        outStream->disposition = inStream->disposition;
+        av_dict_copy(&outStream->metadata, inStream->metadata, 0);
+
+        streamMap_[i] = outStream->index;
+        streamCount_++;
+        std::cout << "直通流 #" << i << ": " << av_get_media_type_string(par->codec_type)
+                  << " " << avcodec_get_name(par->codec_id) << std::endl;
+    }
+    return true;
+}
+
+bool StreamPassthrough::WritePassthroughPacket(AVPacket* packet)
+{
+    int inIndex = packet->stream_index;
+    int outIndex = streamMap_[inIndex];
+    av_packet_rescale_ts(packet, inputCtx_->streams[inIndex]->time_base,
+                         outputCtx_->streams[outIndex]->time_base);
+    packet->stream_index = outIndex;
+    packet->pos = -1;
+    packetCounts_[inIndex]++;
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    // av_interleaved_write_frame总会取走packet的数据；单个包失败（如时间戳异常）不中止整个任务
+    if (av_interleaved_write_frame(outputCtx_, packet) < 0) {
+        std::cerr << "写入直通数据包失败（流 #" << inIndex << "）" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool StreamPassthrough::HandlePacket(AVPacket* packet)
+{
+    if (streamCount_ == 0 || packet->stream_index < 0 ||
+        packet->stream_index >= static_cast<int>(streamMap_.size()) ||
+        streamMap_[packet->stream_index] < 0) {
+        return false;
+    }
+    WritePassthroughPacket(packet);
+    av_packet_unref(packet);
+    return true;
+}
+
+int StreamPassthrough::WriteVideoPacket(AVPacket* packet)
+{
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    return av_interleaved_write_frame(outputCtx_, packet);
+}
+
+bool StreamPassthrough::CopyUntil(int64_t limit, AVRational timeBase)
+{
+    if (streamCount_ == 0) {
+        return true;
+    }
+    if (!pending_) {
+        pending_ = av_packet_alloc();
+        if (!pending_) {
+            return false;
+        }
+    }
+
+    while (true) {
+        if (!hasPending_) {
+            if (inputEnded_) {
+                return true;
+            }
+            if (av_read_frame(inputCtx_, pending_) < 0) {
+                inputEnded_ = true;
+                return true;
+            }
+            if (streamMap_[pending_->stream_index] < 0) {
+                av_packet_unref(pending_);
+                continue;
+            }
+            hasPending_ = true;
+        }
+
+        int64_t dts = pending_->dts != AV_NOPTS_VALUE ? pending_->dts : pending_->pts;
+        if (limit != AV_NOPTS_VALUE && dts != AV_NOPTS_VALUE &&
+            av_compare_ts(dts, inputCtx_->streams[pending_->stream_index]->time_base, limit, timeBase) > 0) {
+            return true;
+        }
+        WritePassthroughPacket(pending_);
+        av_packet_unref(pending_);
+        hasPending_ = false;
+    }
+}
+
+void StreamPassthrough::PrintSummary() const
+{
+    for (size_t i = 0; i < streamMap_.size(); i++) {
+        if (streamMap_[i] >= 0) {
+            std::cout << "直通流 #" << i << ": " << packetCounts_[i] << " 个数据包" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,274 @@
+#include "SyntheticFrameSource.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// 每个周期的三个阶段（秒）
+static const int kMovingEndSeconds = 4;
+static const int kScrollEndSeconds = 7;
+static const int kCycleSeconds = 10;
+
+static const int kTitleBarHeight = 24;
+// 5x7点阵字符放大2倍，加上字间距和行间距
+static const int kGlyphScale = 2;
+static const int kCharWidth = 6 * kGlyphScale;
+static const int kLineHeight = 8 * kGlyphScale;
+// 终端每帧向上滚动的像素数
+static const int kScrollStep = 2;
+
+// splitmix64，用来生成确定性的"文字"
+static uint64_t Hash64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// 在 [0, range] 之间来回反弹的位置
+static int Bounce(int64_t position, int range)
+{
+    if (range <= 0) {
+        return 0;
+    }
+    int64_t period = 2 * static_cast<int64_t>(range);
+    int64_t p = position % period;
+    return static_cast<int>(p <= range ? p : period - p);
+}
+
+// 颜色为0xRRGGBB，按BGRA字节顺序写入
+static void StorePixel(uint8_t* dst, uint32_t color)
+{
+    dst[0] = static_cast<uint8_t>(color);
+    dst[1] = static_cast<uint8_t>(color >> 8);
+    dst[2] = static_cast<uint8_t>(color >> 16);
+    dst[3] = 255;
+}
+
+SyntheticFrameSource::SyntheticFrameSource(int width, int height, int fps)
+    : width_(width)
+    , height_(height)
+    , fps_(fps)
+    , frameIndex_(0)
+    , linesize_(0)
+    , lastPhase_(-1)
+    , windowRects_()
+    , move_()
+{
+}
+
+bool SyntheticFrameSource::Initialize()
+{
+    if (width_ < 64 || height_ < 64 || fps_ <= 0) {
+        std::cerr << "无效的合成画面参数: " << width_ << "x" << height_ << " @ " << fps_ << " fps" << std::endl;
+        return false;
+    }
+
+    linesize_ = width_ * 4;
+    wallpaper_.resize(static_cast<size_t>(linesize_) * height_);
+    frame_.resize(wallpaper_.size());
+    dirtyRects_.reserve(kWindowCount + 1);
+    frameIndex_ = 0;
+    lastPhase_ = -1;
+
+    DrawWallpaper();
+    return true;
+}
+
+bool SyntheticFrameSource::CaptureFrame(CapturedFrame& frame)
+{
+    int64_t cycleFrames = static_cast<int64_t>(kCycleSeconds) * fps_;
+    int64_t t = frameIndex_ % cycleFrames;
+    int phase = 2;
+    if (t < static_cast<int64_t>(kMovingEndSeconds) * fps_) {
+        phase = 0;
+    } else if (t < static_cast<int64_t>(kScrollEndSeconds) * fps_) {
+        phase = 1;
+    }
+
+    // 切换阶段时整个画面都变了；阶段内只报告实际变化的区域
+    bool phaseChanged = phase != lastPhase_;
+    dirtyRects_.clear();
+    int moveCount = 0;
+
+    if (phase == 0) {
+        Rect previous[kWindowCount];
+        std::copy(windowRects_, windowRects_ + kWindowCount, previous);
+        DrawMovingWindows(t);
+        if (!phaseChanged) {
+            // 每个窗口旧位置和新位置的外接矩形
+            for (int i = 0; i < kWindowCount; i++) {
+                const Rect& a = previous[i];
+                const Rect& b = windowRects_[i];
+                int x0 = std::min(a.x, b.x);
+                int y0 = std::min(a.y, b.y);
+                int x1 = std::max(a.x + a.width, b.x + b.width);
+                int y1 = std::max(a.y + a.height, b.y + b.height);
+                dirtyRects_.push_back(FrameRect{ x0, y0, x1 - x0, y1 - y0 });
+            }
+        }
+    } else if (phase == 1) {
+        DrawTerminal(t - static_cast<int64_t>(kMovingEndSeconds) * fps_);
+        if (!phaseChanged) {
+            // 与DXGI报告滚动的方式相同：终端内容整体上移，只有底部新露出的几行是新内容
+            Rect body = TerminalBody();
+            move_.sourceX = body.x;
+            move_.sourceY = body.y + kScrollStep;
+            move_.destination = FrameRect{ body.x, body.y, body.width, body.height - kScrollStep };
+            moveCount = 1;
+            dirtyRects_.push_back(FrameRect{ body.x, body.y + body.height - kScrollStep, body.width, kScrollStep });
+        }
+    }
+    // 静止阶段保持上一帧，没有变化区域
+
+    if (phaseChanged && phase != 2) {
+        dirtyRects_.push_back(FrameRect{ 0, 0, width_, height_ });
+    }
+    lastPhase_ = phase;
+
+    frame.data = frame_.data();
+    frame.linesize = linesize_;
+    frame.width = width_;
+    frame.height = height_;
+    frame.timestampUs = frameIndex_ * 1000000 / fps_;
+    frame.updated = !dirtyRects_.empty() || moveCount > 0;
+    frame.hasDirtyRects = true;
+    frame.dirtyRects = dirtyRects_.data();
+    frame.dirtyRectCount = static_cast<int>(dirtyRects_.size());
+    frame.moveRects = &move_;
+    frame.moveRectCount = moveCount;
+
+    frameIndex_++;
+    return true;
+}
+
+void SyntheticFrameSource::DrawWallpaper()
+{
+    // 竖直渐变的桌面背景，底部是任务栏
+    int taskbarHeight = std::max(height_ / 24, 16);
+    for (int y = 0; y < height_; y++) {
+        uint8_t* row = wallpaper_.data() + static_cast<size_t>(y) * linesize_;
+        uint32_t color;
+        if (y >= height_ - taskbarHeight) {
+            color = 0x202428;
+        } else {
+            uint32_t g = 0x40 + static_cast<uint32_t>(y * 0x50 / height_);
+            uint32_t b = 0x80 + static_cast<uint32_t>(y * 0x60 / height_);
+            color = (0x18u << 16) | (g << 8) | b;
+        }
+        for (int x = 0; x < width_; x++) {
+            StorePixel(row + x * 4, color);
+        }
+    }
+}
+
+void SyntheticFrameSource::DrawMovingWindows(int64_t t)
+{
+    std::memcpy(frame_.data(), wallpaper_.data(), frame_.size());
+
+    static const uint32_t kTitleColors[kWindowCount] = { 0x2B579A, 0x217346, 0xB7472A, 0x5C2D91 };
+
+    for (int i = 0; i < kWindowCount; i++) {
+        Rect rect;
+        rect.width = width_ * (25 + 5 * i) / 100;
+        rect.height = height_ * (30 + 4 * i) / 100;
+
+        // 速度按分辨率缩放，1080p时每帧移动几个像素
+        int64_t vx = std::max<int64_t>(1, (3 + 2 * i) * width_ / 1920);
+        int64_t vy = std::max<int64_t>(1, (2 + i) * height_ / 1080);
+        rect.x = Bounce(i * 97 + vx * t, width_ - rect.width);
+        rect.y = Bounce(i * 61 + vy * t, height_ - rect.height);
+        windowRects_[i] = rect;
+
+        DrawWindow(rect, kTitleColors[i], 0xF0F0F0);
+
+        Rect body = { rect.x + 2, rect.y + kTitleBarHeight, rect.width - 4, rect.height - kTitleBarHeight - 2 };
+        for (int line = 0; line * kLineHeight + kLineHeight <= body.height; line++) {
+            DrawTextLine(body.x + 4, body.y + 4 + line * kLineHeight,
+                         static_cast<uint64_t>(i) << 32 | line, 0x202020, body);
+        }
+    }
+}
+
+void SyntheticFrameSource::DrawTerminal(int64_t t)
+{
+    std::memcpy(frame_.data(), wallpaper_.data(), frame_.size());
+
+    Rect rect = TerminalRect();
+    DrawWindow(rect, 0x3C3C3C, 0x0C0C0C);
+
+    // 每帧向上滚动kScrollStep像素，滚过一整行后换下一行文字
+    Rect body = TerminalBody();
+    int64_t scroll = t * kScrollStep;
+    int64_t firstLine = scroll / kLineHeight;
+    int offset = static_cast<int>(scroll % kLineHeight);
+    for (int line = 0; line * kLineHeight - offset < body.height; line++) {
+        DrawTextLine(body.x + 4, body.y + line * kLineHeight - offset,
+                     0xFFFF0000ull + static_cast<uint64_t>(firstLine + line), 0xCCCCCC, body);
+    }
+}
+
+SyntheticFrameSource::Rect SyntheticFrameSource::TerminalRect() const
+{
+    return Rect{ width_ / 8, height_ / 10, width_ * 3 / 4, height_ * 7 / 10 };
+}
+
+SyntheticFrameSource::Rect SyntheticFrameSource::TerminalBody() const
+{
+    Rect rect = TerminalRect();
+    return Rect{ rect.x + 2, rect.y + kTitleBarHeight, rect.width - 4, rect.height - kTitleBarHeight - 2 };
+}
+
+void SyntheticFrameSource::DrawWindow(const Rect& rect, uint32_t titleColor, uint32_t bodyColor)
+{
+    Rect screen = { 0, 0, width_, height_ };
+    FillRect(rect, 0x808080, screen);
+
+    Rect title = { rect.x + 1, rect.y + 1, rect.width - 2, kTitleBarHeight - 1 };
+    FillRect(title, titleColor, screen);
+
+    Rect body = { rect.x + 1, rect.y + kTitleBarHeight, rect.width - 2, rect.height - kTitleBarHeight - 1 };
+    FillRect(body, bodyColor, screen);
+}
+
+void SyntheticFrameSource::DrawTextLine(int x, int y, uint64_t seed, uint32_t color, const Rect& clip)
+{
+    int maxChars = (clip.x + clip.width - x) / kCharWidth;
+    if (maxChars <= 0) {
+        return;
+    }
+    uint64_t lineHash = Hash64(seed);
+    int length = static_cast<int>(lineHash % static_cast<uint64_t>(maxChars)) + 1;
+
+    for (int c = 0; c < length; c++) {
+        // 大约每6个字符一个空格
+        uint64_t code = Hash64(lineHash + c) % 48;
+        if (code < 8) {
+            continue;
+        }
+        // 用字符编码的哈希作为5x7点阵
+        uint64_t glyph = Hash64(code * 0x100 + 0x55);
+        for (int gy = 0; gy < 7; gy++) {
+            for (int gx = 0; gx < 5; gx++) {
+                if (glyph >> (gy * 5 + gx) & 1) {
+                    Rect dot = { x + c * kCharWidth + gx * kGlyphScale, y + gy * kGlyphScale, kGlyphScale, kGlyphScale };
+                    FillRect(dot, color, clip);
+                }
+            }
+        }
+    }
+}
+
+void SyntheticFrameSource::FillRect(const Rect& rect, uint32_t color, const Rect& clip)
+{
+    int x0 = std::max(rect.x, clip.x);
+    int y0 = std::max(rect.y, clip.y);
+    int x1 = std::min(rect.x + rect.width, clip.x + clip.width);
+    int y1 = std::min(rect.y + rect.height, clip.y + clip.height);
+    for (int y = y0; y < y1; y++) {
+        uint8_t* row = frame_.data() + static_cast<size_t>(y) * linesize_;
+        for (int x = x0; x < x1; x++) {
+            StorePixel(row + x * 4, color);
+        }
+    }
+}
@@ -0,0 +1,358 @@
+#include "TextOverlay.h"
+#include "BlendKernels.h"
+#include "ScratchArena.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <cwchar>
+#include <iostream>
+
+GlyphAtlas::GlyphAtlas()
+    : width_(0)
+    , height_(0)
+    , lineHeight_(0)
+{
+}
+
+void GlyphAtlas::Reset(int width, int height, int lineHeight)
+{
+    width_ = width;
+    height_ = height;
+    lineHeight_ = lineHeight;
+    coverage_.assign(static_cast<size_t>(width) * height, 0);
+    outline_.clear();
+    glyphs_.clear();
+}
+
+void GlyphAtlas::AddGlyph(wchar_t ch, const GlyphInfo& info)
+{
+    glyphs_[ch] = info;
+}
+
+const GlyphInfo* GlyphAtlas::Find(wchar_t ch) const
+{
+    auto it = glyphs_.find(ch);
+    return it != glyphs_.end() ? &it->second : nullptr;
+}
+
+void GlyphAtlas::BuildOutline()
+{
+    // 膨胀限制在每个单元内，不会把相邻单元的笔画带进来
+    outline_.assign(coverage_.size(), 0);
+    for (const auto& entry : glyphs_) {
+        const GlyphInfo& g = entry.second;
+        for (int y = g.y; y < g.y + g.height; y++) {
+            int y0 = std::max(y - 1, g.y);
+            int y1 = std::min(y + 1, g.y + g.height - 1);
+            for (int x = g.x; x < g.x + g.width; x++) {
+                int x0 = std::max(x - 1, g.x);
+                int x1 = std::min(x + 1, g.x + g.width - 1);
+                uint8_t value = 0;
+                for (int yy = y0; yy <= y1; yy++) {
+                    const uint8_t* row = coverage_.data() + static_cast<size_t>(yy) * width_;
+                    for (int xx = x0; xx <= x1; xx++) {
+                        value = std::max(value, row[xx]);
+                    }
+                }
+                outline_[static_cast<size_t>(y) * width_ + x] = value;
+            }
+        }
+    }
+}
+
+namespace {
+
+// 变量可能输出的字符
+const wchar_t* const kVariableCharset = L"0123456789-:. ";
+
+}
+
+TextOverlay::TextOverlay()
+    : atlas_(nullptr)
+    , x_(0)
+    , y_(0)
+    , maskWidth_(0)
+    , maskHeight_(0)
+    , rect_{ 0, 0, 0, 0 }
+    , chromaShiftW_(-1)
+    , chromaShiftH_(-1)
+    , chromaDirty_(true)
+    , rangeLevels_(-1)
+    , relayouts_(0)
+{
+}
+
+void TextOverlay::ParseTemplate(const std::wstring& textTemplate, std::vector<Segment>& outSegments)
+{
+    static const struct { const wchar_t* name; Segment::Kind kind; } kTokens[] = {
+        { L"{time}", Segment::Time }, { L"{frame}", Segment::Frame }, { L"{pts}", Segment::Pts }
+    };
+    outSegments.clear();
+    size_t pos = 0;
+    while (pos < textTemplate.size()) {
+        Segment::Kind kind = Segment::Literal;
+        size_t length = 1;
+        if (textTemplate[pos] == L'{') {
+            for (const auto& token : kTokens) {
+                if (textTemplate.compare(pos, wcslen(token.name), token.name) == 0) {
+                    kind = token.kind;
+                    length = wcslen(token.name);
+                    break;
+                }
+            }
+        }
+        // 相邻的字面字符合并成一段，不认识的 {xxx} 也原样显示
+        if (kind == Segment::Literal && !outSegments.empty() && outSegments.back().kind == Segment::Literal) {
+            outSegments.back().text += textTemplate[pos];
+        } else {
+            Segment segment;
+            segment.kind = kind;
+            if (kind == Segment::Literal) {
+                segment.text = textTemplate[pos];
+            }
+            outSegments.push_back(segment);
+        }
+        pos += length;
+    }
+}
+
+std::wstring TextOverlay::GetCharset(const std::wstring& textTemplate)
+{
+    std::vector<Segment> segments;
+    ParseTemplate(textTemplate, segments);
+
+    std::wstring charset = kVariableCharset;
+    for (const Segment& segment : segments) {
+        for (wchar_t ch : segment.text) {
+            if (charset.find(ch) == std::wstring::npos) {
+                charset += ch;
+            }
+        }
+    }
+    return charset;
+}
+
+bool TextOverlay::Initialize(const std::wstring& textTemplate, const GlyphAtlas* atlas, int x, int y)
+{
+    if (!atlas || atlas->GetLineHeight() <= 0 || textTemplate.empty()) {
+        std::cerr << "文字叠加的模板或字形图集无效" << std::endl;
+        return false;
+    }
+
+    ParseTemplate(textTemplate, segments_);
+    atlas_ = atlas;
+    x_ = std::max(x, 0) & ~1;
+    y_ = std::max(y, 0) & ~1;
+    text_.clear();
+    maskWidth_ = 0;
+    maskHeight_ = 0;
+    rect_ = { 0, 0, 0, 0 };
+    chromaDirty_ = true;
+    relayouts_ = 0;
+    return true;
+}
+
+std::unique_ptr<DynamicLayer> TextOverlay::Clone() const
+{
+    return std::unique_ptr<DynamicLayer>(new TextOverlay(*this));
+}
+
+void TextOverlay::Format(int64_t frameNumber, int64_t mediaTimeMs)
+{
+    std::wstring& text = formatted_;
+    text.clear();
+    wchar_t buffer[64];
+    for (const Segment& segment : segments_) {
+        switch (segment.kind) {
+        case Segment::Literal:
+            text += segment.text;
+            break;
+        case Segment::Time: {
+            std::time_t now = std::time(nullptr);
+            std::tm local = {};
+#ifdef _WIN32
+            localtime_s(&local, &now);
+#else
+            localtime_r(&now, &local);
+#endif
+            swprintf(buffer, 64, L"%04d-%02d-%02d %02d:%02d:%02d",
+                     local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                     local.tm_hour, local.tm_min, local.tm_sec);
+            text += buffer;
+            break;
+        }
+        case Segment::Frame:
+            swprintf(buffer, 64, L"%lld", static_cast<long long>(frameNumber));
+            text += buffer;
+            break;
+        case Segment::Pts: {
+            int64_t ms = std::max<int64_t>(mediaTimeMs, 0);
+            swprintf(buffer, 64, L"%02d:%02d:%02d.%03d",
+                     static_cast<int>(ms / 3600000), static_cast<int>(ms / 60000 % 60),
+                     static_cast<int>(ms / 1000 % 60), static_cast<int>(ms % 1000));
+            text += buffer;
+            break;
+        }
+        }
+    }
+}
+
+void TextOverlay::Layout()
+{
+    const int pad = GlyphAtlas::kPadding;
+    const GlyphInfo* fallback = atlas_->Find(L'?');
+
+    // 第一遍确定每个字形单元的位置和遮罩宽度；单元的留白互相重叠，按最大值合并
+    std::vector<PlacedGlyph>& placed = placed_;
+    placed.clear();
+    float pen = static_cast<float>(pad);
+    int width = 0;
+    for (wchar_t ch : formatted_) {
+        const GlyphInfo* g = atlas_->Find(ch);
+        if (!g) {
+            g = fallback;
+        }
+        if (!g) {
+            pen += atlas_->GetLineHeight() / 3.0f;
+            continue;
+        }
+        int x = static_cast<int>(std::lround(pen)) - pad;
+        placed.push_back({ g, x });
+        width = std::max(width, x + g->width);
+        pen += g->advance;
+    }
+
+    maskWidth_ = (std::max(width, 2) + 1) & ~1;
+    maskHeight_ = (atlas_->GetLineHeight() + 2 * pad + 1) & ~1;
+    fill_.assign(static_cast<size_t>(maskWidth_) * maskHeight_, 0);
+    outline_.assign(fill_.size(), 0);
+
+    const uint8_t* coverage = atlas_->GetCoverage();
+    const uint8_t* outline = atlas_->GetOutline();
+    for (const PlacedGlyph& p : placed) {
+        const GlyphInfo& g = *p.glyph;
+        int rows = std::min(g.height, maskHeight_);
+        for (int y = 0; y < rows; y++) {
+            size_t src = static_cast<size_t>(g.y + y) * atlas_->GetWidth() + g.x;
+            size_t dst = static_cast<size_t>(y) * maskWidth_ + p.x;
+            for (int x = 0; x < g.width; x++) {
+                fill_[dst + x] = std::max(fill_[dst + x], coverage[src + x]);
+                outline_[dst + x] = std::max(outline_[dst + x], outline[src + x]);
+            }
+        }
+    }
+
+    text_ = formatted_;
+    chromaDirty_ = true;
+    relayouts_++;
+}
+
+size_t TextOverlay::GetBufferCapacity() const
+{
+    return (formatted_.capacity() + text_.capacity()) * sizeof(wchar_t) +
+           placed_.capacity() * sizeof(PlacedGlyph) +
+           fill_.capacity() + outline_.capacity() + chromaMask_.capacity() +
+           dark_.capacity() + light_.capacity() + neutral_.capacity();
+}
+
+bool TextOverlay::Prepare(int64_t frameNumber, int64_t mediaTimeMs, int frameWidth, int frameHeight,
+                          FrameRect& outRect)
+{
+    size_t capacity = GetBufferCapacity();
+    Format(frameNumber, mediaTimeMs);
+    if (formatted_ != text_) {
+        Layout();
+    }
+    if (GetBufferCapacity() > capacity) {
+        RecordSmallAllocation(GetBufferCapacity() - capacity);
+    }
+
+    rect_.x = x_;
+    rect_.y = y_;
+    rect_.width = std::max(std::min(maskWidth_, frameWidth - x_), 0);
+    rect_.height = std::max(std::min(maskHeight_, frameHeight - y_), 0);
+    outRect = rect_;
+    return rect_.width > 0 && rect_.height > 0;
+}
+
+void TextOverlay::BuildChromaMask(int chromaShiftW, int chromaShiftH)
+{
+    int blockW = 1 << chromaShiftW;
+    int blockH = 1 << chromaShiftH;
+    int cw = (maskWidth_ + blockW - 1) >> chromaShiftW;
+    int ch = (maskHeight_ + blockH - 1) >> chromaShiftH;
+    chromaMask_.assign(static_cast<size_t>(cw) * ch, 0);
+    for (int cy = 0; cy < ch; cy++) {
+        for (int cx = 0; cx < cw; cx++) {
+            int sum = 0;
+            int count = 0;
+            for (int y = cy * blockH; y < std::min((cy + 1) * blockH, maskHeight_); y++) {
+                for (int x = cx * blockW; x < std::min((cx + 1) * blockW, maskWidth_); x++) {
+                    size_t i = static_cast<size_t>(y) * maskWidth_ + x;
+                    sum += std::max(fill_[i], outline_[i]);
+                    count++;
+                }
+            }
+            chromaMask_[static_cast<size_t>(cy) * cw + cx] = static_cast<uint8_t>((sum + count / 2) / count);
+        }
+    }
+    chromaShiftW_ = chromaShiftW;
+    chromaShiftH_ = chromaShiftH;
+    chromaDirty_ = false;
+}
+
+void TextOverlay::Draw(const LayerTarget& target)
+{
+    if (rect_.width <= 0 || rect_.height <= 0) {
+        return;
+    }
+    int chromaShiftW = target.chromaShiftW;
+    int chromaShiftH = target.chromaShiftH;
+
+    // 混合目标是常量行：亮度的黑/白和色度的中性灰，遮罩直接作为alpha
+    size_t capacity = GetBufferCapacity();
+    bool fullRange = target.fullRange;
+    int levels = fullRange ? 1 : 0;
+    if (rangeLevels_ != levels || static_cast<int>(dark_.size()) < maskWidth_) {
+        size_t size = std::max(static_cast<size_t>(maskWidth_), dark_.size());
+        dark_.assign(size, fullRange ? 0 : 16);
+        light_.assign(size, fullRange ? 255 : 235);
+        neutral_.assign(size, 128);
+        rangeLevels_ = levels;
+    }
+    if (chromaDirty_ || chromaShiftW != chromaShiftW_ || chromaShiftH != chromaShiftH_) {
+        BuildChromaMask(chromaShiftW, chromaShiftH);
+    }
+    if (GetBufferCapacity() > capacity) {
+        RecordSmallAllocation(GetBufferCapacity() - capacity);
+    }
+
+    const BlendKernels& kernels = GetBlendKernels();
+    for (int y = 0; y < rect_.height; y++) {
+        uint8_t* dst = target.data[0] + static_cast<size_t>(rect_.y + y) * target.linesize[0] + rect_.x;
+        size_t row = static_cast<size_t>(y) * maskWidth_;
+        kernels.planar(dst, dark_.data(), outline_.data() + row, 255, rect_.width);
+        kernels.planar(dst, light_.data(), fill_.data() + row, 255, rect_.width);
+    }
+
+    // 文字区域的起点为偶数，色度样本与遮罩的色度块对齐
+    int cx = rect_.x >> chromaShiftW;
+    int cy = rect_.y >> chromaShiftH;
+    int cw = ((rect_.x + rect_.width + (1 << chromaShiftW) - 1) >> chromaShiftW) - cx;
+    int ch = ((rect_.y + rect_.height + (1 << chromaShiftH) - 1) >> chromaShiftH) - cy;
+    int maskCw = (maskWidth_ + (1 << chromaShiftW) - 1) >> chromaShiftW;
+    for (int p = 1; p < 3; p++) {
+        for (int y = 0; y < ch; y++) {
+            uint8_t* dst = target.data[p] + static_cast<size_t>(cy + y) * target.linesize[p] + cx;
+            kernels.planar(dst, neutral_.data(), chromaMask_.data() + static_cast<size_t>(y) * maskCw, 255, cw);
+        }
+    }
+}
+
+std::string TextOverlay::Describe() const
+{
+    return "文字 " + std::to_string(maskWidth_) + "x" + std::to_string(maskHeight_) +
+           " (图集 " + std::to_string(atlas_ ? atlas_->GetGlyphCount() : 0) + " 个字形, 重新排版 " +
+           std::to_string(relayouts_) + " 次)";
+}
@@ -1,5 +1,8 @@
 #include "VideoProcessor.h"
+#include "BlendKernels.h"
+#include "FramePipeline.h"
 #include <iostream>
+#include <algorithm>
 
 VideoProcessor::VideoProcessor()
     : inputFormatCtx_(nullptr)
@@ -15,6 +18,8 @@ VideoProcessor::VideoProcessor()
     , outVideoStream_(nullptr)
     , videoStreamIndex_(-1)
     , d3dProcessor_(nullptr)
+    , useCpuBlend_(false)
+    , prebuiltCoverage_(nullptr)
     , width_(0)
     , height_(0)
     , pixelFormat_(AV_PIX_FMT_NONE)
@@ -22,6 +27,9 @@ VideoProcessor::VideoProcessor()
     , watermarkSRV_(nullptr)
     , videoTexture_(nullptr)
     , videoSRV_(nullptr)
+    , pipelineDepth_(0)
+    , segment_(WholeFileRange())
+    , firstFrame_(true)
 {
 }
 
@@ -30,104 +38,13 @@ VideoProcessor::~VideoProcessor()
     Cleanup();
 }
 
-bool VideoProcessor::GetVideoDimensions(const std::string& path, int& width, int& height)
-{
-    AVFormatContext* formatCtx = nullptr;
-    
-    // 打开输入文件
-    if (avformat_open_input(&formatCtx, path.c_str(), nullptr, nullptr) < 0) {
-        std::cerr << "无法打开输入文件: " << path << std::endl;
-        return false;
-    }
-
-    // 获取流信息
-    if (avformat_find_stream_info(formatCtx, nullptr) < 0) {
-        std::cerr << "无法获取流信息" << std::endl;
-        avformat_close_input(&formatCtx);
-        return false;
-    }
-
-    // 查找视频流
-    int videoStreamIndex = -1;
-    for (unsigned int i = 0; i < formatCtx->nb_streams; i++) {
-        if (formatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            videoStreamIndex = i;
-            break;
-        }
-    }
-
-    if (videoStreamIndex == -1) {
-        std::cerr << "未找到视频流" << std::endl;
-        avformat_close_input(&formatCtx);
-        return false;
-    }
-
-    // 获取视频尺寸
-    AVCodecParameters* codecpar = formatCtx->streams[videoStreamIndex]->codecpar;
-    width = codecpar->width;
-    height = codecpar->height;
-
-    // 清理
-    avformat_close_input(&formatCtx);
-    
-    return true;
-}
-
 bool VideoProcessor::OpenInput(const std::string& path)
 {
-    // 打开输入文件
-    if (avformat_open_input(&inputFormatCtx_, path.c_str(), nullptr, nullptr) < 0) {
-        std::cerr << "无法打开输入文件: " << path << std::endl;
-        return false;
-    }
-
-    // 获取流信息
-    if (avformat_find_stream_info(inputFormatCtx_, nullptr) < 0) {
-        std::cerr << "无法获取流信息" << std::endl;
+    if (!OpenVideoDecoder(path, &inputFormatCtx_, videoStreamIndex_, &decoderCtx_)) {
         return false;
     }
-
-    // 查找视频流
-    videoStreamIndex_ = -1;
-    for (unsigned int i = 0; i < inputFormatCtx_->nb_streams; i++) {
-        if (inputFormatCtx_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            videoStreamIndex_ = i;
-            break;
-        }
-    }
-
-    if (videoStreamIndex_ == -1) {
-        std::cerr << "未找到视频流" << std::endl;
-        return false;
-    }
-
     videoStream_ = inputFormatCtx_->streams[videoStreamIndex_];
-    AVCodecParameters* codecpar = videoStream_->codecpar;
-
-    // 查找解码器
-    decoder_ = avcodec_find_decoder(codecpar->codec_id);
-    if (!decoder_) {
-        std::cerr << "未找到解码器" << std::endl;
-        return false;
-    }
-
-    // 创建解码器上下文
-    decoderCtx_ = avcodec_alloc_context3(decoder_);
-    if (!decoderCtx_) {
-        std::cerr << "无法分配解码器上下文" << std::endl;
-        return false;
-    }
-
-    if (avcodec_parameters_to_context(decoderCtx_, codecpar) < 0) {
-        std::cerr << "无法复制解码器参数" << std::endl;
-        return false;
-    }
-
-    // 打开解码器
-    if (avcodec_open2(decoderCtx_, decoder_, nullptr) < 0) {
-        std::cerr << "无法打开解码器" << std::endl;
-        return false;
-    }
+    decoder_ = decoderCtx_->codec;
 
     width_ = decoderCtx_->width;
     height_ = decoderCtx_->height;
@@ -178,6 +95,12 @@ bool VideoProcessor::OpenOutput(const std::string& path)
     encoderCtx_->bit_rate = 4000000; // 4 Mbps
     encoderCtx_->gop_size = 12;
     encoderCtx_->max_b_frames = 2;
+    // 分段输出要首尾相接地拼接，不使用B帧，保证各段的dts与pts一致且连续；
+    // 并行度来自分段之间，每个编码器只用一个线程，避免线程数远超核心数
+    if (!IsWholeFile(segment_)) {
+        encoderCtx_->max_b_frames = 0;
+        encoderCtx_->thread_count = 1;
+    }
 
     if (outputFormatCtx_->oformat->flags & AVFMT_GLOBALHEADER) {
         encoderCtx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
@@ -204,6 +127,11 @@ bool VideoProcessor::OpenOutput(const std::string& path)
 
     outVideoStream_->time_base = encoderCtx_->time_base;
 
+    // 音频、字幕等其他流以流复制方式直通；分段模式下由拼接阶段从原始输入直通
+    if (!passthrough_.Setup(inputFormatCtx_, outputFormatCtx_, videoStreamIndex_, IsWholeFile(segment_))) {
+        return false;
+    }
+
     // 打开输出文件
     if (!(outputFormatCtx_->oformat->flags & AVFMT_NOFILE)) {
         if (avio_open(&outputFormatCtx_->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
@@ -230,57 +158,83 @@ AVFrame* VideoProcessor::ProcessFrame(AVFrame* frame,
                                       float alpha)
 {
     // 打印第一帧的颜色属性
-    static bool firstFrame = true;
-    if (firstFrame) {
+    if (firstFrame_) {
         std::cout << "原始帧颜色属性: " << std::endl;
         std::cout << "  color_range: " << frame->color_range << std::endl;
         std::cout << "  color_primaries: " << frame->color_primaries << std::endl;
         std::cout << "  color_trc: " << frame->color_trc << std::endl;
         std::cout << "  colorspace: " << frame->colorspace << std::endl;
-        firstFrame = false;
+        firstFrame_ = false;
     }
     
-    // 分配RGB缓冲区
-    AVFrame* rgbFrame = av_frame_alloc();
-    rgbFrame->format = AV_PIX_FMT_RGB24;
-    rgbFrame->width = width_;
-    rgbFrame->height = height_;
-    av_frame_get_buffer(rgbFrame, 0);
+    // 从缓冲池取RGB帧（稳态下不分配内存）
+    AVFrame* rgbFrame = rgbPool_.Acquire();
+    if (!rgbFrame) {
+        std::cerr << "从缓冲池获取RGB帧失败" << std::endl;
+        return nullptr;
+    }
 
     // 转换为RGB（使用缓存的上下文）
     sws_scale(swsToRgbCtx_, frame->data, frame->linesize, 0, height_,
               rgbFrame->data, rgbFrame->linesize);
 
-    // 由于FFmpeg的linesize可能有padding，需要复制到紧密排列的缓冲区
-    std::vector<unsigned char> tightRgbData(width_ * height_ * 3);
-    for (int y = 0; y < height_; y++) {
-        memcpy(tightRgbData.data() + y * width_ * 3,
-               rgbFrame->data[0] + y * rgbFrame->linesize[0],
-               width_ * 3);
+    if (useCpuBlend_) {
+        // CPU混合：直接在rgbFrame上按行混合（按linesize寻址，不需要紧密排列的副本）
+        // 水印系数已在blendPlan_中预乘，这里每个字节只做一次乘加
+        const BlendKernels& kernels = GetBlendKernels();
+        for (int y = 0; y < wmCoverage_.GetHeight(); y++) {
+            uint8_t* dst = rgbFrame->data[0] + y * rgbFrame->linesize[0];
+            for (const CoverageSpan* s = wmCoverage_.RowBegin(y); s != wmCoverage_.RowEnd(y); ++s) {
+                blendPlan_.BlendRow(kernels, dst, y, s->x * 3, s->length * 3);
+            }
+        }
+
+        AVFrame* yuvFrame = yuvPool_.Acquire();
+        if (!yuvFrame) {
+            std::cerr << "从缓冲池获取YUV帧失败" << std::endl;
+            av_frame_free(&rgbFrame);
+            return nullptr;
+        }
+
+        yuvFrame->pts = frame->pts;
+        yuvFrame->pkt_dts = frame->pkt_dts;
+        yuvFrame->color_range = frame->color_range;
+        yuvFrame->color_primaries = frame->color_primaries;
+        yuvFrame->color_trc = frame->color_trc;
+        yuvFrame->colorspace = frame->colorspace;
+        yuvFrame->pict_type = AV_PICTURE_TYPE_NONE;
+
+        sws_scale(swsToYuvCtx_, rgbFrame->data, rgbFrame->linesize, 0, height_,
+                  yuvFrame->data, yuvFrame->linesize);
+
+        av_frame_free(&rgbFrame);
+        return yuvFrame;
     }
 
-    // 更新视频纹理数据（不重新创建纹理）
-    if (!d3dProcessor_->UpdateTextureData(videoTexture_, tightRgbData.data(), width_, height_)) {
+    // GPU路径的rgbFrame是RGBA，与纹理格式相同，按linesize直接上传（不需要紧密排列的副本）
+    bool uploaded = d3dProcessor_->UpdateTextureRGBA(videoTexture_, rgbFrame->data[0], rgbFrame->linesize[0]);
+    av_frame_free(&rgbFrame);
+    if (!uploaded) {
         std::cerr << "更新视频纹理失败" << std::endl;
-        av_frame_free(&rgbFrame);
         return nullptr;
     }
 
-    // GPU混合
-    std::vector<unsigned char> blendedData(width_ * height_ * 3);
-    if (!d3dProcessor_->BlendTextures(videoSRV_, watermarkSRV_, alpha, blendedData.data())) {
+    // 将混合后的RGB转回YUV420P（YUV帧来自缓冲池）
+    AVFrame* yuvFrame = yuvPool_.Acquire();
+    if (!yuvFrame) {
+        std::cerr << "从缓冲池获取YUV帧失败" << std::endl;
+        return nullptr;
+    }
+
+    // GPU混合，结果留在映射的staging纹理中
+    const unsigned char* blendedData = nullptr;
+    int blendedLinesize = 0;
+    if (!d3dProcessor_->BlendTexturesMapped(videoSRV_, watermarkSRV_, alpha, &blendedData, &blendedLinesize)) {
         std::cerr << "GPU混合失败" << std::endl;
-        av_frame_free(&rgbFrame);
+        av_frame_free(&yuvFrame);
         return nullptr;
     }
 
-    // 将混合后的RGB转回YUV420P（创建新的YUV帧）
-    AVFrame* yuvFrame = av_frame_alloc();
-    yuvFrame->format = AV_PIX_FMT_YUV420P;
-    yuvFrame->width = width_;
-    yuvFrame->height = height_;
-    av_frame_get_buffer(yuvFrame, 0);
-    
     // 复制原始帧的属性
     yuvFrame->pts = frame->pts;
     yuvFrame->pkt_dts = frame->pkt_dts;
@@ -290,26 +244,12 @@ AVFrame* VideoProcessor::ProcessFrame(AVFrame* frame,
     yuvFrame->colorspace = frame->colorspace;
     yuvFrame->pict_type = AV_PICTURE_TYPE_NONE;
 
-    // 创建临时RGB帧用于转换
-    AVFrame* tempRgbFrame = av_frame_alloc();
-    tempRgbFrame->format = AV_PIX_FMT_RGB24;
-    tempRgbFrame->width = width_;
-    tempRgbFrame->height = height_;
-    av_frame_get_buffer(tempRgbFrame, 0);
-
-    // 逐行复制混合后的数据，考虑目标的linesize
-    for (int y = 0; y < height_; y++) {
-        memcpy(tempRgbFrame->data[0] + y * tempRgbFrame->linesize[0],  // 目标：有padding
-               blendedData.data() + y * width_ * 3,                     // 源：紧密排列
-               width_ * 3);                                             // 复制一行
-    }
-
-    // 转换回YUV（写入新分配的yuvFrame）
-    sws_scale(swsToYuvCtx_, tempRgbFrame->data, tempRgbFrame->linesize, 0, height_,
+    // 以RowPitch为linesize直接从staging纹理转换回YUV，不经过中间RGB帧
+    const uint8_t* srcData[4] = { blendedData, nullptr, nullptr, nullptr };
+    int srcLinesize[4] = { blendedLinesize, 0, 0, 0 };
+    sws_scale(swsToYuvCtx_, srcData, srcLinesize, 0, height_,
               yuvFrame->data, yuvFrame->linesize);
-
-    av_frame_free(&tempRgbFrame);
-    av_frame_free(&rgbFrame);
+    d3dProcessor_->UnmapBlendResult();
 
     return yuvFrame;
 }
@@ -325,6 +265,9 @@ bool VideoProcessor::ProcessVideo(const std::string& inputPath,
     if (!OpenInput(inputPath)) {
         return false;
     }
+    if (!SeekToSegment(inputFormatCtx_, videoStreamIndex_, segment_)) {
+        return false;
+    }
 
     // 打开输出
     if (!OpenOutput(outputPath)) {
@@ -334,37 +277,62 @@ bool VideoProcessor::ProcessVideo(const std::string& inputPath,
     // 创建D3D处理器
     d3dProcessor_ = new D3DProcessor();
     if (!d3dProcessor_->Initialize(width_, height_)) {
-        std::cerr << "初始化D3D处理器失败" << std::endl;
-        return false;
-    }
+        std::cerr << "初始化D3D处理器失败，改用CPU混合内核" << std::endl;
+        delete d3dProcessor_;
+        d3dProcessor_ = nullptr;
+        useCpuBlend_ = true;
+        GetBlendKernels();
+
+        // 覆盖索引只构建一次，每帧只处理非透明区间
+        int coverageW = std::min(watermarkWidth, width_);
+        int coverageH = std::min(watermarkHeight, height_);
+        if (prebuiltCoverage_ && prebuiltCoverage_->GetWidth() == coverageW && prebuiltCoverage_->GetHeight() == coverageH) {
+            wmCoverage_ = *prebuiltCoverage_;
+        } else {
+            wmCoverage_.Build(watermarkData + 3, coverageW, coverageH, 4, watermarkWidth * 4);
+        }
+        wmCoverage_.PrintSummary("RGB");
 
-    // 创建纹理（只创建一次，所有帧共享，每帧只更新数据）
-    std::cout << "创建GPU纹理..." << std::endl;
-    
-    // 创建水印纹理
-    if (!d3dProcessor_->CreateTextureFromRGBA(watermarkData, watermarkWidth, watermarkHeight,
-                                              &watermarkTexture_, &watermarkSRV_)) {
-        std::cerr << "创建水印纹理失败" << std::endl;
-        return false;
+        if (!blendPlan_.BuildPackedRGB24(watermarkData, watermarkWidth * 4, wmCoverage_.GetWidth(),
+                                         wmCoverage_.GetHeight(), BlendAlpha255(alpha))) {
+            std::cerr << "构建混合计划失败" << std::endl;
+            return false;
+        }
+        std::cout << "混合计划: " << blendPlan_.GetMemoryBytes() / 1024 << " KB" << std::endl;
     }
-    
-    // 创建视频纹理（空纹理，每帧更新数据）
-    std::vector<unsigned char> emptyData(width_ * height_ * 3, 0);
-    if (!d3dProcessor_->CreateTextureFromData(emptyData.data(), width_, height_,
-                                              &videoTexture_, &videoSRV_)) {
-        std::cerr << "创建视频纹理失败" << std::endl;
-        return false;
+
+    if (!useCpuBlend_) {
+        // 创建纹理（只创建一次，所有帧共享，每帧只更新数据）
+        std::cout << "创建GPU纹理..." << std::endl;
+        
+        // 创建水印纹理
+        if (!d3dProcessor_->CreateTextureFromRGBA(watermarkData, watermarkWidth, watermarkHeight,
+                                                  &watermarkTexture_, &watermarkSRV_)) {
+            std::cerr << "创建水印纹理失败" << std::endl;
+            return false;
+        }
+        
+        // 创建视频纹理（空纹理，每帧更新数据）
+        std::vector<unsigned char> emptyData(width_ * height_ * 3, 0);
+        if (!d3dProcessor_->CreateTextureFromData(emptyData.data(), width_, height_,
+                                                  &videoTexture_, &videoSRV_)) {
+            std::cerr << "创建视频纹理失败" << std::endl;
+            return false;
+        }
+        
+        std::cout << "GPU纹理创建成功" << std::endl;
     }
     
-    std::cout << "GPU纹理创建成功" << std::endl;
-    
     // 创建颜色空间转换上下文（只创建一次）
     std::cout << "创建颜色空间转换上下文..." << std::endl;
     
+    // CPU混合计划按RGB24构建；GPU纹理是R8G8B8A8，用RGBA可以直接上传和读回
+    AVPixelFormat rgbFormat = useCpuBlend_ ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_RGBA;
+
     // YUV -> RGB (原始视频是 full range，所以两边都用 full range)
     swsToRgbCtx_ = sws_getContext(
         width_, height_, pixelFormat_,
-        width_, height_, AV_PIX_FMT_RGB24,
+        width_, height_, rgbFormat,
         SWS_BILINEAR, nullptr, nullptr, nullptr
     );
     if (!swsToRgbCtx_) {
@@ -382,7 +350,7 @@ bool VideoProcessor::ProcessVideo(const std::string& inputPath,
     
     // RGB -> YUV (输出也用 full range 保持一致)
     swsToYuvCtx_ = sws_getContext(
-        width_, height_, AV_PIX_FMT_RGB24,
+        width_, height_, rgbFormat,
         width_, height_, AV_PIX_FMT_YUV420P,
         SWS_BILINEAR, nullptr, nullptr, nullptr
     );
@@ -398,94 +366,87 @@ bool VideoProcessor::ProcessVideo(const std::string& inputPath,
     
     std::cout << "颜色空间转换上下文创建成功" << std::endl;
 
+    // 每帧用到的RGB/YUV帧都从缓冲池获取，池中的缓冲区在流水线填满后就不再增加
+    if (!rgbPool_.Initialize(rgbFormat, width_, height_) ||
+        !yuvPool_.Initialize(AV_PIX_FMT_YUV420P, width_, height_)) {
+        std::cerr << "创建帧缓冲池失败" << std::endl;
+        return false;
+    }
+
     // 处理视频帧
     AVPacket* packet = av_packet_alloc();
-    AVFrame* frame = av_frame_alloc();
+    AVPacket* outPacket = av_packet_alloc();
 
     int64_t frameCount = 0;
+    // 预热帧数覆盖两个队列和三个阶段中同时存在的帧
+    AllocationMonitor allocMonitor(8 + 2 * pipelineDepth_);
+    AllocationScope allocScope(allocMonitor.GetCounter());
 
     std::cout << "开始处理视频帧..." << std::endl;
 
-    while (av_read_frame(inputFormatCtx_, packet) >= 0) {
-        if (packet->stream_index == videoStreamIndex_) {
-            // 发送数据包到解码器
-            if (avcodec_send_packet(decoderCtx_, packet) >= 0) {
-                // 接收解码后的帧
-                while (avcodec_receive_frame(decoderCtx_, frame) >= 0) {
-                    // 处理帧（添加水印），返回新的YUV帧
-                    AVFrame* processedFrame = ProcessFrame(frame, watermarkData, watermarkWidth, watermarkHeight, alpha);
-                    if (!processedFrame) {
-                        std::cerr << "处理帧失败" << std::endl;
-                        continue;
-                    }
-                    
-                    // 编码处理后的帧
-                    if (avcodec_send_frame(encoderCtx_, processedFrame) >= 0) {
-                        AVPacket* outPacket = av_packet_alloc();
-                        while (avcodec_receive_packet(encoderCtx_, outPacket) >= 0) {
-                            av_packet_rescale_ts(outPacket, encoderCtx_->time_base, 
-                                                outVideoStream_->time_base);
-                            outPacket->stream_index = outVideoStream_->index;
-                            av_interleaved_write_frame(outputFormatCtx_, outPacket);
-                            av_packet_unref(outPacket);
-                        }
-                        av_packet_free(&outPacket);
-                    }
-
-                    // 释放处理后的帧
-                    av_frame_free(&processedFrame);
-
-                    frameCount++;
-                    if (frameCount % 30 == 0) {
-                        std::cout << "已处理 " << frameCount << " 帧" << std::endl;
-                    }
-                }
-            }
+    auto decodeStage = [&](AVFrame** frame) {
+        return DecodeNextFrame(inputFormatCtx_, decoderCtx_, videoStreamIndex_, packet, frame, &segment_,
+                               &passthrough_);
+    };
+
+    auto blendStage = [&](AVFrame* frame, const PipelineEmitFn& emit) {
+        if (!frame) {
+            return true;
         }
-        av_packet_unref(packet);
-    }
 
-    // 刷新解码器
-    avcodec_send_packet(decoderCtx_, nullptr);
-    while (avcodec_receive_frame(decoderCtx_, frame) >= 0) {
+        // 处理帧（添加水印），返回新的YUV帧
         AVFrame* processedFrame = ProcessFrame(frame, watermarkData, watermarkWidth, watermarkHeight, alpha);
-        if (!processedFrame) continue;
-        
-        avcodec_send_frame(encoderCtx_, processedFrame);
-        AVPacket* outPacket = av_packet_alloc();
-        while (avcodec_receive_packet(encoderCtx_, outPacket) >= 0) {
-            av_packet_rescale_ts(outPacket, encoderCtx_->time_base, outVideoStream_->time_base);
-            outPacket->stream_index = outVideoStream_->index;
-            av_interleaved_write_frame(outputFormatCtx_, outPacket);
-            av_packet_unref(outPacket);
+        av_frame_free(&frame);
+        if (!processedFrame) {
+            std::cerr << "处理帧失败" << std::endl;
+            return true;
+        }
+        return emit(processedFrame);
+    };
+
+    auto encodeStage = [&](AVFrame* frame) {
+        // frame为nullptr时刷新编码器
+        if (avcodec_send_frame(encoderCtx_, frame) >= 0 || !frame) {
+            while (avcodec_receive_packet(encoderCtx_, outPacket) >= 0) {
+                av_packet_rescale_ts(outPacket, encoderCtx_->time_base,
+                                    outVideoStream_->time_base);
+                outPacket->stream_index = outVideoStream_->index;
+                passthrough_.WriteVideoPacket(outPacket);
+                av_packet_unref(outPacket);
+            }
         }
-        av_packet_free(&outPacket);
-        
-        // 释放处理后的帧
-        av_frame_free(&processedFrame);
-        
-        frameCount++;
-    }
 
-    // 刷新编码器
-    avcodec_send_frame(encoderCtx_, nullptr);
-    AVPacket* outPacket = av_packet_alloc();
-    while (avcodec_receive_packet(encoderCtx_, outPacket) >= 0) {
-        av_packet_rescale_ts(outPacket, encoderCtx_->time_base, outVideoStream_->time_base);
-        outPacket->stream_index = outVideoStream_->index;
-        av_interleaved_write_frame(outputFormatCtx_, outPacket);
-        av_packet_unref(outPacket);
-    }
+        if (frame) {
+            // 释放处理后的帧
+            av_frame_free(&frame);
+
+            frameCount++;
+            allocMonitor.OnFrameDone(frameCount);
+            if (frameCount % 30 == 0) {
+                std::cout << "已处理 " << frameCount << " 帧" << std::endl;
+            }
+        }
+        return true;
+    };
+
+    // D3D上下文和swscale上下文只在混合线程中使用
+    FramePipeline pipeline(pipelineDepth_);
+    bool ok = pipeline.Run(decodeStage, blendStage, encodeStage);
     av_packet_free(&outPacket);
+    av_packet_free(&packet);
+    pipeline.PrintStats();
+    passthrough_.PrintSummary();
+    allocMonitor.PrintSummary();
+    if (!ok) {
+        std::cerr << "处理视频帧失败" << std::endl;
+        return false;
+    }
 
     // 写入文件尾
     av_write_trailer(outputFormatCtx_);
 
     std::cout << "处理完成！总共 " << frameCount << " 帧" << std::endl;
 
-    av_frame_free(&frame);
-    av_packet_free(&packet);
-
     return true;
 }
 
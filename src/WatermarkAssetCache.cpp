@@ -0,0 +1,382 @@
+#include "WatermarkAssetCache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 文件格式：头部，然后是按64字节对齐的RGBA、每行第一个区间的序号（height+1项）、区间表
+// 格式或生成代码改变时增加版本号，旧文件不再命中
+static const char kMagic[8] = { 'D', 'X', 'W', 'M', 'A', 'S', 'T', '\0' };
+static const uint32_t kVersion = 1;
+static const uint64_t kAlignment = 64;
+static const uint32_t kFlagTiled = 1;
+
+struct AssetFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t keyHash;
+    int32_t width;
+    int32_t height;
+    uint64_t fileBytes;
+    uint64_t rgbaOffset;
+    uint64_t rowStartOffset;
+    uint64_t spanOffset;
+    uint32_t spanCount;
+    uint32_t reserved;
+};
+
+// CoverageSpan中的bool在不同编译器下的填充不一定相同，文件中固定用3个int32
+struct AssetFileSpan
+{
+    int32_t x;
+    int32_t length;
+    int32_t opaque;
+};
+
+static const uint64_t kFnvOffset = 14695981039346656037ULL;
+static const uint64_t kFnvPrime = 1099511628211ULL;
+
+static uint64_t Fnv1a(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+static uint64_t AlignUp(uint64_t value)
+{
+    return (value + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+WatermarkAsset::WatermarkAsset()
+    : rgba_(nullptr)
+    , width_(0)
+    , height_(0)
+    , tiled_(false)
+    , view_(nullptr)
+    , viewBytes_(0)
+{
+}
+
+WatermarkAsset::~WatermarkAsset()
+{
+    Release();
+}
+
+void WatermarkAsset::Release()
+{
+    if (view_) {
+#ifdef _WIN32
+        UnmapViewOfFile(view_);
+#else
+        munmap(const_cast<uint8_t*>(view_), viewBytes_);
+#endif
+        view_ = nullptr;
+        viewBytes_ = 0;
+    }
+    owned_.clear();
+    owned_.shrink_to_fit();
+    rgba_ = nullptr;
+    width_ = 0;
+    height_ = 0;
+    tiled_ = false;
+}
+
+bool WatermarkAsset::Map(const std::string& path, uint64_t keyHash)
+{
+    Release();
+
+    const void* view = nullptr;
+    size_t bytes = 0;
+#ifdef _WIN32
+    // 映射建立后文件和映射对象的句柄都可以关闭，视图一直有效直到UnmapViewOfFile
+    HANDLE file = CreateFileW(std::filesystem::path(path).wstring().c_str(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(AssetFileHeader))) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return false;
+    }
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) {
+        return false;
+    }
+    bytes = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(AssetFileHeader))) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    view = mapped;
+    bytes = static_cast<size_t>(st.st_size);
+#endif
+
+    view_ = static_cast<const uint8_t*>(view);
+    viewBytes_ = bytes;
+
+    // 检查头部和各部分的范围，截断或不匹配的文件当作未命中
+    const AssetFileHeader* header = reinterpret_cast<const AssetFileHeader*>(view_);
+    uint64_t rgbaBytes = static_cast<uint64_t>(header->width) * header->height * 4;
+    bool valid = memcmp(header->magic, kMagic, sizeof(kMagic)) == 0
+        && header->version == kVersion
+        && header->keyHash == keyHash
+        && header->fileBytes == bytes
+        && header->width > 0 && header->height > 0
+        && header->rgbaOffset % kAlignment == 0
+        && header->rowStartOffset % kAlignment == 0
+        && header->spanOffset % kAlignment == 0
+        && header->rgbaOffset + rgbaBytes <= bytes
+        && header->rowStartOffset + (static_cast<uint64_t>(header->height) + 1) * sizeof(int32_t) <= bytes
+        && header->spanOffset + static_cast<uint64_t>(header->spanCount) * sizeof(AssetFileSpan) <= bytes;
+    if (!valid) {
+        Release();
+        return false;
+    }
+
+    rgba_ = view_ + header->rgbaOffset;
+    width_ = header->width;
+    height_ = header->height;
+    tiled_ = (header->flags & kFlagTiled) != 0;
+    return true;
+}
+
+void WatermarkAsset::Adopt(std::vector<unsigned char>&& rgba, int width, int height, bool tiled)
+{
+    Release();
+    owned_ = std::move(rgba);
+    rgba_ = owned_.data();
+    width_ = width;
+    height_ = height;
+    tiled_ = tiled;
+}
+
+bool WatermarkAsset::GetCoverage(WatermarkCoverage& outCoverage) const
+{
+    if (!view_) {
+        return false;
+    }
+
+    const AssetFileHeader* header = reinterpret_cast<const AssetFileHeader*>(view_);
+    const int32_t* rowStart = reinterpret_cast<const int32_t*>(view_ + header->rowStartOffset);
+    const AssetFileSpan* fileSpans = reinterpret_cast<const AssetFileSpan*>(view_ + header->spanOffset);
+
+    std::vector<int> rows(rowStart, rowStart + height_ + 1);
+    if (rows.front() != 0 || rows.back() != static_cast<int>(header->spanCount)) {
+        return false;
+    }
+    for (int y = 0; y < height_; y++) {
+        if (rows[y] > rows[y + 1]) {
+            return false;
+        }
+    }
+
+    std::vector<CoverageSpan> spans(header->spanCount);
+    for (uint32_t i = 0; i < header->spanCount; i++) {
+        const AssetFileSpan& s = fileSpans[i];
+        if (s.x < 0 || s.length <= 0 || s.x + s.length > width_) {
+            return false;
+        }
+        spans[i] = { s.x, s.length, s.opaque != 0 };
+    }
+
+    outCoverage.Assign(std::move(spans), std::move(rows), width_, height_);
+    return true;
+}
+
+WatermarkAssetCache::WatermarkAssetCache(const std::string& directory)
+    : directory_(directory)
+{
+}
+
+uint64_t WatermarkAssetCache::HashBytes(const void* data, size_t size)
+{
+    return Fnv1a(kFnvOffset, data, size);
+}
+
+bool WatermarkAssetCache::HashFile(const std::string& path, uint64_t& outHash)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    uint64_t hash = kFnvOffset;
+    char buffer[64 * 1024];
+    while (file) {
+        file.read(buffer, sizeof(buffer));
+        hash = Fnv1a(hash, buffer, static_cast<size_t>(file.gcount()));
+    }
+    if (file.bad()) {
+        return false;
+    }
+    outHash = hash;
+    return true;
+}
+
+uint64_t WatermarkAssetCache::HashKey(const WatermarkAssetKey& key)
+{
+    std::ostringstream text;
+    text << "v" << kVersion << "|" << key.kind << "|" << std::hex << key.sourceHash << std::dec << "|"
+         << key.width << "x" << key.height << "|" << (key.tiled ? "tile" : "frame") << "|" << key.params;
+    std::string s = text.str();
+    return HashBytes(s.data(), s.size());
+}
+
+std::string WatermarkAssetCache::GetPath(uint64_t keyHash) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << keyHash << ".wmasset";
+    return (std::filesystem::path(directory_) / name.str()).string();
+}
+
+bool WatermarkAssetCache::Acquire(const WatermarkAssetKey& key, const GenerateFn& generate,
+                                  WatermarkAsset& asset) const
+{
+    std::vector<unsigned char> rgba;
+    int width = 0;
+    int height = 0;
+
+    if (directory_.empty()) {
+        if (!generate(rgba, width, height)) {
+            return false;
+        }
+        asset.Adopt(std::move(rgba), width, height, key.tiled);
+        return true;
+    }
+
+    uint64_t keyHash = HashKey(key);
+    std::string path = GetPath(keyHash);
+    if (asset.Map(path, keyHash)) {
+        std::cout << "水印资源缓存命中: " << path << " (" << asset.GetWidth() << "x" << asset.GetHeight()
+                  << ", " << asset.viewBytes_ / 1024 << " KB, 只读映射)" << std::endl;
+        return true;
+    }
+
+    std::cout << "水印资源缓存未命中，生成后写入: " << path << std::endl;
+    if (!generate(rgba, width, height)) {
+        return false;
+    }
+    if (Write(path, keyHash, rgba, width, height, key.tiled) && asset.Map(path, keyHash)) {
+        return true;
+    }
+
+    std::cerr << "写入水印资源缓存失败，使用内存中的水印" << std::endl;
+    asset.Adopt(std::move(rgba), width, height, key.tiled);
+    return true;
+}
+
+bool WatermarkAssetCache::Write(const std::string& path, uint64_t keyHash, const std::vector<unsigned char>& rgba,
+                                int width, int height, bool tiled) const
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+
+    WatermarkCoverage coverage;
+    coverage.Build(rgba.data() + 3, width, height, 4, width * 4);
+    const CoverageSpan* firstSpan = coverage.RowBegin(0);
+    uint32_t spanCount = static_cast<uint32_t>(coverage.RowEnd(height - 1) - firstSpan);
+
+    AssetFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.flags = tiled ? kFlagTiled : 0;
+    header.keyHash = keyHash;
+    header.width = width;
+    header.height = height;
+    header.rgbaOffset = AlignUp(sizeof(header));
+    header.rowStartOffset = AlignUp(header.rgbaOffset + rgba.size());
+    header.spanOffset = AlignUp(header.rowStartOffset + (static_cast<uint64_t>(height) + 1) * sizeof(int32_t));
+    header.spanCount = spanCount;
+    header.fileBytes = header.spanOffset + static_cast<uint64_t>(spanCount) * sizeof(AssetFileSpan);
+
+    std::vector<int32_t> rowStart(height + 1);
+    for (int y = 0; y < height; y++) {
+        rowStart[y] = static_cast<int32_t>(coverage.RowBegin(y) - firstSpan);
+    }
+    rowStart[height] = static_cast<int32_t>(spanCount);
+
+    std::vector<AssetFileSpan> spans(spanCount);
+    for (uint32_t i = 0; i < spanCount; i++) {
+        spans[i] = { firstSpan[i].x, firstSpan[i].length, firstSpan[i].opaque ? 1 : 0 };
+    }
+
+    // 先写到本进程的临时文件，写完再改名，其他进程不会映射到写了一半的文件
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+    std::string tempPath = path + "." + std::to_string(pid) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        std::vector<char> padding(kAlignment, 0);
+        auto pad = [&](uint64_t offset) {
+            file.write(padding.data(), static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+        };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        pad(header.rgbaOffset);
+        file.write(reinterpret_cast<const char*>(rgba.data()), static_cast<std::streamsize>(rgba.size()));
+        pad(header.rowStartOffset);
+        file.write(reinterpret_cast<const char*>(rowStart.data()),
+                   static_cast<std::streamsize>(rowStart.size() * sizeof(int32_t)));
+        pad(header.spanOffset);
+        file.write(reinterpret_cast<const char*>(spans.data()),
+                   static_cast<std::streamsize>(spans.size() * sizeof(AssetFileSpan)));
+        if (!file) {
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    // 其他进程正在映射同名文件时Windows上不能替换；那个文件的键相同，内容也相同，直接使用它
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return std::filesystem::exists(path, ec);
+    }
+
+    std::cout << "水印资源已写入缓存: " << width << "x" << height << ", " << header.fileBytes / 1024
+              << " KB, 覆盖索引 " << spanCount << " 个区间" << std::endl;
+    return true;
+}
@@ -0,0 +1,114 @@
+#include "WatermarkCoverage.h"
+#include <iostream>
+#include <iomanip>
+#include <utility>
+
+// 短于该长度的透明间隙并入相邻区间：alpha为0时混合结果不变，
+// 多混合几个像素比多一次内核调用更便宜
+static const int kMinTransparentGap = 16;
+// 短于该长度的不透明段不单独拆成区间，避免区间过碎
+static const int kMinOpaqueRun = 32;
+
+WatermarkCoverage::WatermarkCoverage()
+    : width_(0)
+    , height_(0)
+    , blendedPixels_(0)
+    , opaquePixels_(0)
+{
+}
+
+void WatermarkCoverage::Build(const uint8_t* alpha, int width, int height, int pixelStride, int rowStride)
+{
+    width_ = width;
+    height_ = height;
+    blendedPixels_ = 0;
+    opaquePixels_ = 0;
+    spans_.clear();
+    rowStart_.assign(height + 1, 0);
+
+    std::vector<std::pair<int, int>> runs;
+
+    for (int y = 0; y < height; y++) {
+        rowStart_[y] = static_cast<int>(spans_.size());
+        const uint8_t* row = alpha + static_cast<size_t>(y) * rowStride;
+
+        // 第一步：找出非透明段，合并较短的透明间隙
+        runs.clear();
+        int x = 0;
+        while (x < width) {
+            while (x < width && row[x * pixelStride] == 0) x++;
+            if (x >= width) break;
+
+            int start = x;
+            while (x < width && row[x * pixelStride] != 0) x++;
+
+            if (!runs.empty() && start - runs.back().second < kMinTransparentGap) {
+                runs.back().second = x;
+            } else {
+                runs.emplace_back(start, x);
+            }
+        }
+
+        // 第二步：把足够长的完全不透明段拆出来，走更便宜的均匀alpha路径
+        for (const auto& run : runs) {
+            int partialStart = run.first;
+            int pos = run.first;
+            while (pos < run.second) {
+                if (row[pos * pixelStride] != 255) {
+                    pos++;
+                    continue;
+                }
+
+                int opaqueStart = pos;
+                while (pos < run.second && row[pos * pixelStride] == 255) pos++;
+                if (pos - opaqueStart < kMinOpaqueRun) {
+                    continue;
+                }
+
+                if (opaqueStart > partialStart) {
+                    spans_.push_back({ partialStart, opaqueStart - partialStart, false });
+                }
+                spans_.push_back({ opaqueStart, pos - opaqueStart, true });
+                opaquePixels_ += pos - opaqueStart;
+                partialStart = pos;
+            }
+            if (run.second > partialStart) {
+                spans_.push_back({ partialStart, run.second - partialStart, false });
+            }
+            blendedPixels_ += run.second - run.first;
+        }
+    }
+    rowStart_[height] = static_cast<int>(spans_.size());
+}
+
+void WatermarkCoverage::Assign(std::vector<CoverageSpan>&& spans, std::vector<int>&& rowStart, int width, int height)
+{
+    spans_ = std::move(spans);
+    rowStart_ = std::move(rowStart);
+    width_ = width;
+    height_ = height;
+    blendedPixels_ = 0;
+    opaquePixels_ = 0;
+    for (const CoverageSpan& span : spans_) {
+        blendedPixels_ += span.length;
+        if (span.opaque) {
+            opaquePixels_ += span.length;
+        }
+    }
+}
+
+double WatermarkCoverage::GetSkippedFraction() const
+{
+    int64_t total = static_cast<int64_t>(width_) * height_;
+    if (total == 0) return 0.0;
+    return static_cast<double>(total - blendedPixels_) / static_cast<double>(total);
+}
+
+void WatermarkCoverage::PrintSummary(const char* label) const
+{
+    int64_t total = static_cast<int64_t>(width_) * height_;
+    std::cout << "[" << label << "] 水印覆盖索引: " << spans_.size() << " 个区间, 混合 "
+              << blendedPixels_ << " / " << total << " 像素 (其中不透明 " << opaquePixels_
+              << "), 跳过 " << std::fixed << std::setprecision(1)
+              << GetSkippedFraction() * 100.0 << "%" << std::defaultfloat << std::endl;
+}
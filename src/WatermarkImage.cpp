@@ -0,0 +1,447 @@
+#include "WatermarkImage.h"
+#include "MediaDecode.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+// 每个线程至少处理这么多输出行，小图不值得开线程
+static const int kMinRowsPerThread = 64;
+
+static const double kPi = 3.14159265358979323846;
+
+bool ParseResampleFilter(const std::string& name, ResampleFilter& outFilter)
+{
+    if (name == "box") {
+        outFilter = ResampleFilter::Box;
+    } else if (name == "bilinear") {
+        outFilter = ResampleFilter::Bilinear;
+    } else if (name == "cubic") {
+        outFilter = ResampleFilter::Cubic;
+    } else if (name == "lanczos") {
+        outFilter = ResampleFilter::Lanczos;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* GetResampleFilterName(ResampleFilter filter)
+{
+    switch (filter) {
+    case ResampleFilter::Box: return "box";
+    case ResampleFilter::Bilinear: return "bilinear";
+    case ResampleFilter::Cubic: return "cubic";
+    case ResampleFilter::Lanczos: return "lanczos";
+    }
+    return "unknown";
+}
+
+std::string GetWatermarkImageKey(ResampleFilter filter)
+{
+    return std::string("avcodec/rgba/stretch/premultiplied/") + GetResampleFilterName(filter);
+}
+
+// 滤波器在缩放比例为1时的半径（像素）
+static double FilterRadius(ResampleFilter filter)
+{
+    switch (filter) {
+    case ResampleFilter::Box: return 0.5;
+    case ResampleFilter::Bilinear: return 1.0;
+    case ResampleFilter::Cubic: return 2.0;
+    case ResampleFilter::Lanczos: return 3.0;
+    }
+    return 1.0;
+}
+
+static double Sinc(double x)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= kPi;
+    return std::sin(x) / x;
+}
+
+static double FilterWeight(ResampleFilter filter, double x)
+{
+    x = std::fabs(x);
+    switch (filter) {
+    case ResampleFilter::Box:
+        return x < 0.5 ? 1.0 : 0.0;
+    case ResampleFilter::Bilinear:
+        return x < 1.0 ? 1.0 - x : 0.0;
+    case ResampleFilter::Cubic:
+        // Catmull-Rom（a = -0.5），经过原来的采样点
+        if (x < 1.0) {
+            return (1.5 * x - 2.5) * x * x + 1.0;
+        }
+        if (x < 2.0) {
+            return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+        }
+        return 0.0;
+    case ResampleFilter::Lanczos:
+        return x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+    }
+    return 0.0;
+}
+
+// 一个方向上每个输出位置的抽头：从first开始的count个输入像素及其权重（和为1）
+struct FilterTaps
+{
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<float> weights;  // 每个输出位置maxTaps个
+    int maxTaps;
+};
+
+static FilterTaps BuildTaps(int srcSize, int dstSize, ResampleFilter filter)
+{
+    // 缩小时按比例拉宽滤波器，覆盖所有落到这个输出像素里的输入像素
+    double scale = static_cast<double>(srcSize) / dstSize;
+    double filterScale = std::max(scale, 1.0);
+    double support = FilterRadius(filter) * filterScale;
+
+    FilterTaps taps;
+    taps.maxTaps = static_cast<int>(std::ceil(support * 2.0)) + 2;
+    taps.first.resize(dstSize);
+    taps.count.resize(dstSize);
+    taps.weights.assign(static_cast<size_t>(dstSize) * taps.maxTaps, 0.0f);
+
+    std::vector<double> w(taps.maxTaps);
+    for (int i = 0; i < dstSize; i++) {
+        double center = (i + 0.5) * scale;
+        int left = std::max(0, static_cast<int>(std::floor(center - support)));
+        int right = std::min(srcSize, static_cast<int>(std::ceil(center + support)) + 1);
+        right = std::min(right, left + taps.maxTaps);
+
+        // 超出图片的抽头直接去掉，剩下的重新归一化（边缘像素不会变暗）
+        double sum = 0.0;
+        int n = 0;
+        int first = left;
+        for (int j = left; j < right; j++) {
+            double weight = FilterWeight(filter, (j + 0.5 - center) / filterScale);
+            if (n == 0 && weight == 0.0) {
+                first = j + 1;
+                continue;
+            }
+            w[n++] = weight;
+            sum += weight;
+        }
+        while (n > 0 && w[n - 1] == 0.0) {
+            n--;
+        }
+        if (n == 0 || sum == 0.0) {
+            first = std::min(std::max(static_cast<int>(center), 0), srcSize - 1);
+            w[0] = 1.0;
+            n = 1;
+            sum = 1.0;
+        }
+
+        taps.first[i] = first;
+        taps.count[i] = n;
+        float* out = &taps.weights[static_cast<size_t>(i) * taps.maxTaps];
+        for (int k = 0; k < n; k++) {
+            out[k] = static_cast<float>(w[k] / sum);
+        }
+    }
+    return taps;
+}
+
+// 水平滤波一行：先预乘alpha，再按抽头加权，输出预乘的RGBA（0-255的浮点数）
+static void FilterRow(const unsigned char* src, int srcWidth, const FilterTaps& taps, int dstWidth,
+                      float* premul, float* out)
+{
+    for (int x = 0; x < srcWidth; x++) {
+        float a = src[x * 4 + 3];
+        float f = a * (1.0f / 255.0f);
+        premul[x * 4 + 0] = src[x * 4 + 0] * f;
+        premul[x * 4 + 1] = src[x * 4 + 1] * f;
+        premul[x * 4 + 2] = src[x * 4 + 2] * f;
+        premul[x * 4 + 3] = a;
+    }
+
+    for (int x = 0; x < dstWidth; x++) {
+        const float* w = &taps.weights[static_cast<size_t>(x) * taps.maxTaps];
+        const float* p = premul + taps.first[x] * 4;
+        float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+        for (int k = 0; k < taps.count[x]; k++) {
+            r += w[k] * p[k * 4 + 0];
+            g += w[k] * p[k * 4 + 1];
+            b += w[k] * p[k * 4 + 2];
+            a += w[k] * p[k * 4 + 3];
+        }
+        out[x * 4 + 0] = r;
+        out[x * 4 + 1] = g;
+        out[x * 4 + 2] = b;
+        out[x * 4 + 3] = a;
+    }
+}
+
+static unsigned char RoundToByte(float v)
+{
+    return static_cast<unsigned char>(std::min(std::max(v + 0.5f, 0.0f), 255.0f));
+}
+
+// 处理输出行[rowBegin, rowEnd)；环形缓冲按输入行号取模存放水平滤波后的行，
+// 相邻输出行的垂直抽头大部分重叠，每个输入行在一个线程内只水平滤波一次
+static void ResampleRows(const unsigned char* src, int srcWidth,
+                         unsigned char* dst, int dstWidth,
+                         const FilterTaps& hTaps, const FilterTaps& vTaps,
+                         int rowBegin, int rowEnd)
+{
+    size_t rowFloats = static_cast<size_t>(dstWidth) * 4;
+    int ringSize = vTaps.maxTaps;
+    std::vector<float> ring(rowFloats * ringSize);
+    std::vector<int> ringRow(ringSize, -1);
+    std::vector<float> premul(static_cast<size_t>(srcWidth) * 4);
+    std::vector<float> acc(rowFloats);
+
+    for (int y = rowBegin; y < rowEnd; y++) {
+        int first = vTaps.first[y];
+        int count = vTaps.count[y];
+        const float* w = &vTaps.weights[static_cast<size_t>(y) * vTaps.maxTaps];
+
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        for (int k = 0; k < count; k++) {
+            int sy = first + k;
+            int slot = sy % ringSize;
+            float* row = &ring[rowFloats * slot];
+            if (ringRow[slot] != sy) {
+                FilterRow(src + static_cast<size_t>(sy) * srcWidth * 4, srcWidth, hTaps, dstWidth,
+                          premul.data(), row);
+                ringRow[slot] = sy;
+            }
+            float weight = w[k];
+            for (size_t i = 0; i < rowFloats; i++) {
+                acc[i] += weight * row[i];
+            }
+        }
+
+        // 还原为非预乘：Cubic/Lanczos的过冲让alpha和颜色一起超出范围，用未截断的alpha相除颜色才不失真；
+        // 颜色先限制在[0, alpha]，alpha输出时再截断到255
+        unsigned char* out = dst + static_cast<size_t>(y) * dstWidth * 4;
+        for (int x = 0; x < dstWidth; x++) {
+            const float* p = &acc[static_cast<size_t>(x) * 4];
+            float a = p[3];
+            if (a < 0.5f) {
+                out[x * 4 + 0] = out[x * 4 + 1] = out[x * 4 + 2] = out[x * 4 + 3] = 0;
+                continue;
+            }
+            float inv = 255.0f / a;
+            out[x * 4 + 0] = RoundToByte(std::min(std::max(p[0], 0.0f), a) * inv);
+            out[x * 4 + 1] = RoundToByte(std::min(std::max(p[1], 0.0f), a) * inv);
+            out[x * 4 + 2] = RoundToByte(std::min(std::max(p[2], 0.0f), a) * inv);
+            out[x * 4 + 3] = RoundToByte(a);
+        }
+    }
+}
+
+void ResampleRGBA(const unsigned char* src, int srcWidth, int srcHeight,
+                  unsigned char* dst, int dstWidth, int dstHeight,
+                  ResampleFilter filter, int threads)
+{
+    if (srcWidth == dstWidth && srcHeight == dstHeight) {
+        std::copy(src, src + static_cast<size_t>(srcWidth) * srcHeight * 4, dst);
+        return;
+    }
+
+    FilterTaps hTaps = BuildTaps(srcWidth, dstWidth, filter);
+    FilterTaps vTaps = BuildTaps(srcHeight, dstHeight, filter);
+
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    threads = std::max(1, std::min(threads, dstHeight / kMinRowsPerThread));
+    if (threads == 1) {
+        ResampleRows(src, srcWidth, dst, dstWidth, hTaps, vTaps, 0, dstHeight);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        int rowBegin = static_cast<int>(static_cast<int64_t>(dstHeight) * t / threads);
+        int rowEnd = static_cast<int>(static_cast<int64_t>(dstHeight) * (t + 1) / threads);
+        workers.emplace_back(ResampleRows, src, srcWidth, dst, dstWidth,
+                             std::cref(hTaps), std::cref(vTaps), rowBegin, rowEnd);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+bool DecodeImageFrames(const std::string& path, int maxFrames, std::vector<ImageFrame>& outFrames,
+                       int& outWidth, int& outHeight, int64_t& outLoopMs)
+{
+    AVFormatContext* formatCtx = nullptr;
+    AVCodecContext* decoderCtx = nullptr;
+    AVPacket* packet = nullptr;
+    AVFrame* frame = nullptr;
+    SwsContext* sws = nullptr;
+    auto cleanup = [&]() {
+        sws_freeContext(sws);
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        avcodec_free_context(&decoderCtx);
+        avformat_close_input(&formatCtx);
+    };
+
+    if (avformat_open_input(&formatCtx, path.c_str(), nullptr, nullptr) < 0) {
+        std::cerr << "无法打开图片文件: " << path << std::endl;
+        return false;
+    }
+    if (avformat_find_stream_info(formatCtx, nullptr) < 0) {
+        std::cerr << "无法获取图片信息: " << path << std::endl;
+        cleanup();
+        return false;
+    }
+
+    int streamIndex = -1;
+    for (unsigned int i = 0; i < formatCtx->nb_streams; i++) {
+        if (formatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            streamIndex = i;
+            break;
+        }
+    }
+    if (streamIndex == -1) {
+        std::cerr << "图片文件中没有图像: " << path << std::endl;
+        cleanup();
+        return false;
+    }
+
+    const AVCodec* decoder = avcodec_find_decoder(formatCtx->streams[streamIndex]->codecpar->codec_id);
+    decoderCtx = decoder ? avcodec_alloc_context3(decoder) : nullptr;
+    if (!decoderCtx || avcodec_parameters_to_context(decoderCtx, formatCtx->streams[streamIndex]->codecpar) < 0
+        || avcodec_open2(decoderCtx, decoder, nullptr) < 0) {
+        std::cerr << "无法打开图片解码器: " << path << std::endl;
+        cleanup();
+        return false;
+    }
+
+    packet = av_packet_alloc();
+    if (!packet) {
+        cleanup();
+        return false;
+    }
+
+    // GIF/APNG解码器输出的是已经按处置方式合成好的整幅画布，每一帧都可以单独显示
+    AVRational timeBase = formatCtx->streams[streamIndex]->time_base;
+    int64_t firstPts = AV_NOPTS_VALUE;
+    outFrames.clear();
+    while (static_cast<int>(outFrames.size()) < maxFrames) {
+        av_frame_free(&frame);
+        if (!DecodeNextFrame(formatCtx, decoderCtx, streamIndex, packet, &frame)) {
+            cleanup();
+            return false;
+        }
+        if (!frame) {
+            break;
+        }
+        if (outFrames.empty()) {
+            outWidth = frame->width;
+            outHeight = frame->height;
+        } else if (frame->width != outWidth || frame->height != outHeight) {
+            break;
+        }
+
+        // 调色板、灰度、16位等格式统一转换为8位RGBA，尺寸不变
+        sws = sws_getCachedContext(sws, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                   frame->width, frame->height, AV_PIX_FMT_RGBA,
+                                   SWS_POINT, nullptr, nullptr, nullptr);
+        if (!sws) {
+            std::cerr << "不支持的图片像素格式: " << path << std::endl;
+            cleanup();
+            return false;
+        }
+
+        ImageFrame decoded;
+        decoded.rgba.resize(static_cast<size_t>(outWidth) * outHeight * 4);
+        uint8_t* dstData[4] = { decoded.rgba.data(), nullptr, nullptr, nullptr };
+        int dstLinesize[4] = { outWidth * 4, 0, 0, 0 };
+        sws_scale(sws, frame->data, frame->linesize, 0, frame->height, dstData, dstLinesize);
+
+        int64_t pts = frame->best_effort_timestamp;
+        if (pts != AV_NOPTS_VALUE && firstPts == AV_NOPTS_VALUE) {
+            firstPts = pts;
+        }
+        decoded.startMs = pts == AV_NOPTS_VALUE ? 0 : av_rescale_q(pts - firstPts, timeBase, AVRational{ 1, 1000 });
+        if (!outFrames.empty() && decoded.startMs <= outFrames.back().startMs) {
+            decoded.startMs = outFrames.back().startMs + 100;
+        }
+        outFrames.push_back(std::move(decoded));
+    }
+
+    if (outFrames.empty()) {
+        std::cerr << "无法解码图片: " << path << std::endl;
+        cleanup();
+        return false;
+    }
+
+    // 最后一帧的显示时长取前面各帧的平均间隔，只有一帧时为100ms
+    int64_t lastStart = outFrames.back().startMs;
+    int64_t count = static_cast<int64_t>(outFrames.size());
+    outLoopMs = lastStart + (count > 1 ? std::max<int64_t>(lastStart / (count - 1), 1) : 100);
+
+    cleanup();
+    return true;
+}
+
+bool DecodeImageRGBA(const std::string& path, std::vector<unsigned char>& outData, int& outWidth, int& outHeight)
+{
+    std::vector<ImageFrame> frames;
+    int64_t loopMs = 0;
+    if (!DecodeImageFrames(path, 1, frames, outWidth, outHeight, loopMs)) {
+        return false;
+    }
+    outData = std::move(frames[0].rgba);
+    return true;
+}
+
+bool LoadWatermarkImage(const std::string& path, int targetWidth, int targetHeight,
+                        ResampleFilter filter, std::vector<unsigned char>& outData)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<unsigned char> image;
+    int imageWidth = 0;
+    int imageHeight = 0;
+    if (!DecodeImageRGBA(path, image, imageWidth, imageHeight)) {
+        return false;
+    }
+    auto decoded = std::chrono::steady_clock::now();
+    std::cout << "水印原始尺寸: " << imageWidth << "x" << imageHeight << std::endl;
+
+    // 直接拉伸到目标尺寸（填满整个画面）
+    std::cout << "水印拉伸到视频尺寸: " << targetWidth << "x" << targetHeight
+              << " (" << GetResampleFilterName(filter) << ")" << std::endl;
+    outData.resize(static_cast<size_t>(targetWidth) * targetHeight * 4);
+    ResampleRGBA(image.data(), imageWidth, imageHeight, outData.data(), targetWidth, targetHeight, filter, 0);
+    auto resampled = std::chrono::steady_clock::now();
+
+    // 检查水印数据是否有非透明像素
+    int64_t nonTransparentPixels = 0;
+    for (size_t i = 3; i < outData.size(); i += 4) {
+        if (outData[i] > 0) {
+            nonTransparentPixels++;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "水印加载成功，解码 " << std::chrono::duration<double, std::milli>(decoded - start).count()
+              << " ms, 缩放 " << std::chrono::duration<double, std::milli>(resampled - decoded).count()
+              << " ms, 非透明像素数: " << nonTransparentPixels << " / "
+              << static_cast<int64_t>(targetWidth) * targetHeight << std::defaultfloat << std::endl;
+
+    if (nonTransparentPixels == 0) {
+        std::cerr << "警告：水印完全透明！" << std::endl;
+    }
+    return true;
+}
@@ -5,6 +5,7 @@
 #include <io.h>
 #include <fcntl.h>
 #include <iomanip>
+#include <cmath>
 
 #pragma comment(lib, "d2d1.lib")
 #pragma comment(lib, "dwrite.lib")
@@ -37,9 +38,26 @@ bool WatermarkRenderer::Initialize()
     return true;
 }
 
+// 修改字体、字号、颜色、角度或间距时同时修改这里，让旧的缓存文件不再命中
+const char* WatermarkRenderer::GetTextStyleKey()
+{
+    return "Microsoft YaHei/bold/48/zh-cn/white/-45/step+150x+80/rect+50x+20";
+}
+
 bool WatermarkRenderer::CreateTiledWatermark(int width, int height,
                                             const std::wstring& text,
                                             std::vector<unsigned char>& outData)
+{
+    // 只渲染一个周期单元，再按单元重复展开到整幅画面
+    WatermarkTile tile;
+    if (!CreateWatermarkTile(text, tile)) {
+        return false;
+    }
+    ExpandWatermarkTile(tile, width, height, outData);
+    return true;
+}
+
+bool WatermarkRenderer::CreateWatermarkTile(const std::wstring& text, WatermarkTile& outTile)
 {
     // 调试：输出文本内容
     _setmode(_fileno(stdout), _O_U8TEXT);
@@ -49,15 +67,55 @@ bool WatermarkRenderer::CreateTiledWatermark(int width, int height,
                    << static_cast<int>(text[i]) << std::dec << std::endl;
     }
     _setmode(_fileno(stdout), _O_TEXT);
-    
+
+    // 创建文本格式（使用支持中文的字体）
+    ComPtr<IDWriteTextFormat> textFormat;
+    HRESULT hr = dwriteFactory_->CreateTextFormat(
+        L"Microsoft YaHei",  // 微软雅黑，支持中文
+        nullptr,
+        DWRITE_FONT_WEIGHT_BOLD,  // 加粗，更清晰
+        DWRITE_FONT_STYLE_NORMAL,
+        DWRITE_FONT_STRETCH_NORMAL,
+        48.0f,  // 增大字号，更明显
+        L"zh-cn",
+        textFormat.GetAddressOf()
+    );
+    if (FAILED(hr)) {
+        std::cerr << "创建文本格式失败，HRESULT: 0x" << std::hex << hr << std::endl;
+        return false;
+    }
+
+    // 计算文本尺寸
+    ComPtr<IDWriteTextLayout> textLayout;
+    hr = dwriteFactory_->CreateTextLayout(
+        text.c_str(),
+        static_cast<UINT32>(text.length()),
+        textFormat.Get(),
+        1000.0f,  // 最大宽度
+        100.0f,   // 最大高度
+        textLayout.GetAddressOf()
+    );
+    if (FAILED(hr)) return false;
+
+    DWRITE_TEXT_METRICS textMetrics;
+    textLayout->GetMetrics(&textMetrics);
+
+    // 平铺参数（根据文本大小调整间距），图案沿x、y分别以xStep、yStep为周期
+    int xStep = static_cast<int>(textMetrics.width + 150);  // 水平间距
+    int yStep = static_cast<int>(textMetrics.height + 80);   // 垂直间距
+
+    // 单元宽高取偶数：步长为奇数时单元包含两个周期
+    int tileWidth = (xStep % 2 == 0) ? xStep : xStep * 2;
+    int tileHeight = (yStep % 2 == 0) ? yStep : yStep * 2;
+
     // 创建WIC位图
     ComPtr<IWICImagingFactory> wicFactory;
-    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr,
-                                  CLSCTX_INPROC_SERVER, IID_PPV_ARGS(wicFactory.GetAddressOf()));
+    hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr,
+                          CLSCTX_INPROC_SERVER, IID_PPV_ARGS(wicFactory.GetAddressOf()));
     if (FAILED(hr)) return false;
 
     ComPtr<IWICBitmap> wicBitmap;
-    hr = wicFactory->CreateBitmap(width, height,
+    hr = wicFactory->CreateBitmap(tileWidth, tileHeight,
                                  GUID_WICPixelFormat32bppPBGRA,
                                  WICBitmapCacheOnDemand,
                                  wicBitmap.GetAddressOf());
@@ -73,23 +131,6 @@ bool WatermarkRenderer::CreateTiledWatermark(int width, int height,
     hr = d2dFactory_->CreateWicBitmapRenderTarget(wicBitmap.Get(), rtProps, renderTarget.GetAddressOf());
     if (FAILED(hr)) return false;
 
-    // 创建文本格式（使用支持中文的字体）
-    ComPtr<IDWriteTextFormat> textFormat;
-    hr = dwriteFactory_->CreateTextFormat(
-        L"Microsoft YaHei",  // 微软雅黑，支持中文
-        nullptr,
-        DWRITE_FONT_WEIGHT_BOLD,  // 加粗，更清晰
-        DWRITE_FONT_STYLE_NORMAL,
-        DWRITE_FONT_STRETCH_NORMAL,
-        48.0f,  // 增大字号，更明显
-        L"zh-cn",
-        textFormat.GetAddressOf()
-    );
-    if (FAILED(hr)) {
-        std::cerr << "创建文本格式失败，HRESULT: 0x" << std::hex << hr << std::endl;
-        return false;
-    }
-
     // 创建画刷（白色，不透明）
     // 注意：这里的透明度应该是1.0，最终透明度由用户的alpha参数控制
     ComPtr<ID2D1SolidColorBrush> brush;
@@ -102,52 +143,32 @@ bool WatermarkRenderer::CreateTiledWatermark(int width, int height,
     renderTarget->BeginDraw();
     renderTarget->Clear(D2D1::ColorF(0, 0, 0, 0)); // 透明背景
 
-    // 计算文本尺寸
-    ComPtr<IDWriteTextLayout> textLayout;
-    hr = dwriteFactory_->CreateTextLayout(
-        text.c_str(),
-        static_cast<UINT32>(text.length()),
-        textFormat.Get(),
-        1000.0f,  // 最大宽度
-        100.0f,   // 最大高度
-        textLayout.GetAddressOf()
+    // 绘制文本的矩形（从原点开始），旋转后落在以原点为圆心、对角线长为半径的圆内
+    D2D1_RECT_F textRect = D2D1::RectF(
+        0,
+        0,
+        textMetrics.width + 50,
+        textMetrics.height + 20
     );
-    
-    DWRITE_TEXT_METRICS textMetrics;
-    textLayout->GetMetrics(&textMetrics);
-    
-    // 平铺参数（根据文本大小调整间距）
-    int xStep = static_cast<int>(textMetrics.width + 150);  // 水平间距
-    int yStep = static_cast<int>(textMetrics.height + 80);   // 垂直间距
-    
+    float reach = std::sqrt(textRect.right * textRect.right + textRect.bottom * textRect.bottom);
+
     // 旋转角度：-45度（顺时针45度）
-    float angle = -45.0f * 3.14159f / 180.0f;
-    
-    // 扩大绘制范围以覆盖旋转后的区域
-    int extendedWidth = width * 2;
-    int extendedHeight = height * 2;
-    
-    // 平铺绘制文字（45度倾斜）
-    for (int y = -extendedHeight / 2; y < extendedHeight; y += yStep) {
-        for (int x = -extendedWidth / 2; x < extendedWidth; x += xStep) {
-            // 保存当前变换
-            renderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
-            
-            // 设置变换：先平移到文本位置，再旋转
-            D2D1::Matrix3x2F transform = 
-                D2D1::Matrix3x2F::Rotation(angle * 180.0f / 3.14159f, D2D1::Point2F(0, 0)) *
-                D2D1::Matrix3x2F::Translation(static_cast<float>(x), static_cast<float>(y));
-            
+    float angle = -45.0f;
+
+    // 文字放在 (i * xStep, j * yStep)，画出所有可能伸进单元的文字，超出单元的部分被裁掉，
+    // 单元左右、上下两边的像素正好首尾相接
+    int iMin = -static_cast<int>(std::ceil(reach / xStep)) - 1;
+    int iMax = static_cast<int>(std::ceil((tileWidth + reach) / xStep)) + 1;
+    int jMin = -static_cast<int>(std::ceil(reach / yStep)) - 1;
+    int jMax = static_cast<int>(std::ceil((tileHeight + reach) / yStep)) + 1;
+    for (int j = jMin; j <= jMax; j++) {
+        for (int i = iMin; i <= iMax; i++) {
+            // 设置变换：先旋转，再平移到文本位置
+            D2D1::Matrix3x2F transform =
+                D2D1::Matrix3x2F::Rotation(angle, D2D1::Point2F(0, 0)) *
+                D2D1::Matrix3x2F::Translation(static_cast<float>(i * xStep), static_cast<float>(j * yStep));
             renderTarget->SetTransform(transform);
-            
-            // 绘制文本（从原点开始）
-            D2D1_RECT_F textRect = D2D1::RectF(
-                0,
-                0,
-                textMetrics.width + 50,
-                textMetrics.height + 20
-            );
-            
+
             renderTarget->DrawText(
                 text.c_str(),
                 static_cast<UINT32>(text.length()),
@@ -157,7 +178,7 @@ bool WatermarkRenderer::CreateTiledWatermark(int width, int height,
             );
         }
     }
-    
+
     // 恢复变换
     renderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
 
@@ -165,170 +186,143 @@ bool WatermarkRenderer::CreateTiledWatermark(int width, int height,
     if (FAILED(hr)) return false;
 
     // 读取位图数据
-    outData.resize(width * height * 4);
-    
-    WICRect rect = { 0, 0, width, height };
-    UINT stride = width * 4;
-    std::vector<BYTE> buffer(stride * height);
-    
-    hr = wicBitmap->CopyPixels(&rect, stride, buffer.size(), buffer.data());
+    WICRect rect = { 0, 0, tileWidth, tileHeight };
+    UINT stride = tileWidth * 4;
+    std::vector<BYTE> buffer(stride * tileHeight);
+
+    hr = wicBitmap->CopyPixels(&rect, stride, static_cast<UINT>(buffer.size()), buffer.data());
     if (FAILED(hr)) return false;
 
     // 转换BGRA到RGBA（保留alpha通道）
+    int pixels = tileWidth * tileHeight;
+    outTile.width = tileWidth;
+    outTile.height = tileHeight;
+    outTile.rgba.resize(static_cast<size_t>(pixels) * 4);
     int nonTransparentPixels = 0;
-    for (int i = 0; i < width * height; i++) {
-        outData[i * 4 + 0] = buffer[i * 4 + 2]; // R
-        outData[i * 4 + 1] = buffer[i * 4 + 1]; // G
-        outData[i * 4 + 2] = buffer[i * 4 + 0]; // B
-        outData[i * 4 + 3] = buffer[i * 4 + 3]; // A
-        
+    for (int i = 0; i < pixels; i++) {
+        outTile.rgba[i * 4 + 0] = buffer[i * 4 + 2]; // R
+        outTile.rgba[i * 4 + 1] = buffer[i * 4 + 1]; // G
+        outTile.rgba[i * 4 + 2] = buffer[i * 4 + 0]; // B
+        outTile.rgba[i * 4 + 3] = buffer[i * 4 + 3]; // A
+
         if (buffer[i * 4 + 3] > 0) {
             nonTransparentPixels++;
         }
     }
-    
-    std::cout << "[调试] 生成的水印非透明像素数: " << nonTransparentPixels 
-              << " / " << (width * height) << std::endl;
+
+    std::cout << "[调试] 水印平铺单元 " << tileWidth << "x" << tileHeight << " (步长 " << xStep << "x" << yStep
+              << "), 非透明像素数: " << nonTransparentPixels << " / " << pixels << std::endl;
 
     return true;
 }
 
-bool WatermarkRenderer::LoadWatermarkFromPNG(const std::string& pngPath,
-                                             int targetWidth, int targetHeight,
-                                             std::vector<unsigned char>& outData)
+bool WatermarkRenderer::CreateGlyphAtlas(const std::wstring& charset, float fontSize, GlyphAtlas& outAtlas)
 {
-    // 创建WIC工厂
-    ComPtr<IWICImagingFactory> wicFactory;
-    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr,
-                                  CLSCTX_INPROC_SERVER, IID_PPV_ARGS(wicFactory.GetAddressOf()));
-    if (FAILED(hr)) {
-        std::cerr << "创建WIC工厂失败" << std::endl;
-        return false;
-    }
-
-    // 转换路径为宽字符
-    std::wstring wPngPath(pngPath.begin(), pngPath.end());
-
-    // 加载PNG文件
-    ComPtr<IWICBitmapDecoder> decoder;
-    hr = wicFactory->CreateDecoderFromFilename(
-        wPngPath.c_str(),
+    ComPtr<IDWriteTextFormat> textFormat;
+    HRESULT hr = dwriteFactory_->CreateTextFormat(
+        L"Microsoft YaHei",
         nullptr,
-        GENERIC_READ,
-        WICDecodeMetadataCacheOnDemand,
-        decoder.GetAddressOf()
+        DWRITE_FONT_WEIGHT_BOLD,
+        DWRITE_FONT_STYLE_NORMAL,
+        DWRITE_FONT_STRETCH_NORMAL,
+        fontSize,
+        L"zh-cn",
+        textFormat.GetAddressOf()
     );
     if (FAILED(hr)) {
-        std::cerr << "无法打开PNG文件: " << pngPath << std::endl;
+        std::cerr << "创建文本格式失败，HRESULT: 0x" << std::hex << hr << std::dec << std::endl;
         return false;
     }
 
-    // 获取第一帧
-    ComPtr<IWICBitmapFrameDecode> frame;
-    hr = decoder->GetFrame(0, frame.GetAddressOf());
-    if (FAILED(hr)) {
-        std::cerr << "无法读取PNG帧" << std::endl;
-        return false;
+    // 逐个字符测量前进宽度，所有单元的高度取最高的一行
+    const int pad = GlyphAtlas::kPadding;
+    std::vector<float> advances(charset.size());
+    float lineHeight = 0.0f;
+    for (size_t i = 0; i < charset.size(); i++) {
+        ComPtr<IDWriteTextLayout> layout;
+        hr = dwriteFactory_->CreateTextLayout(&charset[i], 1, textFormat.Get(),
+                                              1000.0f, 1000.0f, layout.GetAddressOf());
+        if (FAILED(hr)) return false;
+        DWRITE_TEXT_METRICS metrics;
+        layout->GetMetrics(&metrics);
+        advances[i] = metrics.widthIncludingTrailingWhitespace;
+        lineHeight = std::max(lineHeight, metrics.height);
     }
+    int cellHeight = static_cast<int>(std::ceil(lineHeight)) + 2 * pad;
 
-    // 获取原始尺寸
-    UINT originalWidth, originalHeight;
-    frame->GetSize(&originalWidth, &originalHeight);
-    std::cout << "水印原始尺寸: " << originalWidth << "x" << originalHeight << std::endl;
-
-    // 创建格式转换器（转换为32位BGRA）
-    ComPtr<IWICFormatConverter> converter;
-    hr = wicFactory->CreateFormatConverter(converter.GetAddressOf());
-    if (FAILED(hr)) {
-        std::cerr << "创建格式转换器失败" << std::endl;
-        return false;
+    // 单元按行排列，每行不超过1024像素
+    const int maxWidth = 1024;
+    std::vector<GlyphInfo> cells(charset.size());
+    int penX = 0, penY = 0, atlasWidth = 0;
+    for (size_t i = 0; i < charset.size(); i++) {
+        int cellWidth = static_cast<int>(std::ceil(advances[i])) + 2 * pad;
+        if (penX > 0 && penX + cellWidth > maxWidth) {
+            penX = 0;
+            penY += cellHeight;
+        }
+        cells[i] = { penX, penY, cellWidth, cellHeight, advances[i] };
+        penX += cellWidth;
+        atlasWidth = std::max(atlasWidth, penX);
     }
+    int atlasHeight = penY + cellHeight;
 
-    hr = converter->Initialize(
-        frame.Get(),
-        GUID_WICPixelFormat32bppBGRA,
-        WICBitmapDitherTypeNone,
-        nullptr,
-        0.0,
-        WICBitmapPaletteTypeCustom
-    );
-    if (FAILED(hr)) {
-        std::cerr << "初始化格式转换器失败" << std::endl;
-        return false;
-    }
+    ComPtr<IWICImagingFactory> wicFactory;
+    hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr,
+                          CLSCTX_INPROC_SERVER, IID_PPV_ARGS(wicFactory.GetAddressOf()));
+    if (FAILED(hr)) return false;
 
-    // 创建缩放器
-    ComPtr<IWICBitmapScaler> scaler;
-    hr = wicFactory->CreateBitmapScaler(scaler.GetAddressOf());
-    if (FAILED(hr)) {
-        std::cerr << "创建缩放器失败" << std::endl;
-        return false;
-    }
+    ComPtr<IWICBitmap> wicBitmap;
+    hr = wicFactory->CreateBitmap(atlasWidth, atlasHeight,
+                                 GUID_WICPixelFormat32bppPBGRA,
+                                 WICBitmapCacheOnDemand,
+                                 wicBitmap.GetAddressOf());
+    if (FAILED(hr)) return false;
 
-    // 直接拉伸到目标尺寸（填满整个画面）
-    UINT scaledWidth = targetWidth;
-    UINT scaledHeight = targetHeight;
-    
-    std::cout << "水印拉伸到视频尺寸: " << scaledWidth << "x" << scaledHeight << std::endl;
-
-    hr = scaler->Initialize(
-        converter.Get(),
-        scaledWidth,
-        scaledHeight,
-        WICBitmapInterpolationModeHighQualityCubic
+    D2D1_RENDER_TARGET_PROPERTIES rtProps = D2D1::RenderTargetProperties(
+        D2D1_RENDER_TARGET_TYPE_DEFAULT,
+        D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)
     );
-    if (FAILED(hr)) {
-        std::cerr << "初始化缩放器失败" << std::endl;
-        return false;
-    }
+    ComPtr<ID2D1RenderTarget> renderTarget;
+    hr = d2dFactory_->CreateWicBitmapRenderTarget(wicBitmap.Get(), rtProps, renderTarget.GetAddressOf());
+    if (FAILED(hr)) return false;
 
-    // 读取缩放后的位图数据
-    WICRect scaledRect = { 0, 0, static_cast<INT>(scaledWidth), static_cast<INT>(scaledHeight) };
-    UINT scaledStride = scaledWidth * 4;
-    std::vector<BYTE> scaledBuffer(scaledStride * scaledHeight);
-    
-    hr = scaler->CopyPixels(&scaledRect, scaledStride, scaledBuffer.size(), scaledBuffer.data());
-    if (FAILED(hr)) {
-        std::cerr << "复制缩放后的像素失败" << std::endl;
-        return false;
-    }
+    ComPtr<ID2D1SolidColorBrush> brush;
+    renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White, 1.0f), brush.GetAddressOf());
 
-    // 创建目标缓冲区（与视频尺寸相同，RGBA格式）
-    outData.resize(targetWidth * targetHeight * 4);
-    
-    // 复制整个水印，转换BGRA到RGBA
-    for (UINT y = 0; y < scaledHeight; y++) {
-        for (UINT x = 0; x < scaledWidth; x++) {
-            int srcIdx = (y * scaledWidth + x) * 4;
-            int dstIdx = (y * targetWidth + x) * 4;
-            
-            BYTE b = scaledBuffer[srcIdx + 0];
-            BYTE g = scaledBuffer[srcIdx + 1];
-            BYTE r = scaledBuffer[srcIdx + 2];
-            BYTE a = scaledBuffer[srcIdx + 3];
-            
-            // 转换BGRA到RGBA
-            outData[dstIdx + 0] = r;
-            outData[dstIdx + 1] = g;
-            outData[dstIdx + 2] = b;
-            outData[dstIdx + 3] = a;
-        }
+    // 透明背景上不能用ClearType，用灰度抗锯齿，alpha就是覆盖度
+    renderTarget->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+    renderTarget->BeginDraw();
+    renderTarget->Clear(D2D1::ColorF(0, 0, 0, 0));
+    for (size_t i = 0; i < charset.size(); i++) {
+        const GlyphInfo& cell = cells[i];
+        D2D1_RECT_F rect = D2D1::RectF(
+            static_cast<float>(cell.x + pad),
+            static_cast<float>(cell.y + pad),
+            static_cast<float>(cell.x + cell.width - pad),
+            static_cast<float>(cell.y + cell.height - pad)
+        );
+        renderTarget->DrawText(&charset[i], 1, textFormat.Get(), rect, brush.Get());
     }
+    hr = renderTarget->EndDraw();
+    if (FAILED(hr)) return false;
 
-    // 检查水印数据是否有非透明像素
-    int nonTransparentPixels = 0;
-    for (size_t i = 3; i < outData.size(); i += 4) {
-        if (outData[i] > 0) {
-            nonTransparentPixels++;
-        }
+    WICRect rect = { 0, 0, atlasWidth, atlasHeight };
+    UINT stride = atlasWidth * 4;
+    std::vector<BYTE> buffer(static_cast<size_t>(stride) * atlasHeight);
+    hr = wicBitmap->CopyPixels(&rect, stride, static_cast<UINT>(buffer.size()), buffer.data());
+    if (FAILED(hr)) return false;
+
+    outAtlas.Reset(atlasWidth, atlasHeight, cellHeight - 2 * pad);
+    uint8_t* coverage = outAtlas.GetCoverage();
+    for (size_t i = 0; i < static_cast<size_t>(atlasWidth) * atlasHeight; i++) {
+        coverage[i] = buffer[i * 4 + 3];
     }
-    
-    std::cout << "水印加载成功，非透明像素数: " << nonTransparentPixels 
-              << " / " << (targetWidth * targetHeight) << std::endl;
-    
-    if (nonTransparentPixels == 0) {
-        std::cerr << "警告：水印完全透明！" << std::endl;
+    for (size_t i = 0; i < charset.size(); i++) {
+        outAtlas.AddGlyph(charset[i], cells[i]);
     }
-    
+    outAtlas.BuildOutline();
+
+    std::cout << "字形图集: " << charset.size() << " 个字符, " << atlasWidth << "x" << atlasHeight
+              << ", 字号 " << fontSize << std::endl;
     return true;
-}
\ No newline at end of file
+}
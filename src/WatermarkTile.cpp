@@ -0,0 +1,15 @@
+#include "WatermarkTile.h"
+#include <algorithm>
+#include <cstring>
+
+void ExpandWatermarkTile(const WatermarkTile& tile, int width, int height, std::vector<unsigned char>& outData)
+{
+    outData.resize(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* src = tile.rgba.data() + static_cast<size_t>(y % tile.height) * tile.width * 4;
+        unsigned char* dst = outData.data() + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; x += tile.width) {
+            std::memcpy(dst + static_cast<size_t>(x) * 4, src, static_cast<size_t>(std::min(tile.width, width - x)) * 4);
+        }
+    }
+}
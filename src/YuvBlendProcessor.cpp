@@ -0,0 +1,691 @@
+#include "YuvBlendProcessor.h"
+#include "BlendKernels.h"
+#include "FramePipeline.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// 根据视频的色彩空间选择swscale系数表，保证水印转换到YUV时与视频一致
+static int SwsColorspaceFor(AVColorSpace colorspace, int height)
+{
+    switch (colorspace) {
+    case AVCOL_SPC_BT709:
+        return SWS_CS_ITU709;
+    case AVCOL_SPC_BT470BG:
+    case AVCOL_SPC_SMPTE170M:
+        return SWS_CS_ITU601;
+    case AVCOL_SPC_SMPTE240M:
+        return SWS_CS_SMPTE240M;
+    case AVCOL_SPC_FCC:
+        return SWS_CS_FCC;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        return SWS_CS_BT2020;
+    default:
+        // 未标注时按分辨率猜测：高清用BT.709，标清用BT.601
+        return height >= 720 ? SWS_CS_ITU709 : SWS_CS_ITU601;
+    }
+}
+
+// YUVJ格式与对应的YUV格式内存布局相同，只是默认full range
+static bool IsFullRangeFormat(AVPixelFormat fmt)
+{
+    return fmt == AV_PIX_FMT_YUVJ420P || fmt == AV_PIX_FMT_YUVJ422P || fmt == AV_PIX_FMT_YUVJ444P;
+}
+
+YuvBlendProcessor::YuvBlendProcessor()
+    : inputFormatCtx_(nullptr)
+    , outputFormatCtx_(nullptr)
+    , decoder_(nullptr)
+    , encoder_(nullptr)
+    , decoderCtx_(nullptr)
+    , encoderCtx_(nullptr)
+    , videoStream_(nullptr)
+    , outVideoStream_(nullptr)
+    , videoStreamIndex_(-1)
+    , outPacket_(nullptr)
+    , swsToBlendCtx_(nullptr)
+    , width_(0)
+    , height_(0)
+    , pixelFormat_(AV_PIX_FMT_NONE)
+    , blendFormat_(AV_PIX_FMT_NONE)
+    , chromaShiftW_(0)
+    , chromaShiftH_(0)
+    , wmPlaneWidth_{0, 0, 0}
+    , wmPlaneHeight_{0, 0, 0}
+    , alpha255_(0)
+    , watermarkTiled_(false)
+    , prebuiltCoverage_(nullptr)
+    , pipelineDepth_(0)
+    , segment_(WholeFileRange())
+    , targetFps_(0.0)
+    , adaptive_(false)
+    , globalHeader_(false)
+    , lastDts_(AV_NOPTS_VALUE)
+{
+}
+
+YuvBlendProcessor::~YuvBlendProcessor()
+{
+    Cleanup();
+}
+
+bool YuvBlendProcessor::OpenInput(const std::string& path)
+{
+    if (!OpenVideoDecoder(path, &inputFormatCtx_, videoStreamIndex_, &decoderCtx_)) {
+        return false;
+    }
+    videoStream_ = inputFormatCtx_->streams[videoStreamIndex_];
+    decoder_ = decoderCtx_->codec;
+
+    width_ = decoderCtx_->width;
+    height_ = decoderCtx_->height;
+    pixelFormat_ = decoderCtx_->pix_fmt;
+
+    // 8位平面YUV420可以直接原地混合，其它格式先转换到YUV420P（输出本来就是YUV420P）
+    if (pixelFormat_ == AV_PIX_FMT_YUV420P || pixelFormat_ == AV_PIX_FMT_YUVJ420P) {
+        blendFormat_ = pixelFormat_;
+    } else {
+        blendFormat_ = AV_PIX_FMT_YUV420P;
+    }
+    av_pix_fmt_get_chroma_sub_sample(blendFormat_, &chromaShiftW_, &chromaShiftH_);
+
+    std::cout << "输入视频: " << width_ << "x" << height_
+              << ", 格式: " << av_get_pix_fmt_name(pixelFormat_)
+              << ", 混合格式: " << av_get_pix_fmt_name(blendFormat_) << std::endl;
+
+    return true;
+}
+
+bool YuvBlendProcessor::OpenOutput(const std::string& path)
+{
+    // 创建输出格式上下文
+    avformat_alloc_output_context2(&outputFormatCtx_, nullptr, nullptr, path.c_str());
+    if (!outputFormatCtx_) {
+        std::cerr << "无法创建输出上下文" << std::endl;
+        return false;
+    }
+
+    // 查找编码器 (使用H.264)
+    encoder_ = avcodec_find_encoder(AV_CODEC_ID_H264);
+    if (!encoder_) {
+        std::cerr << "未找到H.264编码器" << std::endl;
+        return false;
+    }
+
+    // 创建输出视频流
+    outVideoStream_ = avformat_new_stream(outputFormatCtx_, nullptr);
+    if (!outVideoStream_) {
+        std::cerr << "无法创建输出流" << std::endl;
+        return false;
+    }
+
+    // 换档不改变SPS/PPS（见EncoderSpeedLevel），自适应时参数集同样只写在文件头里
+    globalHeader_ = (outputFormatCtx_->oformat->flags & AVFMT_GLOBALHEADER) != 0;
+    if (!OpenEncoder()) {
+        return false;
+    }
+
+    // 复制编码器参数到流
+    if (avcodec_parameters_from_context(outVideoStream_->codecpar, encoderCtx_) < 0) {
+        std::cerr << "无法复制编码器参数" << std::endl;
+        return false;
+    }
+
+    outVideoStream_->time_base = encoderCtx_->time_base;
+
+    // 音频、字幕等其他流以流复制方式直通；分段模式下由拼接阶段从原始输入直通
+    if (!passthrough_.Setup(inputFormatCtx_, outputFormatCtx_, videoStreamIndex_, IsWholeFile(segment_))) {
+        return false;
+    }
+
+    // 打开输出文件
+    if (!(outputFormatCtx_->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&outputFormatCtx_->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+            std::cerr << "无法打开输出文件: " << path << std::endl;
+            return false;
+        }
+    }
+
+    // 写入文件头
+    if (avformat_write_header(outputFormatCtx_, nullptr) < 0) {
+        std::cerr << "写入文件头失败" << std::endl;
+        return false;
+    }
+
+    std::cout << "输出视频: " << width_ << "x" << height_ << std::endl;
+
+    return true;
+}
+
+bool YuvBlendProcessor::OpenEncoder()
+{
+    // 创建编码器上下文
+    encoderCtx_ = avcodec_alloc_context3(encoder_);
+    if (!encoderCtx_) {
+        std::cerr << "无法分配编码器上下文" << std::endl;
+        return false;
+    }
+
+    // 设置编码参数
+    encoderCtx_->width = width_;
+    encoderCtx_->height = height_;
+    encoderCtx_->time_base = videoStream_->time_base;
+    encoderCtx_->framerate = av_guess_frame_rate(inputFormatCtx_, videoStream_, nullptr);
+    encoderCtx_->pix_fmt = AV_PIX_FMT_YUV420P;
+    encoderCtx_->bit_rate = 4000000; // 4 Mbps
+    encoderCtx_->gop_size = 12;
+    encoderCtx_->max_b_frames = 2;
+    // 分段输出要首尾相接地拼接，不使用B帧，保证各段的dts与pts一致且连续；
+    // 并行度来自分段之间，每个编码器只用一个线程，避免线程数远超核心数
+    if (!IsWholeFile(segment_)) {
+        encoderCtx_->max_b_frames = 0;
+        encoderCtx_->thread_count = 1;
+    }
+
+    // 像素没有经过RGB往返，保留原视频的颜色属性
+    encoderCtx_->color_range = IsFullRangeFormat(pixelFormat_) ? AVCOL_RANGE_JPEG : decoderCtx_->color_range;
+    encoderCtx_->color_primaries = decoderCtx_->color_primaries;
+    encoderCtx_->color_trc = decoderCtx_->color_trc;
+    encoderCtx_->colorspace = decoderCtx_->colorspace;
+
+    if (globalHeader_) {
+        encoderCtx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    // 设置H.264编码参数；自适应时预设不变，按当前档位设置分析选项和CRF，参数集和B帧数各档相同
+    int crf = 23;
+    AVDictionary* opts = nullptr;
+    av_dict_set(&opts, "preset", "medium", 0);
+    if (adaptive_) {
+        crf += speed_.GetLevel().crfOffset;
+        av_dict_set(&opts, "x264-params", speed_.GetX264Params(true).c_str(), 0);
+    }
+    av_dict_set_int(&opts, "crf", crf, 0);
+
+    // 打开编码器
+    if (avcodec_open2(encoderCtx_, encoder_, &opts) < 0) {
+        std::cerr << "无法打开编码器" << std::endl;
+        av_dict_free(&opts);
+        return false;
+    }
+    av_dict_free(&opts);
+
+    return true;
+}
+
+bool YuvBlendProcessor::ReopenEncoder()
+{
+    // 先取出旧编码器中剩余的包，新编码器从IDR帧开始，pts接着原来的时间线
+    if (!EncodeFrame(nullptr)) {
+        return false;
+    }
+    std::vector<uint8_t> extradata(encoderCtx_->extradata, encoderCtx_->extradata + encoderCtx_->extradata_size);
+    avcodec_free_context(&encoderCtx_);
+    if (!OpenEncoder()) {
+        return false;
+    }
+
+    // 文件头中只有第一个编码器的SPS/PPS，换档后必须完全相同
+    if (globalHeader_ && (encoderCtx_->extradata_size != static_cast<int>(extradata.size()) ||
+                          !std::equal(extradata.begin(), extradata.end(), encoderCtx_->extradata))) {
+        std::cerr << "换档后编码器的SPS/PPS与文件头中的不同，停止处理" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool YuvBlendProcessor::PrepareWatermark(const unsigned char* watermarkData,
+                                         int watermarkWidth, int watermarkHeight)
+{
+    // 只有logo、没有文字和图片水印时没有静态水印，每帧跳过水印混合
+    if (!watermarkData) {
+        std::cout << "没有静态水印，跳过水印混合" << std::endl;
+        return true;
+    }
+
+    // 水印转换到与视频相同的色彩空间和范围，这样可以直接与YUV平面混合
+    SwsContext* wmSws = sws_getContext(
+        watermarkWidth, watermarkHeight, AV_PIX_FMT_RGBA,
+        watermarkWidth, watermarkHeight, AV_PIX_FMT_YUV444P,
+        SWS_POINT, nullptr, nullptr, nullptr
+    );
+    if (!wmSws) {
+        std::cerr << "创建水印RGB->YUV转换上下文失败" << std::endl;
+        return false;
+    }
+
+    bool fullRange = IsFullRangeFormat(pixelFormat_) || decoderCtx_->color_range == AVCOL_RANGE_JPEG;
+    const int* table = sws_getCoefficients(SwsColorspaceFor(decoderCtx_->colorspace, height_));
+    sws_setColorspaceDetails(wmSws, table, 1, table, fullRange ? 1 : 0,
+                             0, 1 << 16, 1 << 16);
+
+    AVFrame* wm444 = av_frame_alloc();
+    wm444->format = AV_PIX_FMT_YUV444P;
+    wm444->width = watermarkWidth;
+    wm444->height = watermarkHeight;
+    if (av_frame_get_buffer(wm444, 0) < 0) {
+        std::cerr << "分配水印YUV缓冲区失败" << std::endl;
+        av_frame_free(&wm444);
+        sws_freeContext(wmSws);
+        return false;
+    }
+
+    const uint8_t* srcData[4] = { watermarkData, nullptr, nullptr, nullptr };
+    int srcLinesize[4] = { watermarkWidth * 4, 0, 0, 0 };
+    sws_scale(wmSws, srcData, srcLinesize, 0, watermarkHeight, wm444->data, wm444->linesize);
+    sws_freeContext(wmSws);
+
+    // 只混合水印与视频重叠的区域（与overlay=0:0语义一致）；
+    // 平铺的单元整个保留，混合时按单元尺寸取模重复，单元宽高为偶数，色度块不会跨过单元边界
+    int lumaW = watermarkTiled_ ? watermarkWidth : std::min(watermarkWidth, width_);
+    int lumaH = watermarkTiled_ ? watermarkHeight : std::min(watermarkHeight, height_);
+
+    // Y平面：直接复制，alpha取水印原始alpha
+    wmPlaneWidth_[0] = lumaW;
+    wmPlaneHeight_[0] = lumaH;
+    wmPlanes_[0].resize(lumaW * lumaH);
+    wmAlpha_[0].resize(lumaW * lumaH);
+    for (int y = 0; y < lumaH; y++) {
+        const uint8_t* ySrc = wm444->data[0] + y * wm444->linesize[0];
+        const unsigned char* rgba = watermarkData + y * watermarkWidth * 4;
+        for (int x = 0; x < lumaW; x++) {
+            wmPlanes_[0][y * lumaW + x] = ySrc[x];
+            wmAlpha_[0][y * lumaW + x] = rgba[x * 4 + 3];
+        }
+    }
+
+    // UV平面：按色度采样块下采样，颜色按alpha加权，避免透明像素的颜色渗入边缘
+    int blockW = 1 << chromaShiftW_;
+    int blockH = 1 << chromaShiftH_;
+    int chromaW = AV_CEIL_RSHIFT(lumaW, chromaShiftW_);
+    int chromaH = AV_CEIL_RSHIFT(lumaH, chromaShiftH_);
+    for (int p = 1; p < 3; p++) {
+        wmPlaneWidth_[p] = chromaW;
+        wmPlaneHeight_[p] = chromaH;
+        wmPlanes_[p].resize(chromaW * chromaH);
+        wmAlpha_[p].resize(chromaW * chromaH);
+    }
+
+    for (int cy = 0; cy < chromaH; cy++) {
+        for (int cx = 0; cx < chromaW; cx++) {
+            // 右边和下边的块在水印宽高为奇数时不完整，alpha按块内实际的像素数平均
+            int sumA = 0, sumU = 0, sumV = 0, count = 0;
+            for (int dy = 0; dy < blockH; dy++) {
+                int y = (cy << chromaShiftH_) + dy;
+                if (y >= lumaH) break;
+                for (int dx = 0; dx < blockW; dx++) {
+                    int x = (cx << chromaShiftW_) + dx;
+                    if (x >= lumaW) break;
+                    int a = watermarkData[(y * watermarkWidth + x) * 4 + 3];
+                    sumA += a;
+                    sumU += a * wm444->data[1][y * wm444->linesize[1] + x];
+                    sumV += a * wm444->data[2][y * wm444->linesize[2] + x];
+                    count++;
+                }
+            }
+            int idx = cy * chromaW + cx;
+            wmAlpha_[1][idx] = wmAlpha_[2][idx] = static_cast<unsigned char>((sumA + count / 2) / count);
+            wmPlanes_[1][idx] = static_cast<unsigned char>(sumA ? (sumU + sumA / 2) / sumA : 128);
+            wmPlanes_[2][idx] = static_cast<unsigned char>(sumA ? (sumV + sumA / 2) / sumA : 128);
+        }
+    }
+
+    av_frame_free(&wm444);
+
+    std::cout << "水印已转换为YUV平面: Y " << wmPlaneWidth_[0] << "x" << wmPlaneHeight_[0]
+              << ", UV " << chromaW << "x" << chromaH;
+    if (watermarkTiled_) {
+        std::cout << " (平铺单元)";
+    }
+    std::cout << std::endl;
+
+    // U/V共用同一个alpha平面，覆盖索引也相同
+    if (prebuiltCoverage_ && prebuiltCoverage_->GetWidth() == lumaW && prebuiltCoverage_->GetHeight() == lumaH) {
+        wmCoverage_[0] = *prebuiltCoverage_;
+    } else {
+        wmCoverage_[0].Build(wmAlpha_[0].data(), lumaW, lumaH, 1, lumaW);
+    }
+    wmCoverage_[1].Build(wmAlpha_[1].data(), chromaW, chromaH, 1, chromaW);
+    wmCoverage_[2] = wmCoverage_[1];
+    wmCoverage_[0].PrintSummary("Y");
+    wmCoverage_[1].PrintSummary("UV");
+    return true;
+}
+
+AVFrame* YuvBlendProcessor::BlendFrame(AVFrame* frame)
+{
+    AVFrame* target = frame;
+
+    if (frame->format == blendFormat_) {
+        // 解码器可能还持有该帧的引用（参考帧），此时复制到缓冲池中的帧再混合
+        // （av_frame_make_writable每次都会新分配缓冲区）
+        if (!av_frame_is_writable(frame)) {
+            target = blendPool_.Acquire();
+            if (!target) {
+                std::cerr << "从缓冲池获取帧失败" << std::endl;
+                return nullptr;
+            }
+            if (av_frame_copy(target, frame) < 0 || av_frame_copy_props(target, frame) < 0) {
+                std::cerr << "复制帧失败" << std::endl;
+                av_frame_free(&target);
+                return nullptr;
+            }
+        }
+    } else {
+        swsToBlendCtx_ = sws_getCachedContext(swsToBlendCtx_,
+            width_, height_, static_cast<AVPixelFormat>(frame->format),
+            width_, height_, blendFormat_,
+            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!swsToBlendCtx_) {
+            std::cerr << "创建像素格式转换上下文失败" << std::endl;
+            return nullptr;
+        }
+        target = blendPool_.Acquire();
+        if (!target) {
+            std::cerr << "从缓冲池获取帧失败" << std::endl;
+            return nullptr;
+        }
+        sws_scale(swsToBlendCtx_, frame->data, frame->linesize, 0, height_,
+                  target->data, target->linesize);
+        av_frame_copy_props(target, frame);
+    }
+
+    if (!wmPlanes_[0].empty()) {
+        BlendWatermark(target);
+    }
+    if (layers_.HasStaticLogos()) {
+        FrameRect whole = { 0, 0, width_, height_ };
+        layers_.DrawStaticLogos(GetLayerTarget(target), &whole, 1, width_, height_);
+    }
+    if (layers_.HasDynamicLayers()) {
+        DrawDynamicLayers(target);
+    }
+
+    // YUVJ420P与YUV420P布局相同，以带range标记的YUV420P送入编码器
+    if (target->format == AV_PIX_FMT_YUVJ420P) {
+        target->format = AV_PIX_FMT_YUV420P;
+        target->color_range = AVCOL_RANGE_JPEG;
+    }
+    target->pict_type = AV_PICTURE_TYPE_NONE;
+
+    return target;
+}
+
+void YuvBlendProcessor::BlendWatermark(AVFrame* target)
+{
+    auto blendStart = std::chrono::steady_clock::now();
+    const BlendKernels& kernels = GetBlendKernels();
+    for (int p = 0; p < 3; p++) {
+        if (!watermarkTiled_) {
+            for (int y = 0; y < wmCoverage_[p].GetHeight(); y++) {
+                BlendPlaneRow(kernels, target->data[p] + y * target->linesize[p], p, y, 0, wmPlaneWidth_[p]);
+            }
+            continue;
+        }
+
+        // 平铺：每一行按单元的行取模，沿水平方向逐个单元重复；单元只有几百KB，一直留在缓存中
+        int planeW = p == 0 ? width_ : AV_CEIL_RSHIFT(width_, chromaShiftW_);
+        int planeH = p == 0 ? height_ : AV_CEIL_RSHIFT(height_, chromaShiftH_);
+        for (int y = 0; y < planeH; y++) {
+            uint8_t* dst = target->data[p] + y * target->linesize[p];
+            int wmY = y % wmPlaneHeight_[p];
+            for (int x = 0; x < planeW; x += wmPlaneWidth_[p]) {
+                BlendPlaneRow(kernels, dst, p, wmY, x, planeW);
+            }
+        }
+    }
+
+    layers_.AddStaticTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - blendStart).count());
+}
+
+void YuvBlendProcessor::BlendPlaneRow(const BlendKernels& kernels, uint8_t* dst, int p, int wmY,
+                                      int xOffset, int limit) const
+{
+    // 与WatermarkPS.hlsl相同：lerp(video, watermark, watermark.a * alpha)
+    // 只处理覆盖索引中的区间；不透明区间的系数恒为alpha255，走均匀alpha内核
+    const WatermarkCoverage& coverage = wmCoverage_[p];
+    const unsigned char* wm = wmPlanes_[p].data() + wmY * wmPlaneWidth_[p];
+    const unsigned char* wmA = wmAlpha_[p].data() + wmY * wmPlaneWidth_[p];
+    dst += xOffset;
+    limit -= xOffset;
+    for (const CoverageSpan* s = coverage.RowBegin(wmY); s != coverage.RowEnd(wmY); ++s) {
+        int length = std::min(s->length, limit - s->x);
+        if (length <= 0) {
+            break;
+        }
+        if (!s->opaque) {
+            kernels.planar(dst + s->x, wm + s->x, wmA + s->x, alpha255_, length);
+        } else if (alpha255_ == 255) {
+            memcpy(dst + s->x, wm + s->x, length);
+        } else {
+            kernels.planarUniform(dst + s->x, wm + s->x, alpha255_, length);
+        }
+    }
+}
+
+void YuvBlendProcessor::DrawDynamicLayers(AVFrame* frame)
+{
+    // 帧号和媒体时间都从时间戳换算，不依赖处理顺序，分段处理的结果与整文件处理相同
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (pts == AV_NOPTS_VALUE) {
+        pts = 0;
+    }
+    if (videoStream_->start_time != AV_NOPTS_VALUE) {
+        pts -= videoStream_->start_time;
+    }
+    int64_t mediaTimeMs = av_rescale_q(pts, videoStream_->time_base, AVRational{ 1, 1000 });
+    AVRational rate = videoStream_->avg_frame_rate.num > 0 ? videoStream_->avg_frame_rate : videoStream_->r_frame_rate;
+    int64_t frameNumber = rate.num > 0 && rate.den > 0 ? av_rescale_q(pts, videoStream_->time_base, av_inv_q(rate)) : 0;
+
+    layers_.Prepare(frameNumber, mediaTimeMs, width_, height_);
+    layers_.Draw(GetLayerTarget(frame));
+}
+
+LayerTarget YuvBlendProcessor::GetLayerTarget(AVFrame* frame) const
+{
+    // 与水印转换到YUV时使用相同的范围和颜色矩阵
+    LayerTarget target;
+    target.data = frame->data;
+    target.linesize = frame->linesize;
+    target.chromaShiftW = chromaShiftW_;
+    target.chromaShiftH = chromaShiftH_;
+    target.fullRange = IsFullRangeFormat(pixelFormat_) || decoderCtx_->color_range == AVCOL_RANGE_JPEG;
+    target.bt709 = SwsColorspaceFor(decoderCtx_->colorspace, height_) == SWS_CS_ITU709;
+    return target;
+}
+
+bool YuvBlendProcessor::EncodeFrame(AVFrame* frame)
+{
+    int ret = avcodec_send_frame(encoderCtx_, frame);
+    if (ret < 0 && ret != AVERROR_EOF) {
+        std::cerr << "发送帧到编码器失败" << std::endl;
+        return false;
+    }
+
+    while (avcodec_receive_packet(encoderCtx_, outPacket_) >= 0) {
+        // 换编码器后新编码器的dts从它自己的起点算起，输入帧间隔不均匀时个别情况下不大于上一个包；
+        // 这时调整到上一个dts之后；pts不大于上一个dts时无法调整（dts不能大于pts），报错停止，不把无效的包交给封装器
+        if (adaptive_ && outPacket_->dts != AV_NOPTS_VALUE) {
+            if (lastDts_ != AV_NOPTS_VALUE && outPacket_->dts <= lastDts_) {
+                if (outPacket_->pts != AV_NOPTS_VALUE && outPacket_->pts <= lastDts_) {
+                    std::cerr << "换档后dts无法保持递增: pts " << outPacket_->pts << ", 上一个dts " << lastDts_ << std::endl;
+                    av_packet_unref(outPacket_);
+                    return false;
+                }
+                outPacket_->dts = lastDts_ + 1;
+            }
+            lastDts_ = outPacket_->dts;
+        }
+        av_packet_rescale_ts(outPacket_, encoderCtx_->time_base, outVideoStream_->time_base);
+        outPacket_->stream_index = outVideoStream_->index;
+        int ret = passthrough_.WriteVideoPacket(outPacket_);
+        av_packet_unref(outPacket_);
+        if (ret < 0) {
+            std::cerr << "写入数据包失败" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool YuvBlendProcessor::ProcessVideo(const std::string& inputPath,
+                                     const std::string& outputPath,
+                                     const unsigned char* watermarkData,
+                                     int watermarkWidth,
+                                     int watermarkHeight,
+                                     float alpha)
+{
+    // 打开输入
+    if (!OpenInput(inputPath)) {
+        return false;
+    }
+    if (!SeekToSegment(inputFormatCtx_, videoStreamIndex_, segment_)) {
+        return false;
+    }
+
+    // 编码速度自适应：起始预设与固定设置相同，只在跟不上目标帧率时换快
+    adaptive_ = targetFps_ > 0.0 && IsWholeFile(segment_);
+    if (adaptive_) {
+        if (!speed_.Initialize("medium", targetFps_, 0)) {
+            return false;
+        }
+        std::cout << "编码速度自适应: 目标 " << targetFps_ << " fps, 从 medium 开始" << std::endl;
+    }
+
+    // 打开输出
+    if (!OpenOutput(outputPath)) {
+        return false;
+    }
+
+    // 水印只转换一次，所有帧共享
+    alpha255_ = BlendAlpha255(alpha);
+    if (!PrepareWatermark(watermarkData, watermarkWidth, watermarkHeight)) {
+        return false;
+    }
+
+    // 格式转换和复制参考帧时使用的缓冲池，流水线填满后不再分配
+    if (!blendPool_.Initialize(blendFormat_, width_, height_)) {
+        std::cerr << "创建帧缓冲池失败" << std::endl;
+        return false;
+    }
+
+    // 处理视频帧
+    AVPacket* packet = av_packet_alloc();
+    outPacket_ = av_packet_alloc();
+
+    int64_t frameCount = 0;
+    // 预热帧数覆盖两个队列和三个阶段中同时存在的帧
+    AllocationMonitor allocMonitor(8 + 2 * pipelineDepth_);
+    AllocationScope allocScope(allocMonitor.GetCounter());
+
+    std::cout << "开始处理视频帧（YUV域混合）..." << std::endl;
+
+    auto decodeStage = [&](AVFrame** frame) {
+        return DecodeNextFrame(inputFormatCtx_, decoderCtx_, videoStreamIndex_, packet, frame, &segment_,
+                               &passthrough_);
+    };
+
+    auto blendStage = [&](AVFrame* frame, const PipelineEmitFn& emit) {
+        if (!frame) {
+            return true;
+        }
+
+        AVFrame* blended = BlendFrame(frame);
+        if (!blended) {
+            std::cerr << "处理帧失败" << std::endl;
+            av_frame_free(&frame);
+            return true;
+        }
+        if (blended != frame) {
+            // 结果在缓冲池的帧中，解码帧不再需要
+            av_frame_free(&frame);
+        }
+        return emit(blended);
+    };
+
+    auto encodeStage = [&](AVFrame* frame) {
+        // GOP边界换档，新编码器从这一帧开始
+        if (adaptive_ && frame && frameCount > 0 && frameCount % encoderCtx_->gop_size == 0 &&
+            speed_.OnGopBoundary() && !ReopenEncoder()) {
+            av_frame_free(&frame);
+            return false;
+        }
+
+        // frame为nullptr时刷新编码器
+        auto t = std::chrono::steady_clock::now();
+        if (!EncodeFrame(frame)) {
+            av_frame_free(&frame);
+            return false;
+        }
+        if (adaptive_ && frame) {
+            // 离线处理时混合->编码的队列总是满的，只看编码耗时
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - t;
+            speed_.OnFrameEncoded(elapsed.count(), 0);
+        }
+        if (frame) {
+            av_frame_free(&frame);
+            frameCount++;
+            allocMonitor.OnFrameDone(frameCount);
+            if (frameCount % 30 == 0) {
+                std::cout << "已处理 " << frameCount << " 帧" << std::endl;
+            }
+        }
+        return true;
+    };
+
+    FramePipeline pipeline(pipelineDepth_);
+    bool ok = pipeline.Run(decodeStage, blendStage, encodeStage);
+    av_packet_free(&packet);
+    pipeline.PrintStats();
+    if (adaptive_) {
+        speed_.PrintSummary();
+    }
+    layers_.PrintSummary();
+    passthrough_.PrintSummary();
+    allocMonitor.PrintSummary();
+    if (!ok) {
+        std::cerr << "处理视频帧失败" << std::endl;
+        return false;
+    }
+
+    // 写入文件尾
+    av_write_trailer(outputFormatCtx_);
+
+    std::cout << "处理完成！总共 " << frameCount << " 帧" << std::endl;
+
+    return true;
+}
+
+void YuvBlendProcessor::Cleanup()
+{
+    if (outPacket_) {
+        av_packet_free(&outPacket_);
+    }
+
+    if (swsToBlendCtx_) {
+        sws_freeContext(swsToBlendCtx_);
+        swsToBlendCtx_ = nullptr;
+    }
+
+    if (decoderCtx_) {
+        avcodec_free_context(&decoderCtx_);
+    }
+
+    if (encoderCtx_) {
+        avcodec_free_context(&encoderCtx_);
+    }
+
+    if (inputFormatCtx_) {
+        avformat_close_input(&inputFormatCtx_);
+    }
+
+    if (outputFormatCtx_) {
+        if (!(outputFormatCtx_->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&outputFormatCtx_->pb);
+        }
+        avformat_free_context(outputFormatCtx_);
+        outputFormatCtx_ = nullptr;
+    }
+}
@@ -1,174 +1,813 @@
-#include "VideoProcessor.h"
 #include "FFmpegWatermarkProcessor.h"
-#include "WatermarkRenderer.h"
+#include "YuvBlendProcessor.h"
+#include "SegmentParallelProcessor.h"
+#include "BlendKernels.h"
+#include "ConvertBenchmark.h"
+#include "WatermarkAssetCache.h"
+#include "WatermarkImage.h"
+#include "WatermarkTile.h"
 #include "ScreenRecorder.h"
-#include "DXGICapture.h"
+#include "LayerCompositor.h"
+#include "AnimatedLogoLayer.h"
+#include "TextOverlay.h"
+#include "SyntheticFrameSource.h"
+#include "FileFrameSource.h"
+#ifdef _WIN32
+#include "VideoProcessor.h"
+#include "WatermarkRenderer.h"
+#include "DXGIFrameSource.h"
+#else
+class WatermarkRenderer;  // 文字渲染依赖DirectWrite，只在Windows上可用
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cwchar>
 #include <iostream>
-#include <Windows.h>
+#include <memory>
+#include <thread>
 #include <filesystem>
+#ifdef _WIN32
+#include <Windows.h>
+#include <conio.h>
 #include <shellapi.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+// 使用GetCommandLineW获取Unicode命令行参数
+static bool GetWideArgs(int, char*[], std::vector<std::wstring>& args)
+{
+    int wargc = 0;
+    LPWSTR* wargv = CommandLineToArgvW(GetCommandLineW(), &wargc);
+    if (wargv == nullptr) {
+        return false;
+    }
+    args.assign(wargv, wargv + wargc);
+    LocalFree(wargv);
+    return true;
+}
+
+// 将wstring转换为UTF-8 string
+static std::string WStringToUTF8(const std::wstring& wstr)
+{
+    if (wstr.empty()) return std::string();
+    int size = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
+    std::string result(size - 1, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, &result[0], size, nullptr, nullptr);
+    return result;
+}
+
+// 控制台有按键时取出一个
+static bool PollKey(int& key)
+{
+    if (!_kbhit()) {
+        return false;
+    }
+    key = _getch();
+    return true;
+}
+#else
+// argv是UTF-8，wchar_t是UTF-32，逐个码点解码（不依赖进程的locale）
+static bool GetWideArgs(int argc, char* argv[], std::vector<std::wstring>& args)
+{
+    args.clear();
+    for (int i = 0; i < argc; i++) {
+        std::wstring arg;
+        for (const unsigned char* p = reinterpret_cast<const unsigned char*>(argv[i]); *p;) {
+            uint32_t cp = *p++;
+            int extra = 0;
+            if (cp >= 0xF0) {
+                cp &= 0x07;
+                extra = 3;
+            } else if (cp >= 0xE0) {
+                cp &= 0x0F;
+                extra = 2;
+            } else if (cp >= 0xC0) {
+                cp &= 0x1F;
+                extra = 1;
+            } else if (cp >= 0x80) {
+                cp = 0xFFFD;
+            }
+            for (; extra > 0 && (*p & 0xC0) == 0x80; extra--) {
+                cp = (cp << 6) | (*p++ & 0x3F);
+            }
+            arg.push_back(static_cast<wchar_t>(extra > 0 ? 0xFFFD : cp));
+        }
+        args.push_back(arg);
+    }
+    return true;
+}
+
+// 将wstring（UTF-32）转换为UTF-8 string
+static std::string WStringToUTF8(const std::wstring& wstr)
+{
+    std::string result;
+    for (wchar_t wc : wstr) {
+        uint32_t cp = static_cast<uint32_t>(wc);
+        if (cp < 0x80) {
+            result.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            result.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            result.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            result.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            result.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            result.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            result.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+    return result;
+}
+
+// 标准输入有数据时取出一个字符（终端是行缓冲的，按键后需要回车）
+static bool PollKey(int& key)
+{
+    pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+    unsigned char c = 0;
+    if (poll(&fd, 1, 0) <= 0 || read(STDIN_FILENO, &c, 1) != 1) {
+        return false;
+    }
+    key = c;
+    return true;
+}
+#endif
 
 int main(int argc, char* argv[])
 {
+#ifdef _WIN32
     // 设置控制台代码页为 UTF-8，解决中文乱码问题
     SetConsoleOutputCP(CP_UTF8);
     SetConsoleCP(CP_UTF8);
+#endif
     
-    // 使用GetCommandLineW获取Unicode命令行参数
-    int wargc = 0;
-    LPWSTR* wargv = CommandLineToArgvW(GetCommandLineW(), &wargc);
-    if (wargv == nullptr) {
+    // Unicode命令行参数
+    std::vector<std::wstring> wargv;
+    if (!GetWideArgs(argc, argv, wargv)) {
         std::cerr << "获取命令行参数失败" << std::endl;
         return 1;
     }
+    int wargc = static_cast<int>(wargv.size());
     
-    // 初始化COM
+#ifdef _WIN32
+    // 初始化COM，main返回时释放
     CoInitialize(nullptr);
+    struct ComScope
+    {
+        ~ComScope() { CoUninitialize(); }
+    } comScope;
+#endif
 
     if (wargc < 2) {
         std::cout << "=== 视频水印处理工具 ===" << std::endl;
         std::cout << "\n模式1: 视频文件添加水印" << std::endl;
-        std::cout << "用法: " << argv[0] << " <输入视频> [透明度] [方法] [文字水印]" << std::endl;
+        std::cout << "用法: " << argv[0] << " <输入视频> [透明度] [方法] [文字水印] [--pipeline 队列深度] [--segments 并行数] [--range 开始-结束]... [--target-fps 帧率] [--asset-cache 目录] [--scale-filter 滤波器] [--overlay 模板] [--overlay-pos x,y] [--logo 图片] [--logo-pos x,y]" << std::endl;
         std::cout << "参数说明:" << std::endl;
         std::cout << "  输入视频: 要处理的视频文件路径" << std::endl;
         std::cout << "  透明度: 水印透明度 (0.0-1.0)，默认0.3" << std::endl;
         std::cout << "  方法: 处理方法，可选值：" << std::endl;
-        std::cout << "    dx     - 使用DirectX GPU加速 (默认)" << std::endl;
+        std::cout << "    dx     - 使用DirectX GPU加速 (Windows默认，仅Windows)" << std::endl;
         std::cout << "    ffmpeg - 使用FFmpeg filter" << std::endl;
-        std::cout << "  文字水印: 可选，如果提供则生成文字水印（45度倾斜平铺）" << std::endl;
+        std::cout << "    yuv    - 在YUV平面上直接混合（CPU，不需要GPU，其他平台默认）" << std::endl;
+        std::cout << "  文字水印: 可选，如果提供则生成文字水印（45度倾斜平铺，仅Windows）" << std::endl;
         std::cout << "           如果不提供则使用watermark_1.png图片水印" << std::endl;
+        std::cout << "  --pipeline: 可选，解码/混合/编码各用一个线程，阶段之间的队列深度（如4）" << std::endl;
+        std::cout << "  --segments: 可选，按GOP切分后多线程并行处理再拼接，0表示使用全部CPU核心" << std::endl;
+        std::cout << "  --range: 可选，可重复，只给这些时间区间（秒）加水印，其余GOP直接复制（仅H.264输入）" << std::endl;
+        std::cout << "  --target-fps: 可选，目标处理帧率，编码跟不上时自动降低x264分析强度（仅yuv方法，不能与分段同时使用）" << std::endl;
+        std::cout << "  --asset-cache: 可选，水印资源缓存目录，缓存缩放/渲染好的水印，之后的运行（包括并行的多个进程）直接只读映射" << std::endl;
+        std::cout << "  --scale-filter: 可选，图片水印拉伸到视频尺寸时的滤波器：box、bilinear、cubic（默认）、lanczos" << std::endl;
+        std::cout << "  --overlay: 可选，逐帧变化的文字（仅yuv方法），{time}为本地时间，{frame}为帧号，{pts}为媒体时间" << std::endl;
+        std::cout << "  --overlay-pos: 可选，文字左上角的位置（像素），默认16,16" << std::endl;
+        std::cout << "  --logo: 可选，叠加的logo图片（原尺寸），在平铺水印之上只混合logo的包围盒（dx方法合并进整幅水印）；" << std::endl;
+        std::cout << "          GIF/APNG等动画图片按媒体时间循环播放（仅yuv方法，其他方法只用第一帧，ffmpeg方法忽略）" << std::endl;
+        std::cout << "  --logo-pos: 可选，logo左上角的位置（像素），默认右上角" << std::endl;
         std::cout << "\n示例:" << std::endl;
         std::cout << "  " << argv[0] << " input.mp4 0.3 dx" << std::endl;
         std::cout << "  " << argv[0] << " input.mp4 0.3 dx \"机密文件\"" << std::endl;
         std::cout << "  " << argv[0] << " input.mp4 0.3 ffmpeg" << std::endl;
+        std::cout << "  " << argv[0] << " input.mp4 0.3 yuv" << std::endl;
+        std::cout << "  " << argv[0] << " input.mp4 0.3 yuv --pipeline 4" << std::endl;
+        std::cout << "  " << argv[0] << " input.mp4 0.3 yuv --segments 0" << std::endl;
+        std::cout << "  " << argv[0] << " input.mp4 0.3 yuv --range 60-360 --range 3600-3660" << std::endl;
+        std::cout << "  " << argv[0] << " input.mp4 0.3 yuv --pipeline 4 --target-fps 60" << std::endl;
+        std::cout << "  " << argv[0] << " input.mp4 0.3 yuv --asset-cache wmcache" << std::endl;
+        std::cout << "  " << argv[0] << " input.mp4 0.3 yuv --overlay \"{pts} 帧{frame}\"" << std::endl;
+        std::cout << "  " << argv[0] << " input.mp4 0.3 yuv \"机密文件\" --logo logo.gif --overlay \"{pts}\"" << std::endl;
         
         std::cout << "\n模式2: 录制桌面并添加水印" << std::endl;
-        std::cout << "用法: " << argv[0] << " --record <输出文件> <时长(秒)> [帧率] [透明度] [文字水印]" << std::endl;
+        std::cout << "用法: " << argv[0] << " --record <输出文件> <时长(秒)> [帧率] [透明度] [文字水印] [--source 来源] [--drop 策略] [--ring 容量] [--vfr] [--max-gap 毫秒] [--replay 秒数] [--replay-mb MB] [--low-latency] [--latency-slo 毫秒] [--adaptive] [--asset-cache 目录] [--scale-filter 滤波器] [--overlay 模板] [--overlay-pos x,y] [--logo 图片] [--logo-pos x,y]" << std::endl;
         std::cout << "参数说明:" << std::endl;
         std::cout << "  输出文件: 录制视频的保存路径" << std::endl;
         std::cout << "  时长: 录制时长（秒）" << std::endl;
         std::cout << "  帧率: 录制帧率，默认30" << std::endl;
         std::cout << "  透明度: 水印透明度 (0.0-1.0)，默认0.3" << std::endl;
-        std::cout << "  文字水印: 可选，如果提供则生成文字水印" << std::endl;
+        std::cout << "  文字水印: 可选，如果提供则生成文字水印（仅Windows）" << std::endl;
         std::cout << "           如果不提供则使用watermark_1.png图片水印" << std::endl;
+        std::cout << "  --source: 可选，画面来源，默认desktop（真实桌面，仅Windows）" << std::endl;
+        std::cout << "    synthetic[:宽x高] - 确定性的合成画面（移动窗口/滚动文字/静止），全速运行用于测量吞吐量" << std::endl;
+        std::cout << "    file:<视频路径>   - 把录好的视频当作桌面回放" << std::endl;
+        std::cout << "  --drop: 可选，采集线程和编码线程之间的帧环满时的策略" << std::endl;
+        std::cout << "    oldest - 丢弃排队中最旧的帧（桌面默认）" << std::endl;
+        std::cout << "    newest - 丢弃刚采集的帧" << std::endl;
+        std::cout << "    block  - 采集线程等待，不丢帧（合成画面/视频回放默认）" << std::endl;
+        std::cout << "  --ring: 可选，帧环容量（帧），默认4，至少3" << std::endl;
+        std::cout << "  --vfr: 可选，可变帧率，画面和鼠标都没有变化时不输出帧，静止的桌面几乎不占CPU和码率" << std::endl;
+        std::cout << "  --max-gap: 可选，可变帧率下两帧之间的最大间隔（毫秒），超过时输出一帧保活，默认1000" << std::endl;
+        std::cout << "  --replay: 可选，即时回放，编码结果只在内存中保留最近N秒，按S键保存为<输出文件名>_replay_<序号>，" << std::endl;
+        std::cout << "            结束时把最后N秒写到输出文件" << std::endl;
+        std::cout << "  --replay-mb: 可选，即时回放缓冲的内存上限（MB），0表示不限，默认512" << std::endl;
+        std::cout << "  --low-latency: 可选，低延迟编码：无B帧、周期帧内刷新、VBV限制单帧大小、条带多线程、每包立即写入" << std::endl;
+        std::cout << "  --latency-slo: 可选，延迟目标（毫秒），统计从开始采集到写入文件超过该时间的帧" << std::endl;
+        std::cout << "  --adaptive: 可选，编码跟不上帧率或帧环积压时自动降低x264分析强度/码率，有富余时换回" << std::endl;
+        std::cout << "  --asset-cache: 可选，水印资源缓存目录（同模式1）" << std::endl;
+        std::cout << "  --scale-filter: 可选，图片水印的缩放滤波器（同模式1）" << std::endl;
+        std::cout << "  --overlay: 可选，逐帧变化的文字（同模式1），{pts}为相对开始录制的时间" << std::endl;
+        std::cout << "  --overlay-pos: 可选，文字左上角的位置（像素），默认16,16" << std::endl;
+        std::cout << "  --logo: 可选，叠加的logo图片（同模式1），动画logo按相对开始录制的时间播放" << std::endl;
+        std::cout << "  --logo-pos: 可选，logo左上角的位置（像素），默认右上角" << std::endl;
         std::cout << "\n示例:" << std::endl;
         std::cout << "  " << argv[0] << " --record output.mp4 10" << std::endl;
         std::cout << "  " << argv[0] << " --record output.mp4 30 30 0.5" << std::endl;
         std::cout << "  " << argv[0] << " --record output.mp4 30 30 0.5 \"机密录屏\"" << std::endl;
+        std::cout << "  " << argv[0] << " --record output.mp4 20 60 0.3 --source synthetic:2560x1440" << std::endl;
+        std::cout << "  " << argv[0] << " --record output.mp4 600 30 0.3 --vfr" << std::endl;
+        std::cout << "  " << argv[0] << " --record incident.mp4 28800 30 0.3 --replay 60" << std::endl;
+        std::cout << "  " << argv[0] << " --record live.ts 60 60 0.3 --low-latency --latency-slo 50" << std::endl;
+        std::cout << "  " << argv[0] << " --record output.mp4 600 60 0.3 --adaptive" << std::endl;
+        std::cout << "  " << argv[0] << " --record output.mp4 60 30 0.3 --overlay \"用户 10086 {time}\"" << std::endl;
+        std::cout << "  " << argv[0] << " --record output.mp4 60 30 0.3 \"机密录屏\" --logo logo.png --logo-pos 16,16" << std::endl;
+        
+        std::cout << "\n模式3: CPU混合内核吞吐量测试" << std::endl;
+        std::cout << "用法: " << argv[0] << " --bench-blend [宽] [高] [迭代次数]" << std::endl;
+        std::cout << "  默认 1920x1080，100 次" << std::endl;
+        
+        std::cout << "\n模式4: 录屏转换吞吐量测试（旧的多遍流程 vs 融合转换内核）" << std::endl;
+        std::cout << "用法: " << argv[0] << " --bench-convert [宽] [高] [迭代次数]" << std::endl;
+        std::cout << "  默认 3840x2160，30 次" << std::endl;
         
         std::cout << "\n输出文件将自动生成在指定位置" << std::endl;
-        LocalFree(wargv);
-        CoUninitialize();
         return 1;
     }
 
-    // 从Unicode参数转换为所需格式
-    // 将wstring转换为UTF-8 string
-    auto WStringToUTF8 = [](const std::wstring& wstr) -> std::string {
-        if (wstr.empty()) return std::string();
-        int size = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
-        std::string result(size - 1, 0);
-        WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, &result[0], size, nullptr, nullptr);
-        return result;
+    // 准备水印：有文字时渲染文字水印（平铺单元，或展开到width x height），否则把watermark_1.png拉伸到width x height。
+    // 指定了资源缓存目录时优先只读映射缓存中已经准备好的水印，未命中时生成后写入缓存
+    auto PrepareWatermark = [](WatermarkRenderer* renderer, const std::string& cacheDir, const std::wstring& text,
+                               int width, int height, bool tiled, ResampleFilter scaleFilter,
+                               WatermarkAsset& asset) -> bool {
+        WatermarkAssetCache cache(cacheDir);
+        WatermarkAssetKey key;
+        key.width = tiled ? 0 : width;
+        key.height = tiled ? 0 : height;
+        key.tiled = tiled;
+
+        if (!text.empty()) {
+#ifdef _WIN32
+            std::cout << "生成文字水印..." << std::endl;
+            key.kind = "text";
+            key.sourceHash = WatermarkAssetCache::HashBytes(text.data(), text.size() * sizeof(wchar_t));
+            key.params = WatermarkRenderer::GetTextStyleKey();
+            bool created = cache.Acquire(key, [&](std::vector<unsigned char>& rgba, int& outWidth, int& outHeight) {
+                if (!tiled) {
+                    outWidth = width;
+                    outHeight = height;
+                    return renderer->CreateTiledWatermark(width, height, text, rgba);
+                }
+                WatermarkTile tile;
+                if (!renderer->CreateWatermarkTile(text, tile)) {
+                    return false;
+                }
+                rgba = std::move(tile.rgba);
+                outWidth = tile.width;
+                outHeight = tile.height;
+                return true;
+            }, asset);
+            if (!created) {
+                std::cerr << "生成文字水印失败" << std::endl;
+                return false;
+            }
+            std::cout << "文字水印生成成功（45度倾斜平铺）" << std::endl;
+            return true;
+#else
+            (void)renderer;
+            std::cerr << "生成文字水印失败：文字渲染只支持Windows" << std::endl;
+            return false;
+#endif
+        }
+
+        // 从PNG文件加载水印（自适应视频尺寸）
+        std::string watermarkPath = "watermark_1.png";
+        std::cout << "从文件加载水印: " << watermarkPath << std::endl;
+        key.kind = "png";
+        key.params = GetWatermarkImageKey(scaleFilter);
+        bool loaded = WatermarkAssetCache::HashFile(watermarkPath, key.sourceHash)
+            && cache.Acquire(key, [&](std::vector<unsigned char>& rgba, int& outWidth, int& outHeight) {
+                outWidth = width;
+                outHeight = height;
+                return LoadWatermarkImage(watermarkPath, width, height, scaleFilter, rgba);
+            }, asset);
+        if (!loaded) {
+            std::cerr << "加载水印失败，请确保 watermark_1.png 存在于程序目录" << std::endl;
+        }
+        return loaded;
     };
-    
-    // 检查是否是录屏模式
+
+    // --logo指定的图片：帧在动画logo层的所有副本之间共享
+    struct LogoImage
+    {
+        std::string path;
+        std::shared_ptr<std::vector<ImageFrame>> frames;
+        int width = 0;
+        int height = 0;
+        int64_t loopMs = 0;
+        int x = 0;
+        int y = 0;
+    };
+
+    // 加载--logo指定的图片（GIF/APNG等多帧图片解码所有帧），没有指定位置时放在右上角
+    auto LoadLogo = [](const std::string& path, const std::wstring& posSpec, int frameWidth, LogoImage& logo) -> bool {
+        logo.path = path;
+        logo.frames = std::make_shared<std::vector<ImageFrame>>();
+        if (!DecodeImageFrames(path, 600, *logo.frames, logo.width, logo.height, logo.loopMs)) {
+            std::cerr << "加载logo失败: " << path << std::endl;
+            return false;
+        }
+        if (posSpec.empty()) {
+            logo.x = std::max(frameWidth - logo.width - 16, 0);
+            logo.y = 16;
+        } else if (swscanf(posSpec.c_str(), L"%d,%d", &logo.x, &logo.y) != 2 || logo.x < 0 || logo.y < 0) {
+            std::cerr << "错误: 无效的logo位置 '" << WStringToUTF8(posSpec) << "'，格式为 x,y" << std::endl;
+            return false;
+        }
+        std::cout << "logo: " << path << " " << logo.width << "x" << logo.height;
+        if (logo.frames->size() > 1) {
+            std::cout << "，" << logo.frames->size() << " 帧，一轮 " << logo.loopMs << " ms";
+        }
+        std::cout << std::endl;
+        return true;
+    };
+
+    // 准备静态水印：文字水印按平铺单元混合（或展开），没有文字也没有logo时使用watermark_1.png；
+    // 只有logo时没有静态水印（asset为空），处理器跳过静态混合。
+    // flatten（DirectX方法，水印纹理拉伸到整帧）时只有一帧的logo与文字水印按顺序合并成一个整幅水印
+    // （经过资源缓存），每层的透明度已经乘进alpha，混合时全局透明度用1.0；
+    // 其他方法的静态logo由AddLayers加成框内静态层，只混合logo的包围盒
+    auto PrepareStaticLayers = [&PrepareWatermark](WatermarkRenderer* renderer, const std::string& cacheDir,
+                                                   const std::wstring& text, const LogoImage& logo,
+                                                   int width, int height, bool tiled, bool flatten, float alpha,
+                                                   ResampleFilter scaleFilter, WatermarkAsset& asset,
+                                                   float& outAlpha, std::vector<std::string>& outNames) -> bool {
+        bool staticLogo = !logo.path.empty() && logo.frames->size() == 1;
+        outNames.clear();
+        outAlpha = alpha;
+        if (!flatten || !staticLogo) {
+            if (!text.empty()) {
+                outNames.push_back("平铺文字");
+            } else if (!logo.path.empty()) {
+                std::cout << "只有logo，没有静态水印" << std::endl;
+                return true;
+            } else {
+                outNames.push_back("watermark_1.png");
+            }
+            return PrepareWatermark(renderer, cacheDir, text, width, height, tiled, scaleFilter, asset);
+        }
+
+        if (!text.empty()) {
+            outNames.push_back("平铺文字");
+        }
+        outNames.push_back("logo");
+
+        WatermarkAssetKey key;
+        key.kind = "layers";
+        key.width = width;
+        key.height = height;
+        key.tiled = false;
+        uint64_t sources[2] = { WatermarkAssetCache::HashBytes(text.data(), text.size() * sizeof(wchar_t)), 0 };
+        if (!WatermarkAssetCache::HashFile(logo.path, sources[1])) {
+            std::cerr << "读取logo失败: " << logo.path << std::endl;
+            return false;
+        }
+        key.sourceHash = WatermarkAssetCache::HashBytes(sources, sizeof(sources));
+#ifdef _WIN32
+        key.params = WatermarkRenderer::GetTextStyleKey();
+#endif
+        key.params += "/logo" + std::to_string(logo.x) + "," +
+                     std::to_string(logo.y) + "/a" + std::to_string(BlendAlpha255(alpha));
+
+        std::cout << "合并静态水印层..." << std::endl;
+        WatermarkAssetCache cache(cacheDir);
+        bool created = cache.Acquire(key, [&](std::vector<unsigned char>& rgba, int& outWidth, int& outHeight) {
+            std::vector<StaticLayer> layers;
+            WatermarkTile tile;
+            if (!text.empty()) {
+#ifdef _WIN32
+                if (!renderer->CreateWatermarkTile(text, tile)) {
+                    return false;
+                }
+#else
+                return false;
+#endif
+                layers.push_back({ "平铺文字", tile.rgba.data(), tile.width, tile.height, 0, 0, true, alpha });
+            }
+            layers.push_back({ "logo", (*logo.frames)[0].rgba.data(), logo.width, logo.height,
+                               logo.x, logo.y, false, alpha });
+            FlattenStaticLayers(layers, width, height, rgba, outWidth, outHeight);
+            return true;
+        }, asset);
+        if (!created) {
+            std::cerr << "合并静态水印层失败" << std::endl;
+            return false;
+        }
+        outAlpha = 1.0f;
+        return true;
+    };
+
+    // 静态水印之上的层：logo（只有一帧时是框内静态层，flatten时已经合并进静态水印；多帧时是动态层）
+    // 和--overlay的逐帧文字（在logo上面），字形图集需要比compositor活得久
+    auto AddLayers = [](WatermarkRenderer* renderer, const LogoImage& logo, bool flatten, float alpha,
+                        const std::wstring& overlayTemplate, int overlayX, int overlayY, int frameHeight,
+                        GlyphAtlas& overlayAtlas, LayerCompositor& compositor) -> bool {
+        bool staticLogo = !logo.path.empty() && logo.frames->size() == 1;
+        if (!logo.path.empty() && !(flatten && staticLogo)) {
+            std::unique_ptr<AnimatedLogoLayer> layer(new AnimatedLogoLayer());
+            if (!layer->Initialize(logo.frames, logo.width, logo.height, logo.loopMs, logo.x, logo.y, alpha)) {
+                return false;
+            }
+            if (staticLogo) {
+                compositor.AddStaticLogo(std::move(layer));
+            } else {
+                compositor.AddDynamicLayer(std::move(layer));
+            }
+        }
+        if (!overlayTemplate.empty()) {
+#ifdef _WIN32
+            // 需要的字符只渲染一次到字形图集，字号随画面高度
+            if (!renderer->CreateGlyphAtlas(TextOverlay::GetCharset(overlayTemplate),
+                                            static_cast<float>(std::max(16, frameHeight / 30)), overlayAtlas)) {
+                std::cerr << "生成字形图集失败" << std::endl;
+                return false;
+            }
+#else
+            (void)renderer;
+            (void)frameHeight;
+            std::cerr << "生成字形图集失败：文字渲染只支持Windows" << std::endl;
+            return false;
+#endif
+            std::unique_ptr<TextOverlay> layer(new TextOverlay());
+            if (!layer->Initialize(overlayTemplate, &overlayAtlas, overlayX, overlayY)) {
+                return false;
+            }
+            compositor.AddDynamicLayer(std::move(layer));
+        }
+        return true;
+    };
+
     std::wstring firstArg = wargv[1];
+
+    // 混合内核吞吐量测试模式
+    if (firstArg == L"--bench-blend") {
+        int benchWidth = (wargc >= 3) ? std::stoi(wargv[2]) : 1920;
+        int benchHeight = (wargc >= 4) ? std::stoi(wargv[3]) : 1080;
+        int iterations = (wargc >= 5) ? std::stoi(wargv[4]) : 100;
+        
+        ReportBlendKernelThroughput(benchWidth, benchHeight, iterations);
+        
+        return 0;
+    }
+
+    if (firstArg == L"--bench-convert") {
+        int benchWidth = (wargc >= 3) ? std::stoi(wargv[2]) : 3840;
+        int benchHeight = (wargc >= 4) ? std::stoi(wargv[3]) : 2160;
+        int iterations = (wargc >= 5) ? std::stoi(wargv[4]) : 30;
+        
+        ReportBgraToYuvThroughput(benchWidth, benchHeight, iterations);
+        
+        return 0;
+    }
+
+    // 检查是否是录屏模式
     if (firstArg == L"--record" || firstArg == L"-r") {
-        // 录屏模式
-        if (wargc < 4) {
+        // 录屏模式：先取出 --source 选项，剩下的参数按位置解析
+        std::string sourceSpec = "desktop";
+        std::string dropSpec;
+        int ringSize = 4;
+        bool vfr = false;
+        int maxGapMs = 1000;
+        int replaySeconds = 0;
+        int replayMegabytes = 512;
+        bool lowLatency = false;
+        int latencySloMs = 0;
+        bool adaptive = false;
+        std::string assetCacheDir;
+        std::string scaleFilterName = "cubic";
+        std::wstring overlayTemplate;
+        std::wstring overlayPos = L"16,16";
+        std::string logoPath;
+        std::wstring logoPos;
+        std::vector<std::wstring> recordArgs;
+        for (int i = 2; i < wargc; i++) {
+            std::wstring arg = wargv[i];
+            if (arg == L"--source" && i + 1 < wargc) {
+                sourceSpec = WStringToUTF8(wargv[++i]);
+            } else if (arg == L"--drop" && i + 1 < wargc) {
+                dropSpec = WStringToUTF8(wargv[++i]);
+            } else if (arg == L"--ring" && i + 1 < wargc) {
+                ringSize = std::stoi(wargv[++i]);
+            } else if (arg == L"--vfr") {
+                vfr = true;
+            } else if (arg == L"--max-gap" && i + 1 < wargc) {
+                maxGapMs = std::stoi(wargv[++i]);
+            } else if (arg == L"--replay" && i + 1 < wargc) {
+                replaySeconds = std::stoi(wargv[++i]);
+            } else if (arg == L"--replay-mb" && i + 1 < wargc) {
+                replayMegabytes = std::stoi(wargv[++i]);
+            } else if (arg == L"--low-latency") {
+                lowLatency = true;
+            } else if (arg == L"--latency-slo" && i + 1 < wargc) {
+                latencySloMs = std::stoi(wargv[++i]);
+            } else if (arg == L"--adaptive") {
+                adaptive = true;
+            } else if (arg == L"--asset-cache" && i + 1 < wargc) {
+                assetCacheDir = WStringToUTF8(wargv[++i]);
+            } else if (arg == L"--scale-filter" && i + 1 < wargc) {
+                scaleFilterName = WStringToUTF8(wargv[++i]);
+            } else if (arg == L"--overlay" && i + 1 < wargc) {
+                overlayTemplate = wargv[++i];
+            } else if (arg == L"--overlay-pos" && i + 1 < wargc) {
+                overlayPos = wargv[++i];
+            } else if (arg == L"--logo" && i + 1 < wargc) {
+                logoPath = WStringToUTF8(wargv[++i]);
+            } else if (arg == L"--logo-pos" && i + 1 < wargc) {
+                logoPos = wargv[++i];
+            } else {
+                recordArgs.push_back(arg);
+            }
+        }
+        if (recordArgs.size() < 2) {
             std::cerr << "错误: 录屏模式需要指定输出文件和时长" << std::endl;
-            std::cerr << "用法: " << argv[0] << " --record <输出文件> <时长(秒)> [帧率] [透明度] [文字水印]" << std::endl;
-            LocalFree(wargv);
-            CoUninitialize();
+            std::cerr << "用法: " << argv[0] << " --record <输出文件> <时长(秒)> [帧率] [透明度] [文字水印] [--source 来源] [--drop 策略] [--ring 容量] [--vfr] [--max-gap 毫秒] [--replay 秒数] [--replay-mb MB] [--low-latency] [--latency-slo 毫秒] [--adaptive] [--asset-cache 目录] [--scale-filter 滤波器] [--overlay 模板] [--overlay-pos x,y] [--logo 图片] [--logo-pos x,y]" << std::endl;
             return 1;
         }
         
-        std::string outputPath = WStringToUTF8(wargv[2]);
-        int duration = std::stoi(wargv[3]);
-        int fps = (wargc >= 5) ? std::stoi(wargv[4]) : 30;
-        float alpha = (wargc >= 6) ? std::stof(wargv[5]) : 0.3f;
-        std::wstring textWatermark = (wargc >= 7) ? wargv[6] : L"";
+        std::string outputPath = WStringToUTF8(recordArgs[0]);
+        int duration = std::stoi(recordArgs[1]);
+        int fps = (recordArgs.size() >= 3) ? std::stoi(recordArgs[2]) : 30;
+        float alpha = (recordArgs.size() >= 4) ? std::stof(recordArgs[3]) : 0.3f;
+        std::wstring textWatermark = (recordArgs.size() >= 5) ? recordArgs[4] : L"";
         
         std::cout << "=== 桌面录制模式 ===" << std::endl;
         std::cout << "输出: " << outputPath << std::endl;
         std::cout << "时长: " << duration << " 秒" << std::endl;
         std::cout << "帧率: " << fps << " fps" << std::endl;
         std::cout << "透明度: " << alpha << std::endl;
+        std::cout << "画面来源: " << sourceSpec << std::endl;
+#ifndef _WIN32
+        // 文字用DirectWrite渲染，其他平台没有文字渲染器，在打开画面来源之前报错
+        if (!textWatermark.empty() || !overlayTemplate.empty()) {
+            std::cerr << "错误: 文字水印和 --overlay 需要DirectWrite，只支持Windows；不指定文字时使用 watermark_1.png" << std::endl;
+            return 1;
+        }
+#endif
         
+#ifdef _WIN32
         // 初始化水印渲染器
         WatermarkRenderer watermarkRenderer;
         if (!watermarkRenderer.Initialize()) {
             std::cerr << "初始化水印渲染器失败" << std::endl;
-            LocalFree(wargv);
-            CoUninitialize();
             return 1;
         }
+        WatermarkRenderer* renderer = &watermarkRenderer;
+#else
+        WatermarkRenderer* renderer = nullptr;
+#endif
         
-        // 获取屏幕尺寸（临时创建DXGICapture来获取）
-        DXGICapture tempCapture;
-        if (!tempCapture.Initialize()) {
-            std::cerr << "无法获取屏幕尺寸" << std::endl;
-            LocalFree(wargv);
-            CoUninitialize();
+        // 创建画面来源，用它的尺寸生成水印
+        // desktop | synthetic[:宽x高] | file:<视频路径>
+        std::unique_ptr<FrameSource> source;
+        if (sourceSpec == "desktop") {
+#ifdef _WIN32
+            source.reset(new DXGIFrameSource());
+#else
+            std::cerr << "错误: 桌面采集（DXGI）只支持Windows，请使用 --source synthetic 或 file:<视频路径>" << std::endl;
+            return 1;
+#endif
+        } else if (sourceSpec == "synthetic" || sourceSpec.compare(0, 10, "synthetic:") == 0) {
+            int syntheticWidth = 1920, syntheticHeight = 1080;
+            if (sourceSpec.size() > 10) {
+                if (sscanf(sourceSpec.c_str() + 10, "%dx%d", &syntheticWidth, &syntheticHeight) != 2) {
+                    std::cerr << "错误: 无效的合成画面尺寸 '" << sourceSpec << "'，格式为 synthetic:宽x高" << std::endl;
+                    return 1;
+                }
+            }
+            source.reset(new SyntheticFrameSource(syntheticWidth, syntheticHeight, fps));
+        } else if (sourceSpec.compare(0, 5, "file:") == 0) {
+            source.reset(new FileFrameSource(sourceSpec.substr(5)));
+        } else {
+            std::cerr << "错误: 无效的画面来源 '" << sourceSpec << "'" << std::endl;
+            std::cerr << "请使用 'desktop'、'synthetic[:宽x高]' 或 'file:<视频路径>'" << std::endl;
+            return 1;
+        }
+        if (!source->Initialize()) {
+            std::cerr << "无法初始化画面来源" << std::endl;
+            return 1;
+        }
+        int screenWidth = source->GetWidth();
+        int screenHeight = source->GetHeight();
+
+        // 默认：实时桌面丢弃最旧帧保证采集节奏，非实时来源阻塞等待以测量完整吞吐量
+        if (dropSpec.empty()) {
+            dropSpec = source->IsRealtime() ? "oldest" : "block";
+        }
+        DropPolicy dropPolicy = DropPolicy::DropOldest;
+        if (dropSpec == "newest") {
+            dropPolicy = DropPolicy::DropNewest;
+        } else if (dropSpec == "block") {
+            dropPolicy = DropPolicy::Block;
+        } else if (dropSpec != "oldest") {
+            std::cerr << "错误: 无效的丢帧策略 '" << dropSpec << "'，请使用 'oldest'、'newest' 或 'block'" << std::endl;
+            return 1;
+        }
+        if (ringSize < 3) {
+            std::cerr << "错误: 帧环容量至少为3" << std::endl;
+            return 1;
+        }
+        if (vfr && maxGapMs <= 0) {
+            std::cerr << "错误: 最大间隔必须大于0毫秒" << std::endl;
+            return 1;
+        }
+        if (replaySeconds < 0 || replayMegabytes < 0) {
+            std::cerr << "错误: 即时回放的时长和内存上限不能为负数" << std::endl;
+            return 1;
+        }
+        if (lowLatency && replaySeconds > 0) {
+            std::cerr << "错误: --low-latency 不能与 --replay 同时使用" << std::endl;
+            return 1;
+        }
+        if (latencySloMs < 0) {
+            std::cerr << "错误: 延迟目标不能为负数" << std::endl;
+            return 1;
+        }
+        ResampleFilter scaleFilter = ResampleFilter::Cubic;
+        if (!ParseResampleFilter(scaleFilterName, scaleFilter)) {
+            std::cerr << "错误: 无效的缩放滤波器 '" << scaleFilterName << "'，请使用 'box'、'bilinear'、'cubic' 或 'lanczos'" << std::endl;
+            return 1;
+        }
+        int overlayX = 0, overlayY = 0;
+        if (swscanf(overlayPos.c_str(), L"%d,%d", &overlayX, &overlayY) != 2 || overlayX < 0 || overlayY < 0) {
+            std::cerr << "错误: 无效的文字位置 '" << WStringToUTF8(overlayPos) << "'，格式为 x,y" << std::endl;
             return 1;
         }
-        int screenWidth = tempCapture.GetWidth();
-        int screenHeight = tempCapture.GetHeight();
-        tempCapture.Cleanup();
         
         std::cout << "屏幕尺寸: " << screenWidth << "x" << screenHeight << std::endl;
         
-        // 生成水印
-        std::vector<unsigned char> watermarkData;
-        if (!textWatermark.empty()) {
-            std::cout << "生成文字水印..." << std::endl;
-            if (!watermarkRenderer.CreateTiledWatermark(screenWidth, screenHeight, 
-                                                       textWatermark, watermarkData)) {
-                std::cerr << "生成文字水印失败" << std::endl;
-                LocalFree(wargv);
-                CoUninitialize();
-                return 1;
-            }
-            std::cout << "文字水印生成成功" << std::endl;
-        } else {
-            std::string watermarkPath = "watermark_1.png";
-            std::cout << "从文件加载水印: " << watermarkPath << std::endl;
-            if (!watermarkRenderer.LoadWatermarkFromPNG(watermarkPath, screenWidth, 
-                                                       screenHeight, watermarkData)) {
-                std::cerr << "加载水印失败，请确保 watermark_1.png 存在于程序目录" << std::endl;
-                LocalFree(wargv);
-                CoUninitialize();
-                return 1;
-            }
+        LogoImage logo;
+        if (!logoPath.empty() && !LoadLogo(logoPath, logoPos, screenWidth, logo)) {
+            return 1;
+        }
+
+        // 生成水印：文字水印只生成一个平铺单元，录制时按单元取模混合；logo不合并进水印
+        WatermarkAsset watermark;
+        float watermarkAlpha = alpha;
+        std::vector<std::string> staticLayers;
+        if (!PrepareStaticLayers(renderer, assetCacheDir, textWatermark, logo, screenWidth, screenHeight,
+                                 !textWatermark.empty(), false, alpha, scaleFilter, watermark, watermarkAlpha, staticLayers)) {
+            return 1;
+        }
+
+        // 静态水印在BGRA->YUV转换中融合混合；静态logo在转换之后只混合变化区域内的包围盒，动态层逐帧绘制
+        LayerCompositor layers;
+        layers.SetStaticLayers(staticLayers, true);
+        GlyphAtlas overlayAtlas;
+        if (!AddLayers(renderer, logo, false, alpha, overlayTemplate, overlayX, overlayY, screenHeight,
+                       overlayAtlas, layers)) {
+            return 1;
         }
         
         // 开始录制
         ScreenRecorder recorder;
+        recorder.SetFrameSource(std::move(source));
+        recorder.SetRingSize(ringSize);
+        recorder.SetDropPolicy(dropPolicy);
+        recorder.SetVariableFrameRate(vfr, maxGapMs);
+        recorder.SetReplay(replaySeconds, replayMegabytes);
+        recorder.SetLowLatency(lowLatency, latencySloMs);
+        recorder.SetAdaptiveSpeed(adaptive);
+        recorder.SetWatermarkTiled(watermark.IsTiled());
+        recorder.SetLayers(layers);
+
+        // 即时回放：控制台按S键保存最近的画面，录制结束后停止检查按键
+        std::atomic<bool> recording(true);
+        std::thread keyThread;
+        if (replaySeconds > 0) {
+#ifdef _WIN32
+            std::cout << "按 S 键保存最近 " << replaySeconds << " 秒" << std::endl;
+#else
+            std::cout << "输入 S 并回车保存最近 " << replaySeconds << " 秒" << std::endl;
+#endif
+            keyThread = std::thread([&recorder, &recording] {
+                while (recording) {
+                    int key = 0;
+                    while (PollKey(key)) {
+                        if (key == 's' || key == 'S') {
+                            recorder.RequestReplaySave();
+                        }
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+            });
+        }
+
         bool success = recorder.RecordScreen(outputPath, duration, fps, 
-                                            watermarkData.data(), 
-                                            screenWidth, screenHeight, alpha);
+                                            watermark.GetRGBA(), 
+                                            watermark.GetWidth(), watermark.GetHeight(), watermarkAlpha);
+        recording = false;
+        if (keyThread.joinable()) {
+            keyThread.join();
+        }
         
         if (!success) {
             std::cerr << "录制失败" << std::endl;
-            LocalFree(wargv);
-            CoUninitialize();
             return 1;
         }
         
         std::cout << "\n录制完成！" << std::endl;
         std::cout << "输出文件: " << outputPath << std::endl;
         
-        LocalFree(wargv);
-        CoUninitialize();
         return 0;
     }
     
-    // 视频文件处理模式
-    std::string inputPath = WStringToUTF8(wargv[1]);
-    float alpha = (wargc >= 3) ? std::stof(wargv[2]) : 0.3f;
-    std::string method = (wargc >= 4) ? WStringToUTF8(wargv[3]) : "dx";
-    std::wstring textWatermark = (wargc >= 5) ? wargv[4] : L"";
+    // 视频文件处理模式：先取出 --xxx 选项，剩下的参数按位置解析
+    int pipelineDepth = 0;
+    bool segmentMode = false;
+    int segmentWorkers = 0;
+    double targetFps = 0.0;
+    std::string assetCacheDir;
+    std::string scaleFilterName = "cubic";
+    std::wstring overlayTemplate;
+    std::wstring overlayPos = L"16,16";
+    std::string logoPath;
+    std::wstring logoPos;
+    std::vector<TimeRange> ranges;
+    std::vector<std::wstring> args;
+    for (int i = 1; i < wargc; i++) {
+        std::wstring arg = wargv[i];
+        if (arg == L"--pipeline" && i + 1 < wargc) {
+            pipelineDepth = std::stoi(wargv[++i]);
+        } else if (arg == L"--segments" && i + 1 < wargc) {
+            segmentMode = true;
+            segmentWorkers = std::stoi(wargv[++i]);
+        } else if (arg == L"--target-fps" && i + 1 < wargc) {
+            targetFps = std::stod(wargv[++i]);
+        } else if (arg == L"--asset-cache" && i + 1 < wargc) {
+            assetCacheDir = WStringToUTF8(wargv[++i]);
+        } else if (arg == L"--scale-filter" && i + 1 < wargc) {
+            scaleFilterName = WStringToUTF8(wargv[++i]);
+        } else if (arg == L"--overlay" && i + 1 < wargc) {
+            overlayTemplate = wargv[++i];
+        } else if (arg == L"--overlay-pos" && i + 1 < wargc) {
+            overlayPos = wargv[++i];
+        } else if (arg == L"--logo" && i + 1 < wargc) {
+            logoPath = WStringToUTF8(wargv[++i]);
+        } else if (arg == L"--logo-pos" && i + 1 < wargc) {
+            logoPos = wargv[++i];
+        } else if (arg == L"--range" && i + 1 < wargc) {
+            // 格式: 开始秒-结束秒，例如 60-360 或 12.5-20
+            std::wstring value = wargv[++i];
+            size_t dash = value.find(L'-', 1);
+            TimeRange range = { 0.0, 0.0 };
+            if (dash != std::wstring::npos) {
+                range.start = std::stod(value.substr(0, dash));
+                range.end = std::stod(value.substr(dash + 1));
+            }
+            if (dash == std::wstring::npos || range.start < 0.0 || range.end <= range.start) {
+                std::cerr << "错误: 无效的区间 '" << WStringToUTF8(value) << "'，格式为 开始秒-结束秒" << std::endl;
+                return 1;
+            }
+            ranges.push_back(range);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
+        std::cerr << "错误: 需要指定输入视频" << std::endl;
+        return 1;
+    }
+
+    std::string inputPath = WStringToUTF8(args[0]);
+    float alpha = (args.size() >= 2) ? std::stof(args[1]) : 0.3f;
+#ifdef _WIN32
+    std::string method = (args.size() >= 3) ? WStringToUTF8(args[2]) : "dx";
+#else
+    std::string method = (args.size() >= 3) ? WStringToUTF8(args[2]) : "yuv";
+#endif
+    std::wstring textWatermark = (args.size() >= 4) ? args[3] : L"";
     
     // 转换为小写
     for (auto& c : method) {
@@ -176,11 +815,25 @@ int main(int argc, char* argv[])
     }
     
     // 验证方法参数
-    if (method != "dx" && method != "ffmpeg") {
+    if (method != "dx" && method != "ffmpeg" && method != "yuv") {
         std::cerr << "错误: 无效的处理方法 '" << method << "'" << std::endl;
-        std::cerr << "请使用 'dx' 或 'ffmpeg'" << std::endl;
-        LocalFree(wargv);
-        CoUninitialize();
+        std::cerr << "请使用 'dx'、'ffmpeg' 或 'yuv'" << std::endl;
+        return 1;
+    }
+#ifndef _WIN32
+    if (method == "dx") {
+        std::cerr << "错误: dx方法需要Direct3D 11，只支持Windows，请使用 'yuv' 或 'ffmpeg'" << std::endl;
+        return 1;
+    }
+#endif
+    ResampleFilter scaleFilter = ResampleFilter::Cubic;
+    if (!ParseResampleFilter(scaleFilterName, scaleFilter)) {
+        std::cerr << "错误: 无效的缩放滤波器 '" << scaleFilterName << "'，请使用 'box'、'bilinear'、'cubic' 或 'lanczos'" << std::endl;
+        return 1;
+    }
+    int overlayX = 0, overlayY = 0;
+    if (swscanf(overlayPos.c_str(), L"%d,%d", &overlayX, &overlayY) != 2 || overlayX < 0 || overlayY < 0) {
+        std::cerr << "错误: 无效的文字位置 '" << WStringToUTF8(overlayPos) << "'，格式为 x,y" << std::endl;
         return 1;
     }
     
@@ -192,10 +845,50 @@ int main(int argc, char* argv[])
     std::string outputPath = outputFilePath.string();
 
     std::cout << "=== 视频水印处理 ===" << std::endl;
-    std::cout << "处理方法: " << (method == "dx" ? "DirectX GPU加速" : "FFmpeg Filter") << std::endl;
+    std::cout << "处理方法: " << (method == "dx" ? "DirectX GPU加速" :
+                                 method == "yuv" ? "YUV域CPU混合" : "FFmpeg Filter") << std::endl;
     std::cout << "输入: " << inputPath << std::endl;
     std::cout << "输出: " << outputPath << std::endl;
     std::cout << "透明度: " << alpha << std::endl;
+    if (pipelineDepth > 0) {
+        std::cout << "流水线队列深度: " << pipelineDepth << std::endl;
+    }
+    if (targetFps > 0.0) {
+        if (method != "yuv" || segmentMode || !ranges.empty()) {
+            std::cout << "注意: --target-fps 只用于yuv方法的整文件处理，忽略" << std::endl;
+        } else {
+            std::cout << "目标帧率: " << targetFps << " fps" << std::endl;
+        }
+    }
+    if (!overlayTemplate.empty() && method != "yuv") {
+        std::cout << "注意: --overlay 只用于yuv方法，忽略" << std::endl;
+        overlayTemplate.clear();
+    }
+    if (!logoPath.empty() && method == "ffmpeg") {
+        std::cout << "注意: --logo 不能用于ffmpeg方法，忽略" << std::endl;
+        logoPath.clear();
+    }
+#ifndef _WIN32
+    // 文字用DirectWrite渲染，其他平台没有文字渲染器，在读取视频之前报错（ffmpeg方法本来就只用图片水印）
+    if ((!textWatermark.empty() && method != "ffmpeg") || !overlayTemplate.empty()) {
+        std::cerr << "错误: 文字水印和 --overlay 需要DirectWrite，只支持Windows；不指定文字时使用 watermark_1.png" << std::endl;
+        return 1;
+    }
+#endif
+    for (const TimeRange& range : ranges) {
+        std::cout << "水印区间: " << range.start << " - " << range.end << " 秒" << std::endl;
+    }
+
+    // 分段模式和区间模式下每个分段由一个处理器实例处理，否则整个文件交给一个实例
+    auto runJob = [&](const SegmentParallelProcessor::SegmentWorkFn& work) {
+        if (!segmentMode && ranges.empty()) {
+            VideoSegment whole = { 0, WholeFileRange(), 0, outputPath, false };
+            return work(whole);
+        }
+        SegmentParallelProcessor segmentProcessor;
+        segmentProcessor.SetRanges(ranges);
+        return segmentProcessor.ProcessVideo(inputPath, outputPath, segmentWorkers, work);
+    };
 
     bool success = false;
     
@@ -204,21 +897,26 @@ int main(int argc, char* argv[])
         std::cout << "\n使用FFmpeg Filter处理..." << std::endl;
         
         std::string watermarkPath = "watermark_1.png";
-        FFmpegWatermarkProcessor processor;
-        
-        success = processor.ProcessVideo(inputPath, outputPath, watermarkPath, alpha);
+        success = runJob([&](const VideoSegment& segment) {
+            FFmpegWatermarkProcessor processor;
+            processor.SetPipelineDepth(pipelineDepth);
+            processor.SetSegment(segment.range);
+            return processor.ProcessVideo(inputPath, segment.path, watermarkPath, alpha);
+        });
         
     } else {
-        // 使用DirectX方法
-        std::cout << "\n使用DirectX GPU加速处理..." << std::endl;
+        // DirectX方法和YUV方法都使用预先生成的RGBA水印
+        if (method == "yuv") {
+            std::cout << "\n使用YUV域CPU混合处理..." << std::endl;
+        } else {
+            std::cout << "\n使用DirectX GPU加速处理..." << std::endl;
+        }
         
         // 获取视频尺寸
         std::cout << "\n正在读取视频信息..." << std::endl;
         int videoWidth = 0, videoHeight = 0;
-        if (!VideoProcessor::GetVideoDimensions(inputPath, videoWidth, videoHeight)) {
+        if (!GetVideoDimensions(inputPath, videoWidth, videoHeight)) {
             std::cerr << "无法获取视频尺寸" << std::endl;
-            LocalFree(wargv);
-            CoUninitialize();
             return 1;
         }
         
@@ -226,61 +924,86 @@ int main(int argc, char* argv[])
 
         // 加载水印
         std::cout << "\n正在加载水印..." << std::endl;
+#ifdef _WIN32
         WatermarkRenderer watermarkRenderer;
         if (!watermarkRenderer.Initialize()) {
             std::cerr << "初始化水印渲染器失败" << std::endl;
-            LocalFree(wargv);
-            CoUninitialize();
             return 1;
         }
+        WatermarkRenderer* renderer = &watermarkRenderer;
+#else
+        WatermarkRenderer* renderer = nullptr;
+#endif
 
-        std::vector<unsigned char> watermarkData;
-        
-        // 根据是否提供文字水印选择加载方式
-        if (!textWatermark.empty()) {
-            // 生成文字水印（45度倾斜平铺）
-            std::cout << "生成文字水印..." << std::endl;
-            
-            // textWatermark已经是wstring，直接使用
-            if (!watermarkRenderer.CreateTiledWatermark(videoWidth, videoHeight, textWatermark, watermarkData)) {
-                std::cerr << "生成文字水印失败" << std::endl;
-                LocalFree(wargv);
-                CoUninitialize();
-                return 1;
-            }
-            std::cout << "文字水印生成成功（45度倾斜平铺）" << std::endl;
-        } else {
-            // 从PNG文件加载水印（自适应视频尺寸）
-            std::string watermarkPath = "watermark_1.png";
-            std::cout << "从文件加载水印: " << watermarkPath << std::endl;
-            
-            if (!watermarkRenderer.LoadWatermarkFromPNG(watermarkPath, videoWidth, videoHeight, watermarkData)) {
-                std::cerr << "加载水印失败，请确保 watermark_1.png 存在于程序目录" << std::endl;
-                LocalFree(wargv);
-                CoUninitialize();
-                return 1;
-            }
+        LogoImage logo;
+        if (!logoPath.empty() && !LoadLogo(logoPath, logoPos, videoWidth, logo)) {
+            return 1;
+        }
+        if (logo.frames && logo.frames->size() > 1 && method != "yuv") {
+            std::cout << "注意: 动画logo只用于yuv方法，只使用第一帧" << std::endl;
+            logo.frames->resize(1);
+        }
+
+        // YUV方法按平铺单元取模混合，logo单独混合自己的包围盒；
+        // DirectX方法的纹理需要整帧尺寸，仍然展开，logo合并进整幅水印
+        bool watermarkTiled = !textWatermark.empty() && method == "yuv";
+        bool flattenLayers = method == "dx";
+        WatermarkAsset watermark;
+        float watermarkAlpha = alpha;
+        std::vector<std::string> staticLayers;
+        if (!PrepareStaticLayers(renderer, assetCacheDir, textWatermark, logo, videoWidth, videoHeight,
+                                 watermarkTiled, flattenLayers, alpha, scaleFilter, watermark, watermarkAlpha, staticLayers)) {
+            return 1;
+        }
+        // 缓存中保存的覆盖索引，各个分段共用，不再各自扫描alpha
+        WatermarkCoverage cachedCoverage;
+        const WatermarkCoverage* coverage = watermark.GetCoverage(cachedCoverage) ? &cachedCoverage : nullptr;
+
+        // 静态logo和动态层的原型，每个分段的处理器复制一份；字形图集和logo帧各个分段共用
+        LayerCompositor layers;
+        layers.SetStaticLayers(staticLayers, false);
+        GlyphAtlas overlayAtlas;
+        if (!AddLayers(renderer, logo, flattenLayers, alpha, overlayTemplate, overlayX, overlayY, videoHeight,
+                       overlayAtlas, layers)) {
+            return 1;
         }
 
         // 处理视频
         std::cout << "\n开始处理视频..." << std::endl;
-        VideoProcessor processor;
-        
-        success = processor.ProcessVideo(inputPath, outputPath, 
-                                    watermarkData.data(), videoWidth, videoHeight, alpha);
+        if (method == "yuv") {
+            success = runJob([&](const VideoSegment& segment) {
+                YuvBlendProcessor processor;
+                processor.SetPipelineDepth(pipelineDepth);
+                processor.SetSegment(segment.range);
+                processor.SetTargetFps(targetFps);
+                processor.SetWatermarkTiled(watermark.IsTiled());
+                processor.SetWatermarkCoverage(coverage);
+                processor.SetLayers(layers);
+                return processor.ProcessVideo(inputPath, segment.path,
+                                              watermark.GetRGBA(), watermark.GetWidth(), watermark.GetHeight(), watermarkAlpha);
+            });
+        } else {
+#ifdef _WIN32
+            // 每个分段创建自己的D3D设备
+            success = runJob([&](const VideoSegment& segment) {
+                VideoProcessor processor;
+                processor.SetPipelineDepth(pipelineDepth);
+                processor.SetSegment(segment.range);
+                processor.SetWatermarkCoverage(coverage);
+                return processor.ProcessVideo(inputPath, segment.path,
+                                              watermark.GetRGBA(), watermark.GetWidth(), watermark.GetHeight(), watermarkAlpha);
+            });
+#endif
+        }
     }
 
     if (!success) {
         std::cerr << "视频处理失败" << std::endl;
-        LocalFree(wargv);
-        CoUninitialize();
         return 1;
     }
 
     std::cout << "\n处理完成！" << std::endl;
     std::cout << "输出文件: " << outputPath << std::endl;
 
-    LocalFree(wargv);
-    CoUninitialize();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "BlendKernels.h"
+#include "TestUtil.h"
+#include <cstring>
+
+// 每个指令集的实现与标量实现比对：所有alpha，0..300个元素（覆盖各个向量宽度的整倍数和行尾），
+// 目标和水印的起点错开0..7字节。缓冲区前后各留一段保护区，实现不能写到[offset, offset + 长度)之外
+static const int kMaxCount = 300;
+static const int kGuard = 64;
+
+// 当前CPU支持的SIMD实现（不含标量）；没有时输出说明，比对自然为空
+static std::vector<const BlendKernels*> GetSimdKernels()
+{
+    std::vector<const BlendKernels*> kernels = GetSupportedBlendKernels();
+    kernels.erase(kernels.begin());
+    for (const BlendKernels* k : kernels) {
+        std::cout << "  比对: " << k->name << std::endl;
+    }
+    if (kernels.empty()) {
+        std::cout << "  当前CPU没有SIMD实现，只有标量实现" << std::endl;
+    }
+    return kernels;
+}
+
+// 目标缓冲区：expected用标量实现、actual用SIMD实现混合，完成后整个缓冲区（包括保护区）必须相同，
+// 保护区必须保持原值
+struct DstPair
+{
+    std::vector<uint8_t> original;
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> actual;
+
+    DstPair(size_t bytes, uint32_t seed) : original(bytes + 2 * kGuard)
+    {
+        FillRandom(original, seed);
+    }
+
+    void Reset()
+    {
+        expected = original;
+        actual = original;
+    }
+
+    bool Matches(int offset, int bytes) const
+    {
+        size_t begin = kGuard + offset;
+        size_t end = begin + bytes;
+        return actual == expected &&
+               std::memcmp(actual.data(), original.data(), begin) == 0 &&
+               std::memcmp(actual.data() + end, original.data() + end, actual.size() - end) == 0;
+    }
+};
+
+TEST_CASE(BlendKernels_Div255)
+{
+    // 定点的div255与四舍五入的 x/255 在整个取值范围内相同
+    for (int x = 0; x <= 255 * 255; x++) {
+        if (BlendDiv255(x) != RoundDiv255(x)) {
+            CHECK_EQ(BlendDiv255(x), RoundDiv255(x));
+            break;
+        }
+    }
+}
+
+TEST_CASE(BlendKernels_ScalarMatchesFormula)
+{
+    // 标量实现本身与 out = round((dst * (255 - a) + wm * a) / 255)、a = round(wm.a * alpha / 255) 一致
+    std::vector<uint8_t> wm(256), wmA(256), dst(256);
+    FillRandom(wm, 1);
+    FillRandom(dst, 2);
+    for (int i = 0; i < 256; i++) {
+        wmA[i] = static_cast<uint8_t>(i);
+    }
+    for (int alpha = 0; alpha <= 255; alpha++) {
+        std::vector<uint8_t> out = dst;
+        BlendPlanarScalar(out.data(), wm.data(), wmA.data(), alpha, 256);
+        for (int i = 0; i < 256; i++) {
+            int a = RoundDiv255(wmA[i] * alpha);
+            int expected = RoundDiv255(dst[i] * (255 - a) + wm[i] * a);
+            if (out[i] != expected) {
+                CHECK_EQ(out[i], expected);
+                return;
+            }
+        }
+    }
+}
+
+TEST_CASE(BlendKernels_Planar)
+{
+    std::vector<const BlendKernels*> kernels = GetSimdKernels();
+    std::vector<uint8_t> wm(kMaxCount + 8), wmA(kMaxCount + 8);
+    FillRandom(wm, 11);
+    FillRandom(wmA, 12);
+    // 透明和不透明的像素也要出现
+    for (size_t i = 0; i < wmA.size(); i += 5) {
+        wmA[i] = i % 10 == 0 ? 0 : 255;
+    }
+    DstPair dst(kMaxCount + 8, 13);
+    for (const BlendKernels* k : kernels) {
+        for (int alpha = 0; alpha <= 255; alpha++) {
+            for (int count = 0; count <= kMaxCount; count++) {
+                int offset = (alpha + count) % 8;
+                int wmOffset = (alpha + 3 * count) % 8;
+                dst.Reset();
+                BlendPlanarScalar(dst.expected.data() + kGuard + offset, wm.data() + wmOffset, wmA.data() + wmOffset, alpha, count);
+                k->planar(dst.actual.data() + kGuard + offset, wm.data() + wmOffset, wmA.data() + wmOffset, alpha, count);
+                if (!dst.Matches(offset, count)) {
+                    std::cerr << k->name << " planar: alpha " << alpha << ", count " << count << std::endl;
+                    CHECK(false);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(BlendKernels_PlanarUniform)
+{
+    std::vector<const BlendKernels*> kernels = GetSimdKernels();
+    std::vector<uint8_t> wm(kMaxCount + 8);
+    FillRandom(wm, 21);
+    DstPair dst(kMaxCount + 8, 22);
+    for (const BlendKernels* k : kernels) {
+        for (int a = 0; a <= 255; a++) {
+            for (int count = 0; count <= kMaxCount; count++) {
+                int offset = (a + count) % 8;
+                int wmOffset = (a + 3 * count) % 8;
+                dst.Reset();
+                BlendPlanarUniformScalar(dst.expected.data() + kGuard + offset, wm.data() + wmOffset, a, count);
+                k->planarUniform(dst.actual.data() + kGuard + offset, wm.data() + wmOffset, a, count);
+                if (!dst.Matches(offset, count)) {
+                    std::cerr << k->name << " planarUniform: a " << a << ", count " << count << std::endl;
+                    CHECK(false);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(BlendKernels_Premul)
+{
+    std::vector<const BlendKernels*> kernels = GetSimdKernels();
+    std::vector<uint8_t> wm(kMaxCount + 8), wmA(kMaxCount + 8);
+    FillRandom(wm, 31);
+    FillRandom(wmA, 32);
+    std::vector<uint16_t> pm(wm.size());
+    std::vector<uint8_t> inv(wm.size());
+    DstPair dst(kMaxCount + 8, 33);
+    for (int alpha = 0; alpha <= 255; alpha++) {
+        // 与BlendPlan相同的预乘格式
+        for (size_t i = 0; i < wm.size(); i++) {
+            int a = BlendDiv255(wmA[i] * alpha);
+            pm[i] = static_cast<uint16_t>(wm[i] * a);
+            inv[i] = static_cast<uint8_t>(255 - a);
+        }
+        for (const BlendKernels* k : kernels) {
+            for (int count = 0; count <= kMaxCount; count++) {
+                int offset = (alpha + count) % 8;
+                int wmOffset = (alpha + 3 * count) % 8;
+                dst.Reset();
+                BlendPremulScalar(dst.expected.data() + kGuard + offset, pm.data() + wmOffset, inv.data() + wmOffset, count);
+                k->premul(dst.actual.data() + kGuard + offset, pm.data() + wmOffset, inv.data() + wmOffset, count);
+                if (!dst.Matches(offset, count)) {
+                    std::cerr << k->name << " premul: alpha " << alpha << ", count " << count << std::endl;
+                    CHECK(false);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(BlendKernels_Packed)
+{
+    // RGB24和4字节像素，count是像素数
+    std::vector<const BlendKernels*> kernels = GetSimdKernels();
+    std::vector<uint8_t> wmRGBA((kMaxCount + 8) * 4);
+    FillRandom(wmRGBA, 41);
+    for (size_t i = 3; i < wmRGBA.size(); i += 20) {
+        wmRGBA[i] = i % 40 == 3 ? 0 : 255;
+    }
+    DstPair dst((kMaxCount + 8) * 4, 42);
+    for (const BlendKernels* k : kernels) {
+        for (int alpha = 0; alpha <= 255; alpha++) {
+            for (int count = 0; count <= kMaxCount; count++) {
+                int offset = (alpha + count) % 8;
+                const uint8_t* wm = wmRGBA.data() + ((alpha + 3 * count) % 8) * 4;
+
+                dst.Reset();
+                BlendPackedRGB24Scalar(dst.expected.data() + kGuard + offset, wm, alpha, count);
+                k->packedRGB24(dst.actual.data() + kGuard + offset, wm, alpha, count);
+                if (!dst.Matches(offset, count * 3)) {
+                    std::cerr << k->name << " packedRGB24: alpha " << alpha << ", count " << count << std::endl;
+                    CHECK(false);
+                    return;
+                }
+
+                dst.Reset();
+                BlendPackedRGBAScalar(dst.expected.data() + kGuard + offset, wm, alpha, count);
+                k->packedRGBA(dst.actual.data() + kGuard + offset, wm, alpha, count);
+                if (!dst.Matches(offset, count * 4)) {
+                    std::cerr << k->name << " packedRGBA: alpha " << alpha << ", count " << count << std::endl;
+                    CHECK(false);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+// 融合转换的输出：两行Y和一行U/V，各自带保护区
+struct YuvOutput
+{
+    DstPair y[2];
+    DstPair u;
+    DstPair v;
+
+    YuvOutput() : y{ DstPair(kMaxCount + 1, 51), DstPair(kMaxCount + 1, 52) }, u(kMaxCount / 2 + 1, 53), v(kMaxCount / 2 + 1, 54) {}
+
+    void Reset()
+    {
+        y[0].Reset();
+        y[1].Reset();
+        u.Reset();
+        v.Reset();
+    }
+
+    void ResetActual()
+    {
+        y[0].actual = y[0].original;
+        y[1].actual = y[1].original;
+        u.actual = u.original;
+        v.actual = v.original;
+    }
+
+    BgraToYuvRows Rows(bool expected, const BgraToYuvRows& input, bool sameRow)
+    {
+        BgraToYuvRows rows = input;
+        for (int r = 0; r < 2; r++) {
+            DstPair& plane = y[sameRow ? 0 : r];
+            rows.y[r] = (expected ? plane.expected : plane.actual).data() + kGuard;
+        }
+        rows.u = (expected ? u.expected : u.actual).data() + kGuard;
+        rows.v = (expected ? v.expected : v.actual).data() + kGuard;
+        return rows;
+    }
+
+    bool Matches(int count) const
+    {
+        int chroma = (count + 1) / 2;
+        return y[0].Matches(0, count) && y[1].Matches(0, count) && u.Matches(0, chroma) && v.Matches(0, chroma);
+    }
+};
+
+TEST_CASE(BlendKernels_BgraToYuv420)
+{
+    // 0..300个像素（包括奇数宽度），每个wmCount；两行都有水印、只有第一行有、都没有，以及高度为奇数时一行与自己配对
+    std::vector<const BlendKernels*> kernels = GetSimdKernels();
+    const int pixels = kMaxCount + 8;
+    std::vector<uint8_t> bgra[2] = { std::vector<uint8_t>(pixels * 4), std::vector<uint8_t>(pixels * 4) };
+    std::vector<uint8_t> wmRGBA(pixels * 4), wmA(pixels * 4);
+    FillRandom(bgra[0], 61);
+    FillRandom(bgra[1], 62);
+    FillRandom(wmRGBA, 63);
+    FillRandom(wmA, 64);
+    std::vector<uint16_t> pm(pixels * 4);
+    std::vector<uint8_t> inv(pixels * 4);
+    YuvOutput out;
+
+    // 各个alpha已经由上面的内核覆盖，这里每种行组合用一个alpha
+    static const int kModeAlpha[4] = { 77, 255, 0, 200 };
+    for (int mode = 0; mode < 4; mode++) {
+        // BGRA元素顺序的预乘计划，第4个元素的系数使目标保持原值（与BlendPlan::BuildPackedBGRA相同）
+        for (int i = 0; i < pixels; i++) {
+            int a = BlendDiv255(wmA[i * 4] * kModeAlpha[mode]);
+            for (int c = 0; c < 3; c++) {
+                pm[i * 4 + c] = static_cast<uint16_t>(wmRGBA[i * 4 + c] * a);
+                inv[i * 4 + c] = static_cast<uint8_t>(255 - a);
+            }
+            pm[i * 4 + 3] = 0;
+            inv[i * 4 + 3] = 255;
+        }
+
+        bool sameRow = mode == 3;
+        BgraToYuvRows input;
+        input.bgra[0] = bgra[0].data();
+        input.bgra[1] = sameRow ? bgra[0].data() : bgra[1].data();
+        input.pm[0] = mode == 2 ? nullptr : pm.data();
+        input.inv[0] = mode == 2 ? nullptr : inv.data();
+        input.pm[1] = mode == 0 || mode == 3 ? pm.data() : nullptr;
+        input.inv[1] = mode == 0 || mode == 3 ? inv.data() : nullptr;
+
+        for (int count = 0; count <= kMaxCount; count++) {
+            for (int wmCount = 0; wmCount <= count; wmCount++) {
+                // 输入从偶数像素错开，行起点不对齐
+                BgraToYuvRows rows = AdvanceBgraToYuvRows(input, 2 * ((count + wmCount) % 4));
+                out.Reset();
+                BlendBgraToYuv420Scalar(out.Rows(true, rows, sameRow), count, wmCount);
+                for (const BlendKernels* k : kernels) {
+                    out.ResetActual();
+                    k->bgraToYuv420(out.Rows(false, rows, sameRow), count, wmCount);
+                    if (!out.Matches(count)) {
+                        std::cerr << k->name << " bgraToYuv420: 模式 " << mode
+                                  << ", count " << count << ", wmCount " << wmCount << std::endl;
+                        CHECK(false);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,295 @@
+#include "CursorCompositor.h"
+#include "TestUtil.h"
+
+// BGRA画面，行尾带填充；填充和第4字节都不能被光标合成改写
+struct TestFrame
+{
+    int width;
+    int height;
+    int linesize;
+    std::vector<uint8_t> data;
+
+    TestFrame(int w, int h, uint32_t seed)
+        : width(w), height(h), linesize(w * 4 + 12), data(static_cast<size_t>(linesize) * h)
+    {
+        FillRandom(data, seed);
+    }
+
+    uint8_t* Pixel(int x, int y) { return data.data() + static_cast<size_t>(y) * linesize + x * 4; }
+};
+
+// 直接按DXGI指针形状的定义合成（不经过预乘格式），作为CursorCompositor的参照
+static void ReferenceComposite(const CursorShape& shape, TestFrame& frame, int x, int y)
+{
+    int rows = shape.type == CursorShapeType::Monochrome ? shape.height / 2 : shape.height;
+    int left = x - shape.hotSpotX;
+    int top = y - shape.hotSpotY;
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < shape.width; col++) {
+            int fx = left + col;
+            int fy = top + row;
+            if (fx < 0 || fy < 0 || fx >= frame.width || fy >= frame.height) {
+                continue;
+            }
+            uint8_t* px = frame.Pixel(fx, fy);
+            if (shape.type == CursorShapeType::Monochrome) {
+                // (屏幕 & AND) ^ XOR
+                const uint8_t* andRow = shape.data + static_cast<size_t>(row) * shape.pitch;
+                const uint8_t* xorRow = andRow + static_cast<size_t>(rows) * shape.pitch;
+                int bit = 0x80 >> (col & 7);
+                uint8_t andMask = (andRow[col >> 3] & bit) ? 0xFF : 0x00;
+                uint8_t xorMask = (xorRow[col >> 3] & bit) ? 0xFF : 0x00;
+                for (int c = 0; c < 3; c++) {
+                    px[c] = static_cast<uint8_t>((px[c] & andMask) ^ xorMask);
+                }
+                continue;
+            }
+            const uint8_t* src = shape.data + static_cast<size_t>(row) * shape.pitch + col * 4;
+            for (int c = 0; c < 3; c++) {
+                if (shape.type == CursorShapeType::Color) {
+                    px[c] = static_cast<uint8_t>(RoundDiv255(px[c] * (255 - src[3]) + src[c] * src[3]));
+                } else if (src[3] == 0) {
+                    px[c] = src[c];
+                } else {
+                    px[c] ^= src[c];
+                }
+            }
+        }
+    }
+}
+
+static CursorShape MakeShape(CursorShapeType type, const std::vector<uint8_t>& data, int width, int height,
+                             int pitch, int hotSpotX, int hotSpotY)
+{
+    return CursorShape{ type, data.data(), data.size(), width, height, pitch, hotSpotX, hotSpotY };
+}
+
+// 单色指针：四种像素（黑、白、透明、反色）按位置轮流出现，pitch比最小值多一个字节
+static std::vector<uint8_t> MakeMonochromeData(int width, int rows, int pitch)
+{
+    std::vector<uint8_t> data(static_cast<size_t>(pitch) * rows * 2, 0);
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < width; col++) {
+            int kind = (row + col) % 4;  // 0黑 1白 2透明 3反色
+            int bit = 0x80 >> (col & 7);
+            if (kind >= 2) {
+                data[static_cast<size_t>(row) * pitch + (col >> 3)] |= bit;
+            }
+            if (kind == 1 || kind == 3) {
+                data[static_cast<size_t>(rows + row) * pitch + (col >> 3)] |= bit;
+            }
+        }
+    }
+    return data;
+}
+
+// 彩色/带掩码彩色指针：随机颜色，第4字节取0、255或（彩色指针）任意的alpha
+static std::vector<uint8_t> MakeColorData(CursorShapeType type, int width, int height, int pitch, uint32_t seed)
+{
+    std::vector<uint8_t> data(static_cast<size_t>(pitch) * height);
+    FillRandom(data, seed);
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            uint8_t* px = data.data() + static_cast<size_t>(row) * pitch + col * 4;
+            int kind = (row * 7 + col) % 5;
+            if (type == CursorShapeType::MaskedColor) {
+                px[3] = kind < 2 ? 0x00 : 0xFF;
+                if (kind == 4) {
+                    px[0] = px[1] = px[2] = 0;  // 与0异或
+                }
+            } else if (kind == 0) {
+                px[3] = 0;
+            } else if (kind == 1) {
+                px[3] = 255;
+            }
+        }
+    }
+    return data;
+}
+
+// 光标在画面内、越过四条边和四个角、完全在画面外的位置（热点在(3, 2)）
+static const int kPositions[][2] = {
+    { 20, 12 }, { 1, 12 }, { 60, 12 }, { 20, 0 }, { 20, 38 },
+    { 0, 0 }, { 63, 0 }, { 0, 39 }, { 63, 39 }, { -50, 12 }, { 20, 100 },
+};
+
+// 在每个位置上比对CursorCompositor与参照的结果（整个缓冲区，包括行尾填充）
+static void CheckAgainstReference(const CursorShape& shape, const BlendKernels* kernels)
+{
+    CursorCompositor compositor(CursorCompositor::kDefaultCacheSize, kernels);
+    CHECK(compositor.SetShape(shape));
+    uint32_t seed = 1;
+    for (const auto& pos : kPositions) {
+        TestFrame actual(64, 40, seed++);
+        TestFrame expected = actual;
+        compositor.Composite(actual.data.data(), actual.linesize, actual.width, actual.height, pos[0], pos[1]);
+        ReferenceComposite(shape, expected, pos[0], pos[1]);
+        CHECK(actual.data == expected.data);
+    }
+}
+
+TEST_CASE(CursorCompositor_MonochromePixels)
+{
+    // 4x1：AND = 0,0,1,1，XOR = 0,1,0,1 依次是黑、白、透明、反色
+    std::vector<uint8_t> data = { 0x30, 0x50 };
+    CursorShape shape = MakeShape(CursorShapeType::Monochrome, data, 4, 2, 1, 0, 0);
+    CursorCompositor compositor;
+    CHECK(compositor.SetShape(shape));
+
+    TestFrame frame(8, 2, 7);
+    for (int x = 0; x < 8; x++) {
+        uint8_t* px = frame.Pixel(x, 0);
+        px[0] = 10; px[1] = 20; px[2] = 30; px[3] = 40;
+    }
+    compositor.Composite(frame.data.data(), frame.linesize, frame.width, frame.height, 2, 0);
+    const uint8_t expected[8][4] = {
+        { 10, 20, 30, 40 }, { 10, 20, 30, 40 },
+        { 0, 0, 0, 40 }, { 255, 255, 255, 40 }, { 10, 20, 30, 40 }, { 245, 235, 225, 40 },
+        { 10, 20, 30, 40 }, { 10, 20, 30, 40 },
+    };
+    for (int x = 0; x < 8; x++) {
+        for (int c = 0; c < 4; c++) {
+            CHECK_EQ(frame.Pixel(x, 0)[c], expected[x][c]);
+        }
+    }
+}
+
+TEST_CASE(CursorCompositor_MaskedColorPixels)
+{
+    // 替换为(1,2,3)；与(0xFF,0x0F,0)异或；与0异或（屏幕不变）
+    std::vector<uint8_t> data = { 1, 2, 3, 0x00, 0xFF, 0x0F, 0x00, 0xFF, 0, 0, 0, 0xFF };
+    CursorShape shape = MakeShape(CursorShapeType::MaskedColor, data, 3, 1, 12, 0, 0);
+    CursorCompositor compositor;
+    CHECK(compositor.SetShape(shape));
+
+    TestFrame frame(3, 1, 7);
+    for (int x = 0; x < 3; x++) {
+        uint8_t* px = frame.Pixel(x, 0);
+        px[0] = 0x55; px[1] = 0xAA; px[2] = 0x0F; px[3] = 0x80;
+    }
+    compositor.Composite(frame.data.data(), frame.linesize, frame.width, frame.height, 0, 0);
+    const uint8_t expected[3][4] = { { 1, 2, 3, 0x80 }, { 0xAA, 0xA5, 0x0F, 0x80 }, { 0x55, 0xAA, 0x0F, 0x80 } };
+    for (int x = 0; x < 3; x++) {
+        for (int c = 0; c < 4; c++) {
+            CHECK_EQ(frame.Pixel(x, 0)[c], expected[x][c]);
+        }
+    }
+}
+
+TEST_CASE(CursorCompositor_ColorPixels)
+{
+    // 不透明替换；透明不变；a = 128时 round((100 * 127 + 200 * 128) / 255) = 150
+    std::vector<uint8_t> data = { 9, 8, 7, 255, 9, 8, 7, 0, 200, 200, 200, 128 };
+    CursorShape shape = MakeShape(CursorShapeType::Color, data, 3, 1, 12, 0, 0);
+    CursorCompositor compositor;
+    CHECK(compositor.SetShape(shape));
+
+    TestFrame frame(3, 1, 7);
+    for (int x = 0; x < 3; x++) {
+        uint8_t* px = frame.Pixel(x, 0);
+        px[0] = px[1] = px[2] = 100;
+        px[3] = 0x33;
+    }
+    compositor.Composite(frame.data.data(), frame.linesize, frame.width, frame.height, 0, 0);
+    const uint8_t expected[3][4] = { { 9, 8, 7, 0x33 }, { 100, 100, 100, 0x33 }, { 150, 150, 150, 0x33 } };
+    for (int x = 0; x < 3; x++) {
+        for (int c = 0; c < 4; c++) {
+            CHECK_EQ(frame.Pixel(x, 0)[c], expected[x][c]);
+        }
+    }
+}
+
+TEST_CASE(CursorCompositor_ClipAtEdges)
+{
+    // 三种形状在画面内、越过四条边和四个角时的每个像素
+    std::vector<uint8_t> mono = MakeMonochromeData(13, 9, 3);
+    std::vector<uint8_t> masked = MakeColorData(CursorShapeType::MaskedColor, 11, 7, 11 * 4 + 8, 21);
+    std::vector<uint8_t> color = MakeColorData(CursorShapeType::Color, 11, 7, 11 * 4, 22);
+    CheckAgainstReference(MakeShape(CursorShapeType::Monochrome, mono, 13, 18, 3, 3, 2), nullptr);
+    CheckAgainstReference(MakeShape(CursorShapeType::MaskedColor, masked, 11, 7, 11 * 4 + 8, 3, 2), nullptr);
+    CheckAgainstReference(MakeShape(CursorShapeType::Color, color, 11, 7, 11 * 4, 3, 2), nullptr);
+
+    CursorCompositor compositor;
+    CHECK(compositor.SetShape(MakeShape(CursorShapeType::Color, color, 11, 7, 11 * 4, 3, 2)));
+    FrameRect rect;
+    CHECK(compositor.GetRect(1, 0, rect));
+    CHECK_EQ(rect.x, -2);
+    CHECK_EQ(rect.y, -2);
+    CHECK_EQ(rect.width, 11);
+    CHECK_EQ(rect.height, 7);
+}
+
+TEST_CASE(CursorCompositor_CacheLru)
+{
+    std::vector<uint8_t> a = MakeColorData(CursorShapeType::Color, 8, 8, 32, 1);
+    std::vector<uint8_t> b = MakeColorData(CursorShapeType::Color, 8, 8, 32, 2);
+    std::vector<uint8_t> c = MakeColorData(CursorShapeType::Color, 8, 8, 32, 3);
+    std::vector<uint8_t> aCopy = a;
+    CursorShape shapeA = MakeShape(CursorShapeType::Color, a, 8, 8, 32, 0, 0);
+    CursorShape shapeB = MakeShape(CursorShapeType::Color, b, 8, 8, 32, 0, 0);
+    CursorShape shapeC = MakeShape(CursorShapeType::Color, c, 8, 8, 32, 0, 0);
+    CursorShape shapeAHot = MakeShape(CursorShapeType::Color, a, 8, 8, 32, 1, 1);
+
+    CursorCompositor compositor(2);
+    CHECK(!compositor.HasShape());
+    CHECK(compositor.SetShape(shapeA));   // 未命中
+    CHECK(compositor.SetShape(shapeB));   // 未命中
+    CHECK(compositor.SetShape(MakeShape(CursorShapeType::Color, aCopy, 8, 8, 32, 0, 0)));  // 内容相同，命中
+    CHECK(compositor.SetShape(shapeC));   // 未命中，替换最久没用的B
+    CHECK(compositor.SetShape(shapeA));   // 命中
+    CHECK(compositor.SetShape(shapeB));   // 未命中，替换C
+    CHECK(compositor.SetShape(shapeAHot));  // 热点不同是另一个形状，未命中，替换A
+    CursorCacheStats stats = compositor.GetStats();
+    CHECK_EQ(stats.hits, 2);
+    CHECK_EQ(stats.misses, 5);
+    CHECK_EQ(stats.cached, 2);
+
+    // 不合法的形状：返回false，统计和当前形状都不变
+    CursorShape invalid = shapeA;
+    invalid.size = 10;
+    CHECK(!compositor.SetShape(invalid));
+    invalid = shapeA;
+    invalid.type = CursorShapeType::Monochrome;
+    invalid.height = 7;
+    CHECK(!compositor.SetShape(invalid));
+    stats = compositor.GetStats();
+    CHECK_EQ(stats.hits, 2);
+    CHECK_EQ(stats.misses, 5);
+    FrameRect rect;
+    CHECK(compositor.GetRect(10, 10, rect));
+    CHECK_EQ(rect.x, 9);
+}
+
+TEST_CASE(CursorCompositor_SimdMatchesScalar)
+{
+    // 宽度37：每行的元素数不是任何向量宽度的倍数，裁剪后起点也不对齐
+    std::vector<uint8_t> mono = MakeMonochromeData(37, 9, 5);
+    std::vector<uint8_t> masked = MakeColorData(CursorShapeType::MaskedColor, 37, 9, 37 * 4, 31);
+    std::vector<uint8_t> color = MakeColorData(CursorShapeType::Color, 37, 9, 37 * 4, 32);
+    CursorShape shapes[] = {
+        MakeShape(CursorShapeType::Monochrome, mono, 37, 18, 5, 3, 2),
+        MakeShape(CursorShapeType::MaskedColor, masked, 37, 9, 37 * 4, 3, 2),
+        MakeShape(CursorShapeType::Color, color, 37, 9, 37 * 4, 3, 2),
+    };
+
+    std::vector<const BlendKernels*> kernels = GetSupportedBlendKernels();
+    for (const BlendKernels* k : kernels) {
+        std::cout << "  光标合成: " << k->name << std::endl;
+        for (const CursorShape& shape : shapes) {
+            CheckAgainstReference(shape, k);
+
+            CursorCompositor scalar(CursorCompositor::kDefaultCacheSize, kernels[0]);
+            CursorCompositor simd(CursorCompositor::kDefaultCacheSize, k);
+            CHECK(scalar.SetShape(shape));
+            CHECK(simd.SetShape(shape));
+            uint32_t seed = 100;
+            for (const auto& pos : kPositions) {
+                TestFrame expected(64, 40, seed++);
+                TestFrame actual = expected;
+                scalar.Composite(expected.data.data(), expected.linesize, expected.width, expected.height, pos[0], pos[1]);
+                simd.Composite(actual.data.data(), actual.linesize, actual.width, actual.height, pos[0], pos[1]);
+                CHECK(actual.data == expected.data);
+            }
+        }
+    }
+}
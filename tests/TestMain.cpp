@@ -0,0 +1,36 @@
+#include "TestUtil.h"
+#include <cstring>
+
+std::vector<TestCase>& TestRegistry()
+{
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+int& TestFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* prefix = argc >= 2 ? argv[1] : "";
+    int run = 0;
+    for (const TestCase& test : TestRegistry()) {
+        if (std::strncmp(test.name, prefix, std::strlen(prefix)) != 0) {
+            continue;
+        }
+        int before = TestFailures();
+        test.fn();
+        std::cout << (TestFailures() == before ? "[通过] " : "[失败] ") << test.name << std::endl;
+        run++;
+    }
+
+    if (run == 0) {
+        std::cerr << "没有匹配的测试: " << prefix << std::endl;
+        return 1;
+    }
+    std::cout << run << " 个测试, " << TestFailures() << " 处检查失败" << std::endl;
+    return TestFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// 最小的测试框架：每个测试文件用TEST_CASE注册测试，CHECK失败时输出位置并计数，
+// 不中断当前测试。测试名按"模块_内容"命名，命令行参数是名字前缀，只运行匹配的测试
+typedef void (*TestFn)();
+
+struct TestCase
+{
+    const char* name;
+    TestFn fn;
+};
+
+std::vector<TestCase>& TestRegistry();
+int& TestFailures();
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, TestFn fn) { TestRegistry().push_back({ name, fn }); }
+};
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            TestFailures()++; \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": 检查失败: " #cond << std::endl; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        auto actualValue = (actual); \
+        auto expectedValue = (expected); \
+        if (!(actualValue == expectedValue)) { \
+            TestFailures()++; \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": 检查失败: " #actual " == " #expected \
+                      << " (" << +actualValue << " != " << +expectedValue << ")" << std::endl; \
+        } \
+    } while (0)
+
+// 固定种子的伪随机字节，每次运行的输入相同
+inline void FillRandom(std::vector<uint8_t>& buffer, uint32_t seed)
+{
+    for (size_t i = 0; i < buffer.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buffer[i] = static_cast<uint8_t>(seed >> 24);
+    }
+}
+
+// 四舍五入的 x/255，与混合内核的定点公式相同
+inline int RoundDiv255(int x)
+{
+    return (x + 127) / 255;
+}
+
+#endif